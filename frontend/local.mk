@@ -36,6 +36,7 @@ DISTCLEANFILES += $(BUILT_SOURCES)
 LDADD = lib/libttfautohint.la \
         lib/libsds.la \
         lib/libnumberset.la \
+        lib/libtamemory.la \
         gnulib/src/libgnu.la \
         $(LTLIBINTL) \
         $(LTLIBTHREAD) \
@@ -46,7 +47,9 @@ bin_PROGRAMS = frontend/ttfautohint
 frontend_ttfautohint_SOURCES = \
   frontend/info.cpp \
   frontend/info.h \
-  frontend/main.cpp
+  frontend/main.cpp \
+  frontend/server.cpp \
+  frontend/server.h
 frontend_ttfautohint_CPPFLAGS = $(AM_CPPFLAGS) \
                                 $(FREETYPE_CPPFLAGS)
 frontend_ttfautohint_LDADD = $(LDADD)
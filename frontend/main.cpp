@@ -25,10 +25,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <errno.h>
 #include <string.h>
 #include <getopt.h>
 #include <limits.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <locale.h>
 
@@ -43,6 +45,7 @@
 #  include FT_FREETYPE_H
 #  include FT_TRUETYPE_TABLES_H // for option `-T'
 #  include "info.h"
+#  include "server.h"
 #endif
 
 #include <ttfautohint.h>
@@ -157,6 +160,7 @@ progress(long curr_idx,
 typedef struct Error_Data_
 {
   const char* control_name;
+  const char* glyph_subset_string;
 } Error_Data;
 
 
@@ -199,6 +203,21 @@ err(TA_Error error,
   else if (error == TA_Err_Missing_Symbol_CMap)
     fprintf(stderr,
             "No symbol character map.\n");
+  else if (error == TA_Err_Invalid_Previous_Font)
+    fprintf(stderr,
+            "The previous font is not a valid font"
+              " created by ttfautohint with a `TTFA' table.\n"
+            "Use command line option `-t' to create such a table.\n");
+  else if (error == TA_Err_Memory_Limit)
+    fprintf(stderr,
+            "The memory limit has been exceeded.\n"
+            "Use option `--memory-limit' to increase it.\n");
+  else if (error == TA_Err_Previous_Font_Mismatch)
+    fprintf(stderr,
+            "The previous font doesn't match the input font"
+              " or the current parameters.\n"
+            "Please process the whole font"
+              " without option `--glyph-subset'.\n");
   else if (error == TA_Err_Missing_Glyph)
     fprintf(stderr,
             "No glyph for a standard character"
@@ -219,8 +238,11 @@ err(TA_Error error,
     else if (error >= 0x100 && error < 0x200)
     {
       fprintf(stderr, "An error with code 0x%03x occurred"
-                        " while parsing the argument of option `-X'",
-                      error);
+                        " while parsing the argument of option `%s'",
+                      error,
+                      (errline && errline == data->glyph_subset_string)
+                        ? "--glyph-subset"
+                        : "-X");
       fprintf(stderr, errline ? ":\n" : ".\n");
 
       if (errline)
@@ -304,6 +326,8 @@ show_help(bool
 "Options:\n"
 #ifndef BUILD_GUI
 "      --debug                print debugging information\n"
+"      --debug-trace=FILE     write debugging information in a compact\n"
+"                             binary format to FILE (implies `--debug')\n"
 #endif
 "  -a, --stem-width-mode=S    select stem width mode for grayscale, GDI\n"
 "                             ClearType, and DW ClearType, where S is a\n"
@@ -318,6 +342,14 @@ show_help(bool
 "                             in the `name' table\n"
 "  -G, --hinting-limit=N      switch off hinting above this PPEM value\n"
 "                             (default: %d); value 0 means no limit\n"
+#ifndef BUILD_GUI
+"      --glyph-subset=STRING  only hint the glyphs with indices given in\n"
+"                             the comma-separated list STRING, taking the\n"
+"                             bytecode of all other glyphs from the font\n"
+"                             given with option `--previous'\n"
+"      --hinting-threads=N    use N threads to hint a single glyph\n"
+"                             (default: 1)\n"
+#endif
 "  -h, --help                 display this help and exit\n"
 "  -H, --fallback-stem-width=N\n"
 "                             set fallback stem width\n"
@@ -332,10 +364,22 @@ show_help(bool
 "                             (default: %d)\n"
 #ifndef BUILD_GUI
 "  -m, --control-file=FILE    get control instructions from FILE\n"
+"      --memory-limit=N       abort if hinting needs more than N MiB\n"
+"                             of memory (default: 0, no limit)\n"
+"      --memory-stats         show memory usage statistics\n"
 #endif
 "  -n, --no-info              don't add ttfautohint info\n"
 "                             to the version string(s) in the `name' table\n"
-"  -p, --adjust-subglyphs     handle subglyph adjustments in exotic fonts\n",
+"  -p, --adjust-subglyphs     handle subglyph adjustments in exotic fonts\n"
+#ifndef BUILD_GUI
+"      --previous=FILE        font previously created by ttfautohint\n"
+"                             from IN-FILE (needs `--glyph-subset')\n"
+"      --profile=FILE         write a per-glyph cost report in CSV format\n"
+"                             to FILE\n"
+"      --profile-top=N        list the N slowest glyphs at the end of\n"
+"                             the report (default: 10)\n"
+#endif
+,
           TA_HINTING_LIMIT, TA_HINTING_RANGE_MIN);
   fprintf(handle,
 "  -r, --hinting-range-max=N  the maximum PPEM value for hint sets\n"
@@ -345,12 +389,26 @@ show_help(bool
 #endif
 "  -s, --symbol               input is symbol font\n"
 "  -S, --fallback-scaling     use fallback scaling, not hinting\n"
+#ifdef HAVE_SERVER
+"      --server=ADDRESS       run as a server, reading requests from the\n"
+"                             Unix domain socket ADDRESS, or from standard\n"
+"                             input if ADDRESS is `-'\n"
+"      --server-timeout=N     abort server requests that take longer than\n"
+"                             N milliseconds (default: 0, no limit)\n"
+"      --server-workers=N     process N server requests in parallel\n"
+"                             (default: number of processors)\n"
+#endif
 "  -t, --ttfa-table           add TTFA information table\n"
 #ifndef BUILD_GUI
 "  -T, --ttfa-info            display TTFA table in IN-FILE and exit\n"
 #endif
 "  -v, --verbose              show progress information\n"
 "  -V, --version              print version information and exit\n"
+#ifdef BUILD_GUI
+"      --watch-delay=N        wait N milliseconds after the last modification\n"
+"                             of a watched input file before re-running\n"
+"                             (default: 1000)\n"
+#endif
 "  -W, --windows-compatibility\n"
 "                             add blue zones for `usWinAscent' and\n"
 "                             `usWinDescent' to avoid clipping\n"
@@ -696,9 +754,104 @@ Exit:
 
   exit(EXIT_SUCCESS);
 }
+
+
+static void
+show_memory_stats(const TA_Memory_Stats* stats)
+{
+  static const char* phase_names[TA_MEMORY_PHASE_MAX] =
+  {
+    "load", "globals", "glyphs", "output"
+  };
+
+  fprintf(stderr,
+          "memory usage: peak %lu bytes, %lu allocations, %lu frees\n",
+          (unsigned long)stats->peak_bytes,
+          stats->num_allocs,
+          stats->num_frees);
+
+  for (int i = 0; i < TA_MEMORY_PHASE_MAX; i++)
+  {
+    const TA_Memory_Phase_Stats* phase = &stats->phases[i];
+
+    fprintf(stderr,
+            "  %-8s peak %10lu bytes, %10lu bytes allocated"
+              " in %lu allocations\n",
+            phase_names[i],
+            (unsigned long)phase->peak_bytes,
+            (unsigned long)phase->total_bytes,
+            phase->num_allocs);
+  }
+
+  if (stats->cur_bytes)
+    fprintf(stderr, "  %lu bytes not deallocated\n",
+            (unsigned long)stats->cur_bytes);
+}
 #endif
 
 
+// Convert the argument `arg' of option `--name' to an integer in the
+// range [min;max]; exit with an error message if this is not possible.
+
+static long
+parse_number(const char* name,
+             const char* arg,
+             long min,
+             long max)
+{
+  char* endptr;
+  errno = 0;
+
+  long val = strtol(arg, &endptr, 10);
+  if (endptr == arg || *endptr != '\0')
+  {
+    fprintf(stderr, "Option `--%s' needs an integer argument, not `%s'\n",
+                    name, arg);
+    exit(EXIT_FAILURE);
+  }
+  if (errno == ERANGE || val < min || val > max)
+  {
+    fprintf(stderr, "Value %s of option `--%s' is out of range [%ld;%ld]\n",
+                    arg, name, min, max);
+    exit(EXIT_FAILURE);
+  }
+
+  return val;
+}
+
+
+static unsigned long long
+parse_unsigned(const char* name,
+               const char* arg,
+               unsigned long long max)
+{
+  char* endptr;
+  errno = 0;
+
+  // `strtoull' silently negates values with a leading minus sign
+  const char* p = arg;
+  while (isspace((unsigned char)*p))
+    p++;
+
+  unsigned long long val = strtoull(arg, &endptr, 10);
+  if (*p == '-' || endptr == arg || *endptr != '\0')
+  {
+    fprintf(stderr, "Option `--%s' needs a non-negative integer argument,"
+                    " not `%s'\n",
+                    name, arg);
+    exit(EXIT_FAILURE);
+  }
+  if (errno == ERANGE || val > max)
+  {
+    fprintf(stderr, "Value %s of option `--%s' is out of range [0;%llu]\n",
+                    arg, name, max);
+    exit(EXIT_FAILURE);
+  }
+
+  return val;
+}
+
+
 int
 main(int argc,
      char** argv)
@@ -748,8 +901,11 @@ main(int argc,
 
   bool dehint = false;
 
-#ifndef BUILD_GUI
+#ifdef BUILD_GUI
+  int watch_delay = 1000;
+#else
   bool debug = false;
+  const char* debug_trace_name = NULL;
 
   TA_Progress_Func progress_func = NULL;
   TA_Error_Func err_func = err;
@@ -760,9 +916,26 @@ main(int argc,
   const char* reference_name = NULL;
   int reference_index = 0;
 
+  const char* glyph_subset_string = NULL;
+  const char* previous_name = NULL;
+
+  int hinting_threads = 1;
+
+  const char* profile_name = NULL;
+  int profile_top = 10;
+
+  size_t memory_limit = 0; // in MiB
+  bool memory_stats = false;
+
   unsigned long long epoch = ULLONG_MAX;
 #endif
 
+#ifdef HAVE_SERVER
+  const char* server_address = NULL;
+  int server_timeout = 0;
+  int server_workers = 0;
+#endif
+
   // For real numbers (both parsing and displaying) we only use `.' as the
   // decimal separator; similarly, we don't want localized formats like a
   // thousands separator for any number.
@@ -783,7 +956,19 @@ main(int argc,
     {
       PASS_THROUGH = CHAR_MAX + 1,
       HELP_ALL_OPTION,
-      DEBUG_OPTION
+      DEBUG_OPTION,
+      DEBUG_TRACE_OPTION,
+      GLYPH_SUBSET_OPTION,
+      HINTING_THREADS_OPTION,
+      MEMORY_LIMIT_OPTION,
+      MEMORY_STATS_OPTION,
+      PREVIOUS_OPTION,
+      PROFILE_OPTION,
+      PROFILE_TOP_OPTION,
+      SERVER_OPTION,
+      SERVER_TIMEOUT_OPTION,
+      SERVER_WORKERS_OPTION,
+      WATCH_DELAY_OPTION
     };
 
     static struct option long_options[] =
@@ -799,6 +984,7 @@ main(int argc,
 #ifndef BUILD_GUI
       {"control-file", required_argument, NULL, 'm'},
       {"debug", no_argument, NULL, DEBUG_OPTION},
+      {"debug-trace", required_argument, NULL, DEBUG_TRACE_OPTION},
 #endif
       {"default-script", required_argument, NULL, 'D'},
       {"dehint", no_argument, NULL, 'd'},
@@ -807,16 +993,34 @@ main(int argc,
       {"fallback-script", required_argument, NULL, 'f'},
       {"fallback-stem-width", required_argument, NULL, 'H'},
       {"family-suffix", required_argument, NULL, 'F'},
+#ifndef BUILD_GUI
+      {"glyph-subset", required_argument, NULL, GLYPH_SUBSET_OPTION},
+#endif
       {"hinting-limit", required_argument, NULL, 'G'},
       {"hinting-range-max", required_argument, NULL, 'r'},
       {"hinting-range-min", required_argument, NULL, 'l'},
+#ifndef BUILD_GUI
+      {"hinting-threads", required_argument, NULL, HINTING_THREADS_OPTION},
+#endif
       {"ignore-restrictions", no_argument, NULL, 'i'},
       {"increase-x-height", required_argument, NULL, 'x'},
       {"no-info", no_argument, NULL, 'n'},
       {"pre-hinting", no_argument, NULL, 'p'},
+#ifndef BUILD_GUI
+      {"memory-limit", required_argument, NULL, MEMORY_LIMIT_OPTION},
+      {"memory-stats", no_argument, NULL, MEMORY_STATS_OPTION},
+      {"previous", required_argument, NULL, PREVIOUS_OPTION},
+      {"profile", required_argument, NULL, PROFILE_OPTION},
+      {"profile-top", required_argument, NULL, PROFILE_TOP_OPTION},
+#endif
 #ifndef BUILD_GUI
       {"reference", required_argument, NULL, 'R'},
       {"reference-index", required_argument, NULL, 'Z'},
+#endif
+#ifdef HAVE_SERVER
+      {"server", required_argument, NULL, SERVER_OPTION},
+      {"server-timeout", required_argument, NULL, SERVER_TIMEOUT_OPTION},
+      {"server-workers", required_argument, NULL, SERVER_WORKERS_OPTION},
 #endif
       {"stem-width-mode", required_argument, NULL, 'a'},
       {"strong-stem-width", required_argument, NULL, 'w'},
@@ -827,6 +1031,9 @@ main(int argc,
 #endif
       {"verbose", no_argument, NULL, 'v'},
       {"version", no_argument, NULL, 'V'},
+#ifdef BUILD_GUI
+      {"watch-delay", required_argument, NULL, WATCH_DELAY_OPTION},
+#endif
       {"windows-compatibility", no_argument, NULL, 'W'},
       {"x-height-snapping-exceptions", required_argument, NULL, 'X'},
 
@@ -1082,6 +1289,57 @@ main(int argc,
     case DEBUG_OPTION:
       debug = true;
       break;
+
+    case DEBUG_TRACE_OPTION:
+      debug_trace_name = optarg;
+      break;
+
+    case GLYPH_SUBSET_OPTION:
+      glyph_subset_string = optarg;
+      break;
+
+    case HINTING_THREADS_OPTION:
+      hinting_threads = (int)parse_number("hinting-threads", optarg,
+                                           1, 1024);
+      break;
+
+    case MEMORY_LIMIT_OPTION:
+      memory_limit = (size_t)parse_unsigned("memory-limit", optarg,
+                                            SIZE_MAX >> 20);
+      break;
+
+    case MEMORY_STATS_OPTION:
+      memory_stats = true;
+      break;
+
+    case PREVIOUS_OPTION:
+      previous_name = optarg;
+      break;
+
+    case PROFILE_OPTION:
+      profile_name = optarg;
+      break;
+
+    case PROFILE_TOP_OPTION:
+      profile_top = (int)parse_number("profile-top", optarg,
+                                       0, INT_MAX);
+      break;
+#endif
+
+#ifdef HAVE_SERVER
+    case SERVER_OPTION:
+      server_address = optarg;
+      break;
+
+    case SERVER_TIMEOUT_OPTION:
+      server_timeout = (int)parse_number("server-timeout", optarg,
+                                          0, INT_MAX);
+      break;
+
+    case SERVER_WORKERS_OPTION:
+      server_workers = (int)parse_number("server-workers", optarg,
+                                          0, 1024);
+      break;
 #endif
 
 #ifdef BUILD_GUI
@@ -1090,6 +1348,10 @@ main(int argc,
       show_help(true, false);
 #endif
       break;
+
+    case WATCH_DELAY_OPTION:
+      watch_delay = (int)parse_number("watch-delay", optarg, 0, INT_MAX);
+      break;
 #endif
 
     case PASS_THROUGH:
@@ -1137,6 +1399,7 @@ main(int argc,
     have_increase_x_height = false;
     have_x_height_snapping_exceptions_string = false;
     debug = false;
+    debug_trace_name = NULL;
   }
 #endif
 
@@ -1309,6 +1572,74 @@ main(int argc,
 
   int num_args = argc - optind;
 
+#ifdef HAVE_SERVER
+  if (server_address)
+  {
+    if (num_args > 0)
+    {
+      fprintf(stderr, "Option `--server' doesn't take file arguments\n");
+      exit(EXIT_FAILURE);
+    }
+    if (control_name
+        || reference_name
+        || glyph_subset_string
+        || previous_name
+        || profile_name
+        || show_TTFA_info
+        || debug
+        || debug_trace_name
+        || memory_stats)
+    {
+      fprintf(stderr, "Options `-m', `-R', `-T', `--debug', `--debug-trace',"
+                      " `--glyph-subset',\n"
+                      "`--memory-stats', `--previous', and `--profile'"
+                      " can't be used together with option `--server'\n");
+      exit(EXIT_FAILURE);
+    }
+
+    Hint_Options hint_options;
+
+    hint_options.hinting_range_min = hinting_range_min;
+    hint_options.hinting_range_max = hinting_range_max;
+    hint_options.hinting_limit = hinting_limit;
+
+    hint_options.gray_stem_width_mode = gray_stem_width_mode;
+    hint_options.gdi_cleartype_stem_width_mode =
+      gdi_cleartype_stem_width_mode;
+    hint_options.dw_cleartype_stem_width_mode = dw_cleartype_stem_width_mode;
+
+    hint_options.increase_x_height = increase_x_height;
+    hint_options.x_height_snapping_exceptions_string =
+      x_height_snapping_exceptions_string;
+    hint_options.fallback_stem_width = fallback_stem_width;
+
+    hint_options.ignore_restrictions = ignore_restrictions;
+    hint_options.windows_compatibility = windows_compatibility;
+    hint_options.adjust_subglyphs = adjust_subglyphs;
+    hint_options.hint_composites = hint_composites;
+    hint_options.no_info = no_info;
+    hint_options.detailed_info = detailed_info;
+    hint_options.default_script = default_script;
+    hint_options.fallback_script = fallback_script;
+    hint_options.fallback_scaling = fallback_scaling;
+    hint_options.family_suffix = family_suffix;
+    hint_options.symbol = symbol;
+    hint_options.dehint = dehint;
+    hint_options.TTFA_info = TTFA_info;
+
+    hint_options.epoch = epoch;
+
+    Server_Options server_options;
+
+    server_options.address = server_address;
+    server_options.num_workers = server_workers;
+    server_options.timeout = server_timeout;
+    server_options.memory_limit = memory_limit << 20;
+
+    exit(run_server(&server_options, &hint_options));
+  }
+#endif
+
   if (num_args > 2)
     show_help(false, true);
 
@@ -1436,8 +1767,63 @@ main(int argc,
   else
     reference = NULL;
 
+  if ((glyph_subset_string != NULL) != (previous_name != NULL))
+  {
+    fprintf(stderr, "Options `--glyph-subset' and `--previous'"
+                    " must be used together\n");
+    exit(EXIT_FAILURE);
+  }
+
+  FILE* debug_trace = NULL;
+  if (debug_trace_name)
+  {
+    debug_trace = fopen(debug_trace_name, "wb");
+    if (!debug_trace)
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while opening debug trace file `%s':\n"
+              "\n"
+              "  %s\n",
+              debug_trace_name, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  FILE* profile = NULL;
+  if (profile_name)
+  {
+    profile = fopen(profile_name, "w");
+    if (!profile)
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while opening profile file `%s':\n"
+              "\n"
+              "  %s\n",
+              profile_name, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  FILE* previous = NULL;
+  if (previous_name)
+  {
+    previous = fopen(previous_name, "rb");
+    if (!previous)
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while opening previous font `%s':\n"
+              "\n"
+              "  %s\n",
+              previous_name, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
   Progress_Data progress_data = {-1, 1, 0};
-  Error_Data error_data = {control_name};
+  Error_Data error_data = {control_name, glyph_subset_string};
   Info_Data info_data;
 
   if (!*family_suffix)
@@ -1499,6 +1885,8 @@ main(int argc,
   if (out == stdout)
     SET_BINARY(stdout);
 
+  TA_Memory_Stats stats;
+
   TA_Error error =
     TTF_autohint("in-file, out-file, control-file,"
                  "reference-file, reference-index, reference-name,"
@@ -1513,7 +1901,10 @@ main(int argc,
                  "increase-x-height, x-height-snapping-exceptions,"
                  "fallback-stem-width, default-script,"
                  "fallback-script, fallback-scaling,"
-                 "symbol, dehint, debug, TTFA-info, epoch",
+                 "symbol, dehint, debug, TTFA-info, epoch,"
+                 "previous-file, glyph-subset, hinting-threads,"
+                 "profile-file, profile-top, debug-trace-file,"
+                 "memory-limit, memory-stats",
                  in, out, control,
                  reference, reference_index, reference_name,
                  hinting_range_min, hinting_range_max, hinting_limit,
@@ -1527,7 +1918,13 @@ main(int argc,
                  increase_x_height, x_height_snapping_exceptions_string,
                  fallback_stem_width, default_script,
                  fallback_script, fallback_scaling,
-                 symbol, dehint, debug, TTFA_info, epoch);
+                 symbol, dehint, debug, TTFA_info, epoch,
+                 previous, glyph_subset_string, hinting_threads,
+                 profile, profile_top, debug_trace,
+                 memory_limit << 20, &stats);
+
+  if (memory_stats)
+    show_memory_stats(&stats);
 
   if (!no_info)
   {
@@ -1543,6 +1940,12 @@ main(int argc,
     fclose(control);
   if (reference)
     fclose(reference);
+  if (previous)
+    fclose(previous);
+  if (profile)
+    fclose(profile);
+  if (debug_trace)
+    fclose(debug_trace);
 
   exit(error ? EXIT_FAILURE : EXIT_SUCCESS);
 
@@ -1594,7 +1997,8 @@ main(int argc,
                    ignore_restrictions, windows_compatibility, adjust_subglyphs,
                    hint_composites, no_info, detailed_info,
                    default_script, fallback_script, fallback_scaling,
-                   family_suffix, symbol, dehint, TTFA_info);
+                   family_suffix, symbol, dehint, TTFA_info,
+                   watch_delay);
 
     dummy.move(-50000, -50000);
     dummy.show();
@@ -1614,7 +2018,8 @@ main(int argc,
                ignore_restrictions, windows_compatibility, adjust_subglyphs,
                hint_composites, no_info, detailed_info,
                default_script, fallback_script, fallback_scaling,
-               family_suffix, symbol, dehint, TTFA_info);
+               family_suffix, symbol, dehint, TTFA_info,
+               watch_delay);
   gui.show();
 
   return app.exec();
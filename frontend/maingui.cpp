@@ -129,7 +129,8 @@ Main_GUI::Main_GUI(bool horizontal_layout,
                    const char* suffix,
                    bool symb,
                    bool dh,
-                   bool TTFA)
+                   bool TTFA,
+                   int delay)
 : hinting_range_min(range_min),
   hinting_range_max(range_max),
   hinting_limit(limit),
@@ -150,6 +151,7 @@ Main_GUI::Main_GUI(bool horizontal_layout,
   symbol(symb),
   dehint(dh),
   TTFA_info(TTFA),
+  watch_delay(delay),
   // constants
   fallback_do_scale(1),
   fallback_do_hint(0)
@@ -178,14 +180,17 @@ Main_GUI::Main_GUI(bool horizontal_layout,
   x_height_snapping_exceptions = NULL;
 
   // if the current input files have been updated
-  // we wait a given time interval, then we reload the files
+  // we wait a given time interval, then we reload the files;
+  // every further notification within this interval restarts the timer
+  // so that a burst of modifications triggers only a single run
   file_watcher = new QFileSystemWatcher(this);
   timer = new QTimer(this);
-  timer->setInterval(1000); // XXX make this configurable
+  timer->setInterval(watch_delay);
   timer->setSingleShot(true);
   fileinfo_input_file.setCaching(false);
   fileinfo_control_file.setCaching(false);
   fileinfo_reference_file.setCaching(false);
+  control_only = false;
 
   // XXX register translations somewhere and loop over them
   if (QLocale::system().name() == "en_US")
@@ -895,25 +900,106 @@ Main_GUI::check_watch()
 
 
 void
-Main_GUI::start_timer()
+Main_GUI::start_timer(const QString& path)
 {
+  // Many editors save a file by writing a new one and renaming it,
+  // which makes the watcher drop the path; re-add it if possible.
+  if (!file_watcher->files().contains(path) && QFile::exists(path))
+    file_watcher->addPath(path);
+
   // we delay the file watching action, mainly to ensure
   // that newly generated files have been completely written to disk
+  // (`start' restarts an already running timer)
   check = CheckNow;
   timer->start();
 }
 
 
+void
+Main_GUI::check_directory(const QString&)
+{
+  // We watch the directories of the input files also so that we get
+  // notified if a removed file reappears; in this case we have to add it
+  // to the watcher again.  Other changes in the directories (for example,
+  // writing the output font) are ignored.
+  QStringList paths;
+
+  add_watch_paths(fileinfo_input_file, paths);
+  add_watch_paths(fileinfo_control_file, paths);
+  add_watch_paths(fileinfo_reference_file, paths);
+
+  const QStringList watched = file_watcher->files();
+
+  for (int i = 0; i < paths.size(); i++)
+  {
+    const QString& path = paths.at(i);
+
+    if (!watched.contains(path) && QFile::exists(path))
+      start_timer(path);
+  }
+}
+
+
+// Collect the paths to be watched for a given file: the file itself, and,
+// if the file is a symlink, its target also (the watcher doesn't follow
+// symlinks on all platforms).
+
+void
+Main_GUI::add_watch_paths(const QFileInfo& fileinfo,
+                          QStringList& paths)
+{
+  if (fileinfo.fileName().isEmpty())
+    return;
+
+  paths << fileinfo.filePath();
+
+  if (fileinfo.isSymLink())
+  {
+    QString target = fileinfo.canonicalFilePath();
+
+    if (!target.isEmpty() && !paths.contains(target))
+      paths << target;
+  }
+}
+
+
+void
+Main_GUI::start_watching()
+{
+  QStringList files;
+
+  add_watch_paths(fileinfo_input_file, files);
+  add_watch_paths(fileinfo_control_file, files);
+  add_watch_paths(fileinfo_reference_file, files);
+
+  QStringList dirs;
+
+  for (int i = 0; i < files.size(); i++)
+  {
+    QString dir = QFileInfo(files.at(i)).absolutePath();
+
+    if (!dirs.contains(dir))
+      dirs << dir;
+  }
+
+  check = DoCheck;
+
+  // `addPaths' ignores paths that are already being watched
+  file_watcher->addPaths(files);
+  file_watcher->addPaths(dirs);
+}
+
+
 void
 Main_GUI::stop_watching()
 {
   check = DoCheck;
-  if (!fileinfo_input_file.fileName().isEmpty())
-    file_watcher->removePath(fileinfo_input_file.fileName());
-  if (!fileinfo_control_file.fileName().isEmpty())
-    file_watcher->removePath(fileinfo_control_file.fileName());
-  if (!fileinfo_reference_file.fileName().isEmpty())
-    file_watcher->removePath(fileinfo_reference_file.fileName());
+  timer->stop();
+
+  if (!file_watcher->files().isEmpty())
+    file_watcher->removePaths(file_watcher->files());
+  if (!file_watcher->directories().isEmpty())
+    file_watcher->removePaths(file_watcher->directories());
 }
 
 
@@ -931,27 +1017,25 @@ Main_GUI::watch_files()
           : (fileinfo_reference_file.exists()
              && fileinfo_reference_file.isReadable())))
   {
+    // we are event-driven, so any difference in the time stamps
+    // (in either direction, e.g., after restoring a backup) counts
     QDateTime modified_input = fileinfo_input_file.lastModified();
     QDateTime modified_control = fileinfo_control_file.lastModified();
     QDateTime modified_reference = fileinfo_reference_file.lastModified();
-    // XXX make this configurable
-    if (datetime_input_file.msecsTo(modified_input) > 1000
-        || datetime_control_file.msecsTo(modified_control) > 1000
-        || datetime_reference_file.msecsTo(modified_reference) > 1000)
+
+    if (modified_input != datetime_input_file
+        || modified_control != datetime_control_file
+        || modified_reference != datetime_reference_file)
     {
+      // if the control instructions file is the only one that has changed,
+      // `run' can restrict the rerun to the glyphs affected by the change
+      control_only = (modified_input == datetime_input_file
+                      && modified_reference == datetime_reference_file);
+
       check = CheckNow;
       run(); // this function sets `datetime_XXX'
-    }
-    else
-    {
-      // restart timer for symlinks
-      if (watch_box->isChecked())
-      {
-        if (fileinfo_input_file.isSymLink()
-            || fileinfo_control_file.isSymLink()
-            || fileinfo_reference_file.isSymLink())
-          timer->start();
-      }
+
+      control_only = false;
     }
   }
   else
@@ -1039,6 +1123,7 @@ struct GUI_Error_Data
   QString reference_name;
   int* ignore_restrictions_p;
   bool retry;
+  bool incremental;
 };
 
 
@@ -1059,6 +1144,17 @@ gui_error(TA_Error error,
   if (!error)
     return;
 
+  // the output font of the last run can't be used for an incremental
+  // rerun (for example, because the parameters have changed);
+  // silently do a full run instead
+  if (data->incremental
+      && (error == TA_Err_Invalid_Previous_Font
+          || error == TA_Err_Previous_Font_Mismatch))
+  {
+    data->retry = true;
+    return;
+  }
+
   if (error == TA_Err_Canceled)
     ;
   else if (error == TA_Err_Invalid_FreeType_Version)
@@ -1198,6 +1294,8 @@ Main_GUI::run()
 
   if (check == CheckLater)
   {
+    // an input file is temporarily missing or unreadable;
+    // give it one more debounce interval to reappear
     timer->start();
     return;
   }
@@ -1218,6 +1316,26 @@ Main_GUI::run()
   FILE* control;
   FILE* reference;
 
+  // An incremental rerun (only rehinting glyphs whose control
+  // instructions have changed, copying everything else) needs the output
+  // font of the last run, which must contain a `TTFA' table; we have to
+  // read it before `open_files' truncates it.
+  bool incremental = false;
+  QByteArray previous_font;
+
+  if (control_only
+      && TTFA_box->isChecked()
+      && !dehint_box->isChecked())
+  {
+    QFile previous_file(output_name);
+
+    if (previous_file.open(QIODevice::ReadOnly))
+    {
+      previous_font = previous_file.readAll();
+      incremental = !previous_font.isEmpty();
+    }
+  }
+
 again:
   if (!open_files(input_name, &input,
                   output_name, &output,
@@ -1238,7 +1356,8 @@ again:
   GUI_Progress_Data gui_progress_data = {-1, true, &dialog};
   GUI_Error_Data gui_error_data = {this, locale,
                                    output_name, control_name, reference_name,
-                                   &ignore_restrictions, false};
+                                   &ignore_restrictions, false,
+                                   incremental};
 
   fileinfo_input_file.setFile(input_name);
   fileinfo_control_file.setFile(control_name);
@@ -1344,26 +1463,33 @@ again:
 
   QByteArray snapping_string = snapping_line->text().toLocal8Bit();
 
+  QByteArray options("in-file, out-file, control-file, reference-file,"
+                     "reference-index, reference-name,"
+                     "hinting-range-min, hinting-range-max,"
+                     "hinting-limit,"
+                     "gray-stem-width-mode,"
+                     "gdi-cleartype-stem-width-mode,"
+                     "dw-cleartype-stem-width-mode,"
+                     "progress-callback, progress-callback-data,"
+                     "error-callback, error-callback-data,"
+                     "info-callback, info-post-callback, info-callback-data,"
+                     "ignore-restrictions,"
+                     "windows-compatibility,"
+                     "adjust-subglyphs,"
+                     "hint-composites,"
+                     "increase-x-height,"
+                     "x-height-snapping-exceptions, fallback-stem-width,"
+                     "default-script,"
+                     "fallback-script, fallback-scaling,"
+                     "symbol, dehint, TTFA-info");
+
+  // the values of these options are always passed to `TTF_autohint'
+  // but only used if the option string mentions them
+  if (incremental)
+    options += ", previous-buffer, previous-buffer-len, glyph-subset";
+
   TA_Error error =
-    TTF_autohint("in-file, out-file, control-file, reference-file,"
-                 "reference-index, reference-name,"
-                 "hinting-range-min, hinting-range-max,"
-                 "hinting-limit,"
-                 "gray-stem-width-mode,"
-                 "gdi-cleartype-stem-width-mode,"
-                 "dw-cleartype-stem-width-mode,"
-                 "progress-callback, progress-callback-data,"
-                 "error-callback, error-callback-data,"
-                 "info-callback, info-post-callback, info-callback-data,"
-                 "ignore-restrictions,"
-                 "windows-compatibility,"
-                 "adjust-subglyphs,"
-                 "hint-composites,"
-                 "increase-x-height,"
-                 "x-height-snapping-exceptions, fallback-stem-width,"
-                 "default-script,"
-                 "fallback-script, fallback-scaling,"
-                 "symbol, dehint, TTFA-info",
+    TTF_autohint(options.constData(),
                  input, output, control, reference,
                  info_data.reference_index, info_data.reference_name,
                  info_data.hinting_range_min, info_data.hinting_range_max,
@@ -1382,7 +1508,9 @@ again:
                  snapping_string.constData(), info_data.fallback_stem_width,
                  info_data.default_script,
                  info_data.fallback_script, info_data.fallback_scaling,
-                 info_data.symbol, info_data.dehint, info_data.TTFA_info);
+                 info_data.symbol, info_data.dehint, info_data.TTFA_info,
+                 previous_font.constData(), (size_t)previous_font.size(),
+                 "");
 
   if (info_box->currentIndex())
   {
@@ -1401,7 +1529,11 @@ again:
   {
     // retry if there is a user request to do so (handled in `gui_error')
     if (gui_error_data.retry)
+    {
+      // a retry is always a full run
+      incremental = false;
       goto again;
+    }
 
     stop_watching();
   }
@@ -1416,22 +1548,7 @@ again:
     // we have successfully processed a file;
     // start file watching now if requested
     if (watch_box->isChecked())
-    {
-      check = DoCheck;
-
-      // Qt's file watcher doesn't handle symlinks;
-      // we thus fall back to polling
-      if (fileinfo_input_file.isSymLink()
-          || fileinfo_control_file.isSymLink()
-          || fileinfo_reference_file.isSymLink())
-        timer->start();
-      else
-      {
-        file_watcher->addPath(input_name);
-        file_watcher->addPath(control_name);
-        file_watcher->addPath(reference_name);
-      }
-    }
+      start_watching();
   }
 }
 
@@ -1907,10 +2024,15 @@ Main_GUI::create_layout(bool horizontal_layout)
        " the hinting process as soon as an input file"
        " (either the font, the reference font,"
        " or the control instructions file) is modified.<br>"
+       "If only the control instructions file has changed"
+       " and %2 is switched on,"
+       " just the glyphs with changed control instructions"
+       " get rehinted.<br>"
        "Pressing the %1 button starts watching.<br>"
        "If an error occurs, watching stops and must be restarted"
        " with the %1 button.")
-       .arg(QUOTE_STRING_LITERAL(tr("Run"))));
+       .arg(QUOTE_STRING_LITERAL(tr("Run")))
+       .arg(QUOTE_STRING_LITERAL(tr("Add TTFA Info Table"))));
 
   run_button = new QPushButton("    "
                                + tr("&Run")
@@ -2269,7 +2391,9 @@ Main_GUI::create_connections()
           SLOT(check_dehint()));
 
   connect(file_watcher, SIGNAL(fileChanged(const QString&)),
-          SLOT(start_timer()));
+          SLOT(start_timer(const QString&)));
+  connect(file_watcher, SIGNAL(directoryChanged(const QString&)),
+          SLOT(check_directory(const QString&)));
   connect(timer, SIGNAL(timeout()),
           SLOT(watch_files()));
 
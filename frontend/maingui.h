@@ -70,7 +70,8 @@ public:
            bool, bool, bool,
            bool, bool, bool,
            const char*, const char*, bool,
-           const char*, bool, bool, bool);
+           const char*, bool, bool, bool,
+           int);
   ~Main_GUI();
 
 protected:
@@ -97,7 +98,8 @@ private slots:
   void check_number_set();
   void check_family_suffix();
   void clear_status_bar();
-  void start_timer();
+  void start_timer(const QString&);
+  void check_directory(const QString&);
   void check_watch();
   void watch_files();
   void check_run();
@@ -128,6 +130,7 @@ private:
   int symbol;
   int dehint;
   int TTFA_info;
+  int watch_delay;
 
   const int fallback_do_scale;
   const int fallback_do_hint;
@@ -154,6 +157,8 @@ private:
   QDateTime datetime_control_file;
   QDateTime datetime_reference_file;
   CheckState check;
+  // set by `watch_files' if only the control instructions file has changed
+  bool control_only;
 
   void create_connections();
   void create_actions();
@@ -173,7 +178,9 @@ private:
                  const QString&, FILE**);
   int handle_error(TA_Error, const unsigned char*, QString);
 
+  void start_watching();
   void stop_watching();
+  void add_watch_paths(const QFileInfo&, QStringList&);
 
   QMenu* file_menu;
   QMenu* help_menu;
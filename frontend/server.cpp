@@ -0,0 +1,1362 @@
+// server.cpp
+
+// Copyright (C) 2022 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+// A server mode for `ttfautohint': Fonts are sent to a long-running
+// process, avoiding process startup costs.
+//
+// The protocol is the same for Unix domain sockets and standard
+// input/output.  All integers are unsigned 32-bit values in big-endian
+// byte order.  A request consists of
+//
+//   id              a value chosen by the client, returned in the response
+//   options length
+//   options         UTF-8 string of `key=value' lines (see below)
+//   font length
+//   font
+//
+// and gets answered with
+//
+//   id
+//   error           a `TA_Error' value; zero means success
+//   message length
+//   message         UTF-8 error message; empty on success
+//   font length
+//   font            the hinted font; empty on error
+//
+// Keys are the names of ttfautohint's long command line options (without
+// leading dashes); boolean options can be given without a value.  Options
+// not given in a request take the values from the command line.
+//
+// With standard input and output, requests are processed in parallel and
+// responses can thus arrive in a different order.  With sockets, requests
+// of a single connection are processed sequentially; parallelism comes
+// from multiple connections.  The main thread watches all connections and
+// hands a connection to a worker thread only if a request arrives; the
+// worker gives it back after sending the response.  Idle connections thus
+// don't occupy worker threads.  A client must send a complete request and
+// accept the complete response within `IO_TIMEOUT' each; otherwise the
+// server closes the connection (after sending an error response if the
+// request ID is known).
+
+#include "server.h"
+
+#ifdef HAVE_SERVER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <string>
+#include <deque>
+#include <vector>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <ttfautohint.h>
+#include "info.h"
+
+
+using namespace std;
+
+
+// upper limits for the size of request data
+#define MAX_OPTIONS_LEN 0x10000
+#define MAX_FONT_LEN 0x40000000
+
+// the time in milliseconds a socket client gets for sending a complete
+// request, and for receiving a complete response
+#define IO_TIMEOUT 60000
+
+
+typedef struct Request_
+{
+  int fd; // the connection to read the request from; -1 for stdio
+  unsigned long id;
+  string options;
+  string font;
+} Request;
+
+
+typedef struct Response_
+{
+  unsigned long id;
+  TA_Error error;
+  string message;
+  char* font_buf;
+  size_t font_len;
+} Response;
+
+
+// a bounded queue of requests; with sockets, it holds connections with
+// pending requests instead
+typedef struct Queue_
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+
+  deque<Request*> requests;
+  size_t capacity;
+  bool closed;
+} Queue;
+
+
+typedef struct Server_
+{
+  const Server_Options* options;
+  const Hint_Options* defaults;
+
+  // standard input and output
+  Queue queue;
+  pthread_mutex_t output_mutex;
+  bool output_failed;
+
+  // sockets
+  int listen_fd;
+  pthread_mutex_t clients_mutex;
+  int* client_fds; // one per worker; -1 if idle
+  vector<int> returned_fds; // connections given back by workers
+} Server;
+
+
+typedef struct Worker_
+{
+  Server* server;
+  int idx;
+  pthread_t thread;
+} Worker;
+
+
+typedef struct Job_Data_
+{
+  bool have_deadline;
+  struct timespec deadline;
+  bool timed_out;
+} Job_Data;
+
+
+// set by the main thread to cancel all running jobs
+static volatile sig_atomic_t stop_server = 0;
+
+// the write end of a pipe to wake up the main thread in socket mode
+static int wake_fd = -1;
+
+
+extern "C" {
+
+static int
+progress(long curr_idx,
+         long num_glyphs,
+         long curr_sfnt,
+         long num_sfnts,
+         void* user)
+{
+  Job_Data* data = (Job_Data*)user;
+  struct timespec now;
+
+  (void)curr_idx;
+  (void)num_glyphs;
+  (void)curr_sfnt;
+  (void)num_sfnts;
+
+  if (stop_server)
+    return 1;
+
+  if (!data->have_deadline)
+    return 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (now.tv_sec > data->deadline.tv_sec
+      || (now.tv_sec == data->deadline.tv_sec
+          && now.tv_nsec > data->deadline.tv_nsec))
+  {
+    data->timed_out = true;
+    return 1;
+  }
+
+  return 0;
+}
+
+
+static void
+err(TA_Error error,
+    const char* error_string,
+    unsigned int errlinenum,
+    const char* errline,
+    const char* errpos,
+    void* user)
+{
+  string* message = static_cast<string*>(user);
+  char buf[128];
+
+  (void)errlinenum;
+
+  if (!error)
+    return;
+
+  if (error >= 0x100 && error < 0x200)
+  {
+    snprintf(buf, sizeof (buf),
+             "error 0x%03x while parsing option"
+               " `x-height-snapping-exceptions'",
+             error);
+    *message = buf;
+
+    if (errline)
+    {
+      *message += ": ";
+      *message += errline;
+
+      if (errpos)
+      {
+        snprintf(buf, sizeof (buf),
+                 " (column %d)", int(errpos - errline + 1));
+        *message += buf;
+      }
+    }
+  }
+  else
+  {
+    snprintf(buf, sizeof (buf), "error 0x%02x", error);
+    *message = buf;
+
+    if (error_string)
+    {
+      *message += ": ";
+      *message += error_string;
+    }
+  }
+}
+
+} // extern "C"
+
+
+// Set `deadline' to `ms' milliseconds from now.
+
+static void
+set_deadline(struct timespec* deadline,
+             int ms)
+{
+  clock_gettime(CLOCK_MONOTONIC, deadline);
+
+  deadline->tv_sec += ms / 1000;
+  deadline->tv_nsec += (ms % 1000) * 1000000L;
+  if (deadline->tv_nsec >= 1000000000L)
+  {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000L;
+  }
+}
+
+
+// Wait until `fd' is ready for `events'.  Return false on error, or if
+// `deadline' has passed (setting `errno' to `ETIMEDOUT').
+
+static bool
+wait_fd(int fd,
+        short events,
+        const struct timespec* deadline)
+{
+  for (;;)
+  {
+    struct timespec now;
+    long long ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (long long)(deadline->tv_sec - now.tv_sec) * 1000
+         + (deadline->tv_nsec - now.tv_nsec + 999999L) / 1000000L;
+    if (ms <= 0)
+    {
+      errno = ETIMEDOUT;
+      return false;
+    }
+
+    struct pollfd pfd = { fd, events, 0 };
+    int n = poll(&pfd, 1, ms > INT_MAX ? INT_MAX : int(ms));
+    if (n > 0)
+      return true;
+    if (n < 0 && errno != EINTR)
+      return false;
+  }
+}
+
+
+// Read `len' bytes from `fd'.  Return the number of bytes actually read
+// (which is smaller than `len' at end of input), or -1 on error.  If
+// `deadline' is non-NULL, `fd' must be non-blocking, and the function
+// fails with `errno' set to `ETIMEDOUT' when the deadline has passed.
+
+static ssize_t
+read_all(int fd,
+         void* buf,
+         size_t len,
+         const struct timespec* deadline)
+{
+  char* p = (char*)buf;
+  size_t count = 0;
+
+  while (count < len)
+  {
+    ssize_t n = read(fd, p + count, len - count);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (deadline
+          && (errno == EAGAIN || errno == EWOULDBLOCK)
+          && wait_fd(fd, POLLIN, deadline))
+        continue;
+      return -1;
+    }
+    if (n == 0)
+      break;
+
+    count += size_t(n);
+  }
+
+  return ssize_t(count);
+}
+
+
+// The same for writing; return false on error.
+
+static bool
+write_all(int fd,
+          const void* buf,
+          size_t len,
+          const struct timespec* deadline)
+{
+  const char* p = (const char*)buf;
+
+  while (len)
+  {
+    ssize_t n = write(fd, p, len);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (deadline
+          && (errno == EAGAIN || errno == EWOULDBLOCK)
+          && wait_fd(fd, POLLOUT, deadline))
+        continue;
+      return false;
+    }
+
+    p += n;
+    len -= size_t(n);
+  }
+
+  return true;
+}
+
+
+static unsigned long
+get_ulong(const unsigned char* p)
+{
+  return ((unsigned long)p[0] << 24)
+         | ((unsigned long)p[1] << 16)
+         | ((unsigned long)p[2] << 8)
+         | (unsigned long)p[3];
+}
+
+
+static void
+put_ulong(unsigned char* p,
+          unsigned long val)
+{
+  p[0] = (unsigned char)(val >> 24);
+  p[1] = (unsigned char)(val >> 16);
+  p[2] = (unsigned char)(val >> 8);
+  p[3] = (unsigned char)val;
+}
+
+
+// Read a length-prefixed block of data.  The buffer grows with the data
+// actually received, so a client can't make us allocate `max_len' bytes
+// by merely announcing them.
+
+static bool
+read_data(int fd,
+          string* data,
+          unsigned long max_len,
+          const struct timespec* deadline)
+{
+  unsigned char buf[4];
+  unsigned long len;
+  size_t count = 0;
+
+  if (read_all(fd, buf, 4, deadline) != 4)
+    return false;
+
+  len = get_ulong(buf);
+  if (len > max_len)
+    return false;
+
+  data->clear();
+  while (count < len)
+  {
+    // at most double the buffer size in each step
+    size_t chunk = len - count;
+    if (chunk > count + 0x10000)
+      chunk = count + 0x10000;
+
+    data->resize(count + chunk);
+    if (read_all(fd, &(*data)[count], chunk, deadline) != ssize_t(chunk))
+      return false;
+
+    count += chunk;
+  }
+
+  return true;
+}
+
+
+// Return 1 on success, 0 at end of input, and -1 on error.  Return -2 if
+// `deadline' has passed after the request ID has been read.
+
+static int
+read_request(int fd,
+             Request* request,
+             const struct timespec* deadline)
+{
+  unsigned char buf[4];
+  ssize_t n;
+
+  n = read_all(fd, buf, 4, deadline);
+  if (n == 0)
+    return 0;
+  if (n != 4)
+    return -1;
+
+  request->id = get_ulong(buf);
+
+  errno = 0;
+  if (!read_data(fd, &request->options, MAX_OPTIONS_LEN, deadline)
+      || !read_data(fd, &request->font, MAX_FONT_LEN, deadline))
+    return errno == ETIMEDOUT ? -2 : -1;
+
+  return 1;
+}
+
+
+static bool
+write_response(int fd,
+               const Response* response,
+               const struct timespec* deadline)
+{
+  unsigned char buf[12];
+
+  put_ulong(buf, response->id);
+  put_ulong(buf + 4, (unsigned long)response->error);
+  put_ulong(buf + 8, response->message.size());
+
+  if (!write_all(fd, buf, 12, deadline))
+    return false;
+  if (!write_all(fd, response->message.data(), response->message.size(),
+                 deadline))
+    return false;
+
+  put_ulong(buf, response->font_len);
+
+  if (!write_all(fd, buf, 4, deadline))
+    return false;
+  if (response->font_len
+      && !write_all(fd, response->font_buf, response->font_len, deadline))
+    return false;
+
+  return true;
+}
+
+
+static bool
+parse_int(const char* value,
+          int* result)
+{
+  char* endptr;
+  long val;
+
+  if (!value || !*value)
+    return false;
+
+  errno = 0;
+  val = strtol(value, &endptr, 10);
+  if (errno || *endptr || val < INT_MIN || val > INT_MAX)
+    return false;
+
+  *result = int(val);
+  return true;
+}
+
+
+static bool
+parse_bool(const char* value,
+           bool* result)
+{
+  if (!value || !strcmp(value, "1"))
+    *result = true;
+  else if (!strcmp(value, "0"))
+    *result = false;
+  else
+    return false;
+
+  return true;
+}
+
+
+static bool
+parse_stem_width_mode(char c,
+                      int* result)
+{
+  switch (c)
+  {
+  case 'n':
+    *result = TA_STEM_WIDTH_MODE_NATURAL;
+    break;
+  case 'q':
+    *result = TA_STEM_WIDTH_MODE_QUANTIZED;
+    break;
+  case 's':
+    *result = TA_STEM_WIDTH_MODE_STRONG;
+    break;
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+
+// Parse the option string of a request, overriding values in `options'.
+// The string gets modified so that string values can directly point into
+// it.  On error, `message' gets filled.
+
+static TA_Error
+parse_options(string* options_string,
+              Hint_Options* options,
+              string* message)
+{
+  if (options_string->empty())
+    return TA_Err_Ok;
+
+  char* p = &(*options_string)[0];
+  char* end = p + options_string->size();
+
+  while (p < end)
+  {
+    char* key = p;
+    char* eol = (char*)memchr(p, '\n', size_t(end - p));
+    if (!eol)
+      eol = end;
+
+    *eol = '\0';
+    p = eol + 1;
+
+    // remove leading and trailing whitespace
+    key += strspn(key, " \t");
+    while (eol > key && strchr(" \t\r", eol[-1]))
+      *--eol = '\0';
+
+    if (!*key)
+      continue;
+
+    char* value = strchr(key, '=');
+    if (value)
+    {
+      char* key_end = value;
+
+      *value++ = '\0';
+      value += strspn(value, " \t");
+      while (key_end > key && strchr(" \t", key_end[-1]))
+        *--key_end = '\0';
+    }
+
+    bool ok;
+
+    if (!strcmp(key, "adjust-subglyphs"))
+      ok = parse_bool(value, &options->adjust_subglyphs);
+    else if (!strcmp(key, "composites"))
+      ok = parse_bool(value, &options->hint_composites);
+    else if (!strcmp(key, "default-script"))
+    {
+      options->default_script = value;
+      ok = value && strlen(value) == 4;
+    }
+    else if (!strcmp(key, "dehint"))
+      ok = parse_bool(value, &options->dehint);
+    else if (!strcmp(key, "detailed-info"))
+    {
+      ok = parse_bool(value, &options->detailed_info);
+      if (options->detailed_info)
+        options->no_info = false;
+    }
+    else if (!strcmp(key, "fallback-scaling"))
+      ok = parse_bool(value, &options->fallback_scaling);
+    else if (!strcmp(key, "fallback-script"))
+    {
+      options->fallback_script = value;
+      ok = value && strlen(value) == 4;
+    }
+    else if (!strcmp(key, "fallback-stem-width"))
+      ok = parse_int(value, &options->fallback_stem_width)
+           && options->fallback_stem_width > 0;
+    else if (!strcmp(key, "family-suffix"))
+    {
+      options->family_suffix = value ? value : "";
+      ok = !check_family_suffix(options->family_suffix);
+    }
+    else if (!strcmp(key, "hinting-limit"))
+      ok = parse_int(value, &options->hinting_limit);
+    else if (!strcmp(key, "hinting-range-max"))
+      ok = parse_int(value, &options->hinting_range_max);
+    else if (!strcmp(key, "hinting-range-min"))
+      ok = parse_int(value, &options->hinting_range_min);
+    else if (!strcmp(key, "ignore-restrictions"))
+      ok = parse_bool(value, &options->ignore_restrictions);
+    else if (!strcmp(key, "increase-x-height"))
+      ok = parse_int(value, &options->increase_x_height);
+    else if (!strcmp(key, "no-info"))
+    {
+      ok = parse_bool(value, &options->no_info);
+      if (options->no_info)
+        options->detailed_info = false;
+    }
+    else if (!strcmp(key, "stem-width-mode"))
+      ok = value
+           && strlen(value) == 3
+           && parse_stem_width_mode(value[0],
+                                    &options->gray_stem_width_mode)
+           && parse_stem_width_mode(value[1],
+                                    &options->gdi_cleartype_stem_width_mode)
+           && parse_stem_width_mode(value[2],
+                                    &options->dw_cleartype_stem_width_mode);
+    else if (!strcmp(key, "symbol"))
+      ok = parse_bool(value, &options->symbol);
+    else if (!strcmp(key, "ttfa-table"))
+      ok = parse_bool(value, &options->TTFA_info);
+    else if (!strcmp(key, "windows-compatibility"))
+      ok = parse_bool(value, &options->windows_compatibility);
+    else if (!strcmp(key, "x-height-snapping-exceptions"))
+    {
+      options->x_height_snapping_exceptions_string = value ? value : "";
+      ok = true;
+    }
+    else
+    {
+      *message = string("unknown option `") + key + "'";
+      return TA_Err_Unknown_Argument;
+    }
+
+    if (!ok)
+    {
+      *message = string("invalid value for option `") + key + "'";
+      return FT_Err_Invalid_Argument;
+    }
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static void
+process_request(Server* server,
+                Request* request,
+                Response* response)
+{
+  Hint_Options options = *server->defaults;
+  Job_Data job_data;
+  Info_Data info_data;
+
+  response->id = request->id;
+  response->error = TA_Err_Ok;
+  response->font_buf = NULL;
+  response->font_len = 0;
+
+  response->error = parse_options(&request->options, &options,
+                                  &response->message);
+  if (response->error)
+    return;
+
+  job_data.have_deadline = server->options->timeout > 0;
+  job_data.timed_out = false;
+  if (job_data.have_deadline)
+    set_deadline(&job_data.deadline, server->options->timeout);
+
+  info_data.no_info = options.no_info;
+  info_data.detailed_info = options.detailed_info;
+  info_data.info_string = NULL;
+  info_data.info_string_wide = NULL;
+  info_data.info_string_len = 0;
+  info_data.info_string_wide_len = 0;
+
+  info_data.control_name = NULL;
+  info_data.reference_name = NULL;
+  info_data.reference_index = 0;
+
+  info_data.hinting_range_min = options.hinting_range_min;
+  info_data.hinting_range_max = options.hinting_range_max;
+  info_data.hinting_limit = options.hinting_limit;
+
+  info_data.gray_stem_width_mode = options.gray_stem_width_mode;
+  info_data.gdi_cleartype_stem_width_mode =
+    options.gdi_cleartype_stem_width_mode;
+  info_data.dw_cleartype_stem_width_mode =
+    options.dw_cleartype_stem_width_mode;
+
+  info_data.windows_compatibility = options.windows_compatibility;
+  info_data.adjust_subglyphs = options.adjust_subglyphs;
+  info_data.hint_composites = options.hint_composites;
+  info_data.increase_x_height = options.increase_x_height;
+  info_data.x_height_snapping_exceptions_string =
+    options.x_height_snapping_exceptions_string;
+  info_data.family_suffix = options.family_suffix;
+  info_data.family_data_head = NULL;
+  info_data.fallback_stem_width = options.fallback_stem_width;
+  info_data.symbol = options.symbol;
+  info_data.fallback_scaling = options.fallback_scaling;
+  info_data.TTFA_info = options.TTFA_info;
+
+  strncpy(info_data.default_script,
+          options.default_script,
+          sizeof (info_data.default_script));
+  strncpy(info_data.fallback_script,
+          options.fallback_script,
+          sizeof (info_data.fallback_script));
+
+  info_data.dehint = options.dehint;
+
+  if (!options.no_info
+      && build_version_string(&info_data))
+  {
+    response->error = FT_Err_Out_Of_Memory;
+    response->message = "can't build ttfautohint info string";
+    return;
+  }
+
+  TA_Error error =
+    TTF_autohint("in-buffer, in-buffer-len, out-buffer, out-buffer-len,"
+                 "hinting-range-min, hinting-range-max, hinting-limit,"
+                 "gray-stem-width-mode, gdi-cleartype-stem-width-mode,"
+                 "dw-cleartype-stem-width-mode,"
+                 "progress-callback, progress-callback-data,"
+                 "error-callback, error-callback-data,"
+                 "info-callback, info-post-callback, info-callback-data,"
+                 "ignore-restrictions, windows-compatibility,"
+                 "adjust-subglyphs, hint-composites,"
+                 "increase-x-height, x-height-snapping-exceptions,"
+                 "fallback-stem-width, default-script,"
+                 "fallback-script, fallback-scaling,"
+                 "symbol, dehint, TTFA-info, epoch, memory-limit",
+                 request->font.data(), request->font.size(),
+                 &response->font_buf, &response->font_len,
+                 options.hinting_range_min, options.hinting_range_max,
+                 options.hinting_limit,
+                 options.gray_stem_width_mode,
+                 options.gdi_cleartype_stem_width_mode,
+                 options.dw_cleartype_stem_width_mode,
+                 progress, &job_data,
+                 err, &response->message,
+                 info, *options.family_suffix ? info_post : NULL,
+                 &info_data,
+                 options.ignore_restrictions, options.windows_compatibility,
+                 options.adjust_subglyphs, options.hint_composites,
+                 options.increase_x_height,
+                 options.x_height_snapping_exceptions_string,
+                 options.fallback_stem_width, options.default_script,
+                 options.fallback_script, options.fallback_scaling,
+                 options.symbol, options.dehint, options.TTFA_info,
+                 options.epoch, server->options->memory_limit);
+
+  if (!options.no_info)
+  {
+    free(info_data.info_string);
+    free(info_data.info_string_wide);
+  }
+
+  response->error = error;
+  if (error)
+  {
+    free(response->font_buf);
+    response->font_buf = NULL;
+    response->font_len = 0;
+
+    if (error == TA_Err_Canceled)
+      response->message = job_data.timed_out ? "timeout"
+                                             : "server shutdown";
+  }
+}
+
+
+static void
+queue_init(Queue* queue,
+           size_t capacity)
+{
+  pthread_mutex_init(&queue->mutex, NULL);
+  pthread_cond_init(&queue->not_empty, NULL);
+  pthread_cond_init(&queue->not_full, NULL);
+  queue->capacity = capacity;
+  queue->closed = false;
+}
+
+
+static void
+queue_done(Queue* queue)
+{
+  pthread_cond_destroy(&queue->not_full);
+  pthread_cond_destroy(&queue->not_empty);
+  pthread_mutex_destroy(&queue->mutex);
+}
+
+
+static void
+queue_push(Queue* queue,
+           Request* request)
+{
+  pthread_mutex_lock(&queue->mutex);
+
+  while (queue->requests.size() >= queue->capacity)
+    pthread_cond_wait(&queue->not_full, &queue->mutex);
+
+  queue->requests.push_back(request);
+
+  pthread_cond_signal(&queue->not_empty);
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+
+// Return NULL if the queue is closed and empty.
+
+static Request*
+queue_pop(Queue* queue)
+{
+  Request* request = NULL;
+
+  pthread_mutex_lock(&queue->mutex);
+
+  while (queue->requests.empty() && !queue->closed)
+    pthread_cond_wait(&queue->not_empty, &queue->mutex);
+
+  if (!queue->requests.empty())
+  {
+    request = queue->requests.front();
+    queue->requests.pop_front();
+
+    pthread_cond_signal(&queue->not_full);
+  }
+
+  pthread_mutex_unlock(&queue->mutex);
+
+  return request;
+}
+
+
+static void
+queue_close(Queue* queue)
+{
+  pthread_mutex_lock(&queue->mutex);
+
+  queue->closed = true;
+
+  pthread_cond_broadcast(&queue->not_empty);
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+
+extern "C" {
+
+static void*
+stdio_worker(void* user)
+{
+  Worker* worker = (Worker*)user;
+  Server* server = worker->server;
+  Request* request;
+
+  while ((request = queue_pop(&server->queue)))
+  {
+    Response response;
+
+    process_request(server, request, &response);
+    delete request;
+
+    pthread_mutex_lock(&server->output_mutex);
+    if (!server->output_failed
+        && !write_response(STDOUT_FILENO, &response, NULL))
+      server->output_failed = true;
+    pthread_mutex_unlock(&server->output_mutex);
+
+    free(response.font_buf);
+  }
+
+  return NULL;
+}
+
+
+static void*
+socket_worker(void* user)
+{
+  Worker* worker = (Worker*)user;
+  Server* server = worker->server;
+  Request* request;
+
+  while ((request = queue_pop(&server->queue)))
+  {
+    int fd = request->fd;
+    bool keep = false;
+
+    // register connection so that the main thread can shut it down
+    pthread_mutex_lock(&server->clients_mutex);
+    if (!stop_server)
+    {
+      server->client_fds[worker->idx] = fd;
+      keep = true;
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    // handle a single request; a protocol error or a timeout closes the
+    // connection
+    if (keep)
+    {
+      struct timespec deadline;
+      int r;
+
+      keep = false;
+
+      set_deadline(&deadline, IO_TIMEOUT);
+      r = read_request(fd, request, &deadline);
+      if (r > 0)
+      {
+        Response response;
+
+        process_request(server, request, &response);
+
+        set_deadline(&deadline, IO_TIMEOUT);
+        keep = write_response(fd, &response, &deadline);
+        free(response.font_buf);
+      }
+      else if (r == -2)
+      {
+        Response response;
+
+        response.id = request->id;
+        response.error = TA_Err_Canceled;
+        response.message = "request timeout";
+        response.font_buf = NULL;
+        response.font_len = 0;
+
+        // this doesn't wait: the short response fits into the socket
+        // buffer unless the client doesn't read anything at all
+        write_response(fd, &response, &deadline);
+      }
+
+      pthread_mutex_lock(&server->clients_mutex);
+      server->client_fds[worker->idx] = -1;
+      pthread_mutex_unlock(&server->clients_mutex);
+    }
+
+    delete request;
+
+    if (keep && !stop_server)
+    {
+      // give the connection back to the main thread
+      pthread_mutex_lock(&server->clients_mutex);
+      server->returned_fds.push_back(fd);
+      pthread_mutex_unlock(&server->clients_mutex);
+
+      if (write(wake_fd, "", 1) < 0)
+      {
+        // the pipe is full, so the main thread wakes up anyway
+      }
+    }
+    else
+      close(fd);
+  }
+
+  return NULL;
+}
+
+
+static void
+stop_handler(int sig)
+{
+  int saved_errno = errno;
+
+  (void)sig;
+
+  stop_server = 1;
+  if (write(wake_fd, "", 1) < 0)
+  {
+    // see above
+  }
+
+  errno = saved_errno;
+}
+
+} // extern "C"
+
+
+static int
+open_socket(const char* path)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+  int fd;
+
+  if (strlen(path) >= sizeof (addr.sun_path))
+  {
+    fprintf(stderr, "Socket file name `%s' too long\n", path);
+    return -1;
+  }
+
+  // remove a stale socket, but nothing else
+  if (!stat(path, &st) && S_ISSOCK(st.st_mode))
+    unlink(path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    fprintf(stderr, "Can't create socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if (bind(fd, (struct sockaddr*)&addr, sizeof (addr)) < 0
+      || listen(fd, SOMAXCONN) < 0)
+  {
+    fprintf(stderr, "Can't listen on socket `%s': %s\n",
+                    path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+static int
+run_stdio_server(Server* server,
+                 Worker* workers)
+{
+  Queue* queue = &server->queue;
+  int num_workers = server->options->num_workers;
+  int ret = EXIT_SUCCESS;
+
+  queue_init(queue, 2 * size_t(num_workers));
+
+  pthread_mutex_init(&server->output_mutex, NULL);
+  server->output_failed = false;
+
+  for (int i = 0; i < num_workers; i++)
+    pthread_create(&workers[i].thread, NULL, stdio_worker, &workers[i]);
+
+  for (;;)
+  {
+    Request* request = new Request;
+    request->fd = -1;
+
+    int r = read_request(STDIN_FILENO, request, NULL);
+
+    if (r <= 0)
+    {
+      delete request;
+
+      if (r < 0)
+      {
+        fprintf(stderr, "Invalid request data on standard input\n");
+        ret = EXIT_FAILURE;
+      }
+      break;
+    }
+
+    queue_push(queue, request);
+  }
+
+  queue_close(queue);
+
+  for (int i = 0; i < num_workers; i++)
+    pthread_join(workers[i].thread, NULL);
+
+  if (server->output_failed)
+  {
+    fprintf(stderr, "Can't write to standard output\n");
+    ret = EXIT_FAILURE;
+  }
+
+  pthread_mutex_destroy(&server->output_mutex);
+  queue_done(queue);
+
+  return ret;
+}
+
+
+// Accept all pending connections and add them to `fds'.  Return false on
+// a fatal error.
+
+static bool
+accept_connections(int listen_fd,
+                   vector<struct pollfd>* fds)
+{
+  for (;;)
+  {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return true;
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+
+      fprintf(stderr, "Can't accept connection: %s\n", strerror(errno));
+      return false;
+    }
+
+    // workers use `poll' to enforce `IO_TIMEOUT'
+    int flags = fcntl(fd, F_GETFL);
+    if (flags >= 0)
+      fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    fds->push_back(pfd);
+  }
+}
+
+
+static int
+run_socket_server(Server* server,
+                  Worker* workers)
+{
+  const char* path = server->options->address;
+  int num_workers = server->options->num_workers;
+  int wake_pipe[2];
+  sigset_t sigset;
+  sigset_t old_sigset;
+  struct sigaction sa;
+  int ret = EXIT_SUCCESS;
+
+  if (pipe(wake_pipe) < 0)
+  {
+    fprintf(stderr, "Can't create pipe: %s\n", strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  server->listen_fd = open_socket(path);
+  if (server->listen_fd < 0)
+  {
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    return EXIT_FAILURE;
+  }
+
+  // the main thread must never block
+  fcntl(server->listen_fd,
+        F_SETFL, fcntl(server->listen_fd, F_GETFL) | O_NONBLOCK);
+  for (int i = 0; i < 2; i++)
+  {
+    fcntl(wake_pipe[i], F_SETFL, fcntl(wake_pipe[i], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_pipe[i], F_SETFD, FD_CLOEXEC);
+  }
+  wake_fd = wake_pipe[1];
+
+  server->client_fds = new int[num_workers];
+  for (int i = 0; i < num_workers; i++)
+    server->client_fds[i] = -1;
+  pthread_mutex_init(&server->clients_mutex, NULL);
+
+  // connections get handed over one at a time, so there are never more
+  // queue entries than connections
+  queue_init(&server->queue, size_t(-1));
+
+  // only the main thread handles termination signals;
+  // the workers inherit the signal mask
+  sigemptyset(&sigset);
+  sigaddset(&sigset, SIGINT);
+  sigaddset(&sigset, SIGTERM);
+  sigaddset(&sigset, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &sigset, &old_sigset);
+
+  for (int i = 0; i < num_workers; i++)
+    pthread_create(&workers[i].thread, NULL, socket_worker, &workers[i]);
+
+  memset(&sa, 0, sizeof (sa));
+  sa.sa_handler = stop_handler;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGHUP, &sa, NULL);
+
+  pthread_sigmask(SIG_SETMASK, &old_sigset, NULL);
+
+  // the first two entries are the wake-up pipe and the listening socket,
+  // followed by all idle connections
+  vector<struct pollfd> fds;
+  struct pollfd pfd;
+
+  pfd.fd = wake_pipe[0];
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  fds.push_back(pfd);
+
+  pfd.fd = server->listen_fd;
+  fds.push_back(pfd);
+
+  while (!stop_server)
+  {
+    if (poll(&fds[0], fds.size(), -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      fprintf(stderr, "Can't poll sockets: %s\n", strerror(errno));
+      ret = EXIT_FAILURE;
+      break;
+    }
+
+    if (stop_server)
+      break;
+
+    // hand over connections with pending requests (or a closed peer,
+    // which the worker notices)
+    for (size_t i = fds.size(); i-- > 2;)
+    {
+      if (!fds[i].revents)
+        continue;
+
+      Request* request = new Request;
+      request->fd = fds[i].fd;
+      queue_push(&server->queue, request);
+
+      fds[i] = fds.back();
+      fds.pop_back();
+    }
+
+    if (fds[0].revents)
+    {
+      char buf[64];
+
+      while (read(wake_pipe[0], buf, sizeof (buf)) > 0)
+        ;
+
+      pthread_mutex_lock(&server->clients_mutex);
+      for (size_t i = 0; i < server->returned_fds.size(); i++)
+      {
+        pfd.fd = server->returned_fds[i];
+        fds.push_back(pfd);
+      }
+      server->returned_fds.clear();
+      pthread_mutex_unlock(&server->clients_mutex);
+    }
+
+    if (fds[1].revents
+        && !accept_connections(server->listen_fd, &fds))
+    {
+      ret = EXIT_FAILURE;
+      break;
+    }
+
+    for (size_t i = 0; i < fds.size(); i++)
+      fds[i].revents = 0;
+  }
+
+  // cancel running jobs (at the next glyph) and end connections;
+  // responses for canceled jobs can still be written
+  stop_server = 1;
+  queue_close(&server->queue);
+
+  pthread_mutex_lock(&server->clients_mutex);
+  for (int i = 0; i < num_workers; i++)
+    if (server->client_fds[i] >= 0)
+      shutdown(server->client_fds[i], SHUT_RD);
+  pthread_mutex_unlock(&server->clients_mutex);
+
+  for (int i = 0; i < num_workers; i++)
+    pthread_join(workers[i].thread, NULL);
+
+  for (size_t i = 2; i < fds.size(); i++)
+    close(fds[i].fd);
+  for (size_t i = 0; i < server->returned_fds.size(); i++)
+    close(server->returned_fds[i]);
+
+  close(server->listen_fd);
+  unlink(path);
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGHUP, SIG_DFL);
+
+  wake_fd = -1;
+  close(wake_pipe[0]);
+  close(wake_pipe[1]);
+
+  queue_done(&server->queue);
+  pthread_mutex_destroy(&server->clients_mutex);
+  delete[] server->client_fds;
+
+  return ret;
+}
+
+
+int
+run_server(const Server_Options* options,
+           const Hint_Options* defaults)
+{
+  Server_Options opts = *options;
+  Server server;
+  int ret;
+
+  if (opts.num_workers <= 0)
+  {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    opts.num_workers = n > 0 ? int(n) : 1;
+  }
+
+  server.options = &opts;
+  server.defaults = defaults;
+
+  // a client closing its connection early must not terminate the server
+  signal(SIGPIPE, SIG_IGN);
+
+  Worker* workers = new Worker[opts.num_workers];
+  for (int i = 0; i < opts.num_workers; i++)
+  {
+    workers[i].server = &server;
+    workers[i].idx = i;
+  }
+
+  if (!strcmp(opts.address, "-"))
+    ret = run_stdio_server(&server, workers);
+  else
+    ret = run_socket_server(&server, workers);
+
+  delete[] workers;
+
+  return ret;
+}
+
+#endif // HAVE_SERVER
+
+// end of server.cpp
@@ -0,0 +1,95 @@
+// server.h
+
+// Copyright (C) 2022 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <config.h>
+
+#include <stddef.h>
+
+// server mode needs POSIX threads and Unix domain sockets
+#if defined(HAVE_PTHREAD_H) \
+    && defined(HAVE_SYS_SOCKET_H) \
+    && defined(HAVE_SYS_UN_H)
+#  define HAVE_SERVER
+#endif
+
+
+#ifdef HAVE_SERVER
+
+// the hinting parameters of a request; the command line options of
+// `ttfautohint' provide the default values
+typedef struct Hint_Options_
+{
+  int hinting_range_min;
+  int hinting_range_max;
+  int hinting_limit;
+
+  int gray_stem_width_mode;
+  int gdi_cleartype_stem_width_mode;
+  int dw_cleartype_stem_width_mode;
+
+  int increase_x_height;
+  const char* x_height_snapping_exceptions_string;
+  int fallback_stem_width;
+
+  bool ignore_restrictions;
+  bool windows_compatibility;
+  bool adjust_subglyphs;
+  bool hint_composites;
+  bool no_info;
+  bool detailed_info;
+  const char* default_script;
+  const char* fallback_script;
+  bool fallback_scaling;
+  const char* family_suffix;
+  bool symbol;
+  bool dehint;
+  bool TTFA_info;
+
+  unsigned long long epoch;
+} Hint_Options;
+
+
+typedef struct Server_Options_
+{
+  // a file name for a Unix domain socket, or `-' for standard input and
+  // output
+  const char* address;
+
+  // the number of worker threads
+  int num_workers;
+
+  // the maximum time in milliseconds to process a single font;
+  // value 0 means no limit
+  int timeout;
+
+  // the maximum memory in bytes to process a single font;
+  // value 0 means no limit
+  size_t memory_limit;
+} Server_Options;
+
+
+// Run the server; this function returns after standard input has been
+// closed or if the process receives SIGINT or SIGTERM.  The return value
+// is suitable as an exit code.
+int
+run_server(const Server_Options* options,
+           const Hint_Options* defaults);
+
+#endif // HAVE_SERVER
+
+#endif // SERVER_H_
+
+// end of server.h
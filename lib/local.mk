@@ -17,7 +17,8 @@ ABI_AGE = 0
 
 noinst_LTLIBRARIES += \
   lib/libsds.la \
-  lib/libnumberset.la
+  lib/libnumberset.la \
+  lib/libtamemory.la
 
 lib_LTLIBRARIES = lib/libttfautohint.la
 
@@ -34,6 +35,11 @@ lib_libsds_la_SOURCES = \
 lib_libnumberset_la_SOURCES = \
   lib/numberset.c lib/numberset.h
 
+# `sds.c' and `numberset.c' use the library's memory manager, so it must
+# be available to the front end also
+lib_libtamemory_la_SOURCES = \
+  lib/tamemory.c lib/tamemory.h
+
 # We have to bypass automake's default handling of flex (.l) and bison (.y)
 # files, since such files are always treated as traditional lex and yacc
 # files, not allowing for flex and bison extensions.  For this reason, we
@@ -45,9 +51,11 @@ lib_libttfautohint_la_SOURCES = \
   lib/ta.h \
   lib/tablue.c lib/tablue.h \
   lib/tabytecode.c lib/tabytecode.h \
+  lib/tacontext.c \
   lib/tacontrol.c lib/tacontrol.h \
   lib/tacontrol-flex.c lib/tacontrol-flex.h \
   lib/tacontrol-bison.c lib/tacontrol-bison.h \
+  lib/tacoords.c lib/tacoords.h \
   lib/tacvt.c \
   lib/tadsig.c \
   lib/tadummy.c lib/tadummy.h \
@@ -69,16 +77,21 @@ lib_libttfautohint_la_SOURCES = \
   lib/taloca.c \
   lib/tamaxp.c \
   lib/taname.c \
+  lib/tapeephole.c \
   lib/tapost.c \
   lib/taprep.c \
+  lib/taprofile.c \
   lib/taranges.c lib/taranges.h \
   lib/tascript.c \
   lib/tasfnt.c \
   lib/tashaper.c lib/tashaper.h \
   lib/tasort.c lib/tasort.h \
   lib/tastyles.h \
+  lib/tasubr.c \
+  lib/tasubset.c \
   lib/tatables.c lib/tatables.h \
   lib/tatime.c \
+  lib/tatrace.c lib/tatrace.h \
   lib/tattc.c \
   lib/tattf.c \
   lib/tattfa.c \
@@ -117,8 +130,46 @@ EXTRA_DIST += \
   lib/tacontrol.flex lib/tacontrol.bison \
   lib/ttfautohint.pc.in \
   lib/numberset-test.c \
+  lib/talatin-link-bench.c \
+  lib/tapeephole-test.c \
+  lib/tatrace-decode.c \
+  lib/ttfautohint-kernel-bench.c \
+  lib/ttfautohint-render-test.c \
+  lib/ttfautohint-scaling-bench.sh \
+  lib/ttfautohint-shortcut-check.sh \
+  lib/ttfautohint-thread-test.c \
   lib/ttfautohint.h.in
 
+# The font generator is needed by `ttfautohint-shortcut-check.sh'.
+check_PROGRAMS = lib/ttfautohint-font-gen
+
+lib_ttfautohint_font_gen_SOURCES = \
+  lib/ttfautohint-font-gen.c \
+  lib/taranges.c
+lib_ttfautohint_font_gen_CPPFLAGS = \
+  $(AM_CPPFLAGS) \
+  $(FREETYPE_CPPFLAGS)
+lib_ttfautohint_font_gen_LDADD =
+
+# Compare the output of `ttfautohint' with a build configured with
+# `CPPFLAGS=-DTA_NO_OUTLINE_SHORTCUT', given by `TTFAUTOHINT_REF'; the
+# check is skipped if this variable is not set.
+check-local: check-shortcut
+
+check-shortcut: frontend/ttfautohint$(EXEEXT) \
+                lib/ttfautohint-font-gen$(EXEEXT)
+	@if test -z "$(TTFAUTOHINT_REF)"; then \
+	  echo "TTFAUTOHINT_REF not set; skipping outline shortcut check"; \
+	else \
+	  TTFAUTOHINT=frontend/ttfautohint$(EXEEXT) \
+	  TTFAUTOHINT_REF="$(TTFAUTOHINT_REF)" \
+	  FONT_GEN=lib/ttfautohint-font-gen$(EXEEXT) \
+	  $(SHELL) $(srcdir)/lib/ttfautohint-shortcut-check.sh \
+	    $(SHORTCUT_CHECK_FONTS); \
+	fi
+
+.PHONY: check-shortcut
+
 pkgconfigdir = $(libdir)/pkgconfig
 pkgconfig_DATA = lib/ttfautohint.pc
 
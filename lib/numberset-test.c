@@ -17,7 +17,8 @@
  *
  *   $(CC) $(CFLAGS) \
  *         -I.. -I. \
- *         -o numberset-test numberset-test.c numberset.c sds.c
+ *         -o numberset-test numberset-test.c \
+ *            numberset.c sds.c tamemory.c -lpthread
  *
  * after configuration.  The resulting binary aborts with an assertion
  * message in case of an error, otherwise it produces no output.
@@ -23,6 +23,7 @@
 
 #include <sds.h>
 #include <numberset.h>
+#include "tamemory.h"
 
 
 number_range*
@@ -56,7 +57,7 @@ number_set_new(int start,
   if (start < min || end > max)
     return NUMBERSET_INVALID_RANGE;
 
-  nr = (number_range*)malloc(sizeof (number_range));
+  nr = (number_range*)ta_malloc(sizeof (number_range));
   if (!nr)
     return NUMBERSET_ALLOCATION_ERROR;
 
@@ -128,7 +129,7 @@ wrap_range_new(int start,
   if (i == num_wraps)
     return NUMBERSET_INVALID_WRAP_RANGE;
 
-  nr = (number_range*)malloc(sizeof (number_range));
+  nr = (number_range*)ta_malloc(sizeof (number_range));
   if (!nr)
     return NUMBERSET_ALLOCATION_ERROR;
 
@@ -169,7 +170,7 @@ number_set_prepend(number_range* list,
     /* merge adjacent ranges */
     list->end = element->end;
 
-    free(element);
+    ta_free(element);
 
     return list;
   }
@@ -291,14 +292,14 @@ number_set_insert(number_range* list,
     {
       nr->start = element->start;
 
-      free(element);
+      ta_free(element);
 
       if (nr->next
           && nr->next->end + 1 == nr->start)
       {
         element = nr->next;
         element->end = nr->end;
-        free(nr);
+        ta_free(nr);
         return element;
       }
 
@@ -312,7 +313,7 @@ number_set_insert(number_range* list,
       if (nr->end + 1 == element->start)
       {
         nr->end = element->end;
-        free(element);
+        ta_free(element);
         return list;
       }
 
@@ -579,7 +580,7 @@ number_set_parse(const char* s,
     {
       if (number_set)
       {
-        new_range = (number_range*)malloc(sizeof (number_range));
+        new_range = (number_range*)ta_malloc(sizeof (number_range));
         if (!new_range)
         {
           error_code = NUMBERSET_ALLOCATION_ERROR;
@@ -632,7 +633,7 @@ number_set_free(number_range* number_set)
 
     tmp = nr;
     nr = nr->next;
-    free(tmp);
+    ta_free(tmp);
   }
 }
 
@@ -708,7 +709,7 @@ Exit:
   /* we return an empty string for an empty number set */
   /* (this is, number_set == NULL or unsuitable `min' and `max' values) */
   len = sdslen(s) + 1;
-  res = (char*)malloc(len);
+  res = (char*)ta_malloc(len);
   if (res)
     memcpy(res, s, len);
 
@@ -252,10 +252,11 @@ number_set_reverse(number_range* list);
  *
  * If the user provides a non-NULL `number_set' value, `number_set_parse'
  * stores a linked list of ordered number ranges in `*number_set', allocated
- * with `malloc'.  If there is no range at all (for example, an empty string
- * or whitespace and commas only) no data gets allocated, and `*number_set'
- * is set to NULL.  In case of error, `*number_set' returns an error code;
- * you should use the following macros to compare with.
+ * with `ta_malloc' (see `tamemory.h'; this is `malloc' if called outside of
+ * the ttfautohint library).  If there is no range at all (for example, an
+ * empty string or whitespace and commas only) no data gets allocated, and
+ * `*number_set' is set to NULL.  In case of error, `*number_set' returns
+ * an error code; you should use the following macros to compare with.
  *
  *   NUMBERSET_INVALID_CHARACTER   invalid character in description string
  *   NUMBERSET_OVERFLOW            numerical overflow
@@ -302,8 +303,9 @@ number_set_free(number_range* number_set);
 /*
  * Return a string representation of `number_set', viewed through a
  * `window', so to say, spanned up by the parameters `min' and `max'.  After
- * use, the string should be deallocated with a call to `free'.  In case of
- * an allocation error, the return value is NULL.
+ * use, the string should be deallocated with a call to `ta_free' (or
+ * `free' outside of the ttfautohint library).  In case of an allocation
+ * error, the return value is NULL.
  *
  * Note that a negative value for `min' is replaced with zero, and a
  * negative value for `max' with the largest representable integer, INT_MAX.
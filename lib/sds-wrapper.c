@@ -20,6 +20,17 @@
 /* we don't enforce a fully C99-compliant compiler */
 #include <stdarg.h>
 
+/* Route sds's allocations through the library's memory manager.  The */
+/* macros are function-like since `sds.c' has a structure field `free'; */
+/* `stdlib.h' must be included before. */
+#include <stdlib.h>
+#include "tamemory.h"
+
+#define malloc(size) ta_malloc(size)
+#define calloc(nmemb, size) ta_calloc(nmemb, size)
+#define realloc(ptr, size) ta_realloc(ptr, size)
+#define free(ptr) ta_free(ptr)
+
 #include "sds.c"
 
 /* end of sds-wrapper.c */
@@ -22,6 +22,8 @@
 #include FT_FREETYPE_H
 #include FT_TRUETYPE_TABLES_H
 #include FT_TRUETYPE_TAGS_H
+#include FT_INCREMENTAL_H
+#include FT_SIZES_H
 
 #include <ttfautohint.h>
 #include <sds.h>
@@ -119,7 +121,10 @@ typedef struct GLYPH_
   FT_ULong len1; /* number of bytes before instruction related data */
   FT_ULong len2; /* number of bytes after instruction related data; */
                  /* if zero, this indicates a composite glyph */
-  FT_Byte* buf; /* extracted glyph data (without instruction related data) */
+  FT_Byte* buf; /* glyph data before instruction related data */
+  FT_Byte* buf2; /* glyph data after instruction related data */
+  FT_Bool owns_buf; /* if not set, `buf' and `buf2' point into */
+                    /* the `glyf' table instead of allocated memory */
   FT_ULong flags_offset; /* offset to last flag in a composite glyph */
 
   FT_Byte ins_extra_len; /* number of extra instructions */
@@ -140,6 +145,27 @@ typedef struct GLYPH_
   FT_UShort num_composite_contours; /* after recursion */
 } GLYPH;
 
+/* the per-glyph data collected for option `profile-file'; */
+/* the outline counts are taken at the smallest hinting PPEM */
+typedef struct Glyph_Profile_
+{
+  double time; /* wall time in milliseconds */
+
+  FT_UInt num_points;
+  FT_UInt num_segments;
+  FT_UInt num_edges;
+
+  FT_UInt num_action_hints_records;
+  FT_UInt num_point_hints_records;
+  FT_UInt num_delta_exceptions;
+
+  FT_UInt ins_len;
+  FT_UInt final_ins_len; /* after extracting subroutines */
+
+  /* the glyph whose bytecode got reused, or -1 */
+  FT_Long copy_of;
+} Glyph_Profile;
+
 /* a representation of the data in the `glyf' table */
 typedef struct glyf_Data_
 {
@@ -159,6 +185,10 @@ typedef struct glyf_Data_
   FT_ULong fpgm_idx;
   FT_ULong prep_idx;
 
+  /* the number of functions appended to the `fpgm' table */
+  /* by `TA_sfnt_extract_subroutines' */
+  FT_UInt num_subroutines;
+
   /* styles present in a font get a running number; */
   /* unavailable styles get value 0xFFFF */
   FT_UInt style_ids[TA_STYLE_MAX];
@@ -188,6 +218,10 @@ typedef struct SFNT_Table_
 /* represent table info records of the TTF header */
 typedef FT_ULong SFNT_Table_Info;
 
+/* a context for hinting part of the hinting range in a separate thread; */
+/* the structure is defined in `tabytecode.c' */
+typedef struct Shard_ Shard;
+
 /* this structure is used to model a TTF or a subfont within a TTC */
 typedef struct SFNT_
 {
@@ -215,15 +249,62 @@ typedef struct SFNT_
   FT_UShort max_twilight_points;
   FT_UShort max_instructions;
   FT_UShort max_components;
+
+  /* the corresponding subfont of the previous font (if any) */
+  /* together with its unmodified `glyf' and `loca' tables */
+  FT_Face previous;
+  FT_Byte* previous_glyf;
+  FT_ULong previous_glyf_len;
+  FT_Byte* previous_loca;
+  FT_ULong previous_loca_len;
+  FT_Bool previous_long_offsets;
+  /* for each glyph, a flag whether its bytecode must be regenerated */
+  FT_Byte* previous_rehint;
+
+  /* used by `TTF_autohint_glyph' to replace glyph data */
+  FT_Incremental incremental;
+
+  /* one FreeType size object per PPEM value of the hinting range, */
+  /* created on demand by `TA_sfnt_activate_size' */
+  FT_Size* sizes;
+
+  /* contexts for the additional threads of option `hinting-threads' */
+  Shard* shards;
+  FT_UInt num_shards;
+
+  /* per-glyph data of option `profile-file' */
+  Glyph_Profile* profile;
+  FT_UInt num_profile;
+
+  /* statistics of `TA_sfnt_optimize_bytecode'; */
+  /* the step counts are summed over the hinting range */
+  FT_ULong bytecode_len_before;
+  FT_ULong bytecode_len_after;
+  FT_ULong bytecode_steps_before;
+  FT_ULong bytecode_steps_after;
 } SFNT;
 
 typedef struct Control_ Control;
 
+/* a growable buffer to emit the bytecode of a glyph; */
+/* `TA_bytecode_buffer_reserve' must be called before writing to it */
+typedef struct Bytecode_Buffer_
+{
+  FT_Byte* buf;
+  FT_ULong size; /* number of allocated bytes */
+  FT_Error error; /* set if a reservation has failed */
+} Bytecode_Buffer;
+
 /* our font object; the `FONT' typedef is in `taloader.h' */
 struct FONT_
 {
   FT_Library lib;
 
+  /* the memory manager of this font; */
+  /* `ft_memory' routes FreeType's allocations to it */
+  TA_Memory memory;
+  struct FT_MemoryRec_ ft_memory;
+
   FT_Byte* in_buf;
   size_t in_len;
 
@@ -240,6 +321,13 @@ struct FONT_
   FT_Long reference_index;
   const char* reference_name;
 
+  /* a font previously created by ttfautohint, */
+  /* used to reuse bytecode of glyphs not in `glyph_subset' */
+  FT_Byte* previous_buf;
+  size_t previous_len;
+  number_range* glyph_subset;
+  number_range* glyph_subset_control; /* glyphs with changed control data */
+
   SFNT* sfnts;
   FT_Long num_sfnts;
 
@@ -265,6 +353,13 @@ struct FONT_
 
   TA_LoaderRec loader[1]; /* the interface to the autohinter */
 
+  /* reused for the bytecode of all glyphs */
+  Bytecode_Buffer bytecode_buffer;
+
+  /* the binary replacement of the debugging output; */
+  /* active if `trace.file' is set */
+  TA_TraceRec trace;
+
   /* configuration options */
   TA_Progress_Func progress;
   void* progress_data;
@@ -276,6 +371,9 @@ struct FONT_
   FT_UInt hinting_range_min;
   FT_UInt hinting_range_max;
   FT_UInt hinting_limit;
+  FT_UInt hinting_threads;
+  FILE* profile_file;
+  FT_UInt profile_top;
   FT_UInt increase_x_height;
   number_range* x_height_snapping_exceptions;
   FT_UInt fallback_stem_width;
@@ -319,6 +417,17 @@ TA_get_current_time(FONT* font,
                     FT_ULong* high,
                     FT_ULong* low);
 
+double
+TA_profile_time(void);
+FT_Error
+TA_sfnt_init_profile(SFNT* sfnt,
+                     FONT* font);
+void
+TA_sfnt_finish_profile(SFNT* sfnt,
+                       FONT* font);
+FT_Error
+TA_font_write_profile(FONT* font);
+
 FT_Byte*
 TA_build_push(FT_Byte* bufp,
               FT_UInt* args,
@@ -326,14 +435,26 @@ TA_build_push(FT_Byte* bufp,
               FT_Bool need_words,
               FT_Bool optimize);
 
+FT_Byte*
+TA_bytecode_buffer_reserve(Bytecode_Buffer* buffer,
+                           FT_Byte* bufp,
+                           FT_ULong len);
+
 FT_Error
 TA_font_init(FONT* font);
+void*
+TA_font_allocate(FONT* font,
+                 size_t size);
+void
+TA_font_deallocate(FONT* font,
+                   void* block);
 void
 TA_font_unload(FONT* font,
                const char* in_buf,
                char** out_bufp,
                const char* control_buf,
-               const char* reference_buf);
+               const char* reference_buf,
+               const char* previous_buf);
 
 FT_Error
 TA_font_file_read(FILE* file,
@@ -355,6 +476,21 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
                                  FONT* font,
                                  FT_Long idx);
 
+#ifdef HAVE_PTHREAD_H
+void
+TA_sfnt_free_shards(SFNT* sfnt);
+#endif
+
+FT_Error
+TA_sfnt_extract_subroutines(SFNT* sfnt,
+                            FONT* font);
+
+FT_Error
+TA_sfnt_optimize_bytecode(SFNT* sfnt,
+                          FONT* font,
+                          FT_Byte* buf,
+                          FT_UInt* len);
+
 FT_Error
 TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
                                FONT* font);
@@ -412,6 +548,11 @@ FT_Error
 TA_sfnt_build_loca_table(SFNT* sfnt,
                          FONT* font);
 
+void
+TA_sfnt_fill_maxp_buffer(SFNT* sfnt,
+                         FONT* font,
+                         FT_Byte* buf);
+
 FT_Error
 TA_sfnt_update_maxp_table(SFNT* sfnt,
                           FONT* font);
@@ -428,6 +569,26 @@ FT_Error
 TA_sfnt_build_prep_table(SFNT* sfnt,
                          FONT* font);
 
+FT_Error
+TA_sfnt_open_incremental_face(SFNT* sfnt,
+                              FONT* font);
+TA_Error
+TA_context_new(TA_Context* contextp,
+               FONT* font,
+               const char* in_buf,
+               const char* control_buf,
+               const char* reference_buf);
+
+FT_Error
+TA_font_check_previous_TTFA(FONT* font);
+FT_Error
+TA_sfnt_check_previous_tables(SFNT* sfnt,
+                              FONT* font);
+FT_Error
+TA_sfnt_copy_previous_instructions(SFNT* sfnt,
+                                   FONT* font,
+                                   FT_Long idx);
+
 FT_Error
 TA_sfnt_build_TTF_header(SFNT* sfnt,
                          FONT* font,
@@ -17,6 +17,10 @@
 
 #include <stdbool.h> /* for llrb.h */
 
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+
 #include "llrb.h" /* a red-black tree implementation */
 #include "tahints.h"
 
@@ -25,12 +29,13 @@
 
 
 #ifdef TA_DEBUG
-int _ta_debug = 0;
-int _ta_debug_global = 0;
-int _ta_debug_disable_horz_hints;
-int _ta_debug_disable_vert_hints;
-int _ta_debug_disable_blue_hints;
-void* _ta_debug_hints;
+TA_THREAD_LOCAL int _ta_debug = 0;
+TA_THREAD_LOCAL int _ta_debug_global = 0;
+TA_THREAD_LOCAL int _ta_debug_disable_horz_hints;
+TA_THREAD_LOCAL int _ta_debug_disable_vert_hints;
+TA_THREAD_LOCAL int _ta_debug_disable_blue_hints;
+TA_THREAD_LOCAL void* _ta_debug_hints;
+TA_THREAD_LOCAL void* _ta_debug_trace;
 #endif
 
 
@@ -168,7 +173,7 @@ typedef struct Recorder_
 
 /* this is the bytecode of the `.ttfautohint' glyph */
 
-FT_Byte ttfautohint_glyph_bytecode[7] =
+const FT_Byte ttfautohint_glyph_bytecode[7] =
 {
 
   /* increment `cvtl_is_subglyph' counter */
@@ -184,7 +189,7 @@ FT_Byte ttfautohint_glyph_bytecode[7] =
 
 
 /* if we have y delta exceptions before IUP_y, this code gets inserted */
-static FT_Byte ins_extra_delta_exceptions[4] =
+static const FT_Byte ins_extra_delta_exceptions[4] =
 {
 
   /* tell bci_{scale,scale_composite,hint}_glyph to not call IUP_y */
@@ -197,7 +202,7 @@ static FT_Byte ins_extra_delta_exceptions[4] =
 
 
 /* if we have a non-base glyph, this code gets inserted */
-static FT_Byte ins_extra_ignore_std_width[4] =
+static const FT_Byte ins_extra_ignore_std_width[4] =
 {
 
   /* tell bci_{smooth,strong}_stem_width to ignore std_width */
@@ -273,121 +278,71 @@ TA_build_push(FT_Byte* bufp,
 }
 
 
-/*
- * We optimize two common cases, replacing
- *
- *   NPUSHB A ... NPUSHB B [... NPUSHB C] ... CALL
- *
- * with
- *
- *   NPUSHB (A+B[+C]) ... CALL
- *
- * if possible
- */
+/* the maximum number of bytes `TA_build_push' needs for `num_args' */
+#define BUILD_PUSH_MAX_LEN(num_args) \
+          (2 * (num_args) + 2 * (((num_args) + 254) / 255))
 
-static FT_Byte*
-TA_optimize_push(FT_Byte* buf,
-                 FT_Byte** pos)
-{
-  FT_Byte sizes[3];
-  FT_Byte new_size1;
-  FT_Byte new_size2;
 
-  FT_UInt sum;
-  FT_UInt i;
-  FT_UInt pos_idx;
+/*
+ * The `glyf' table stores the bytecode length of a glyph in a 16bit
+ * field.  Hints records, which are temporarily stored in the bytecode
+ * buffer, use two bytes per value, thus we allow twice this size.
+ */
+#define BYTECODE_BUFFER_MAX (2 * 0xFFFFUL)
 
-  FT_Byte* p;
-  FT_Byte* bufp;
+/* this covers most glyphs without reallocation */
+#define BYTECODE_BUFFER_INITIAL_SIZE 4096
 
 
-  /* XXX improve handling of NPUSHW */
-  if (*(pos[0]) == NPUSHW
-      || *(pos[1]) == NPUSHW
-      || *(pos[2]) == NPUSHW)
-    return buf;
+/*
+ * make sure that `buffer' can hold `len' more bytes starting at `bufp'
+ * (which must point into `buffer->buf', or be equal to it if the buffer
+ * is still empty), growing the buffer geometrically if necessary;
+ * the return value is `bufp' adjusted to the (possibly moved) buffer, or
+ * NULL in case of error, which is then stored in `buffer->error' also
+ */
 
-  /* the point hints records block can be missing */
-  if (pos[0] == pos[1])
-  {
-    pos[1] = pos[2];
-    pos[2] = NULL;
-  }
+FT_Byte*
+TA_bytecode_buffer_reserve(Bytecode_Buffer* buffer,
+                           FT_Byte* bufp,
+                           FT_ULong len)
+{
+  FT_ULong used;
+  FT_ULong new_size;
+  FT_Byte* new_buf;
 
-  /* only needed for the algorithm loops below */
-  pos[3] = NULL;
 
-  /* there are at least two NPUSHB instructions */
-  /* (one of them directly at the start) */
-  sizes[0] = *(pos[0] + 1);
-  sizes[1] = *(pos[1] + 1);
-  sizes[2] = pos[2] ? *(pos[2] + 1) : 0;
+  if (buffer->error)
+    return NULL;
 
-  sum = sizes[0] + sizes[1] + sizes[2];
+  used = buffer->buf ? (FT_ULong)(bufp - buffer->buf) : 0;
 
-  if (sum > 2 * 0xFF)
-    return buf; /* nothing to do since we need three NPUSHB */
-  else if (!sizes[2] && (sum > 0xFF))
-    return buf; /* nothing to do since we need two NPUSHB */
+  if (len <= buffer->size - used)
+    return bufp;
 
-  if (sum > 0xFF)
-  {
-    /* reduce three NPUSHB to two */
-    new_size1 = 0xFF;
-    new_size2 = (FT_Byte)(sum - 0xFF);
-  }
-  else
+  if (len > BYTECODE_BUFFER_MAX - used)
   {
-    /* reduce two or three NPUSHB to one */
-    new_size1 = (FT_Byte)sum;
-    new_size2 = 0;
+    buffer->error = TA_Err_Hinter_Overflow;
+    return NULL;
   }
 
-  /* pack data */
-  p = buf;
-  bufp = buf;
-  pos_idx = 0;
-
-  if (new_size1 <= 8)
-    BCI(PUSHB_1 - 1 + new_size1);
-  else
-  {
-    BCI(NPUSHB);
-    BCI(new_size1);
-  }
-  for (i = 0; i < new_size1; i++)
-  {
-    if (p == pos[pos_idx])
-    {
-      pos_idx++;
-      p += 2; /* skip old NPUSHB */
-    }
-    *(bufp++) = *(p++);
-  }
+  new_size = buffer->size ? buffer->size : BYTECODE_BUFFER_INITIAL_SIZE;
+  while (new_size < used + len)
+    new_size *= 2;
+  if (new_size > BYTECODE_BUFFER_MAX)
+    new_size = BYTECODE_BUFFER_MAX;
 
-  if (new_size2)
+  new_buf = (FT_Byte*)ta_realloc(buffer->buf, new_size);
+  if (!new_buf)
   {
-    if (new_size2 <= 8)
-      BCI(PUSHB_1 - 1 + new_size2);
-    else
-    {
-      BCI(NPUSHB);
-      BCI(new_size2);
-    }
-    for (i = 0; i < new_size2; i++)
-    {
-      if (p == pos[pos_idx])
-      {
-        pos_idx++;
-        p += 2;
-      }
-      *(bufp++) = *(p++);
-    }
+    buffer->error = FT_Err_Out_Of_Memory;
+    return NULL;
   }
 
-  BCI(CALL);
+  buffer->buf = new_buf;
+  buffer->size = new_size;
 
-  return bufp;
+  return new_buf + used;
 }
 
 
@@ -445,10 +400,10 @@ TA_get_segment_index(TA_Segment segment,
 static FT_Byte*
 TA_sfnt_build_glyph_segments(SFNT* sfnt,
                              Recorder* recorder,
-                             FT_Byte* bufp,
-                             FT_Bool optimize)
+                             FT_Byte* bufp)
 {
   FONT* font = recorder->font;
+  Bytecode_Buffer* buffer = &font->bytecode_buffer;
   TA_GlyphHints hints = &font->loader->hints;
   TA_AxisHints axis = &hints->axis[TA_DIMENSION_VERT];
   TA_Point points = hints->points;
@@ -522,9 +477,12 @@ TA_sfnt_build_glyph_segments(SFNT* sfnt,
   /* collect all arguments temporarily in an array (in reverse order) */
   /* so that we can easily split into chunks of 255 args */
   /* as needed by NPUSHB and NPUSHW, respectively */
-  args = (FT_UInt*)malloc(num_args * sizeof (FT_UInt));
+  args = (FT_UInt*)ta_malloc(num_args * sizeof (FT_UInt));
   if (!args)
+  {
+    buffer->error = FT_Err_Out_Of_Memory;
     return NULL;
+  }
 
   arg = args + num_args - 1;
 
@@ -638,10 +596,19 @@ TA_sfnt_build_glyph_segments(SFNT* sfnt,
     }
   }
 
+  bufp = TA_bytecode_buffer_reserve(buffer,
+                                    bufp,
+                                    BUILD_PUSH_MAX_LEN(num_args) + 1);
+  if (!bufp)
+  {
+    ta_free(args);
+    return NULL;
+  }
+
   /* with most fonts it is very rare */
   /* that any of the pushed arguments is larger than 0xFF, */
   /* thus we refrain from further optimizing this case */
-  bufp = TA_build_push(bufp, args, num_args, need_words, optimize);
+  bufp = TA_build_push(bufp, args, num_args, need_words, 1);
 
   BCI(CALL);
 
@@ -662,7 +629,7 @@ TA_sfnt_build_glyph_segments(SFNT* sfnt,
   if (num_stack_elements > sfnt->max_stack_elements)
     sfnt->max_stack_elements = num_stack_elements;
 
-  free(args);
+  ta_free(args);
 
   return bufp;
 }
@@ -750,6 +717,7 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
   GLYPH* glyph = &data->glyphs[idx];
 
   FT_Face face = font->loader->face;
+  Bytecode_Buffer* buffer = &font->bytecode_buffer;
 
   unsigned int num_points;
   int i;
@@ -799,14 +767,15 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
     {
       for (i = 0; i < 6; i++)
       {
-        /* see the comment on allocating `ins_buf' in function */
-        /* `TA_sfnt_build_glyph_instructions' for more on the array sizes; */
+        /* a DELTA instruction covers 16 ppem values, */
+        /* needing two arguments for each point and ppem value; */
         /* we have to increase by 2 to push the number of argument pairs */
         /* and the function for a LOOPCALL instruction */
-        delta_before_IUP_args[i] = (FT_UInt*)malloc((16 * 2 * num_points + 2)
-                                                    * sizeof (FT_UInt));
+        delta_before_IUP_args[i] =
+          (FT_UInt*)ta_malloc((16 * 2 * num_points + 2) * sizeof (FT_UInt));
         if (!delta_before_IUP_args[i])
         {
+          buffer->error = FT_Err_Out_Of_Memory;
           bufp = NULL;
           goto Done;
         }
@@ -822,10 +791,11 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
       {
         /* we have to increase by 1 for the number of argument pairs */
         /* as needed by the DELTA instructions */
-        delta_after_IUP_args[i] = (FT_UInt*)malloc((16 * 2 * num_points + 1)
-                                                   * sizeof (FT_UInt));
+        delta_after_IUP_args[i] = (FT_UInt*)ta_malloc((16 * 2 * num_points + 1)
+                                                      * sizeof (FT_UInt));
         if (!delta_after_IUP_args[i])
         {
+          buffer->error = FT_Err_Out_Of_Memory;
           bufp = NULL;
           goto Done;
         }
@@ -838,6 +808,9 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
     /* and the control instruction entries have the same order, */
     /* we don't need to test for equality of font and glyph indices: */
     /* at this very point in the code we certainly have a hit */
+    if (sfnt->profile)
+      sfnt->profile[idx].num_delta_exceptions++;
+
     if (ctrl->type == Control_Delta_before_IUP)
     {
       build_delta_exception(ctrl,
@@ -916,9 +889,10 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
         continue;
 
       num_args_new = num_args + num_delta_before_IUP_args[i];
-      args_new = (FT_UInt*)realloc(args, num_args_new * sizeof (FT_UInt));
+      args_new = (FT_UInt*)ta_realloc(args, num_args_new * sizeof (FT_UInt));
       if (!args_new)
       {
+        buffer->error = FT_Err_Out_Of_Memory;
         bufp = NULL;
         goto Done;
       }
@@ -933,6 +907,12 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
 
     num_before_IUP_stack_elements = (FT_UShort)num_args;
 
+    bufp = TA_bytecode_buffer_reserve(buffer,
+                                      bufp,
+                                      BUILD_PUSH_MAX_LEN(num_args));
+    if (!bufp)
+      goto Done;
+
     bufp = TA_build_push(bufp, args, num_args, need_before_IUP_words, 1);
   }
   else
@@ -950,6 +930,13 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
 
       num_delta_arg = num_delta_before_IUP_args[i] - 2;
 
+      bufp = TA_bytecode_buffer_reserve(buffer,
+                                        bufp,
+                                        BUILD_PUSH_MAX_LEN(num_delta_arg)
+                                          + 5);
+      if (!bufp)
+        goto Done;
+
       bufp = TA_build_push(bufp,
                            delta_before_IUP_args[i],
                            num_delta_arg,
@@ -969,6 +956,11 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
     }
   }
 
+  /* the next block emits at most 9 bytes */
+  bufp = TA_bytecode_buffer_reserve(buffer, bufp, 9);
+  if (!bufp)
+    goto Done;
+
   /* emit y DELTA opcodes (via `bci_deltap[1-3]' functions) */
   if (num_delta_before_IUP_args[5])
     BCI(LOOPCALL);
@@ -1016,9 +1008,10 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
         continue;
 
       num_args_new = num_args + num_delta_after_IUP_args[i];
-      args_new = (FT_UInt*)realloc(args, num_args_new * sizeof (FT_UInt));
+      args_new = (FT_UInt*)ta_realloc(args, num_args_new * sizeof (FT_UInt));
       if (!args_new)
       {
+        buffer->error = FT_Err_Out_Of_Memory;
         bufp = NULL;
         goto Done;
       }
@@ -1033,6 +1026,12 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
 
     num_after_IUP_stack_elements = (FT_UShort)num_args;
 
+    bufp = TA_bytecode_buffer_reserve(buffer,
+                                      bufp,
+                                      BUILD_PUSH_MAX_LEN(num_args));
+    if (!bufp)
+      goto Done;
+
     bufp = TA_build_push(bufp, args, num_args, need_after_IUP_words, 1);
   }
   else
@@ -1050,6 +1049,13 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
 
       num_delta_arg = num_delta_after_IUP_args[i] - 1;
 
+      bufp = TA_bytecode_buffer_reserve(buffer,
+                                        bufp,
+                                        BUILD_PUSH_MAX_LEN(num_delta_arg)
+                                          + 3);
+      if (!bufp)
+        goto Done;
+
       bufp = TA_build_push(bufp,
                            delta_after_IUP_args[i],
                            num_delta_arg,
@@ -1065,6 +1071,11 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
     }
   }
 
+  /* the rest of this function emits at most 11 bytes */
+  bufp = TA_bytecode_buffer_reserve(buffer, bufp, 11);
+  if (!bufp)
+    goto Done;
+
   /* emit y DELTA opcodes */
   if (num_delta_after_IUP_args[5])
     BCI(DELTAP3);
@@ -1098,10 +1109,11 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
 
     ins_extra_len_new = glyph->ins_extra_len
                         + sizeof (ins_extra_delta_exceptions);
-    ins_extra_buf_new = (FT_Byte*)realloc(glyph->ins_extra_buf,
-                                          ins_extra_len_new);
+    ins_extra_buf_new = (FT_Byte*)ta_realloc(glyph->ins_extra_buf,
+                                             ins_extra_len_new);
     if (!ins_extra_buf_new)
     {
+      buffer->error = FT_Err_Out_Of_Memory;
       bufp = NULL;
       goto Done;
     }
@@ -1125,10 +1137,10 @@ TA_sfnt_build_delta_exceptions(SFNT* sfnt,
 Done:
   for (i = 0; i < 6; i++)
   {
-    free(delta_before_IUP_args[i]);
-    free(delta_after_IUP_args[i]);
+    ta_free(delta_before_IUP_args[i]);
+    ta_free(delta_after_IUP_args[i]);
   }
-  free(args);
+  ta_free(args);
 
   if (num_before_IUP_stack_elements > sfnt->max_stack_elements)
     sfnt->max_stack_elements = num_before_IUP_stack_elements;
@@ -1145,6 +1157,7 @@ TA_sfnt_build_glyph_scaler(SFNT* sfnt,
                            FT_Byte* bufp)
 {
   FONT* font = recorder->font;
+  Bytecode_Buffer* buffer = &font->bytecode_buffer;
   FT_GlyphSlot glyph = sfnt->face->glyph;
   FT_Vector* points = glyph->outline.points;
   FT_UInt num_contours = (FT_UInt)glyph->outline.n_contours;
@@ -1165,9 +1178,12 @@ TA_sfnt_build_glyph_scaler(SFNT* sfnt,
   /* collect all arguments temporarily in an array (in reverse order) */
   /* so that we can easily split into chunks of 255 args */
   /* as needed by NPUSHB and NPUSHW, respectively */
-  args = (FT_UInt*)malloc(num_args * sizeof (FT_UInt));
+  args = (FT_UInt*)ta_malloc(num_args * sizeof (FT_UInt));
   if (!args)
+  {
+    buffer->error = FT_Err_Out_Of_Memory;
     return NULL;
+  }
 
   arg = args + num_args - 1;
 
@@ -1216,6 +1232,15 @@ TA_sfnt_build_glyph_scaler(SFNT* sfnt,
   if (end > 0xFF)
     need_words = 1;
 
+  bufp = TA_bytecode_buffer_reserve(buffer,
+                                    bufp,
+                                    BUILD_PUSH_MAX_LEN(num_args) + 1);
+  if (!bufp)
+  {
+    ta_free(args);
+    return NULL;
+  }
+
   /* with most fonts it is very rare */
   /* that any of the pushed arguments is larger than 0xFF, */
   /* thus we refrain from further optimizing this case */
@@ -1231,7 +1256,7 @@ TA_sfnt_build_glyph_scaler(SFNT* sfnt,
   if (num_stack_elements > sfnt->max_stack_elements)
     sfnt->max_stack_elements = num_stack_elements;
 
-  free(args);
+  ta_free(args);
 
   return bufp;
 }
@@ -1243,6 +1268,7 @@ TA_font_build_subglyph_shifter(FONT* font,
 {
   FT_Face face = font->loader->face;
   FT_GlyphSlot glyph = face->glyph;
+  Bytecode_Buffer* buffer = &font->bytecode_buffer;
 
   TA_GlyphLoader gloader = font->loader->gloader;
 
@@ -1266,7 +1292,10 @@ TA_font_build_subglyph_shifter(FONT* font,
     /* load subglyph to get the number of contours */
     error = FT_Load_Glyph(face, (FT_UInt)subglyph->index, FT_LOAD_NO_SCALE);
     if (error)
+    {
+      buffer->error = error;
       return NULL;
+    }
     num_contours = glyph->outline.n_contours;
 
     /* nothing to do if there is a point-to-point alignment */
@@ -1284,6 +1313,11 @@ TA_font_build_subglyph_shifter(FONT* font,
     /* note that calling `FT_Load_Glyph' without FT_LOAD_NO_RECURSE */
     /* ensures that composite subglyphs are represented as simple glyphs */
 
+    /* we emit at most 11 bytes */
+    bufp = TA_bytecode_buffer_reserve(buffer, bufp, 11);
+    if (!bufp)
+      return NULL;
+
     if (num_contours > 0xFF
         || curr_contour > 0xFF)
     {
@@ -1339,17 +1373,19 @@ TA_font_build_subglyph_shifter(FONT* font,
  * pair contains an inner loop to emit the correponding points.
  */
 
-static void
+static FT_Error
 TA_build_point_hints(Recorder* recorder,
                      TA_GlyphHints hints)
 {
   TA_AxisHints axis = &hints->axis[TA_DIMENSION_VERT];
   TA_Edge edges = axis->edges;
 
+  Bytecode_Buffer* buffer = &recorder->font->bytecode_buffer;
   FT_Byte* p = recorder->hints_record.buf;
 
   FT_UShort i;
   FT_UShort j;
+  FT_UInt num_points;
 
   FT_UShort prev_edge;
   FT_UShort prev_before_edge;
@@ -1385,6 +1421,10 @@ TA_build_point_hints(Recorder* recorder,
     FT_UShort edge_first_idx;
 
 
+    p = TA_bytecode_buffer_reserve(buffer, p, 6 + 2 * (FT_ULong)i);
+    if (!p)
+      return buffer->error;
+
     recorder->hints_record.num_actions++;
 
     edge = edges;
@@ -1433,6 +1473,10 @@ TA_build_point_hints(Recorder* recorder,
     FT_UShort edge_first_idx;
 
 
+    p = TA_bytecode_buffer_reserve(buffer, p, 6 + 2 * (FT_ULong)i);
+    if (!p)
+      return buffer->error;
+
     recorder->hints_record.num_actions++;
 
     edge = edges + axis->num_edges - 1;
@@ -1465,6 +1509,7 @@ TA_build_point_hints(Recorder* recorder,
 
   prev_edge = 0xFFFF;
   i = 0;
+  num_points = 0;
   for (on_node = LLRB_MIN(ip_on_points,
                           &recorder->ip_on_points_head);
        on_node;
@@ -1478,10 +1523,17 @@ TA_build_point_hints(Recorder* recorder,
       i++;
       prev_edge = on_node->edge;
     }
+    num_points++;
   }
 
   if (i)
   {
+    p = TA_bytecode_buffer_reserve(buffer,
+                                   p,
+                                   4 + 4 * (FT_ULong)i + 2 * num_points);
+    if (!p)
+      return buffer->error;
+
     recorder->hints_record.num_actions++;
 
     *(p++) = 0;
@@ -1557,6 +1609,7 @@ TA_build_point_hints(Recorder* recorder,
   prev_before_edge = 0xFFFF;
   prev_after_edge = 0xFFFF;
   i = 0;
+  num_points = 0;
   for (between_node = LLRB_MIN(ip_between_points,
                                &recorder->ip_between_points_head);
        between_node;
@@ -1572,10 +1625,17 @@ TA_build_point_hints(Recorder* recorder,
       prev_before_edge = between_node->before_edge;
       prev_after_edge = between_node->after_edge;
     }
+    num_points++;
   }
 
   if (i)
   {
+    p = TA_bytecode_buffer_reserve(buffer,
+                                   p,
+                                   4 + 6 * (FT_ULong)i + 2 * num_points);
+    if (!p)
+      return buffer->error;
+
     recorder->hints_record.num_actions++;
 
     *(p++) = 0;
@@ -1655,6 +1715,8 @@ TA_build_point_hints(Recorder* recorder,
   }
 
   recorder->hints_record.buf = p;
+
+  return FT_Err_Ok;
 }
 
 
@@ -1691,7 +1753,8 @@ TA_add_hints_record(Hints_Record** hints_records,
 {
   Hints_Record* hints_records_new;
   FT_UInt buf_len;
-  /* at this point, `hints_record.buf' still points into `ins_buf' */
+  /* at this point, `hints_record.buf' */
+  /* still points into the bytecode buffer */
   FT_Byte* end = hints_record.buf;
 
 
@@ -1699,7 +1762,7 @@ TA_add_hints_record(Hints_Record** hints_records,
 
   /* now fill the structure completely */
   hints_record.buf_len = buf_len;
-  hints_record.buf = (FT_Byte*)malloc(buf_len);
+  hints_record.buf = (FT_Byte*)ta_malloc(buf_len);
   if (!hints_record.buf)
     return FT_Err_Out_Of_Memory;
 
@@ -1707,11 +1770,11 @@ TA_add_hints_record(Hints_Record** hints_records,
 
   (*num_hints_records)++;
   hints_records_new =
-    (Hints_Record*)realloc(*hints_records, *num_hints_records
-                                           * sizeof (Hints_Record));
+    (Hints_Record*)ta_realloc(*hints_records, *num_hints_records
+                                              * sizeof (Hints_Record));
   if (!hints_records_new)
   {
-    free(hints_record.buf);
+    ta_free(hints_record.buf);
     (*num_hints_records)--;
     return FT_Err_Out_Of_Memory;
   }
@@ -1727,9 +1790,10 @@ TA_add_hints_record(Hints_Record** hints_records,
 static FT_Byte*
 TA_emit_hints_record(Recorder* recorder,
                      Hints_Record* hints_record,
-                     FT_Byte* bufp,
-                     FT_Bool optimize)
+                     FT_Byte* bufp)
 {
+  Bytecode_Buffer* buffer = &recorder->font->bytecode_buffer;
+
   FT_Byte* p;
   FT_Byte* endp;
   FT_Bool need_words = 0;
@@ -1755,13 +1819,19 @@ TA_emit_hints_record(Recorder* recorder,
   num_arguments = hints_record->buf_len / 2;
   p = endp - 2;
 
+  bufp = TA_bytecode_buffer_reserve(buffer,
+                                    bufp,
+                                    BUILD_PUSH_MAX_LEN(num_arguments));
+  if (!bufp)
+    return NULL;
+
   if (need_words)
   {
     for (i = 0; i < num_arguments; i += 255)
     {
       num_args = (num_arguments - i > 255) ? 255 : (num_arguments - i);
 
-      if (optimize && num_args <= 8)
+      if (num_args <= 8)
         BCI(PUSHW_1 - 1 + num_args);
       else
       {
@@ -1785,7 +1855,7 @@ TA_emit_hints_record(Recorder* recorder,
     {
       num_args = (num_arguments - i > 255) ? 255 : (num_arguments - i);
 
-      if (optimize && num_args <= 8)
+      if (num_args <= 8)
         BCI(PUSHB_1 - 1 + num_args);
       else
       {
@@ -1812,9 +1882,10 @@ static FT_Byte*
 TA_emit_hints_records(Recorder* recorder,
                       Hints_Record* hints_records,
                       FT_UInt num_hints_records,
-                      FT_Byte* bufp,
-                      FT_Bool optimize)
+                      FT_Byte* bufp)
 {
+  Bytecode_Buffer* buffer = &recorder->font->bytecode_buffer;
+
   FT_UInt i;
   Hints_Record* hints_record;
 
@@ -1825,6 +1896,10 @@ TA_emit_hints_records(Recorder* recorder,
   /* with the ppem size as the condition */
   for (i = 0; i < num_hints_records - 1; i++)
   {
+    bufp = TA_bytecode_buffer_reserve(buffer, bufp, 6);
+    if (!bufp)
+      return NULL;
+
     BCI(MPPEM);
     if (hints_record->size > 0xFF)
     {
@@ -1839,13 +1914,26 @@ TA_emit_hints_records(Recorder* recorder,
     }
     BCI(LT);
     BCI(IF);
-    bufp = TA_emit_hints_record(recorder, hints_record, bufp, optimize);
+    bufp = TA_emit_hints_record(recorder, hints_record, bufp);
+    if (!bufp)
+      return NULL;
+
+    bufp = TA_bytecode_buffer_reserve(buffer, bufp, 1);
+    if (!bufp)
+      return NULL;
+
     BCI(ELSE);
 
     hints_record++;
   }
 
-  bufp = TA_emit_hints_record(recorder, hints_record, bufp, optimize);
+  bufp = TA_emit_hints_record(recorder, hints_record, bufp);
+  if (!bufp)
+    return NULL;
+
+  bufp = TA_bytecode_buffer_reserve(buffer, bufp, num_hints_records - 1);
+  if (!bufp)
+    return NULL;
 
   for (i = 0; i < num_hints_records - 1; i++)
     BCI(EIF);
@@ -1862,9 +1950,9 @@ TA_free_hints_records(Hints_Record* hints_records,
 
 
   for (i = 0; i < num_hints_records; i++)
-    free(hints_records[i].buf);
+    ta_free(hints_records[i].buf);
 
-  free(hints_records);
+  ta_free(hints_records);
 }
 
 
@@ -2028,7 +2116,7 @@ TA_hints_recorder(TA_Action action,
       TA_Point point = (TA_Point)arg1;
 
 
-      before_node = (Node1*)malloc(sizeof (Node1));
+      before_node = (Node1*)ta_malloc(sizeof (Node1));
       if (!before_node)
         return;
       before_node->point = (FT_UShort)(point - points);
@@ -2045,7 +2133,7 @@ TA_hints_recorder(TA_Action action,
       TA_Point point = (TA_Point)arg1;
 
 
-      after_node = (Node1*)malloc(sizeof (Node1));
+      after_node = (Node1*)ta_malloc(sizeof (Node1));
       if (!after_node)
         return;
       after_node->point = (FT_UShort)(point - points);
@@ -2063,7 +2151,7 @@ TA_hints_recorder(TA_Action action,
       TA_Edge edge = arg2;
 
 
-      on_node = (Node2*)malloc(sizeof (Node2));
+      on_node = (Node2*)ta_malloc(sizeof (Node2));
       if (!on_node)
         return;
       on_node->edge = (FT_UShort)(edge - edges);
@@ -2083,7 +2171,7 @@ TA_hints_recorder(TA_Action action,
       TA_Edge after = arg3;
 
 
-      between_node = (Node3*)malloc(sizeof (Node3));
+      between_node = (Node3*)ta_malloc(sizeof (Node3));
       if (!between_node)
         return;
       between_node->before_edge = (FT_UShort)(before - edges);
@@ -2105,6 +2193,15 @@ TA_hints_recorder(TA_Action action,
     break;
   }
 
+  /* an action needs at most 12 bytes plus the data emitted by */
+  /* `TA_hints_recorder_handle_segments' for at most two edges, */
+  /* which is 2 bytes plus 4 bytes per segment for each edge */
+  p = TA_bytecode_buffer_reserve(&font->bytecode_buffer,
+                                 p,
+                                 16 + 4 * (FT_ULong)axis->num_segments);
+  if (!p)
+    return;
+
   /* some enum values correspond to 4, 7, 8, or 12 bytecode functions; */
   /* if the value is n, the function numbers are n, ..., n+11, */
   /* to be differentiated with flags */
@@ -2501,7 +2598,8 @@ TA_init_recorder(Recorder* recorder,
   /* we use segment_map[axis->num_segments] */
   /* as the total number of mapped segments, so allocate one more element */
   recorder->segment_map =
-    (FT_UShort*)malloc((size_t)(axis->num_segments + 1) * sizeof (FT_UShort));
+    (FT_UShort*)ta_malloc((size_t)(axis->num_segments + 1)
+                          * sizeof (FT_UShort));
   if (!recorder->segment_map)
     return FT_Err_Out_Of_Memory;
 
@@ -2515,8 +2613,8 @@ TA_init_recorder(Recorder* recorder,
       recorder->num_wrap_around_segments++;
 
   recorder->wrap_around_segments =
-    (FT_UShort*)malloc(recorder->num_wrap_around_segments
-                       * sizeof (FT_UShort));
+    (FT_UShort*)ta_malloc(recorder->num_wrap_around_segments
+                          * sizeof (FT_UShort));
   if (!recorder->wrap_around_segments)
     return FT_Err_Out_Of_Memory;
 
@@ -2571,7 +2669,7 @@ TA_rewind_recorder(Recorder* recorder,
     LLRB_REMOVE(ip_before_points,
                 &recorder->ip_before_points_head,
                 before_node);
-    free(before_node);
+    ta_free(before_node);
   }
 
   for (after_node = LLRB_MIN(ip_after_points,
@@ -2585,7 +2683,7 @@ TA_rewind_recorder(Recorder* recorder,
     LLRB_REMOVE(ip_after_points,
                 &recorder->ip_after_points_head,
                 after_node);
-    free(after_node);
+    ta_free(after_node);
   }
 
   for (on_node = LLRB_MIN(ip_on_points,
@@ -2599,7 +2697,7 @@ TA_rewind_recorder(Recorder* recorder,
     LLRB_REMOVE(ip_on_points,
                 &recorder->ip_on_points_head,
                 on_node);
-    free(on_node);
+    ta_free(on_node);
   }
 
   for (between_node = LLRB_MIN(ip_between_points,
@@ -2613,7 +2711,7 @@ TA_rewind_recorder(Recorder* recorder,
     LLRB_REMOVE(ip_between_points,
                 &recorder->ip_between_points_head,
                 between_node);
-    free(between_node);
+    ta_free(between_node);
   }
 }
 
@@ -2621,180 +2719,828 @@ TA_rewind_recorder(Recorder* recorder,
 static void
 TA_free_recorder(Recorder* recorder)
 {
-  free(recorder->segment_map);
-  free(recorder->wrap_around_segments);
+  ta_free(recorder->segment_map);
+  ta_free(recorder->wrap_around_segments);
 
   TA_rewind_recorder(recorder, NULL, 0);
 }
 
 
-FT_Error
-TA_sfnt_build_glyph_instructions(SFNT* sfnt,
-                                 FONT* font,
-                                 FT_Long idx)
+/*
+ * Make `size' the current pixel size of the subfont's face.  Everything
+ * computed by FreeType for a given size only depends on the PPEM value,
+ * but we hint each glyph for the whole hinting range.  We thus create a
+ * FreeType size object for each PPEM value once and simply activate it
+ * afterwards.
+ */
+
+static FT_Error
+TA_sfnt_activate_size(SFNT* sfnt,
+                      FONT* font,
+                      FT_UInt size)
 {
   FT_Face face = sfnt->face;
+  FT_Size* sizep;
+  FT_Size new_size;
   FT_Error error;
 
-  FT_Byte* ins_buf;
-  FT_UInt ins_len;
-  FT_Byte* bufp;
-  FT_Byte* p;
 
-  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
-  glyf_Data* data = (glyf_Data*)glyf_table->data;
-  /* `idx' is never negative */
-  GLYPH* glyph = &data->glyphs[idx];
+  if (!sfnt->sizes)
+  {
+    sfnt->sizes = (FT_Size*)ta_calloc(font->hinting_range_max
+                                        - font->hinting_range_min + 1,
+                                      sizeof (FT_Size));
+    if (!sfnt->sizes)
+      return FT_Err_Out_Of_Memory;
+  }
 
-  TA_FaceGlobals globals = (TA_FaceGlobals)sfnt->face->autohint.data;
-  FT_UShort* gstyles = globals->glyph_styles;
-  FT_Bool use_gstyle_data = 1;
+  sizep = sfnt->sizes + size - font->hinting_range_min;
+  if (*sizep)
+    return FT_Activate_Size(*sizep);
 
-  TA_GlyphHints hints;
+  error = FT_New_Size(face, &new_size);
+  if (error)
+    return error;
 
-  FT_UInt num_action_hints_records = 0;
-  FT_UInt num_point_hints_records = 0;
-  Hints_Record* action_hints_records = NULL;
-  Hints_Record* point_hints_records = NULL;
+  error = FT_Activate_Size(new_size);
+  if (!error)
+    error = FT_Set_Pixel_Sizes(face, size, size);
+  if (error)
+  {
+    FT_Done_Size(new_size);
+    return error;
+  }
 
-  Recorder recorder;
-  FT_UShort num_stack_elements;
-  FT_Bool optimize = 0;
+  *sizep = new_size;
 
-  FT_Int32 load_flags;
-  FT_UInt size;
+  return FT_Err_Ok;
+}
 
-  /* we store only three positions, but it simplifies the algorithm in */
-  /* `TA_optimize_push' if we have one additional element */
-  FT_Byte* pos[4];
 
-#ifdef TA_DEBUG
-  int _ta_debug_save;
-#endif
+/*
+ * Hint glyph `idx' at PPEM value `size', collecting the hints with
+ * `recorder'.  The resulting action and point hints records get appended
+ * to the given arrays if they differ from their predecessors.
+ */
+
+static FT_Error
+TA_record_hints_at_size(Recorder* recorder,
+                        FT_Long idx,
+                        FT_Int32 load_flags,
+                        FT_UInt size,
+                        Hints_Record** action_hints_records,
+                        FT_UInt* num_action_hints_records,
+                        Hints_Record** point_hints_records,
+                        FT_UInt* num_point_hints_records)
+{
+  SFNT* sfnt = recorder->sfnt;
+  FONT* font = recorder->font;
+  FT_Face face = sfnt->face;
 
+  Bytecode_Buffer* buffer = &font->bytecode_buffer;
+  TA_GlyphHints hints = &font->loader->hints;
 
-  /* XXX: right now, we abuse this flag to control */
-  /*      the global behaviour of the auto-hinter */
-  load_flags = 1 << 29; /* vertical hinting only */
-  if (!font->adjust_subglyphs)
-  {
-    if (font->hint_composites)
-      load_flags |= FT_LOAD_NO_SCALE;
-    else
-      load_flags |= FT_LOAD_NO_RECURSE;
-  }
+  FT_Error error;
+#ifdef DEBUGGING
+  int have_dumps = 0;
+  FT_Byte* p;
+#endif
 
-  /* computing the segments is resolution independent, */
-  /* thus the pixel size in this call is arbitrary -- */
-  /* however, we avoid unnecessary debugging output */
-  /* if we use the lowest value of the hinting range */
-  error = FT_Set_Pixel_Sizes(face,
-                             font->hinting_range_min,
-                             font->hinting_range_min);
-  if (error)
-    return error;
 
-  /* this data is needed for `ta_glyph_hints_reload' (in file `tahints.c') */
-  /* to modify `out' directions of points at the user's request */
-  /* (which will eventually become single-point segments) */
-  error = TA_control_segment_dir_collect(font, face->face_index, idx);
+  TA_rewind_recorder(recorder, buffer->buf, size);
+
+  error = TA_sfnt_activate_size(sfnt, font, size);
   if (error)
     return error;
 
-#ifdef TA_DEBUG
-  /* temporarily disable some debugging output */
-  /* to avoid getting the information twice */
-  _ta_debug_save = _ta_debug;
-  _ta_debug = 0;
-#endif
+#ifdef DEBUGGING
+  if (font->trace.file)
+    TA_trace_size(&font->trace, size);
+  else if (font->debug)
+  {
+    int num_chars, i;
 
-  ta_loader_register_hints_recorder(font->loader, NULL, NULL);
-  error = ta_loader_load_glyph(font, face, (FT_UInt)idx, load_flags);
 
-#ifdef TA_DEBUG
-  _ta_debug = _ta_debug_save;
+    num_chars = fprintf(stderr, "size %d\n", size);
+    for (i = 0; i < num_chars - 1; i++)
+      putc('-', stderr);
+    fprintf(stderr, "\n\n");
+  }
 #endif
 
+  /* calling `ta_loader_load_glyph' uses the */
+  /* `TA_hints_recorder' function as a callback, */
+  /* modifying `hints_record' */
+  error = ta_loader_load_glyph(font, face, (FT_UInt)idx, load_flags);
+  if (!error)
+    error = buffer->error;
   if (error)
     return error;
 
-  /* do nothing if we have an empty glyph */
-  if (!(font->loader->gloader->current.num_subglyphs
-        || face->glyph->outline.n_contours))
-    return FT_Err_Ok;
-
-  hints = &font->loader->hints;
-
-  /*
-   * We allocate a buffer which is certainly large enough
-   * to hold all of the created bytecode instructions;
-   * later on it gets reallocated to its real size.
-   *
-   * The value `1000' is a very rough guess, not tested well.
-   *
-   * For delta exceptions, we have three DELTA commands,
-   * covering 3*16 ppem values.
-   * Since a point index can be larger than 255,
-   * we assume two bytes everywhere for the necessary PUSH calls.
-   * This value must be doubled for the other arguments of DELTA.
-   * Additionally, we have both x and y deltas,
-   * which need to be handled separately in the bytecode.
-   * In summary, this is approx. 3*16 * 2*2 * 2 = 400 bytes per point,
-   * adding some bytes for the necessary overhead.
-   */
-  ins_len = (FT_UInt)(hints->num_points
-                      * (1000
-                         + ((font->control_data_head != NULL) ? 400 : 0)));
-  ins_buf = (FT_Byte*)malloc(ins_len);
-  if (!ins_buf)
-    return FT_Err_Out_Of_Memory;
-
-  /* handle composite glyph */
-  if (font->loader->gloader->current.num_subglyphs)
+  if (TA_hints_record_is_different(*action_hints_records,
+                                   *num_action_hints_records,
+                                   buffer->buf, recorder->hints_record.buf))
   {
-    bufp = TA_font_build_subglyph_shifter(font, ins_buf);
-    if (!bufp)
+#ifdef DEBUGGING
+    if (font->trace.file)
     {
-      error = FT_Err_Out_Of_Memory;
-      goto Err;
+      have_dumps = 1;
+
+      ta_glyph_hints_trace((TA_GlyphHints)_ta_debug_hints, &font->trace);
+      TA_trace_record(&font->trace, TA_TRACE_ACTION_RECORD,
+                      buffer->buf, recorder->hints_record.buf);
     }
+    else if (font->debug)
+    {
+      have_dumps = 1;
 
-    use_gstyle_data = 0;
+      ta_glyph_hints_dump_edges((TA_GlyphHints)_ta_debug_hints);
+      ta_glyph_hints_dump_segments((TA_GlyphHints)_ta_debug_hints);
+      ta_glyph_hints_dump_points((TA_GlyphHints)_ta_debug_hints);
 
-    goto Done1;
+      fprintf(stderr, "action hints record:\n");
+      if (buffer->buf == recorder->hints_record.buf)
+        fprintf(stderr, "  (none)");
+      else
+      {
+        fprintf(stderr, "  ");
+        for (p = buffer->buf; p < recorder->hints_record.buf; p += 2)
+          fprintf(stderr, " %2d", *p * 256 + *(p + 1));
+      }
+      fprintf(stderr, "\n");
+    }
+#endif
+
+    error = TA_add_hints_record(action_hints_records,
+                                num_action_hints_records,
+                                buffer->buf, recorder->hints_record);
+    if (error)
+      return error;
   }
 
+  /* now handle point records */
 
-  if (font->fallback_scaling)
-  {
-    TA_StyleClass style_class = font->loader->metrics->style_class;
+  TA_reset_recorder(recorder, buffer->buf);
 
+  /* use the point hints data collected in `TA_hints_recorder' */
+  error = TA_build_point_hints(recorder, hints);
+  if (error)
+    return error;
 
-    if (style_class == &ta_none_dflt_style_class)
+  if (TA_hints_record_is_different(*point_hints_records,
+                                   *num_point_hints_records,
+                                   buffer->buf, recorder->hints_record.buf))
+  {
+#ifdef DEBUGGING
+    if (font->trace.file)
     {
-      /* the scaling value of `none_dflt' */
-      /* (this is, hinting without script-specific blue zones) */
-      /* is always 1, which corresponds to a no-op */
-      bufp = ins_buf;
-
-      use_gstyle_data = 0;
+      if (!have_dumps)
+      {
+        TA_trace_size(&font->trace, size);
+        ta_glyph_hints_trace((TA_GlyphHints)_ta_debug_hints, &font->trace);
+      }
 
-      goto Done1;
+      TA_trace_record(&font->trace, TA_TRACE_POINT_RECORD,
+                      buffer->buf, recorder->hints_record.buf);
     }
-    else if (style_class == ta_style_classes[font->fallback_style])
+    else if (font->debug)
     {
-      /* since `TA_init_recorder' hasn't been called yet, */
-      /* we manually initialize the `sfnt', `font', and `glyph' fields */
-      recorder.sfnt = sfnt;
+      if (!have_dumps)
+      {
+        int num_chars, i;
+
+
+        num_chars = fprintf(stderr, "size %d\n", size);
+        for (i = 0; i < num_chars - 1; i++)
+          putc('-', stderr);
+        fprintf(stderr, "\n\n");
+
+        ta_glyph_hints_dump_edges((TA_GlyphHints)_ta_debug_hints);
+        ta_glyph_hints_dump_segments((TA_GlyphHints)_ta_debug_hints);
+        ta_glyph_hints_dump_points((TA_GlyphHints)_ta_debug_hints);
+      }
+
+      fprintf(stderr, "point hints record:\n");
+      if (buffer->buf == recorder->hints_record.buf)
+        fprintf(stderr, "  (none)");
+      else
+      {
+        fprintf(stderr, "  ");
+        for (p = buffer->buf; p < recorder->hints_record.buf; p += 2)
+          fprintf(stderr, " %2d", *p * 256 + *(p + 1));
+      }
+      fprintf(stderr, "\n\n");
+    }
+#endif
+
+    error = TA_add_hints_record(point_hints_records,
+                                num_point_hints_records,
+                                buffer->buf, recorder->hints_record);
+    if (error)
+      return error;
+  }
+
+  return FT_Err_Ok;
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+/*
+ * With option `hinting-threads', the part of the hinting range after the
+ * first size gets split into chunks that are hinted concurrently, which
+ * helps fonts with few glyphs but large hinting ranges.  A FreeType face
+ * must not be used by more than one thread at a time, so each additional
+ * thread gets a `Shard' context with a face of its own.  The shard's
+ * shallow copy of our `FONT' structure provides a separate glyph loader
+ * and bytecode buffer; its face globals are a copy of the subfont's
+ * globals (without HarfBuzz data), and the style metrics are copied on
+ * demand.
+ */
+
+#define SHARD_MIN_SIZES 4 /* don't split off smaller chunks */
+
+struct Shard_
+{
+  FONT font;
+  SFNT sfnt;
+
+  /* the current job */
+  Recorder recorder;
+  FT_Long idx;
+  FT_Int32 load_flags;
+  FT_UInt first_size;
+  FT_UInt last_size;
+
+  /* the job's results */
+  Hints_Record* action_hints_records;
+  FT_UInt num_action_hints_records;
+  Hints_Record* point_hints_records;
+  FT_UInt num_point_hints_records;
+  FT_Error error;
+
+  pthread_t thread;
+  FT_Bool running;
+};
+
+
+static FT_Error
+TA_sfnt_init_shards(SFNT* sfnt,
+                    FONT* font)
+{
+  TA_FaceGlobals globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+  FT_UInt num_shards = font->hinting_threads - 1;
+  FT_UInt i;
+
+#ifdef TA_DEBUG
+  void* debug_hints = _ta_debug_hints;
+#endif
+
+
+  sfnt->shards = (Shard*)ta_calloc(num_shards, sizeof (Shard));
+  if (!sfnt->shards)
+    return FT_Err_Out_Of_Memory;
+
+  for (i = 0; i < num_shards; i++)
+  {
+    Shard* shard = &sfnt->shards[i];
+    TA_FaceGlobals shard_globals;
+    FT_Face face;
+    FT_Error error;
+
+
+    shard->font = *font;
+    memset(&shard->font.bytecode_buffer, 0, sizeof (Bytecode_Buffer));
+
+    /* `TA_sfnt_free_shards' can clean up from here on */
+    sfnt->num_shards = i + 1;
+
+    error = ta_loader_init(&shard->font);
+#ifdef TA_DEBUG
+    /* `ta_loader_init' has changed this */
+    _ta_debug_hints = debug_hints;
+#endif
+    if (error)
+      return error;
+
+    /* no need to lock anything: */
+    /* the shard threads don't create or destroy faces */
+    error = FT_New_Memory_Face(font->lib,
+                               font->in_buf,
+                               (FT_Long)font->in_len,
+                               sfnt->face->face_index,
+                               &face);
+    if (error)
+      return error;
+
+    shard->sfnt = *sfnt;
+    shard->sfnt.face = face;
+    shard->sfnt.sizes = NULL;
+    shard->sfnt.shards = NULL;
+    shard->sfnt.num_shards = 0;
+
+    /* we allocate the globals together with the `glyph_styles' array */
+    /* as done in `ta_face_globals_new' */
+    shard_globals = (TA_FaceGlobals)ta_calloc(
+                      1, sizeof (TA_FaceGlobalsRec)
+                         + (size_t)globals->glyph_count * sizeof (FT_UShort));
+    if (!shard_globals)
+      return FT_Err_Out_Of_Memory;
+
+    shard_globals->face = face;
+    shard_globals->glyph_count = globals->glyph_count;
+    shard_globals->glyph_styles = (FT_UShort*)(shard_globals + 1);
+    memcpy(shard_globals->glyph_styles,
+           globals->glyph_styles,
+           (size_t)globals->glyph_count * sizeof (FT_UShort));
+    shard_globals->increase_x_height = globals->increase_x_height;
+    shard_globals->font = &shard->font;
+
+    face->autohint.data = (FT_Pointer)shard_globals;
+    face->autohint.finalizer = (FT_Generic_Finalizer)ta_face_globals_free;
+  }
+
+  return FT_Err_Ok;
+}
+
+
+void
+TA_sfnt_free_shards(SFNT* sfnt)
+{
+  FT_UInt i;
+
+#ifdef TA_DEBUG
+  void* debug_hints = _ta_debug_hints;
+#endif
+
+
+  for (i = 0; i < sfnt->num_shards; i++)
+  {
+    Shard* shard = &sfnt->shards[i];
+
+
+    /* this also frees the shard's size objects and face globals; */
+    /* the latter still need the shard's `FONT' structure */
+    FT_Done_Face(shard->sfnt.face);
+    ta_free(shard->sfnt.sizes);
+
+    ta_loader_done(&shard->font);
+    ta_free(shard->font.bytecode_buffer.buf);
+  }
+
+#ifdef TA_DEBUG
+  _ta_debug_hints = debug_hints;
+#endif
+
+  ta_free(sfnt->shards);
+  sfnt->shards = NULL;
+  sfnt->num_shards = 0;
+}
+
+
+/* set up `shard' to hint sizes `first_size' up to `last_size' */
+/* of the glyph currently handled by `recorder' */
+
+static FT_Error
+TA_shard_prepare(Shard* shard,
+                 Recorder* recorder,
+                 FT_Long idx,
+                 FT_Int32 load_flags,
+                 FT_UInt first_size,
+                 FT_UInt last_size)
+{
+  FONT* font = recorder->font;
+  TA_FaceGlobals globals = font->loader->globals;
+  TA_FaceGlobals shard_globals =
+    (TA_FaceGlobals)shard->sfnt.face->autohint.data;
+
+  TA_StyleClass style_class = font->loader->metrics->style_class;
+  TA_WritingSystemClass writing_system_class =
+    ta_writing_system_classes[style_class->writing_system];
+  FT_UInt style = (FT_UInt)style_class->style;
+
+
+  /* the shard threads must not compute style metrics themselves */
+  /* since this accesses the reference font (if any); */
+  /* we rather copy the (unscaled) metrics of the glyph's style */
+  if (!shard_globals->metrics[style])
+  {
+    TA_StyleMetrics metrics;
+
+
+    metrics = (TA_StyleMetrics)
+                ta_malloc(writing_system_class->style_metrics_size);
+    if (!metrics)
+      return FT_Err_Out_Of_Memory;
+
+    memcpy(metrics,
+           globals->metrics[style],
+           writing_system_class->style_metrics_size);
+    metrics->globals = shard_globals;
+
+    shard_globals->metrics[style] = metrics;
+  }
+
+  /* set up by `TA_control_segment_dir_collect' for the current glyph */
+  shard->font.control_segment_dirs_head = font->control_segment_dirs_head;
+  shard->font.control_segment_dirs_cur = font->control_segment_dirs_head;
+
+  /* the segment map and the wrap-around segments are already */
+  /* initialized, and the shard only reads them */
+  shard->recorder = *recorder;
+  shard->recorder.sfnt = &shard->sfnt;
+  shard->recorder.font = &shard->font;
+
+  LLRB_INIT(&shard->recorder.ip_before_points_head);
+  LLRB_INIT(&shard->recorder.ip_after_points_head);
+  LLRB_INIT(&shard->recorder.ip_on_points_head);
+  LLRB_INIT(&shard->recorder.ip_between_points_head);
+
+  shard->idx = idx;
+  shard->load_flags = load_flags;
+  shard->first_size = first_size;
+  shard->last_size = last_size;
+
+  shard->action_hints_records = NULL;
+  shard->num_action_hints_records = 0;
+  shard->point_hints_records = NULL;
+  shard->num_point_hints_records = 0;
+  shard->error = FT_Err_Ok;
+
+  return FT_Err_Ok;
+}
+
+
+/* the thread function of a shard */
+
+static void*
+TA_shard_run(void* arg)
+{
+  Shard* shard = (Shard*)arg;
+  FONT* font = &shard->font;
+  GLYPH* glyph = shard->recorder.glyph;
+  Bytecode_Buffer* buffer = &font->bytecode_buffer;
+
+  FT_UInt size;
+
+
+  /* a new thread inherits nothing from its creator */
+  _ta_memory = font->memory;
+
+  buffer->error = FT_Err_Ok;
+  if (!TA_bytecode_buffer_reserve(buffer,
+                                  buffer->buf,
+                                  BYTECODE_BUFFER_INITIAL_SIZE))
+  {
+    shard->error = buffer->error;
+    return NULL;
+  }
+
+  if (glyph->num_contours > 0)
+    ta_loader_decode_glyph(font->loader, shard->sfnt.face,
+                           (FT_UInt)shard->idx,
+                           glyph->buf, glyph->len1,
+                           glyph->buf2, glyph->len2);
+
+  ta_loader_register_hints_recorder(font->loader,
+                                    TA_hints_recorder,
+                                    (void*)&shard->recorder);
+
+  for (size = shard->first_size; size <= shard->last_size; size++)
+  {
+    shard->error = TA_record_hints_at_size(
+                     &shard->recorder,
+                     shard->idx,
+                     shard->load_flags,
+                     size,
+                     &shard->action_hints_records,
+                     &shard->num_action_hints_records,
+                     &shard->point_hints_records,
+                     &shard->num_point_hints_records);
+    if (shard->error)
+      break;
+  }
+
+  ta_loader_register_hints_recorder(font->loader, NULL, NULL);
+
+  /* free the red-black trees */
+  TA_rewind_recorder(&shard->recorder, NULL, 0);
+
+  return NULL;
+}
+
+
+/*
+ * Append the hints records `more' of a chunk to `hints_records', taking
+ * ownership of them.  Since the chunks are hinted independently, the
+ * chunk's first record might be identical to the last record of the
+ * previous chunk, in which case it gets dropped; this gives exactly the
+ * same records as hinting all sizes sequentially.
+ */
+
+static FT_Error
+TA_merge_hints_records(Hints_Record** hints_records,
+                       FT_UInt* num_hints_records,
+                       Hints_Record* more,
+                       FT_UInt num_more)
+{
+  Hints_Record* hints_records_new;
+  FT_UInt skip = 0;
+
+
+  if (!num_more)
+    return FT_Err_Ok;
+
+  if (!TA_hints_record_is_different(*hints_records,
+                                    *num_hints_records,
+                                    more[0].buf,
+                                    more[0].buf + more[0].buf_len))
+  {
+    ta_free(more[0].buf);
+    skip = 1;
+  }
+
+  hints_records_new =
+    (Hints_Record*)ta_realloc(*hints_records,
+                              (*num_hints_records + num_more - skip)
+                              * sizeof (Hints_Record));
+  if (!hints_records_new)
+  {
+    FT_UInt i;
+
+
+    for (i = skip; i < num_more; i++)
+      ta_free(more[i].buf);
+    ta_free(more);
+
+    return FT_Err_Out_Of_Memory;
+  }
+
+  memcpy(hints_records_new + *num_hints_records,
+         more + skip,
+         (num_more - skip) * sizeof (Hints_Record));
+
+  *hints_records = hints_records_new;
+  *num_hints_records += num_more - skip;
+
+  ta_free(more);
+
+  return FT_Err_Ok;
+}
+
+
+/* hint sizes `first_size' up to `font->hinting_range_max' */
+/* using the subfont's shards */
+
+static FT_Error
+TA_sfnt_record_hints_sharded(SFNT* sfnt,
+                             Recorder* recorder,
+                             FT_Long idx,
+                             FT_Int32 load_flags,
+                             FT_UInt first_size,
+                             Hints_Record** action_hints_records,
+                             FT_UInt* num_action_hints_records,
+                             Hints_Record** point_hints_records,
+                             FT_UInt* num_point_hints_records)
+{
+  FONT* font = recorder->font;
+  FT_UInt num_sizes = font->hinting_range_max - first_size + 1;
+  FT_UInt num_chunks = sfnt->num_shards + 1;
+  FT_UInt num_prepared;
+  FT_UInt last_size;
+  FT_UInt size;
+  FT_UInt i;
+
+  FT_Error error = FT_Err_Ok;
+
+
+  if (num_chunks > num_sizes / SHARD_MIN_SIZES)
+    num_chunks = num_sizes / SHARD_MIN_SIZES;
+  if (num_chunks < 2)
+    num_chunks = 1;
+
+  /* chunk `i' starts with size `first_size + i * num_sizes / num_chunks'; */
+  /* the first chunk is handled by the current thread */
+  for (i = 1; i < num_chunks; i++)
+  {
+    Shard* shard = &sfnt->shards[i - 1];
+
+
+    error = TA_shard_prepare(shard, recorder, idx, load_flags,
+                             first_size + i * num_sizes / num_chunks,
+                             first_size + (i + 1) * num_sizes / num_chunks
+                               - 1);
+    if (error)
+      break;
+
+    /* if we can't start a thread, do the job ourselves */
+    shard->running = !pthread_create(&shard->thread, NULL,
+                                     TA_shard_run, shard);
+    if (!shard->running)
+      TA_shard_run(shard);
+  }
+  num_prepared = i;
+
+  last_size = first_size + num_sizes / num_chunks - 1;
+  for (size = first_size; !error && size <= last_size; size++)
+    error = TA_record_hints_at_size(recorder, idx, load_flags, size,
+                                    action_hints_records,
+                                    num_action_hints_records,
+                                    point_hints_records,
+                                    num_point_hints_records);
+
+  /* collect the chunks' results in order */
+  for (i = 1; i < num_prepared; i++)
+  {
+    Shard* shard = &sfnt->shards[i - 1];
+
+
+    if (shard->running)
+    {
+      pthread_join(shard->thread, NULL);
+      shard->running = 0;
+    }
+
+    if (!error)
+      error = shard->error;
+
+    if (!error)
+      error = TA_merge_hints_records(action_hints_records,
+                                     num_action_hints_records,
+                                     shard->action_hints_records,
+                                     shard->num_action_hints_records);
+    else
+      TA_free_hints_records(shard->action_hints_records,
+                            shard->num_action_hints_records);
+    shard->action_hints_records = NULL;
+    shard->num_action_hints_records = 0;
+
+    if (!error)
+      error = TA_merge_hints_records(point_hints_records,
+                                     num_point_hints_records,
+                                     shard->point_hints_records,
+                                     shard->num_point_hints_records);
+    else
+      TA_free_hints_records(shard->point_hints_records,
+                            shard->num_point_hints_records);
+    shard->point_hints_records = NULL;
+    shard->num_point_hints_records = 0;
+  }
+
+  return error;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+
+FT_Error
+TA_sfnt_build_glyph_instructions(SFNT* sfnt,
+                                 FONT* font,
+                                 FT_Long idx)
+{
+  FT_Face face = sfnt->face;
+  FT_Error error;
+
+  Bytecode_Buffer* buffer = &font->bytecode_buffer;
+  FT_UInt ins_len;
+  FT_Byte* bufp;
+
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  /* `idx' is never negative */
+  GLYPH* glyph = &data->glyphs[idx];
+
+  TA_FaceGlobals globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+  FT_UShort* gstyles = globals->glyph_styles;
+  FT_Bool use_gstyle_data = 1;
+
+  TA_GlyphHints hints;
+
+  FT_UInt num_action_hints_records = 0;
+  FT_UInt num_point_hints_records = 0;
+  Hints_Record* action_hints_records = NULL;
+  Hints_Record* point_hints_records = NULL;
+
+  Recorder recorder;
+  FT_UShort num_stack_elements;
+
+  FT_Int32 load_flags;
+  FT_UInt size;
+  FT_Size default_size = NULL;
+
+#ifdef TA_DEBUG
+  int _ta_debug_save;
+#endif
+
+
+  /* XXX: right now, we abuse this flag to control */
+  /*      the global behaviour of the auto-hinter */
+  load_flags = 1 << 29; /* vertical hinting only */
+  if (!font->adjust_subglyphs)
+  {
+    if (font->hint_composites)
+      load_flags |= FT_LOAD_NO_SCALE;
+    else
+      load_flags |= FT_LOAD_NO_RECURSE;
+  }
+
+  /* computing the segments is resolution independent, */
+  /* thus the pixel size in this call is arbitrary -- */
+  /* however, we avoid unnecessary debugging output */
+  /* if we use the lowest value of the hinting range */
+  error = FT_Set_Pixel_Sizes(face,
+                             font->hinting_range_min,
+                             font->hinting_range_min);
+  if (error)
+    return error;
+
+  /* this data is needed for `ta_glyph_hints_reload' (in file `tahints.c') */
+  /* to modify `out' directions of points at the user's request */
+  /* (which will eventually become single-point segments) */
+  error = TA_control_segment_dir_collect(font, face->face_index, idx);
+  if (error)
+    return error;
+
+#ifdef TA_DEBUG
+  /* temporarily disable some debugging output */
+  /* to avoid getting the information twice */
+  _ta_debug_save = _ta_debug;
+  _ta_debug = 0;
+#endif
+
+  /* decode a simple glyph directly from its `glyf' table record; */
+  /* after being checked in the next call, this outline is used */
+  /* instead of FreeType's loader in the loop over all sizes below */
+  if (glyph->num_contours > 0)
+    ta_loader_decode_glyph(font->loader, face, (FT_UInt)idx,
+                           glyph->buf, glyph->len1,
+                           glyph->buf2, glyph->len2);
+
+  ta_loader_register_hints_recorder(font->loader, NULL, NULL);
+  error = ta_loader_load_glyph(font, face, (FT_UInt)idx, load_flags);
+
+#ifdef TA_DEBUG
+  _ta_debug = _ta_debug_save;
+#endif
+
+  if (error)
+    return error;
+
+  /* do nothing if we have an empty glyph */
+  if (!(font->loader->gloader->current.num_subglyphs
+        || face->glyph->outline.n_contours))
+    return FT_Err_Ok;
+
+  hints = &font->loader->hints;
+
+  /* the bytecode buffer is shared by all glyphs; */
+  /* it grows as needed while emitting instructions */
+  buffer->error = FT_Err_Ok;
+  bufp = TA_bytecode_buffer_reserve(buffer,
+                                    buffer->buf,
+                                    BYTECODE_BUFFER_INITIAL_SIZE);
+  if (!bufp)
+    return buffer->error;
+
+  /* handle composite glyph */
+  if (font->loader->gloader->current.num_subglyphs)
+  {
+    bufp = TA_font_build_subglyph_shifter(font, bufp);
+    if (!bufp)
+      return buffer->error;
+
+    use_gstyle_data = 0;
+
+    goto Done1;
+  }
+
+
+  if (font->fallback_scaling)
+  {
+    TA_StyleClass style_class = font->loader->metrics->style_class;
+
+
+    if (style_class == &ta_none_dflt_style_class)
+    {
+      /* the scaling value of `none_dflt' */
+      /* (this is, hinting without script-specific blue zones) */
+      /* is always 1, which corresponds to a no-op */
+
+      use_gstyle_data = 0;
+
+      goto Done1;
+    }
+    else if (style_class == ta_style_classes[font->fallback_style])
+    {
+      /* since `TA_init_recorder' hasn't been called yet, */
+      /* we manually initialize the `sfnt', `font', and `glyph' fields */
+      recorder.sfnt = sfnt;
       recorder.font = font;
       recorder.glyph = glyph;
 
-      bufp = TA_sfnt_build_glyph_scaler(sfnt, &recorder, ins_buf);
+      bufp = TA_sfnt_build_glyph_scaler(sfnt, &recorder, bufp);
       if (!bufp)
-      {
-        error = FT_Err_Out_Of_Memory;
-        goto Err;
-      }
+        return buffer->error;
 
       use_gstyle_data = 0;
 
@@ -2802,6 +3548,17 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
     }
   }
 
+  if (sfnt->profile)
+  {
+    Glyph_Profile* profile = &sfnt->profile[idx];
+
+
+    profile->num_points = (FT_UInt)hints->num_points;
+    profile->num_segments =
+      (FT_UInt)hints->axis[TA_DIMENSION_VERT].num_segments;
+    profile->num_edges = (FT_UInt)hints->axis[TA_DIMENSION_VERT].num_edges;
+  }
+
   error = TA_init_recorder(&recorder, sfnt, font, glyph, hints);
   if (error)
     goto Err;
@@ -2810,7 +3567,17 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   /* to find hints records which get pushed onto the bytecode stack */
 
 #ifdef DEBUGGING
-  if (font->debug)
+  if (font->trace.file)
+  {
+    char buf[256];
+
+
+    buf[0] = '\0';
+    (void)FT_Get_Glyph_Name(face, (FT_UInt)idx, buf, 256);
+
+    TA_trace_glyph(&font->trace, face->face_index, idx, buf);
+  }
+  else if (font->debug)
   {
     int num_chars, i;
     char buf[256];
@@ -2829,7 +3596,8 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   }
 #endif
 
-  /* we temporarily use `ins_buf' to record the current glyph hints */
+  /* we temporarily use the bytecode buffer */
+  /* to record the current glyph hints */
   ta_loader_register_hints_recorder(font->loader,
                                     TA_hints_recorder,
                                     (void*)&recorder);
@@ -2841,131 +3609,64 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
    * non-edge one-point segments, and `TA_get_segment_index' would return
    * wrong indices otherwise.
    */
-  for (size = font->hinting_range_min;
-       size <= font->hinting_range_max;
-       size++)
-  {
-#ifdef DEBUGGING
-    int have_dumps = 0;
-#endif
+  default_size = face->size;
 
-
-    TA_rewind_recorder(&recorder, ins_buf, size);
-
-    error = FT_Set_Pixel_Sizes(face, size, size);
+#ifdef HAVE_PTHREAD_H
+  if (font->hinting_threads > 1
+      && !font->debug
+      && !sfnt->incremental
+      && !sfnt->shards)
+  {
+    error = TA_sfnt_init_shards(sfnt, font);
     if (error)
       goto Err;
+  }
+#endif
 
-#ifdef DEBUGGING
-    if (font->debug)
+  for (size = font->hinting_range_min;
+       size <= font->hinting_range_max;
+       size++)
+  {
+#ifdef HAVE_PTHREAD_H
+    /* as soon as the segment map is set up, */
+    /* the remaining sizes can be hinted concurrently */
+    if (sfnt->shards && recorder.segment_map_initialized)
     {
-      int num_chars, i;
-
+      error = TA_sfnt_record_hints_sharded(sfnt, &recorder, idx,
+                                           load_flags, size,
+                                           &action_hints_records,
+                                           &num_action_hints_records,
+                                           &point_hints_records,
+                                           &num_point_hints_records);
+      if (error)
+        goto Err;
 
-      num_chars = fprintf(stderr, "size %d\n", size);
-      for (i = 0; i < num_chars - 1; i++)
-        putc('-', stderr);
-      fprintf(stderr, "\n\n");
+      break;
     }
 #endif
 
-    /* calling `ta_loader_load_glyph' uses the */
-    /* `TA_hints_recorder' function as a callback, */
-    /* modifying `hints_record' */
-    error = ta_loader_load_glyph(font, face, (FT_UInt)idx, load_flags);
+    error = TA_record_hints_at_size(&recorder, idx, load_flags, size,
+                                    &action_hints_records,
+                                    &num_action_hints_records,
+                                    &point_hints_records,
+                                    &num_point_hints_records);
     if (error)
       goto Err;
+  }
 
-    if (TA_hints_record_is_different(action_hints_records,
-                                     num_action_hints_records,
-                                     ins_buf, recorder.hints_record.buf))
-    {
-#ifdef DEBUGGING
-      if (font->debug)
-      {
-        have_dumps = 1;
-
-        ta_glyph_hints_dump_edges((TA_GlyphHints)_ta_debug_hints);
-        ta_glyph_hints_dump_segments((TA_GlyphHints)_ta_debug_hints);
-        ta_glyph_hints_dump_points((TA_GlyphHints)_ta_debug_hints);
-
-        fprintf(stderr, "action hints record:\n");
-        if (ins_buf == recorder.hints_record.buf)
-          fprintf(stderr, "  (none)");
-        else
-        {
-          fprintf(stderr, "  ");
-          for (p = ins_buf; p < recorder.hints_record.buf; p += 2)
-            fprintf(stderr, " %2d", *p * 256 + *(p + 1));
-        }
-        fprintf(stderr, "\n");
-      }
-#endif
-
-      error = TA_add_hints_record(&action_hints_records,
-                                  &num_action_hints_records,
-                                  ins_buf, recorder.hints_record);
-      if (error)
-        goto Err;
-    }
-
-    /* now handle point records */
-
-    TA_reset_recorder(&recorder, ins_buf);
-
-    /* use the point hints data collected in `TA_hints_recorder' */
-    TA_build_point_hints(&recorder, hints);
-
-    if (TA_hints_record_is_different(point_hints_records,
-                                     num_point_hints_records,
-                                     ins_buf, recorder.hints_record.buf))
-    {
-#ifdef DEBUGGING
-      if (font->debug)
-      {
-        if (!have_dumps)
-        {
-          int num_chars, i;
-
-
-          num_chars = fprintf(stderr, "size %d\n", size);
-          for (i = 0; i < num_chars - 1; i++)
-            putc('-', stderr);
-          fprintf(stderr, "\n\n");
-
-          ta_glyph_hints_dump_edges((TA_GlyphHints)_ta_debug_hints);
-          ta_glyph_hints_dump_segments((TA_GlyphHints)_ta_debug_hints);
-          ta_glyph_hints_dump_points((TA_GlyphHints)_ta_debug_hints);
-        }
-
-        fprintf(stderr, "point hints record:\n");
-        if (ins_buf == recorder.hints_record.buf)
-          fprintf(stderr, "  (none)");
-        else
-        {
-          fprintf(stderr, "  ");
-          for (p = ins_buf; p < recorder.hints_record.buf; p += 2)
-            fprintf(stderr, " %2d", *p * 256 + *(p + 1));
-        }
-        fprintf(stderr, "\n\n");
-      }
-#endif
-
-      error = TA_add_hints_record(&point_hints_records,
-                                  &num_point_hints_records,
-                                  ins_buf, recorder.hints_record);
-      if (error)
-        goto Err;
-    }
+  if (sfnt->profile)
+  {
+    sfnt->profile[idx].num_action_hints_records = num_action_hints_records;
+    sfnt->profile[idx].num_point_hints_records = num_point_hints_records;
   }
 
   if (num_action_hints_records == 1 && !action_hints_records[0].num_actions)
   {
     /* since we only have a single empty record we just scale the glyph */
-    bufp = TA_sfnt_build_glyph_scaler(sfnt, &recorder, ins_buf);
+    bufp = TA_sfnt_build_glyph_scaler(sfnt, &recorder, buffer->buf);
     if (!bufp)
     {
-      error = FT_Err_Out_Of_Memory;
+      error = buffer->error;
       goto Err;
     }
 
@@ -2974,57 +3675,61 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
     goto Done;
   }
 
-  /* if there is only a single record, */
-  /* we do a global optimization later on */
-  if (num_action_hints_records > 1)
-    optimize = 1;
-
-  /* store the hints records and handle stack depth */
-  pos[0] = ins_buf;
+  /* store the hints records and handle stack depth; */
+  /* adjacent push instructions get merged later on */
+  /* by `TA_sfnt_optimize_bytecode' */
   bufp = TA_emit_hints_records(&recorder,
                                point_hints_records,
                                num_point_hints_records,
-                               ins_buf,
-                               optimize);
+                               buffer->buf);
+  if (!bufp)
+  {
+    error = buffer->error;
+    goto Err;
+  }
 
   num_stack_elements = recorder.num_stack_elements;
   recorder.num_stack_elements = 0;
 
-  pos[1] = bufp;
   bufp = TA_emit_hints_records(&recorder,
                                action_hints_records,
                                num_action_hints_records,
-                               bufp,
-                               optimize);
+                               bufp);
+  if (!bufp)
+  {
+    error = buffer->error;
+    goto Err;
+  }
 
   recorder.num_stack_elements += num_stack_elements;
 
-  pos[2] = bufp;
-  bufp = TA_sfnt_build_glyph_segments(sfnt, &recorder, bufp, optimize);
+  bufp = TA_sfnt_build_glyph_segments(sfnt, &recorder, bufp);
   if (!bufp)
   {
-    error = FT_Err_Out_Of_Memory;
+    error = buffer->error;
     goto Err;
   }
 
-  if (num_action_hints_records == 1)
-    bufp = TA_optimize_push(ins_buf, pos);
-
 Done:
   TA_free_hints_records(action_hints_records, num_action_hints_records);
   TA_free_hints_records(point_hints_records, num_point_hints_records);
   TA_free_recorder(&recorder);
 
+  /* a registered recorder makes the loader skip work */
+  /* that is only needed for a completely hinted outline */
+  ta_loader_register_hints_recorder(font->loader, NULL, NULL);
+
+  /* calls of `FT_Set_Pixel_Sizes' elsewhere */
+  /* must not modify our cached size objects */
+  FT_Activate_Size(default_size);
+
 Done1:
   /* handle delta exceptions */
   if (font->control_data_head)
   {
     bufp = TA_sfnt_build_delta_exceptions(sfnt, font, idx, bufp);
     if (!bufp)
-    {
-      error = FT_Err_Out_Of_Memory;
-      goto Err;
-    }
+      return buffer->error;
   }
 
   /* we need to insert a few extra bytecode instructions */
@@ -3037,13 +3742,10 @@ Done1:
 
     ins_extra_len_new = glyph->ins_extra_len
                         + sizeof (ins_extra_ignore_std_width);
-    ins_extra_buf_new = (FT_Byte*)realloc(glyph->ins_extra_buf,
-                                          ins_extra_len_new);
+    ins_extra_buf_new = (FT_Byte*)ta_realloc(glyph->ins_extra_buf,
+                                             ins_extra_len_new);
     if (!ins_extra_buf_new)
-    {
-      bufp = NULL;
-      goto Done;
-    }
+      return FT_Err_Out_Of_Memory;
 
     /* set `cvtl_ignore_std_width' to 100 at the beginning of the bytecode */
     /* by activating `ins_extra_ignore_std_width' */
@@ -3054,6 +3756,10 @@ Done1:
     glyph->ins_extra_buf = ins_extra_buf_new;
     glyph->ins_extra_len = ins_extra_len_new;
 
+    bufp = TA_bytecode_buffer_reserve(buffer, bufp, 4);
+    if (!bufp)
+      return buffer->error;
+
     /* reset `cvtl_ignore_std_width' for next glyph */
     BCI(PUSHB_2);
     BCI(cvtl_ignore_std_width);
@@ -3061,12 +3767,28 @@ Done1:
     BCI(WCVTP);
   }
 
-  ins_len = (FT_UInt)(bufp - ins_buf);
+  ins_len = (FT_UInt)(bufp - buffer->buf);
+
+  error = TA_sfnt_optimize_bytecode(sfnt, font, buffer->buf, &ins_len);
+  if (error)
+    return error;
+
+  /* the `glyf' table can't hold more bytecode */
+  if (glyph->ins_extra_len + ins_len > 0xFFFF)
+    return TA_Err_Hinter_Overflow;
 
   if (ins_len > sfnt->max_instructions)
     sfnt->max_instructions = (FT_UShort)ins_len;
 
-  glyph->ins_buf = (FT_Byte*)realloc(ins_buf, ins_len);
+  glyph->ins_buf = NULL;
+  if (ins_len)
+  {
+    glyph->ins_buf = (FT_Byte*)ta_malloc(ins_len);
+    if (!glyph->ins_buf)
+      return FT_Err_Out_Of_Memory;
+
+    memcpy(glyph->ins_buf, buffer->buf, ins_len);
+  }
   glyph->ins_len = ins_len;
 
   return FT_Err_Ok;
@@ -3075,7 +3797,11 @@ Err:
   TA_free_hints_records(action_hints_records, num_action_hints_records);
   TA_free_hints_records(point_hints_records, num_point_hints_records);
   TA_free_recorder(&recorder);
-  free(ins_buf);
+
+  ta_loader_register_hints_recorder(font->loader, NULL, NULL);
+
+  if (default_size)
+    FT_Activate_Size(default_size);
 
   return error;
 }
@@ -660,7 +660,7 @@
            + CVT_DATA->cvt_blue_adjustment_offsets[i])
 
 
-extern FT_Byte ttfautohint_glyph_bytecode[7];
+extern const FT_Byte ttfautohint_glyph_bytecode[7];
 
 #endif /* TABYTECODE_H_ */
 
@@ -0,0 +1,475 @@
+/* tacontext.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Hinting of single glyphs.  `TTF_autohint' with option `context' sets up
+ * everything necessary; `TTF_autohint_glyph' then creates the bytecode of
+ * a single glyph, optionally replacing the glyph's data from the input
+ * font.  `TTF_autohint_context_get_table' provides the global tables the
+ * bytecode relies on.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ta.h"
+
+
+struct TA_ContextRec_
+{
+  FONT* font;
+
+  /* needed for `TA_font_unload' */
+  const char* in_buf;
+  const char* control_buf;
+  const char* reference_buf;
+};
+
+
+/*
+ * We use FreeType's incremental interface to provide glyph data, either
+ * from the input font's `glyf' table or from a replacement buffer.
+ */
+
+struct FT_IncrementalRec_
+{
+  FT_Byte* glyf;
+  FT_ULong glyf_len;
+  FT_Byte* loca;
+  FT_ULong loca_len;
+  FT_Bool long_offsets;
+
+  /* a replacement for glyph `replace_idx' if `replace_buf' is set */
+  FT_UInt replace_idx;
+  const FT_Byte* replace_buf;
+  FT_ULong replace_len;
+
+  /* FreeType only stores a pointer to this structure */
+  FT_Incremental_InterfaceRec interface;
+};
+
+
+static FT_Error
+TA_incremental_get_glyph_data(FT_Incremental incremental,
+                              FT_UInt glyph_index,
+                              FT_Data* adata)
+{
+  FT_Byte* p;
+  FT_ULong start;
+  FT_ULong end;
+
+
+  if (incremental->replace_buf
+      && glyph_index == incremental->replace_idx)
+  {
+    adata->pointer = incremental->replace_buf;
+    adata->length = (FT_Int)incremental->replace_len;
+
+    return FT_Err_Ok;
+  }
+
+  if (incremental->long_offsets)
+  {
+    if (((FT_ULong)glyph_index + 2) * 4 > incremental->loca_len)
+      return FT_Err_Invalid_Glyph_Index;
+
+    p = incremental->loca + glyph_index * 4;
+    start = NEXT_ULONG(p);
+    end = NEXT_ULONG(p);
+  }
+  else
+  {
+    if (((FT_ULong)glyph_index + 2) * 2 > incremental->loca_len)
+      return FT_Err_Invalid_Glyph_Index;
+
+    p = incremental->loca + glyph_index * 2;
+    start = (FT_ULong)NEXT_USHORT(p) * 2;
+    end = (FT_ULong)NEXT_USHORT(p) * 2;
+  }
+
+  if (start > end
+      || end > incremental->glyf_len)
+    return FT_Err_Invalid_Table;
+
+  adata->pointer = incremental->glyf + start;
+  adata->length = (FT_Int)(end - start);
+
+  return FT_Err_Ok;
+}
+
+
+static void
+TA_incremental_free_glyph_data(FT_Incremental incremental,
+                               FT_Data* data)
+{
+  FT_UNUSED(incremental);
+  FT_UNUSED(data);
+
+  /* nothing to do; the data is owned by the `FONT' object */
+}
+
+
+static const FT_Incremental_FuncsRec incremental_funcs =
+{
+  TA_incremental_get_glyph_data,
+  TA_incremental_free_glyph_data,
+  NULL
+};
+
+
+/*
+ * Replace `sfnt->face' with a face that loads its glyph data with
+ * FreeType's incremental interface.  This must be called after the `glyf'
+ * table has been split and before the face's `globals' object gets
+ * created.
+ */
+
+FT_Error
+TA_sfnt_open_incremental_face(SFNT* sfnt,
+                              FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  SFNT_Table* loca_table = &font->tables[sfnt->loca_idx];
+  SFNT_Table* head_table = &font->tables[sfnt->head_idx];
+
+  FT_Parameter parameter;
+  FT_Open_Args args;
+  FT_Face face;
+  FT_Error error;
+
+
+  sfnt->incremental = (FT_Incremental)ta_calloc(1,
+                                                sizeof (*sfnt->incremental));
+  if (!sfnt->incremental)
+    return FT_Err_Out_Of_Memory;
+
+  sfnt->incremental->glyf = glyf_table->buf;
+  sfnt->incremental->glyf_len = glyf_table->len;
+  sfnt->incremental->loca = loca_table->buf;
+  sfnt->incremental->loca_len = loca_table->len;
+  sfnt->incremental->long_offsets =
+    head_table->buf[LOCA_FORMAT_OFFSET] != 0;
+
+  sfnt->incremental->interface.funcs = &incremental_funcs;
+  sfnt->incremental->interface.object = sfnt->incremental;
+
+  parameter.tag = FT_PARAM_TAG_INCREMENTAL;
+  parameter.data = &sfnt->incremental->interface;
+
+  args.flags = FT_OPEN_MEMORY | FT_OPEN_PARAMS;
+  args.memory_base = font->in_buf;
+  args.memory_size = (FT_Long)font->in_len;
+  args.num_params = 1;
+  args.params = &parameter;
+
+  error = FT_Open_Face(font->lib, &args, sfnt->face->face_index, &face);
+  if (error)
+    return error;
+
+  FT_Done_Face(sfnt->face);
+  sfnt->face = face;
+
+  return TA_Err_Ok;
+}
+
+
+TA_Error
+TA_context_new(TA_Context* contextp,
+               FONT* font,
+               const char* in_buf,
+               const char* control_buf,
+               const char* reference_buf)
+{
+  TA_Context context;
+
+
+  context = (TA_Context)ta_malloc(sizeof (*context));
+  if (!context)
+    return FT_Err_Out_Of_Memory;
+
+  context->font = font;
+  context->in_buf = in_buf;
+  context->control_buf = control_buf;
+  context->reference_buf = reference_buf;
+
+  *contextp = context;
+
+  return TA_Err_Ok;
+}
+
+
+TA_LIB_EXPORT TA_Error
+TTF_autohint_glyph(TA_Context context,
+                   long face_index,
+                   unsigned int glyph_index,
+                   const unsigned char* glyph_buf,
+                   size_t glyph_len,
+                   unsigned char** ins_bufp,
+                   size_t* ins_lenp)
+{
+  FONT* font;
+  SFNT* sfnt;
+  glyf_Data* data;
+  GLYPH* glyph;
+
+  FT_UShort loop_count;
+  FT_Short num_contours = 0;
+  FT_UShort num_points = 0;
+  FT_Short saved_num_contours = 0;
+  FT_UShort saved_num_points = 0;
+
+  FT_Byte* buf;
+  size_t len;
+  TA_Error error;
+
+  TA_Memory saved_memory;
+
+
+  if (!context || !ins_bufp || !ins_lenp)
+    return FT_Err_Invalid_Argument;
+
+  font = context->font;
+
+  if (face_index < 0 || face_index >= font->num_sfnts)
+    return FT_Err_Invalid_Argument;
+
+  sfnt = &font->sfnts[face_index];
+  data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+
+  /* we don't include the artificial `.ttfautohint' glyph */
+  loop_count = data->num_glyphs;
+  if (sfnt->max_components && font->hint_composites)
+    loop_count--;
+
+  if (glyph_index >= loop_count)
+    return FT_Err_Invalid_Glyph_Index;
+
+  glyph = &data->glyphs[glyph_index];
+
+  if (glyph_buf)
+  {
+    const FT_Byte* p = glyph_buf;
+    FT_ULong off;
+
+
+    if (font->adjust_subglyphs || glyph->num_contours < 0)
+      return FT_Err_Invalid_Argument;
+
+    /* check header size */
+    if (glyph_len < 10)
+      return FT_Err_Invalid_Table;
+
+    num_contours = (FT_Short)NEXT_USHORT(p);
+    if (num_contours < 0)
+      return FT_Err_Invalid_Argument;
+
+    if (num_contours)
+    {
+      /* use the last contour's end point to compute number of points */
+      off = 10 + ((FT_ULong)num_contours - 1) * 2;
+      if (off >= glyph_len - 1)
+        return FT_Err_Invalid_Table;
+
+      num_points = (FT_UShort)((glyph_buf[off] << 8)
+                               + glyph_buf[off + 1] + 1);
+    }
+
+    /* temporarily replace the glyph */
+    sfnt->incremental->replace_idx = glyph_index;
+    sfnt->incremental->replace_buf = glyph_buf;
+    sfnt->incremental->replace_len = glyph_len;
+
+    saved_num_contours = glyph->num_contours;
+    saved_num_points = glyph->num_points;
+    glyph->num_contours = num_contours;
+    glyph->num_points = num_points;
+  }
+
+  /* we might be called from a different thread than `TTF_autohint' */
+  saved_memory = _ta_memory;
+  _ta_memory = font->memory;
+
+  font->memory->limit_exceeded = 0;
+  TA_memory_set_phase(font->memory, TA_MEMORY_PHASE_GLYPHS);
+
+#ifdef TA_DEBUG
+  _ta_debug = font->debug;
+  _ta_debug_global = font->debug;
+#endif
+
+  /* control instructions are accessed sequentially; */
+  /* we thus have to start from the beginning */
+  TA_control_rewind(font);
+  TA_control_skip_glyph(font, face_index, (long)glyph_index - 1);
+
+  error = ta_loader_init(font);
+  if (!error)
+    error = TA_sfnt_build_glyph_instructions(sfnt, font, glyph_index);
+  ta_loader_done(font);
+
+  if (!error)
+  {
+    len = glyph->ins_extra_len + glyph->ins_len;
+
+    /* return a valid pointer even for empty bytecode */
+    buf = (FT_Byte*)TA_font_allocate(font, len ? len : 1);
+    if (buf)
+    {
+      if (glyph->ins_extra_len)
+        memcpy(buf, glyph->ins_extra_buf, glyph->ins_extra_len);
+      if (glyph->ins_len)
+        memcpy(buf + glyph->ins_extra_len, glyph->ins_buf, glyph->ins_len);
+
+      *ins_bufp = (unsigned char*)buf;
+      *ins_lenp = len;
+    }
+    else
+      error = FT_Err_Out_Of_Memory;
+  }
+
+  /* reset glyph data for the next call */
+  ta_free(glyph->ins_extra_buf);
+  glyph->ins_extra_buf = NULL;
+  glyph->ins_extra_len = 0;
+  ta_free(glyph->ins_buf);
+  glyph->ins_buf = NULL;
+  glyph->ins_len = 0;
+
+  if (glyph_buf)
+  {
+    sfnt->incremental->replace_buf = NULL;
+
+    glyph->num_contours = saved_num_contours;
+    glyph->num_points = saved_num_points;
+  }
+
+  if (error && font->memory->limit_exceeded)
+    error = TA_Err_Memory_Limit;
+
+  _ta_memory = saved_memory;
+
+  return error;
+}
+
+
+TA_LIB_EXPORT TA_Error
+TTF_autohint_context_get_table(TA_Context context,
+                               long face_index,
+                               const char* tag_string,
+                               unsigned char** bufp,
+                               size_t* lenp)
+{
+  FONT* font;
+  SFNT* sfnt;
+  SFNT_Table* table = NULL;
+
+  FT_ULong tag;
+  FT_ULong i;
+  FT_Byte* buf;
+
+
+  if (!context || !tag_string || !bufp || !lenp)
+    return FT_Err_Invalid_Argument;
+
+  font = context->font;
+
+  if (face_index < 0 || face_index >= font->num_sfnts)
+    return FT_Err_Invalid_Argument;
+
+  sfnt = &font->sfnts[face_index];
+
+  /* pad short tags like `cvt' with spaces */
+  if (strlen(tag_string) > 4)
+    return FT_Err_Invalid_Argument;
+
+  tag = 0;
+  for (i = 0; i < 4; i++)
+    tag = (tag << 8) | (FT_Byte)(tag_string[i] ? tag_string[i] : ' ');
+
+  /* only the tables created or modified by ttfautohint */
+  /* are of interest here */
+  if (!(tag == TTAG_cvt
+        || tag == TTAG_fpgm
+        || tag == TTAG_gasp
+        || tag == TTAG_maxp
+        || tag == TTAG_prep))
+    return FT_Err_Invalid_Argument;
+
+  for (i = 0; i < sfnt->num_table_infos; i++)
+  {
+    SFNT_Table_Info idx = sfnt->table_infos[i];
+
+
+    if (idx != MISSING && font->tables[idx].tag == tag)
+    {
+      table = &font->tables[idx];
+      break;
+    }
+  }
+
+  if (!table)
+    return FT_Err_Table_Missing;
+
+  if (tag == TTAG_maxp && table->len != MAXP_LEN)
+    return FT_Err_Invalid_Table;
+
+  buf = (FT_Byte*)TA_font_allocate(font, table->len);
+  if (!buf)
+    return FT_Err_Out_Of_Memory;
+
+  memcpy(buf, table->buf, table->len);
+
+  /* the `maxp' table gets updated only while writing the output font; */
+  /* we thus fill in the values as they are now */
+  if (tag == TTAG_maxp)
+    TA_sfnt_fill_maxp_buffer(sfnt, font, buf);
+
+  *bufp = (unsigned char*)buf;
+  *lenp = table->len;
+
+  return TA_Err_Ok;
+}
+
+
+TA_LIB_EXPORT void
+TTF_autohint_context_free(TA_Context context)
+{
+  FONT* font;
+  TA_Memory memory;
+  TA_Memory saved_memory;
+
+
+  if (!context)
+    return;
+
+  font = context->font;
+  memory = font->memory;
+
+  saved_memory = _ta_memory;
+  _ta_memory = memory;
+
+  TA_control_free(font->control);
+  TA_control_free_tree(font);
+  TA_font_unload(font, context->in_buf, NULL,
+                 context->control_buf, context->reference_buf, NULL);
+
+  ta_free(context);
+
+  _ta_memory = saved_memory;
+
+  TA_memory_done(memory, NULL);
+}
+
+/* end of tacontext.c */
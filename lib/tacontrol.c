@@ -40,7 +40,7 @@ TA_control_new(Control_Type type,
   Control* control;
 
 
-  control = (Control*)malloc(sizeof (Control));
+  control = (Control*)ta_malloc(sizeof (Control));
   if (!control)
     return NULL;
 
@@ -143,7 +143,7 @@ TA_control_free(Control* control)
 
     tmp = control;
     control = control->next;
-    free(tmp);
+    ta_free(tmp);
   }
 }
 
@@ -292,8 +292,8 @@ control_show_line(FONT* font,
   }
 
 Exit:
-  free(points_buf);
-  free(ppems_buf);
+  ta_free(points_buf);
+  ta_free(ppems_buf);
 
   return s;
 }
@@ -335,7 +335,7 @@ TA_control_show(FONT* font)
 
   /* we return an empty string if there is no data */
   len = sdslen(s) + 1;
-  res = (char*)malloc(len);
+  res = (char*)ta_malloc(len);
   if (res)
     memcpy(res, s, len);
 
@@ -388,14 +388,15 @@ Fail:
       *errline_p = NULL;
       *errpos_p = NULL;
       if (*context.errmsg)
-        *error_string_p = strdup(context.errmsg);
+        *error_string_p = ta_strdup(context.errmsg);
       else
-        *error_string_p = strdup(TA_get_error_message(context.error));
+        *error_string_p = ta_strdup(TA_get_error_message(context.error));
     }
     else
     {
-      int ret;
       char auxbuf[128];
+      const char* errmsg;
+      size_t len;
 
       char* buf_end;
       char* p_start;
@@ -427,7 +428,15 @@ Fail:
           break;
         p_end++;
       }
-      *errline_p = strndup(p_start, (size_t)(p_end - p_start));
+      /* the strings get deallocated with `ta_free', */
+      /* so we can't use `strndup' and `asprintf' */
+      len = (size_t)(p_end - p_start);
+      *errline_p = (char*)ta_malloc(len + 1);
+      if (*errline_p)
+      {
+        memcpy(*errline_p, p_start, len);
+        (*errline_p)[len] = '\0';
+      }
 
       /* construct data for `error_string_p' */
       if (context.error == TA_Err_Control_Invalid_Font_Index)
@@ -453,12 +462,15 @@ Fail:
       else
         auxbuf[0] = '\0';
 
-      ret = asprintf(error_string_p, "%s%s",
-                     *context.errmsg ? context.errmsg
-                                     : TA_get_error_message(context.error),
-                     auxbuf);
-      if (ret == -1)
-        *error_string_p = NULL;
+      errmsg = *context.errmsg ? context.errmsg
+                               : TA_get_error_message(context.error);
+      *error_string_p = (char*)ta_malloc(strlen(errmsg)
+                                         + strlen(auxbuf) + 1);
+      if (*error_string_p)
+      {
+        strcpy(*error_string_p, errmsg);
+        strcat(*error_string_p, auxbuf);
+      }
 
       if (*errline_p)
         *errpos_p = *errline_p + context.errline_pos_left - 1;
@@ -638,10 +650,10 @@ TA_control_free_tree(FONT* font)
   {
     next_node = LLRB_NEXT(control_data, control_data_head, node);
     LLRB_REMOVE(control_data, control_data_head, node);
-    free(node);
+    ta_free(node);
   }
 
-  free(control_data_head);
+  ta_free(control_data_head);
   TA_control_free(control_segment_dirs_head);
 }
 
@@ -665,7 +677,7 @@ TA_control_build_tree(FONT* font)
     return TA_Err_Ok;
   }
 
-  control_data_head = (control_data*)malloc(sizeof (control_data));
+  control_data_head = (control_data*)ta_malloc(sizeof (control_data));
   if (!control_data_head)
     return FT_Err_Out_Of_Memory;
 
@@ -716,7 +728,7 @@ TA_control_build_tree(FONT* font)
         Node* val;
 
 
-        node = (Node*)malloc(sizeof (Node));
+        node = (Node*)ta_malloc(sizeof (Node));
         if (!node)
           return FT_Err_Out_Of_Memory;
 
@@ -779,7 +791,7 @@ TA_control_build_tree(FONT* font)
           val->ctrl.y_shift = y_shift;
           val->ctrl.line_number = line_number;
 
-          free(node);
+          ta_free(node);
         }
 
         point_idx = number_set_get_next(&points_iter);
@@ -830,6 +842,43 @@ TA_control_get_ctrl(FONT* font)
 }
 
 
+void
+TA_control_rewind(FONT* font)
+{
+  control_data* control_data_head = (control_data*)font->control_data_head;
+
+
+  /* nothing to do if no data */
+  if (!control_data_head)
+    return;
+
+  font->control_data_cur = LLRB_MIN(control_data, control_data_head);
+}
+
+
+void
+TA_control_skip_glyph(FONT* font,
+                      long font_idx,
+                      long glyph_idx)
+{
+  for (;;)
+  {
+    const Ctrl* ctrl = TA_control_get_ctrl(font);
+
+
+    if (!ctrl)
+      break;
+
+    if (font_idx < ctrl->font_idx
+        || (font_idx == ctrl->font_idx
+            && glyph_idx < ctrl->glyph_idx))
+      break;
+
+    TA_control_get_next(font);
+  }
+}
+
+
 TA_Error
 TA_control_segment_dir_collect(FONT* font,
                                long font_idx,
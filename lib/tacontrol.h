@@ -346,6 +346,26 @@ const Ctrl*
 TA_control_get_ctrl(FONT* font);
 
 
+/*
+ * Reset `font->control_data_cur' to the first element.
+ */
+
+void
+TA_control_rewind(FONT* font);
+
+
+/*
+ * Skip all control instructions for glyph `glyph_idx' in subfont `font_idx'
+ * (and all glyphs before it).  This is needed for glyphs whose bytecode
+ * doesn't get generated but copied from a previous font.
+ */
+
+void
+TA_control_skip_glyph(FONT* font,
+                      long font_idx,
+                      long glyph_idx);
+
+
 /*
  * Collect one-point segment data for a given glyph index and store them in
  * `font->control_segment_dirs'.
@@ -0,0 +1,410 @@
+/* tacoords.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#include <limits.h>
+
+#include "tatypes.h"
+#include "tacoords.h"
+
+
+/*
+ * The vectorized code handles 64-bit `FT_Pos' values.  `FT_MulFix' is
+ * emulated with 32-bit arguments and a 32-bit result (which is what
+ * FreeType's inline assembler versions of `FT_MulFix' do also); if a
+ * block of values doesn't fit, the scalar code is used for it.
+ *
+ * SSE2 and AVX2 support is selected at compile time.
+ */
+
+#if ULONG_MAX > 0xFFFFFFFFUL
+#  if defined __AVX2__
+#    include <immintrin.h>
+#    define TA_COORDS_AVX2
+#  elif defined __SSE2__
+#    include <emmintrin.h>
+#    define TA_COORDS_SSE2
+#  endif
+#endif
+
+
+#if defined TA_COORDS_AVX2 || defined TA_COORDS_SSE2
+
+/* return the largest absolute value `a' so that `FT_MulFix(a, scale)' */
+/* has both arguments and the result in the 32-bit range, or -1 if */
+/* `scale' itself is too large */
+
+static FT_Pos
+ta_coords_mulfix_limit(FT_Fixed scale)
+{
+  FT_Pos limit;
+
+
+  if (scale < -0x7FFFFFFFL || scale > 0x7FFFFFFFL)
+    return -1;
+  if (scale == 0)
+    return 0x7FFFFFFFL;
+
+  /* |a * scale| + 0x8000 must be smaller than 2^47 */
+  limit = 0x7FFFFFFF7FFFL / TA_ABS(scale);
+
+  return TA_MIN(limit, 0x7FFFFFFFL);
+}
+
+#endif
+
+
+#ifdef TA_COORDS_AVX2
+
+/* `FT_MulFix' for four 64-bit lanes; only the lower 32 bits */
+/* of `a' and `s' are used */
+
+static inline __m256i
+ta_mulfix_avx2(__m256i a,
+               __m256i s)
+{
+  __m256i p = _mm256_mul_epi32(a, s);
+  __m256i neg = _mm256_cmpgt_epi64(_mm256_setzero_si256(), p);
+  __m256i r;
+
+
+  /* round, taking care of the sign */
+  r = _mm256_add_epi64(p, _mm256_add_epi64(_mm256_set1_epi64x(0x8000),
+                                           neg));
+  r = _mm256_srli_epi64(r, 16);
+
+  /* sign-extend the lower 32 bits */
+  r = _mm256_shuffle_epi32(r, _MM_SHUFFLE(2, 2, 0, 0));
+  return _mm256_blend_epi32(r, _mm256_srai_epi32(r, 31), 0xAA);
+}
+
+#endif /* TA_COORDS_AVX2 */
+
+
+#ifdef TA_COORDS_SSE2
+
+/* `FT_MulFix' for two 64-bit lanes; only the lower 32 bits */
+/* of `a' and `s' are used */
+
+static inline __m128i
+ta_mulfix_sse2(__m128i a,
+               __m128i s)
+{
+  __m128i p = _mm_mul_epu32(a, s);
+  __m128i a_neg = _mm_shuffle_epi32(_mm_srai_epi32(a, 31),
+                                    _MM_SHUFFLE(2, 2, 0, 0));
+  __m128i s_neg = _mm_shuffle_epi32(_mm_srai_epi32(s, 31),
+                                    _MM_SHUFFLE(2, 2, 0, 0));
+  __m128i neg;
+  __m128i r;
+
+
+  /* SSE2 only has an unsigned multiplication; */
+  /* correct the result for negative arguments */
+  p = _mm_sub_epi64(p, _mm_and_si128(a_neg, _mm_slli_epi64(s, 32)));
+  p = _mm_sub_epi64(p, _mm_and_si128(s_neg, _mm_slli_epi64(a, 32)));
+
+  /* round, taking care of the sign */
+  neg = _mm_shuffle_epi32(_mm_srai_epi32(p, 31), _MM_SHUFFLE(3, 3, 1, 1));
+  r = _mm_add_epi64(p, _mm_add_epi64(_mm_set1_epi64x(0x8000), neg));
+  r = _mm_srli_epi64(r, 16);
+
+  /* sign-extend the lower 32 bits */
+  r = _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 1, 2, 0));
+  return _mm_unpacklo_epi32(r, _mm_srai_epi32(r, 31));
+}
+
+
+/* check whether both 64-bit lanes of `a' fit into 32 bits */
+
+static inline int
+ta_fits_sse2(__m128i a)
+{
+  __m128i sign = _mm_shuffle_epi32(_mm_srai_epi32(a, 31),
+                                   _MM_SHUFFLE(2, 2, 0, 0));
+
+
+  /* the upper halves must be the sign extension of the lower halves */
+  return (_mm_movemask_epi8(_mm_cmpeq_epi32(a, sign)) & 0xF0F0) == 0xF0F0;
+}
+
+
+/* select `b' for lanes where `mask' is set, `a' otherwise */
+
+static inline __m128i
+ta_select_sse2(__m128i mask,
+               __m128i a,
+               __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+#endif /* TA_COORDS_SSE2 */
+
+
+void
+ta_coords_scale(FT_Pos* out,
+                const FT_Pos* in,
+                FT_UInt count,
+                FT_Fixed scale1,
+                FT_Pos delta1,
+                FT_Fixed scale2,
+                FT_Pos delta2)
+{
+  FT_UInt i = 0;
+
+#if defined TA_COORDS_AVX2 || defined TA_COORDS_SSE2
+  FT_Pos limit1 = ta_coords_mulfix_limit(scale1);
+  FT_Pos limit2 = ta_coords_mulfix_limit(scale2);
+
+
+  if (limit1 >= 0 && limit2 >= 0)
+  {
+#  ifdef TA_COORDS_AVX2
+    __m256i s = _mm256_set_epi64x(scale2, scale1, scale2, scale1);
+    __m256i d = _mm256_set_epi64x(delta2, delta1, delta2, delta1);
+    __m256i max = _mm256_set_epi64x(limit2, limit1, limit2, limit1);
+    __m256i min = _mm256_sub_epi64(_mm256_setzero_si256(), max);
+
+
+    /* `i' stays even, so lanes 0 and 2 get `scale1' */
+    for (; i + 4 <= count; i += 4)
+    {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(in + i));
+      __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi64(a, max),
+                                    _mm256_cmpgt_epi64(min, a));
+
+
+      if (_mm256_testz_si256(bad, bad))
+        _mm256_storeu_si256((__m256i*)(out + i),
+                            _mm256_add_epi64(ta_mulfix_avx2(a, s), d));
+      else
+      {
+        out[i] = FT_MulFix(in[i], scale1) + delta1;
+        out[i + 1] = FT_MulFix(in[i + 1], scale2) + delta2;
+        out[i + 2] = FT_MulFix(in[i + 2], scale1) + delta1;
+        out[i + 3] = FT_MulFix(in[i + 3], scale2) + delta2;
+      }
+    }
+#  else /* TA_COORDS_SSE2 */
+    __m128i s = _mm_set_epi64x(scale2, scale1);
+    __m128i d = _mm_set_epi64x(delta2, delta1);
+    __m128i max = _mm_set_epi32(0, (int)limit2, 0, (int)limit1);
+    __m128i min = _mm_set_epi32(0, (int)-limit2, 0, (int)-limit1);
+
+
+    /* `i' stays even, so lane 0 gets `scale1' */
+    for (; i + 2 <= count; i += 2)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+      __m128i bad = _mm_or_si128(_mm_cmpgt_epi32(a, max),
+                                 _mm_cmpgt_epi32(min, a));
+
+
+      if (ta_fits_sse2(a)
+          && !(_mm_movemask_epi8(bad) & 0x0F0F))
+        _mm_storeu_si128((__m128i*)(out + i),
+                         _mm_add_epi64(ta_mulfix_sse2(a, s), d));
+      else
+      {
+        out[i] = FT_MulFix(in[i], scale1) + delta1;
+        out[i + 1] = FT_MulFix(in[i + 1], scale2) + delta2;
+      }
+    }
+#  endif
+  }
+#endif /* TA_COORDS_AVX2 || TA_COORDS_SSE2 */
+
+  for (; i < count; i++)
+  {
+    if (i & 1)
+      out[i] = FT_MulFix(in[i], scale2) + delta2;
+    else
+      out[i] = FT_MulFix(in[i], scale1) + delta1;
+  }
+}
+
+
+void
+ta_coords_shift(FT_Pos* u,
+                const FT_Pos* v,
+                FT_UInt count,
+                FT_Pos delta)
+{
+  FT_UInt i = 0;
+
+#if defined TA_COORDS_AVX2
+  __m256i d = _mm256_set1_epi64x(delta);
+
+
+  for (; i + 4 <= count; i += 4)
+    _mm256_storeu_si256(
+      (__m256i*)(u + i),
+      _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)(v + i)), d));
+#elif defined TA_COORDS_SSE2
+  __m128i d = _mm_set1_epi64x(delta);
+
+
+  for (; i + 2 <= count; i += 2)
+    _mm_storeu_si128(
+      (__m128i*)(u + i),
+      _mm_add_epi64(_mm_loadu_si128((const __m128i*)(v + i)), d));
+#endif
+
+  for (; i < count; i++)
+    u[i] = v[i] + delta;
+}
+
+
+static void
+ta_coords_interp_scalar(FT_Pos* u,
+                        const FT_Pos* v,
+                        FT_UInt count,
+                        FT_Pos v1,
+                        FT_Pos v2,
+                        FT_Pos u1,
+                        FT_Pos d1,
+                        FT_Pos d2,
+                        FT_Fixed scale)
+{
+  FT_UInt i;
+
+
+  for (i = 0; i < count; i++)
+  {
+    FT_Pos x = v[i];
+
+
+    if (x <= v1)
+      x += d1;
+    else if (x >= v2)
+      x += d2;
+    else
+      x = u1 + FT_MulFix(x - v1, scale);
+
+    u[i] = x;
+  }
+}
+
+
+void
+ta_coords_interp(FT_Pos* u,
+                 const FT_Pos* v,
+                 FT_UInt count,
+                 FT_Pos v1,
+                 FT_Pos v2,
+                 FT_Pos u1,
+                 FT_Pos u2)
+{
+  FT_UInt i = 0;
+
+  FT_Pos d1 = u1 - v1;
+  FT_Pos d2 = u2 - v2;
+
+  /* if the reference points have the same original or current */
+  /* coordinates, all points in between get the value `u1' */
+  FT_Fixed scale = (u1 == u2 || v1 == v2) ? 0
+                                          : FT_DivFix(u2 - u1, v2 - v1);
+
+#if defined TA_COORDS_AVX2 || defined TA_COORDS_SSE2
+  /* points in between satisfy 0 < v[i] - v1 < v2 - v1 */
+  FT_Pos limit = ta_coords_mulfix_limit(scale);
+
+
+  if (limit >= 0 && v2 - v1 <= limit
+#  ifdef TA_COORDS_SSE2
+      /* we compare 32-bit values */
+      && v1 >= INT_MIN && v1 <= INT_MAX
+      && v2 >= INT_MIN && v2 <= INT_MAX
+#  endif
+     )
+  {
+#  ifdef TA_COORDS_AVX2
+    __m256i V1 = _mm256_set1_epi64x(v1);
+    __m256i V2 = _mm256_set1_epi64x(v2);
+    __m256i U1 = _mm256_set1_epi64x(u1);
+    __m256i D1 = _mm256_set1_epi64x(d1);
+    __m256i D2 = _mm256_set1_epi64x(d2);
+    __m256i S = _mm256_set1_epi64x(scale);
+
+
+    for (; i + 4 <= count; i += 4)
+    {
+      __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+      __m256i after_v1 = _mm256_cmpgt_epi64(x, V1);
+      __m256i before_v2 = _mm256_cmpgt_epi64(V2, x);
+      __m256i r;
+
+
+      r = _mm256_blendv_epi8(_mm256_add_epi64(x, D1),
+                             _mm256_add_epi64(x, D2),
+                             after_v1);
+      r = _mm256_blendv_epi8(
+            r,
+            _mm256_add_epi64(U1,
+                             ta_mulfix_avx2(_mm256_sub_epi64(x, V1), S)),
+            _mm256_and_si256(after_v1, before_v2));
+
+      _mm256_storeu_si256((__m256i*)(u + i), r);
+    }
+#  else /* TA_COORDS_SSE2 */
+    __m128i V1 = _mm_set1_epi64x(v1);
+    __m128i V1_32 = _mm_set1_epi32((int)v1);
+    __m128i V2_32 = _mm_set1_epi32((int)v2);
+    __m128i U1 = _mm_set1_epi64x(u1);
+    __m128i D1 = _mm_set1_epi64x(d1);
+    __m128i D2 = _mm_set1_epi64x(d2);
+    __m128i S = _mm_set1_epi64x(scale);
+
+
+    for (; i + 2 <= count; i += 2)
+    {
+      __m128i x = _mm_loadu_si128((const __m128i*)(v + i));
+      __m128i after_v1;
+      __m128i before_v2;
+      __m128i r;
+
+
+      if (!ta_fits_sse2(x))
+      {
+        ta_coords_interp_scalar(u + i, v + i, 2,
+                                v1, v2, u1, d1, d2, scale);
+        continue;
+      }
+
+      /* compare the lower halves, then extend the masks to 64 bits */
+      after_v1 = _mm_shuffle_epi32(_mm_cmpgt_epi32(x, V1_32),
+                                   _MM_SHUFFLE(2, 2, 0, 0));
+      before_v2 = _mm_shuffle_epi32(_mm_cmpgt_epi32(V2_32, x),
+                                    _MM_SHUFFLE(2, 2, 0, 0));
+
+      r = ta_select_sse2(after_v1,
+                         _mm_add_epi64(x, D1),
+                         _mm_add_epi64(x, D2));
+      r = ta_select_sse2(
+            _mm_and_si128(after_v1, before_v2),
+            r,
+            _mm_add_epi64(U1, ta_mulfix_sse2(_mm_sub_epi64(x, V1), S)));
+
+      _mm_storeu_si128((__m128i*)(u + i), r);
+    }
+#  endif
+  }
+#endif /* TA_COORDS_AVX2 || TA_COORDS_SSE2 */
+
+  ta_coords_interp_scalar(u + i, v + i, count - i,
+                          v1, v2, u1, d1, d2, scale);
+}
+
+/* end of tacoords.c */
@@ -0,0 +1,85 @@
+/* tacoords.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Kernels for arrays of coordinates (as opposed to the array of
+ * `TA_PointRec' structures), using SSE2 or AVX2 if available at compile
+ * time.  All results are bit-exact to the scalar code with `FT_MulFix'.
+ */
+
+#ifndef TACOORDS_H_
+#define TACOORDS_H_
+
+#include "tatypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * For `count' values in `in', store
+ *
+ *   FT_MulFix(in[i], scale1) + delta1    (i even)
+ *   FT_MulFix(in[i], scale2) + delta2    (i odd)
+ *
+ * in `out'.  This is meant to scale an array of `FT_Vector' elements.
+ */
+
+void
+ta_coords_scale(FT_Pos* out,
+                const FT_Pos* in,
+                FT_UInt count,
+                FT_Fixed scale1,
+                FT_Pos delta1,
+                FT_Fixed scale2,
+                FT_Pos delta2);
+
+
+/*
+ * Shift `count' original coordinates in `v' by `delta', storing the
+ * result in `u'.
+ */
+
+void
+ta_coords_shift(FT_Pos* u,
+                const FT_Pos* v,
+                FT_UInt count,
+                FT_Pos delta);
+
+
+/*
+ * Interpolate `count' original coordinates in `v', storing the result in
+ * `u', using a reference point with original and current coordinates `v1'
+ * and `u1', and a second one with `v2' and `u2'; `v1' must not be larger
+ * than `v2'.  This is the inner loop of the TrueType `IUP' instruction.
+ */
+
+void
+ta_coords_interp(FT_Pos* u,
+                 const FT_Pos* v,
+                 FT_UInt count,
+                 FT_Pos v1,
+                 FT_Pos v2,
+                 FT_Pos u1,
+                 FT_Pos u2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TACOORDS_H_ */
+
+/* end of tacoords.h */
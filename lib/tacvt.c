@@ -154,7 +154,7 @@ TA_table_build_cvt(FT_Byte** cvt,
 
   /* buffer length must be a multiple of four */
   len = (buf_len + 3) & ~3U;
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_malloc(len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -280,7 +280,7 @@ TA_table_build_cvt(FT_Byte** cvt,
   return FT_Err_Ok;
 
 Err:
-  free(buf);
+  ta_free(buf);
   return TA_Err_Hinter_Overflow;
 }
 
@@ -319,7 +319,7 @@ TA_sfnt_build_cvt_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_cvt, cvt_len, cvt_buf);
   if (error)
-    free(cvt_buf);
+    ta_free(cvt_buf);
   else
     data->cvt_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
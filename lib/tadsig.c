@@ -24,7 +24,7 @@ TA_table_build_DSIG(FT_Byte** DSIG)
   FT_Byte* buf;
 
 
-  buf = (FT_Byte*)malloc(DSIG_LEN);
+  buf = (FT_Byte*)ta_malloc(DSIG_LEN);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -195,14 +195,14 @@ TA_font_dump_parameters(FONT* font,
   s = sdscat(s, "\n");
 
 Exit:
-  free(ns);
-  free(ds);
+  ta_free(ns);
+  ta_free(ds);
 
   if (!s)
     return NULL;
 
   len = sdslen(s) + 1;
-  res = (char*)malloc(len);
+  res = (char*)ta_malloc(len);
   if (res)
     memcpy(res, s, len);
 
@@ -28,7 +28,7 @@ TA_font_file_read(FILE* file,
   size_t read_bytes;
 
 
-  *buffer = (FT_Byte*)malloc(BUF_SIZE);
+  *buffer = (FT_Byte*)ta_malloc(BUF_SIZE);
   if (!*buffer)
     return FT_Err_Out_Of_Memory;
 
@@ -37,7 +37,7 @@ TA_font_file_read(FILE* file,
     FT_Byte* buf_new;
 
 
-    buf_new = (FT_Byte*)realloc(*buffer, len + read_bytes);
+    buf_new = (FT_Byte*)ta_realloc(*buffer, len + read_bytes);
     if (!buf_new)
       return FT_Err_Out_Of_Memory;
     else
@@ -81,7 +81,7 @@ TA_control_file_read(FONT* font,
   size_t read_bytes;
 
 
-  font->control_buf = (char*)malloc(BUF_SIZE);
+  font->control_buf = (char*)ta_malloc(BUF_SIZE);
   if (!font->control_buf)
     return FT_Err_Out_Of_Memory;
 
@@ -91,8 +91,8 @@ TA_control_file_read(FONT* font,
 
 
     /* we store the data as a C string, allocating one more byte */
-    control_buf_new = (char*)realloc(font->control_buf,
-                                     control_len + read_bytes + 1);
+    control_buf_new = (char*)ta_realloc(font->control_buf,
+                                        control_len + read_bytes + 1);
     if (!control_buf_new)
       return FT_Err_Out_Of_Memory;
     else
@@ -15,6 +15,38 @@
 
 #include "ta.h"
 
+#include FT_MODULE_H
+
+
+/* FreeType's memory callbacks, forwarding to the font's memory manager */
+
+static void*
+ta_ft_alloc(FT_Memory memory,
+            long size)
+{
+  return TA_memory_alloc((TA_Memory)memory->user, (size_t)size);
+}
+
+
+static void*
+ta_ft_realloc(FT_Memory memory,
+              long cur_size,
+              long new_size,
+              void* block)
+{
+  (void)cur_size;
+
+  return TA_memory_realloc((TA_Memory)memory->user, block, (size_t)new_size);
+}
+
+
+static void
+ta_ft_free(FT_Memory memory,
+           void* block)
+{
+  TA_memory_free((TA_Memory)memory->user, block);
+}
+
 
 FT_Error
 TA_font_init(FONT* font)
@@ -24,10 +56,21 @@ TA_font_init(FONT* font)
   FT_Int major, minor, patch;
 
 
-  error = FT_Init_FreeType(&font->lib);
+  /* this is `FT_Init_FreeType' with our own memory callbacks */
+  font->ft_memory.user = font->memory;
+  font->ft_memory.alloc = ta_ft_alloc;
+  font->ft_memory.realloc = ta_ft_realloc;
+  font->ft_memory.free = ta_ft_free;
+
+  error = FT_New_Library(&font->ft_memory, &font->lib);
   if (error)
     return error;
 
+  FT_Add_Default_Modules(font->lib);
+#if (FREETYPE_MAJOR*1000 + FREETYPE_MINOR)*1000 + FREETYPE_PATCH >= 2008001
+  FT_Set_Default_Properties(font->lib);
+#endif
+
   /* assure correct FreeType version to avoid using the wrong DLL */
   FT_Library_Version(font->lib, &major, &minor, &patch);
   if (((major*1000 + minor)*1000 + patch) < 2004005)
@@ -45,7 +88,7 @@ TA_font_init(FONT* font)
   FT_Done_Face(f);
 
   /* it is a TTC if we have more than a single subfont */
-  font->sfnts = (SFNT*)calloc(1, (size_t)font->num_sfnts * sizeof (SFNT));
+  font->sfnts = (SFNT*)ta_calloc(1, (size_t)font->num_sfnts * sizeof (SFNT));
   if (!font->sfnts)
     return FT_Err_Out_Of_Memory;
 
@@ -60,16 +103,85 @@ TA_font_init(FONT* font)
       return error + 0x300;
   }
 
+  if (font->previous_buf)
+  {
+    FT_Long i;
+
+
+    /* the previous font must have the same number of subfonts */
+    error = FT_New_Memory_Face(font->lib,
+                               font->previous_buf,
+                               (FT_Long)font->previous_len,
+                               -1,
+                               &f);
+    if (error)
+      return TA_Err_Invalid_Previous_Font;
+    if (f->num_faces != font->num_sfnts)
+    {
+      FT_Done_Face(f);
+      return TA_Err_Previous_Font_Mismatch;
+    }
+    FT_Done_Face(f);
+
+    for (i = 0; i < font->num_sfnts; i++)
+    {
+      error = FT_New_Memory_Face(font->lib,
+                                 font->previous_buf,
+                                 (FT_Long)font->previous_len,
+                                 i,
+                                 &font->sfnts[i].previous);
+      if (error)
+        return TA_Err_Invalid_Previous_Font;
+    }
+  }
+
   return TA_Err_Ok;
 }
 
 
+/*
+ * Call the application's allocation functions (options `alloc-func' and
+ * `free-func').  Like other callbacks, they run without a memory manager,
+ * so that library allocations they might trigger on this thread are
+ * neither accounted to the font nor serialized with its hinting threads.
+ */
+
+void*
+TA_font_allocate(FONT* font,
+                 size_t size)
+{
+  TA_Memory saved_memory = _ta_memory;
+  void* block;
+
+
+  _ta_memory = NULL;
+  block = font->allocate(size);
+  _ta_memory = saved_memory;
+
+  return block;
+}
+
+
+void
+TA_font_deallocate(FONT* font,
+                   void* block)
+{
+  TA_Memory saved_memory = _ta_memory;
+
+
+  _ta_memory = NULL;
+  font->deallocate(block);
+  _ta_memory = saved_memory;
+}
+
+
 void
 TA_font_unload(FONT* font,
                const char* in_buf,
                char** out_bufp,
                const char* control_buf,
-               const char* reference_buf)
+               const char* reference_buf,
+               const char* previous_buf)
 {
   /* in case of error it is expected that unallocated pointers */
   /* are NULL (and counters are zero) */
@@ -78,6 +190,7 @@ TA_font_unload(FONT* font,
     return;
 
   ta_loader_done(font);
+  ta_free(font->bytecode_buffer.buf);
 
   if (font->tables)
   {
@@ -86,7 +199,7 @@ TA_font_unload(FONT* font,
 
     for (i = 0; i < font->num_tables; i++)
     {
-      free(font->tables[i].buf);
+      ta_free(font->tables[i].buf);
       if (font->tables[i].data)
       {
         if (font->tables[i].tag == TTAG_glyf)
@@ -97,18 +210,19 @@ TA_font_unload(FONT* font,
 
           for (j = 0; j < data->num_glyphs; j++)
           {
-            free(data->glyphs[j].buf);
-            free(data->glyphs[j].ins_buf);
-            free(data->glyphs[j].ins_extra_buf);
-            free(data->glyphs[j].components);
-            free(data->glyphs[j].pointsums);
+            if (data->glyphs[j].owns_buf)
+              ta_free(data->glyphs[j].buf);
+            ta_free(data->glyphs[j].ins_buf);
+            ta_free(data->glyphs[j].ins_extra_buf);
+            ta_free(data->glyphs[j].components);
+            ta_free(data->glyphs[j].pointsums);
           }
-          free(data->glyphs);
-          free(data);
+          ta_free(data->glyphs);
+          ta_free(data);
         }
       }
     }
-    free(font->tables);
+    ta_free(font->tables);
   }
 
   if (font->sfnts)
@@ -118,30 +232,47 @@ TA_font_unload(FONT* font,
 
     for (i = 0; i < font->num_sfnts; i++)
     {
+#ifdef HAVE_PTHREAD_H
+      TA_sfnt_free_shards(&font->sfnts[i]);
+#endif
+
+      /* this also destroys the face's size objects */
       FT_Done_Face(font->sfnts[i].face);
-      free(font->sfnts[i].table_infos);
+      ta_free(font->sfnts[i].incremental);
+      ta_free(font->sfnts[i].sizes);
+      ta_free(font->sfnts[i].profile);
+      ta_free(font->sfnts[i].table_infos);
+
+      FT_Done_Face(font->sfnts[i].previous);
+      ta_free(font->sfnts[i].previous_glyf);
+      ta_free(font->sfnts[i].previous_loca);
+      ta_free(font->sfnts[i].previous_rehint);
     }
-    free(font->sfnts);
+    ta_free(font->sfnts);
   }
 
   FT_Done_Face(font->reference);
 
   number_set_free(font->x_height_snapping_exceptions);
+  number_set_free(font->glyph_subset);
+  number_set_free(font->glyph_subset_control);
 
-  FT_Done_FreeType(font->lib);
+  FT_Done_Library(font->lib);
 
   /* in case the user provided file handles, */
   /* free the allocated buffers for the file contents */
   if (!in_buf)
-    free(font->in_buf);
+    ta_free(font->in_buf);
   if (!out_bufp)
-    font->deallocate(font->out_buf);
+    TA_font_deallocate(font, font->out_buf);
   if (!control_buf)
-    free(font->control_buf);
+    ta_free(font->control_buf);
   if (!reference_buf)
-    free(font->reference_buf);
+    ta_free(font->reference_buf);
+  if (!previous_buf)
+    ta_free(font->previous_buf);
 
-  free(font);
+  ta_free(font);
 }
 
 /* end of tafont.c */
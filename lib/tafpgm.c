@@ -7195,7 +7195,7 @@ TA_table_build_fpgm(FT_Byte** fpgm,
 
   /* buffer length must be a multiple of four */
   len = (buf_len + 3) & ~3U;
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_malloc(len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -7446,7 +7446,7 @@ TA_sfnt_build_fpgm_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_fpgm, fpgm_len, fpgm_buf);
   if (error)
-    free(fpgm_buf);
+    ta_free(fpgm_buf);
   else
     data->fpgm_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
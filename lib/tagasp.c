@@ -22,7 +22,7 @@ TA_table_build_gasp(FT_Byte** gasp)
   FT_Byte* buf;
 
 
-  buf = (FT_Byte*)malloc(GASP_LEN);
+  buf = (FT_Byte*)ta_malloc(GASP_LEN);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -76,7 +76,7 @@ TA_sfnt_build_gasp_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_gasp, GASP_LEN, gasp_buf);
   if (error)
-    free(gasp_buf);
+    ta_free(gasp_buf);
   else
     font->gasp_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
@@ -54,7 +54,7 @@ TA_GlyphLoader_New(TA_GlyphLoader *aloader)
   TA_GlyphLoader loader;
 
 
-  loader = (TA_GlyphLoader)calloc(1, sizeof (TA_GlyphLoaderRec));
+  loader = (TA_GlyphLoader)ta_calloc(1, sizeof (TA_GlyphLoaderRec));
 
   if (!loader)
     return FT_Err_Out_Of_Memory;
@@ -85,11 +85,11 @@ TA_GlyphLoader_Rewind(TA_GlyphLoader loader)
 void
 TA_GlyphLoader_Reset(TA_GlyphLoader loader)
 {
-  free(loader->base.outline.points);
-  free(loader->base.outline.tags);
-  free(loader->base.outline.contours);
-  free(loader->base.extra_points);
-  free(loader->base.subglyphs);
+  ta_free(loader->base.outline.points);
+  ta_free(loader->base.outline.tags);
+  ta_free(loader->base.outline.contours);
+  ta_free(loader->base.extra_points);
+  ta_free(loader->base.subglyphs);
 
   loader->base.outline.points = NULL;
   loader->base.outline.tags = NULL;
@@ -114,7 +114,7 @@ TA_GlyphLoader_Done(TA_GlyphLoader loader)
   if (loader)
   {
     TA_GlyphLoader_Reset(loader);
-    free(loader);
+    ta_free(loader);
   }
 }
 
@@ -148,7 +148,7 @@ FT_Error
 TA_GlyphLoader_CreateExtra(TA_GlyphLoader loader)
 {
   loader->base.extra_points =
-    (FT_Vector*)calloc(1, 2 * loader->max_points * sizeof (FT_Vector));
+    (FT_Vector*)ta_calloc(1, 2 * loader->max_points * sizeof (FT_Vector));
   if (!loader->base.extra_points)
     return FT_Err_Out_Of_Memory;
 
@@ -206,14 +206,14 @@ TA_GlyphLoader_CheckPoints(TA_GlyphLoader loader,
     if (new_max > FT_OUTLINE_POINTS_MAX)
       return FT_Err_Array_Too_Large;
 
-    points_new = (FT_Vector*)realloc(base->points,
-                                     new_max * sizeof (FT_Vector));
+    points_new = (FT_Vector*)ta_realloc(base->points,
+                                        new_max * sizeof (FT_Vector));
     if (!points_new)
       return FT_Err_Out_Of_Memory;
     base->points = points_new;
 
-    tags_new = (char*)realloc(base->tags,
-                              new_max * sizeof (char));
+    tags_new = (char*)ta_realloc(base->tags,
+                                 new_max * sizeof (char));
     if (!tags_new)
       return FT_Err_Out_Of_Memory;
     base->tags = tags_new;
@@ -224,8 +224,8 @@ TA_GlyphLoader_CheckPoints(TA_GlyphLoader loader,
 
 
       extra_points_new =
-        (FT_Vector*)realloc(loader->base.extra_points,
-                            new_max * 2 * sizeof (FT_Vector));
+        (FT_Vector*)ta_realloc(loader->base.extra_points,
+                               new_max * 2 * sizeof (FT_Vector));
       if (!extra_points_new)
         return FT_Err_Out_Of_Memory;
       loader->base.extra_points = extra_points_new;
@@ -255,8 +255,8 @@ TA_GlyphLoader_CheckPoints(TA_GlyphLoader loader,
     if (new_max > FT_OUTLINE_CONTOURS_MAX)
       return FT_Err_Array_Too_Large;
 
-    contours_new = (short*)realloc(base->contours,
-                                   new_max * sizeof (short));
+    contours_new = (short*)ta_realloc(base->contours,
+                                      new_max * sizeof (short));
     if (!contours_new)
       return FT_Err_Out_Of_Memory;
     base->contours = contours_new;
@@ -293,8 +293,8 @@ TA_GlyphLoader_CheckSubGlyphs(TA_GlyphLoader loader,
 
 
     new_max = TA_PAD_CEIL(new_max, 2);
-    subglyphs_new = (TA_SubGlyph)realloc(base->subglyphs,
-                                         new_max * sizeof (TA_SubGlyphRec));
+    subglyphs_new = (TA_SubGlyph)ta_realloc(base->subglyphs,
+                                            new_max * sizeof (TA_SubGlyphRec));
     if (!subglyphs_new)
       return FT_Err_Out_Of_Memory;
     base->subglyphs = subglyphs_new;
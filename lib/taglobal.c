@@ -18,6 +18,7 @@
 /* heavily modified 2011 by Werner Lemberg <wl@gnu.org> */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "taglobal.h"
 #include "taranges.h"
@@ -155,7 +156,8 @@ ta_face_globals_scan_composite(FT_Face face,
 
   /* since a call to FT_Load_Glyph changes `glyph', */
   /* we have to first store the subglyph indices, then do the recursion */
-  subglyph_indices = (FT_Int*)malloc(sizeof (FT_Int) * glyph->num_subglyphs);
+  subglyph_indices = (FT_Int*)ta_malloc(sizeof (FT_Int)
+                                        * glyph->num_subglyphs);
   if (!subglyph_indices)
     return FT_Err_Out_Of_Memory;
 
@@ -196,7 +198,7 @@ ta_face_globals_scan_composite(FT_Face face,
       break;
   }
 
-  free(subglyph_indices);
+  ta_free(subglyph_indices);
 
   return error;
 }
@@ -471,7 +473,7 @@ ta_face_globals_new(FT_Face face,
 
   /* we allocate an TA_FaceGlobals structure together */
   /* with the glyph_styles array */
-  globals = (TA_FaceGlobals)calloc(
+  globals = (TA_FaceGlobals)ta_calloc(
               1, sizeof (TA_FaceGlobalsRec) +
                  (FT_ULong)face->num_glyphs * sizeof (FT_UShort));
   if (!globals)
@@ -488,7 +490,19 @@ ta_face_globals_new(FT_Face face,
   globals->hb_font = hb_ft_font_create(face, NULL);
   globals->hb_buf = hb_buffer_create();
 
-  error = ta_face_globals_compute_style_coverage(globals);
+  /* the font functions of `hb_ft_font_create' return metrics */
+  /* at the size currently set for `face', which changes while hinting; */
+  /* HarfBuzz's own font functions read the font tables directly */
+  hb_ot_font_set_funcs(globals->hb_font);
+
+  /* we shape at a size of units per EM; this means font units */
+  hb_font_set_scale(globals->hb_font,
+                    (int)face->units_per_EM,
+                    (int)face->units_per_EM);
+
+  error = ta_shaper_cache_new(globals, &globals->shaper_cache);
+  if (!error)
+    error = ta_face_globals_compute_style_coverage(globals);
   if (error)
   {
     ta_face_globals_free(globals);
@@ -513,6 +527,20 @@ ta_face_globals_free(TA_FaceGlobals globals)
 
     for (nn = 0; nn < TA_STYLE_MAX; nn++)
     {
+      if (globals->scaled_metrics[nn])
+      {
+        FT_UInt num_sizes = globals->font->hinting_range_max
+                            - globals->font->hinting_range_min + 1;
+        FT_UInt i;
+
+
+        /* the scaled metrics are shallow copies of `globals->metrics'; */
+        /* `style_metrics_done' must thus not be called for them */
+        for (i = 0; i < num_sizes; i++)
+          ta_free(globals->scaled_metrics[nn][i].metrics);
+        ta_free(globals->scaled_metrics[nn]);
+      }
+
       if (globals->metrics[nn])
       {
         TA_StyleClass style_class =
@@ -524,16 +552,17 @@ ta_face_globals_free(TA_FaceGlobals globals)
         if (writing_system_class->style_metrics_done)
           writing_system_class->style_metrics_done(globals->metrics[nn]);
 
-        free(globals->metrics[nn]);
+        ta_free(globals->metrics[nn]);
       }
     }
 
     hb_font_destroy(globals->hb_font);
     hb_buffer_destroy(globals->hb_buf);
+    ta_shaper_cache_done(globals->shaper_cache);
 
     /* no need to free `globals->glyph_styles'; */
     /* it is part of the `globals' array */
-    free(globals);
+    ta_free(globals);
   }
 }
 
@@ -573,7 +602,7 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
   {
     /* create the global metrics object if necessary */
     metrics = (TA_StyleMetrics)
-                calloc(1, writing_system_class->style_metrics_size);
+                ta_calloc(1, writing_system_class->style_metrics_size);
     if (!metrics)
     {
       error = FT_Err_Out_Of_Memory;
@@ -594,7 +623,7 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
         if (writing_system_class->style_metrics_done)
           writing_system_class->style_metrics_done(metrics);
 
-        free(metrics);
+        ta_free(metrics);
         metrics = NULL;
         goto Exit;
       }
@@ -610,6 +639,90 @@ Exit:
 }
 
 
+/*
+ * Scale `metrics' with `scaler'.  Scaling only depends on the style and
+ * the PPEM value, but the bytecode generator loads every glyph once for
+ * each size of the hinting range.  For those sizes we therefore compute
+ * a scaled copy of the metrics only once and afterwards simply return
+ * it; all other sizes scale `metrics' in place as usual.
+ */
+
+FT_Error
+ta_face_globals_scale_metrics(TA_FaceGlobals globals,
+                              TA_StyleMetrics metrics,
+                              TA_Scaler scaler,
+                              TA_StyleMetrics *ametrics)
+{
+  FONT* font = globals->font;
+  FT_Size_Metrics* size_metrics = &scaler->face->size->metrics;
+  TA_StyleClass style_class = metrics->style_class;
+  TA_WritingSystemClass writing_system_class =
+    ta_writing_system_classes[style_class->writing_system];
+
+  FT_UInt style = (FT_UInt)style_class->style;
+  FT_UInt ppem = size_metrics->x_ppem;
+  TA_ScaledMetrics scaled;
+
+
+  *ametrics = metrics;
+
+  if (!writing_system_class->style_metrics_scale)
+  {
+    metrics->scaler = *scaler;
+    return FT_Err_Ok;
+  }
+
+  if (ppem != size_metrics->y_ppem
+      || ppem < font->hinting_range_min
+      || ppem > font->hinting_range_max)
+  {
+    writing_system_class->style_metrics_scale(metrics, scaler);
+    return FT_Err_Ok;
+  }
+
+  if (!globals->scaled_metrics[style])
+  {
+    FT_UInt num_sizes = font->hinting_range_max
+                        - font->hinting_range_min + 1;
+
+
+    globals->scaled_metrics[style] =
+      (TA_ScaledMetrics)ta_calloc(num_sizes, sizeof (TA_ScaledMetricsRec));
+    if (!globals->scaled_metrics[style])
+      return FT_Err_Out_Of_Memory;
+  }
+
+  scaled = globals->scaled_metrics[style] + ppem - font->hinting_range_min;
+
+  if (!scaled->metrics)
+  {
+    scaled->metrics = (TA_StyleMetrics)
+                        ta_malloc(writing_system_class->style_metrics_size);
+    if (!scaled->metrics)
+      return FT_Err_Out_Of_Memory;
+
+    memcpy(scaled->metrics,
+           metrics,
+           writing_system_class->style_metrics_size);
+  }
+  else if (scaled->scaler.face == scaler->face
+           && TA_SCALER_EQUAL_SCALES(&scaled->scaler, scaler)
+           && scaled->scaler.render_mode == scaler->render_mode
+           && scaled->scaler.flags == scaler->flags)
+  {
+    *ametrics = scaled->metrics;
+    return FT_Err_Ok;
+  }
+
+  writing_system_class->style_metrics_scale(scaled->metrics, scaler);
+  scaled->scaler = *scaler;
+
+  *ametrics = scaled->metrics;
+
+  return FT_Err_Ok;
+}
+
+
 FT_Bool
 ta_face_globals_is_digit(TA_FaceGlobals globals,
                          FT_UInt gindex)
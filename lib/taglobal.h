@@ -77,6 +77,14 @@ extern const char* ta_style_names[];
 
 /* note that glyph_styles[] maps each glyph to an index into the */
 /* `ta_style_classes' array. */
+/* a style's metrics, scaled for a given PPEM value */
+typedef struct TA_ScaledMetricsRec_
+{
+  TA_ScalerRec scaler; /* the scaler `metrics' was computed with */
+  TA_StyleMetrics metrics;
+} TA_ScaledMetricsRec, *TA_ScaledMetrics;
+
+
 typedef struct TA_FaceGlobalsRec_
 {
   FT_Face face;
@@ -85,6 +93,8 @@ typedef struct TA_FaceGlobalsRec_
 
   hb_font_t* hb_font;
   hb_buffer_t* hb_buf; /* for feature comparison */
+  /* possibly shared with other subfonts */
+  TA_ShaperCache shaper_cache;
 
   /* per-face auto-hinter properties */
   FT_UInt increase_x_height;
@@ -92,6 +102,10 @@ typedef struct TA_FaceGlobalsRec_
   TA_StyleMetrics metrics[TA_STYLE_MAX];
   FT_UInt sample_glyphs[TA_STYLE_MAX]; /* per-style sample glyph indices */
 
+  /* per-style arrays of scaled metrics for the hinting range, */
+  /* indexed by `ppem - font->hinting_range_min' */
+  TA_ScaledMetrics scaled_metrics[TA_STYLE_MAX];
+
   FONT* font; /* to access global properties */
 } TA_FaceGlobalsRec;
 
@@ -110,6 +124,12 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
                             FT_UInt options,
                             TA_StyleMetrics *ametrics);
 
+FT_Error
+ta_face_globals_scale_metrics(TA_FaceGlobals globals,
+                              TA_StyleMetrics metrics,
+                              TA_Scaler scaler,
+                              TA_StyleMetrics *ametrics);
+
 void
 ta_face_globals_free(TA_FaceGlobals globals);
 
@@ -16,6 +16,218 @@
 #include "ta.h"
 
 
+/* the data needed to find simple glyphs with identical outlines */
+typedef struct Outline_Key_
+{
+  FT_ULong hash;
+  FT_UShort style; /* including flags like `TA_DIGIT' */
+  FT_UShort idx;
+  GLYPH* glyph;
+} Outline_Key;
+
+
+static FT_ULong
+TA_glyph_hash_outline(GLYPH* glyph)
+{
+  /* FNV-1a */
+  FT_UInt32 hash = 0x811C9DC5UL;
+  FT_ULong i;
+
+
+  for (i = 0; i < glyph->len1; i++)
+    hash = (hash ^ glyph->buf[i]) * 0x01000193UL;
+  for (i = 0; i < glyph->len2; i++)
+    hash = (hash ^ glyph->buf2[i]) * 0x01000193UL;
+
+  return hash;
+}
+
+
+/* compare everything except the glyph index */
+
+static int
+TA_outline_key_compare_outlines(const Outline_Key* key1,
+                                const Outline_Key* key2)
+{
+  int ret;
+
+
+  if (key1->hash != key2->hash)
+    return key1->hash < key2->hash ? -1 : 1;
+  if (key1->style != key2->style)
+    return key1->style < key2->style ? -1 : 1;
+  if (key1->glyph->len1 != key2->glyph->len1)
+    return key1->glyph->len1 < key2->glyph->len1 ? -1 : 1;
+  if (key1->glyph->len2 != key2->glyph->len2)
+    return key1->glyph->len2 < key2->glyph->len2 ? -1 : 1;
+
+  ret = memcmp(key1->glyph->buf, key2->glyph->buf, key1->glyph->len1);
+  if (ret)
+    return ret;
+
+  return memcmp(key1->glyph->buf2, key2->glyph->buf2, key1->glyph->len2);
+}
+
+
+static int
+TA_outline_key_compare(const void* a,
+                       const void* b)
+{
+  const Outline_Key* key1 = (const Outline_Key*)a;
+  const Outline_Key* key2 = (const Outline_Key*)b;
+  int ret;
+
+
+  ret = TA_outline_key_compare_outlines(key1, key2);
+  if (ret)
+    return ret;
+
+  /* identical outlines are sorted by glyph index */
+  return (int)key1->idx - (int)key2->idx;
+}
+
+
+/*
+ * Simple glyphs with identical outlines and glyph styles get identical
+ * bytecode; this happens, for example, if a glyph is duplicated to be
+ * mapped to another character code.  Such glyphs are grouped, and the
+ * `originals' array gets, for every glyph, the index of the first glyph
+ * in its group, which is the only one actually hinted.  Glyphs affected
+ * by glyph-specific control instructions are never grouped.
+ *
+ * The number of glyphs that get their bytecode from another glyph is
+ * returned in `num_shared'.
+ */
+
+static FT_Error
+TA_sfnt_find_identical_outlines(SFNT* sfnt,
+                                FONT* font,
+                                FT_UShort num_glyphs,
+                                FT_UShort** originals,
+                                FT_UShort* num_shared)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+
+  TA_FaceGlobals globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+  FT_UShort* gstyles = globals->glyph_styles;
+
+  FT_UShort* origs = NULL;
+  FT_Byte* excluded = NULL;
+  Outline_Key* keys = NULL;
+  FT_UShort num_keys;
+  FT_UShort i;
+
+  Control* control;
+
+
+  *originals = NULL;
+  *num_shared = 0;
+
+  if (!num_glyphs)
+    return FT_Err_Ok;
+
+  origs = (FT_UShort*)ta_malloc(num_glyphs * sizeof (FT_UShort));
+  excluded = (FT_Byte*)ta_calloc(num_glyphs, 1);
+  keys = (Outline_Key*)ta_malloc(num_glyphs * sizeof (Outline_Key));
+  if (!(origs && excluded && keys))
+  {
+    ta_free(origs);
+    ta_free(excluded);
+    ta_free(keys);
+    return FT_Err_Out_Of_Memory;
+  }
+
+  for (control = font->control; control; control = control->next)
+  {
+    if (control->type == Control_Script_Feature_Glyphs
+        || control->type == Control_Script_Feature_Widths)
+      continue;
+
+    if (control->font_idx == sfnt->face->face_index
+        && control->glyph_idx >= 0
+        && control->glyph_idx < num_glyphs)
+      excluded[control->glyph_idx] = 1;
+  }
+
+  num_keys = 0;
+  for (i = 0; i < num_glyphs; i++)
+  {
+    GLYPH* glyph = &data->glyphs[i];
+
+
+    origs[i] = i;
+
+    if (glyph->num_contours <= 0 || excluded[i])
+      continue;
+
+    /* glyphs getting bytecode from a previous font are not hinted */
+    if (sfnt->previous_rehint && !sfnt->previous_rehint[i])
+      continue;
+
+    keys[num_keys].hash = TA_glyph_hash_outline(glyph);
+    keys[num_keys].style = gstyles[i];
+    keys[num_keys].idx = i;
+    keys[num_keys].glyph = glyph;
+    num_keys++;
+  }
+
+  qsort(keys, num_keys, sizeof (Outline_Key), TA_outline_key_compare);
+
+  /* since each group is sorted by glyph index, */
+  /* its first element is the glyph hinted first */
+  for (i = 1; i < num_keys; i++)
+  {
+    Outline_Key* key = &keys[i];
+    Outline_Key* prev = &keys[i - 1];
+
+
+    if (!TA_outline_key_compare_outlines(key, prev))
+    {
+      origs[key->idx] = origs[prev->idx];
+      (*num_shared)++;
+    }
+  }
+
+  ta_free(excluded);
+  ta_free(keys);
+
+  *originals = origs;
+
+  return FT_Err_Ok;
+}
+
+
+/* copy the bytecode of glyph `original' to glyph `glyph' */
+
+static FT_Error
+TA_glyph_copy_instructions(GLYPH* glyph,
+                           GLYPH* original)
+{
+  if (original->ins_len)
+  {
+    glyph->ins_buf = (FT_Byte*)ta_malloc(original->ins_len);
+    if (!glyph->ins_buf)
+      return FT_Err_Out_Of_Memory;
+    memcpy(glyph->ins_buf, original->ins_buf, original->ins_len);
+  }
+  glyph->ins_len = original->ins_len;
+
+  if (original->ins_extra_len)
+  {
+    glyph->ins_extra_buf = (FT_Byte*)ta_malloc(original->ins_extra_len);
+    if (!glyph->ins_extra_buf)
+      return FT_Err_Out_Of_Memory;
+    memcpy(glyph->ins_extra_buf,
+           original->ins_extra_buf,
+           original->ins_extra_len);
+  }
+  glyph->ins_extra_len = original->ins_extra_len;
+
+  return FT_Err_Ok;
+}
+
+
 static FT_Error
 TA_sfnt_build_glyf_hints(SFNT* sfnt,
                          FONT* font)
@@ -28,30 +240,103 @@ TA_sfnt_build_glyf_hints(SFNT* sfnt,
 
   FT_UShort loop_count;
 
+  FT_UShort* originals;
+  FT_UShort num_shared;
+
 
   /* this loop doesn't include the artificial `.ttfautohint' glyph */
   loop_count = data->num_glyphs;
   if (sfnt->max_components && font->hint_composites)
     loop_count--;
 
+  error = TA_sfnt_find_identical_outlines(sfnt, font, loop_count,
+                                          &originals, &num_shared);
+  if (error)
+    return error;
+
+  if (font->debug && num_shared)
+    fprintf(stderr, "%d glyph%s of subfont %ld"
+                    " reuse%s the bytecode of an identical glyph\n"
+                    "\n",
+                    num_shared, num_shared == 1 ? "" : "s",
+                    sfnt->face->face_index,
+                    num_shared == 1 ? "s" : "");
+
+  error = TA_sfnt_init_profile(sfnt, font);
+  if (error)
+  {
+    ta_free(originals);
+    return error;
+  }
+
   for (idx = 0; idx < loop_count; idx++)
   {
-    error = TA_sfnt_build_glyph_instructions(sfnt, font, idx);
+    double start_time = 0;
+
+
+    if (sfnt->profile)
+      start_time = TA_profile_time();
+
+    /* with option `glyph-subset', */
+    /* reuse the bytecode of unchanged glyphs */
+    if (sfnt->previous_rehint && !sfnt->previous_rehint[idx])
+      error = TA_sfnt_copy_previous_instructions(sfnt, font, idx);
+    /* glyphs with identical outlines get the same bytecode */
+    else if (originals[idx] != idx)
+    {
+      error = TA_glyph_copy_instructions(&data->glyphs[idx],
+                                         &data->glyphs[originals[idx]]);
+      if (sfnt->profile)
+        sfnt->profile[idx].copy_of = originals[idx];
+    }
+    else
+      error = TA_sfnt_build_glyph_instructions(sfnt, font, idx);
     if (error)
+    {
+      ta_free(originals);
       return error;
+    }
+
+    if (sfnt->profile)
+    {
+      sfnt->profile[idx].time = TA_profile_time() - start_time;
+      sfnt->profile[idx].ins_len = (FT_UInt)data->glyphs[idx].ins_len;
+    }
     if (font->progress)
     {
       FT_Int ret;
 
 
+      /* the callback is application code */
+      _ta_memory = NULL;
       ret = font->progress(idx, loop_count,
                            sfnt - font->sfnts, font->num_sfnts,
                            font->progress_data);
+      _ta_memory = font->memory;
       if (ret)
+      {
+        ta_free(originals);
         return TA_Err_Canceled;
+      }
     }
   }
 
+  ta_free(originals);
+
+  if (font->debug && sfnt->bytecode_len_before)
+    fprintf(stderr, "bytecode optimization of subfont %ld:\n"
+                    "  size: %lu bytes -> %lu bytes\n"
+                    "  executed instructions (ppem %u-%u):"
+                    " %lu -> %lu\n"
+                    "\n",
+                    sfnt->face->face_index,
+                    sfnt->bytecode_len_before,
+                    sfnt->bytecode_len_after,
+                    font->hinting_range_min,
+                    font->hinting_range_max,
+                    sfnt->bytecode_steps_before,
+                    sfnt->bytecode_steps_after);
+
   return FT_Err_Ok;
 }
 
@@ -87,9 +372,9 @@ TA_glyph_get_components(GLYPH* glyph,
     component = NEXT_USHORT(p);
 
     glyph->num_components++;
-    components_new = (FT_UShort*)realloc(glyph->components,
-                                         glyph->num_components
-                                         * sizeof (FT_UShort));
+    components_new = (FT_UShort*)ta_realloc(glyph->components,
+                                            glyph->num_components
+                                            * sizeof (FT_UShort));
     if (!components_new)
     {
       glyph->num_components--;
@@ -143,9 +428,10 @@ TA_glyph_parse_composite(GLYPH* glyphs,
   /* (including space for the new component */
   /* and possible argument size changes for shifted point indices) */
   /* and reallocate it later to its real size */
-  glyph->buf = (FT_Byte*)malloc(len + 8 + glyph->num_components * 2);
+  glyph->buf = (FT_Byte*)ta_malloc(len + 8 + glyph->num_components * 2);
   if (!glyph->buf)
     return FT_Err_Out_Of_Memory;
+  glyph->owns_buf = 1;
 
   p = buf;
   q = glyph->buf;
@@ -325,7 +611,7 @@ TA_glyph_parse_composite(GLYPH* glyphs,
   glyph->len1 = (FT_ULong)(q - glyph->buf);
   /* glyph->len2 = 0; */
   glyph->flags_offset = flags_offset;
-  glyph->buf = (FT_Byte*)realloc(glyph->buf, glyph->len1);
+  glyph->buf = (FT_Byte*)ta_realloc(glyph->buf, glyph->len1);
 
   /* we discard instructions (if any) */
   glyph->buf[glyph->flags_offset] &= ~(WE_HAVE_INSTR >> 8);
@@ -434,17 +720,13 @@ TA_glyph_parse_simple(GLYPH* glyph,
 
   flags_size = (FT_ULong)(p - flags_start);
 
-  /* store the data before and after the bytecode instructions */
-  /* in the same array */
+  /* we don't copy the data before and after the bytecode instructions */
+  /* but refer to it in the `glyf' table */
   glyph->len1 = ins_offset;
   glyph->len2 = flags_size + xy_size;
-  glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
-  if (!glyph->buf)
-    return FT_Err_Out_Of_Memory;
-
-  /* now copy everything but the instructions */
-  memcpy(glyph->buf, buf, glyph->len1);
-  memcpy(glyph->buf + glyph->len1, flags_start, glyph->len2);
+  glyph->buf = buf;
+  glyph->buf2 = flags_start;
+  glyph->owns_buf = 0;
 
   return TA_Err_Ok;
 }
@@ -469,9 +751,9 @@ TA_iterate_composite_glyph(glyf_Data* data,
     return FT_Err_Invalid_Table;
 
   (*num_pointsums)++;
-  pointsums_new = (FT_UShort*)realloc(*pointsums,
-                                      *num_pointsums
-                                      * sizeof (FT_UShort));
+  pointsums_new = (FT_UShort*)ta_realloc(*pointsums,
+                                         *num_pointsums
+                                         * sizeof (FT_UShort));
   if (!pointsums_new)
   {
     (*num_pointsums)--;
@@ -608,7 +890,7 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
   if (glyf_table->data)
     return TA_Err_Ok;
 
-  data = (glyf_Data*)calloc(1, sizeof (glyf_Data));
+  data = (glyf_Data*)ta_calloc(1, sizeof (glyf_Data));
   if (!data)
     return FT_Err_Out_Of_Memory;
 
@@ -623,7 +905,7 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
   /* allocate one more glyph slot if we have composite glyphs */
   if (!sfnt->max_components || !font->hint_composites)
     data->num_glyphs -= 1;
-  data->glyphs = (GLYPH*)calloc(1, data->num_glyphs * sizeof (GLYPH));
+  data->glyphs = (GLYPH*)ta_calloc(1, data->num_glyphs * sizeof (GLYPH));
   if (!data->glyphs)
     return FT_Err_Out_Of_Memory;
 
@@ -766,9 +1048,11 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
 
     glyph->len1 = 12;
     glyph->len2 = 1;
-    glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
+    glyph->buf = (FT_Byte*)ta_malloc(glyph->len1 + glyph->len2);
     if (!glyph->buf)
       return FT_Err_Out_Of_Memory;
+    glyph->buf2 = glyph->buf + glyph->len1;
+    glyph->owns_buf = 1;
 
     buf = glyph->buf;
 
@@ -791,7 +1075,7 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
     /* this works because the loop in `TA_sfnt_build_glyf_hints' */
     /* doesn't include the newly appended glyph */
     glyph->ins_len = sizeof (ttfautohint_glyph_bytecode);
-    glyph->ins_buf = (FT_Byte*)malloc(glyph->ins_len);
+    glyph->ins_buf = (FT_Byte*)ta_malloc(glyph->ins_len);
     if (!glyph->ins_buf)
       return FT_Err_Out_Of_Memory;
     memcpy(glyph->ins_buf, ttfautohint_glyph_bytecode, glyph->ins_len);
@@ -828,6 +1112,11 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
     error = TA_sfnt_build_glyf_hints(sfnt, font);
     if (error)
       return error;
+    error = TA_sfnt_extract_subroutines(sfnt, font);
+    if (error)
+      return error;
+
+    TA_sfnt_finish_profile(sfnt, font);
   }
 
   /* get table size */
@@ -848,13 +1137,13 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
   /* assure an even length of the `glyf' table */
   glyf_table->len = (len + 1) & ~1U;
 
-  buf_new = (FT_Byte*)realloc(glyf_table->buf, (len + 3) & ~3U);
+  /* the data of simple glyphs refers to the old table, */
+  /* so we have to use a new buffer */
+  buf_new = (FT_Byte*)ta_malloc((len + 3) & ~3U);
   if (!buf_new)
     return FT_Err_Out_Of_Memory;
-  else
-    glyf_table->buf = buf_new;
 
-  p = glyf_table->buf;
+  p = buf_new;
   glyph = data->glyphs;
   for (i = 0; i < data->num_glyphs; i++, glyph++)
   {
@@ -871,6 +1160,9 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
       if (glyph->len2)
       {
         /* simple glyph */
+        FT_Byte* q = p;
+
+
         p += glyph->len1;
         *(p++) = HIGH(glyph->ins_extra_len + glyph->ins_len);
         *(p++) = LOW(glyph->ins_extra_len + glyph->ins_len);
@@ -884,7 +1176,15 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
           memcpy(p, glyph->ins_buf, glyph->ins_len);
           p += glyph->ins_len;
         }
-        memcpy(p, glyph->buf + glyph->len1, glyph->len2);
+        memcpy(p, glyph->buf2, glyph->len2);
+
+        /* make the glyph data refer to the new table */
+        if (!glyph->owns_buf)
+        {
+          glyph->buf = q;
+          glyph->buf2 = p;
+        }
+
         p += glyph->len2;
       }
       else
@@ -928,6 +1228,9 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
     }
   }
 
+  ta_free(glyf_table->buf);
+  glyf_table->buf = buf_new;
+
   glyf_table->checksum = TA_table_compute_checksum(glyf_table->buf,
                                                    glyf_table->len);
   glyf_table->processed = 1;
@@ -971,7 +1274,7 @@ TA_create_glyph_data(FT_Outline* outline,
   /* we use `calloc' since we rely on the array */
   /* being initialized to zero; */
   /* additionally, we need one more byte for a test after the loop */
-  flags = (FT_Byte*)calloc(1, (size_t)outline->n_points + 1);
+  flags = (FT_Byte*)ta_calloc(1, (size_t)outline->n_points + 1);
   if (!flags)
   {
     error = FT_Err_Out_Of_Memory;
@@ -979,14 +1282,14 @@ TA_create_glyph_data(FT_Outline* outline,
   }
 
   /* we have either one-byte or two-byte elements */
-  x = (FT_Byte*)malloc(2 * (size_t)outline->n_points);
+  x = (FT_Byte*)ta_malloc(2 * (size_t)outline->n_points);
   if (!x)
   {
     error = FT_Err_Out_Of_Memory;
     goto Exit;
   }
 
-  y = (FT_Byte*)malloc(2 * (size_t)outline->n_points);
+  y = (FT_Byte*)ta_malloc(2 * (size_t)outline->n_points);
   if (!y)
   {
     error = FT_Err_Out_Of_Memory;
@@ -1121,12 +1424,14 @@ TA_create_glyph_data(FT_Outline* outline,
   glyph->len1 = (FT_ULong)(10 + 2 * outline->n_contours);
   glyph->len2 = (FT_ULong)((flagsp - flags) + (xp - x) + (yp - y));
 
-  glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
+  glyph->buf = (FT_Byte*)ta_malloc(glyph->len1 + glyph->len2);
   if (!glyph->buf)
   {
     error = FT_Err_Out_Of_Memory;
     goto Exit;
   }
+  glyph->buf2 = glyph->buf + glyph->len1;
+  glyph->owns_buf = 1;
 
   p = glyph->buf;
   memcpy(p, header, 10);
@@ -1150,9 +1455,9 @@ TA_create_glyph_data(FT_Outline* outline,
   memcpy(p, y, (size_t)(yp - y));
 
 Exit:
-  free(flags);
-  free(x);
-  free(y);
+  ta_free(flags);
+  ta_free(x);
+  ta_free(y);
 
   return error;
 }
@@ -1183,14 +1488,14 @@ TA_sfnt_create_glyf_data(SFNT* sfnt,
   if (glyf_table->data)
     return TA_Err_Ok;
 
-  data = (glyf_Data*)calloc(1, sizeof (glyf_Data));
+  data = (glyf_Data*)ta_calloc(1, sizeof (glyf_Data));
   if (!data)
     return FT_Err_Out_Of_Memory;
 
   glyf_table->data = data;
 
   data->num_glyphs = (FT_UShort)face->num_glyphs;
-  data->glyphs = (GLYPH*)calloc(1, data->num_glyphs * sizeof (GLYPH));
+  data->glyphs = (GLYPH*)ta_calloc(1, data->num_glyphs * sizeof (GLYPH));
   if (!data->glyphs)
     return FT_Err_Out_Of_Memory;
 
@@ -64,7 +64,7 @@ TA_read_coverage_table(FT_Byte* p,
     if (p - GPOS_table->buf > (ptrdiff_t)(GPOS_table->len - GlyphCount * 2))
       return FT_Err_Invalid_Table;
 
-    glyph_idxs = (FT_UShort*)malloc(GlyphCount * sizeof (FT_UShort));
+    glyph_idxs = (FT_UShort*)ta_malloc(GlyphCount * sizeof (FT_UShort));
     if (!glyph_idxs)
       return FT_Err_Out_Of_Memory;
 
@@ -115,7 +115,7 @@ TA_read_coverage_table(FT_Byte* p,
       count += end - start + 1;
     }
 
-    glyph_idxs = (FT_UShort*)malloc(count * sizeof (FT_UShort));
+    glyph_idxs = (FT_UShort*)ta_malloc(count * sizeof (FT_UShort));
     if (!glyph_idxs)
       return FT_Err_Out_Of_Memory;
 
@@ -264,14 +264,14 @@ TA_handle_cursive_lookup(FT_Byte* Lookup,
         goto Fail;
     }
 
-    free(cov.glyph_idxs);
+    ta_free(cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_free(cov.glyph_idxs);
   return error;
 }
 
@@ -344,7 +344,7 @@ TA_handle_markbase_lookup(FT_Byte* Lookup,
         return error;
     }
 
-    free(cov.glyph_idxs);
+    ta_free(cov.glyph_idxs);
 
     error = TA_read_coverage_table(BaseCoverage, &cov, sfnt, font);
     if (error)
@@ -379,14 +379,14 @@ TA_handle_markbase_lookup(FT_Byte* Lookup,
       }
     }
 
-    free(cov.glyph_idxs);
+    ta_free(cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_free(cov.glyph_idxs);
   return error;
 }
 
@@ -459,7 +459,7 @@ TA_handle_marklig_lookup(FT_Byte* Lookup,
         return error;
     }
 
-    free(cov.glyph_idxs);
+    ta_free(cov.glyph_idxs);
 
     error = TA_read_coverage_table(LigatureCoverage, &cov, sfnt, font);
     if (error)
@@ -508,14 +508,14 @@ TA_handle_marklig_lookup(FT_Byte* Lookup,
       }
     }
 
-    free(cov.glyph_idxs);
+    ta_free(cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_free(cov.glyph_idxs);
   return error;
 }
 
@@ -588,7 +588,7 @@ TA_handle_markmark_lookup(FT_Byte* Lookup,
         return error;
     }
 
-    free(cov.glyph_idxs);
+    ta_free(cov.glyph_idxs);
 
     error = TA_read_coverage_table(Mark2Coverage, &cov, sfnt, font);
     if (error)
@@ -623,14 +623,14 @@ TA_handle_markmark_lookup(FT_Byte* Lookup,
       }
     }
 
-    free(cov.glyph_idxs);
+    ta_free(cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_free(cov.glyph_idxs);
   return error;
 }
 
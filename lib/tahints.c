@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "tahints.h"
+#include "tacoords.h"
 
 
 /* get new segment for given axis */
@@ -64,7 +65,7 @@ ta_axis_hints_new_segment(TA_AxisHints axis,
 
     if (axis->segments == axis->embedded.segments)
     {
-      axis->segments = (TA_Segment)malloc(
+      axis->segments = (TA_Segment)ta_malloc(
                          (size_t)new_max * sizeof (TA_SegmentRec));
       if (!axis->segments)
         return FT_Err_Out_Of_Memory;
@@ -74,7 +75,7 @@ ta_axis_hints_new_segment(TA_AxisHints axis,
     }
     else
     {
-      segments_new = (TA_Segment)realloc(
+      segments_new = (TA_Segment)ta_realloc(
                        axis->segments,
                        (size_t)new_max * sizeof (TA_SegmentRec));
       if (!segments_new)
@@ -138,7 +139,7 @@ ta_axis_hints_new_edge(TA_AxisHints axis,
 
     if (axis->edges == axis->embedded.edges)
     {
-      axis->edges = (TA_Edge)malloc((size_t)new_max * sizeof (TA_EdgeRec));
+      axis->edges = (TA_Edge)ta_malloc((size_t)new_max * sizeof (TA_EdgeRec));
       if (!axis->edges)
         return FT_Err_Out_Of_Memory;
 
@@ -147,8 +148,8 @@ ta_axis_hints_new_edge(TA_AxisHints axis,
     }
     else
     {
-      edges_new = (TA_Edge)realloc(axis->edges,
-                                   (size_t)new_max * sizeof (TA_EdgeRec));
+      edges_new = (TA_Edge)ta_realloc(axis->edges,
+                                      (size_t)new_max * sizeof (TA_EdgeRec));
       if (!edges_new)
         return FT_Err_Out_Of_Memory;
       axis->edges = edges_new;
@@ -158,22 +159,39 @@ ta_axis_hints_new_edge(TA_AxisHints axis,
   }
 
   edges = axis->edges;
-  edge = edges + axis->num_edges;
 
-  while (edge > edges)
+  /* the edges are sorted by position (in descending order for */
+  /* top-to-bottom hinting); we want the edge with same position and */
+  /* minor direction to appear before those in the major one in the */
+  /* list, so a new edge in major direction gets inserted after edges */
+  /* with the same position, and before them otherwise */
   {
-    if (top_to_bottom_hinting ? (edge[-1].fpos > fpos)
-                              : (edge[-1].fpos < fpos))
-      break;
-
-    /* we want the edge with same position and minor direction */
-    /* to appear before those in the major one in the list */
-    if (edge[-1].fpos == fpos
-        && dir == axis->major_dir)
-      break;
-
-    edge[0] = edge[-1];
-    edge--;
+    FT_Int lo = 0;
+    FT_Int hi = axis->num_edges;
+
+
+    while (lo < hi)
+    {
+      FT_Int mid = lo + (hi - lo) / 2;
+      FT_Int mid_fpos = edges[mid].fpos;
+      FT_Bool before;
+
+
+      if (mid_fpos == fpos)
+        before = (dir == axis->major_dir);
+      else
+        before = top_to_bottom_hinting ? (mid_fpos > fpos)
+                                       : (mid_fpos < fpos);
+
+      if (before)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    edge = edges + lo;
+    memmove(edge + 1, edge,
+            (size_t)(axis->num_edges - lo) * sizeof (TA_EdgeRec));
   }
 
   axis->num_edges++;
@@ -199,7 +217,26 @@ _ta_message(const char* format,
 
 
   va_start(ap, format);
-  vfprintf(stderr, format, ap);
+  if (_ta_debug_trace)
+  {
+    TA_Trace trace = (TA_Trace)_ta_debug_trace;
+    char buf[1024];
+    int len;
+
+
+    len = vsnprintf(buf, sizeof (buf), format, ap);
+    if (len >= (int)sizeof (buf))
+      len = sizeof (buf) - 1;
+
+    if (len > 0)
+    {
+      TA_trace_open_event(trace, TA_TRACE_MESSAGE);
+      TA_trace_bytes(trace, buf, (size_t)len);
+      TA_trace_close_event(trace);
+    }
+  }
+  else
+    vfprintf(stderr, format, ap);
   va_end(ap);
 }
 
@@ -397,7 +434,7 @@ ta_glyph_hints_dump_points(TA_GlyphHints hints)
 static const char*
 ta_edge_flags_to_string(FT_Byte flags)
 {
-  static char temp[32];
+  static TA_THREAD_LOCAL char temp[32];
   int pos = 0;
 
 
@@ -542,6 +579,118 @@ ta_glyph_hints_dump_edges(TA_GlyphHints hints)
   }
 }
 
+
+/* the binary counterpart of the three dump functions above; */
+/* see file `tatrace.h' for the format */
+
+void
+ta_glyph_hints_trace(TA_GlyphHints hints,
+                     TA_Trace trace)
+{
+  FT_Int dimension;
+
+  TA_Point points = hints->points;
+  TA_Point limit = points + hints->num_points;
+  TA_Point* contour = hints->contours;
+  TA_Point* climit = contour + hints->num_contours;
+  TA_Point point;
+
+
+  for (dimension = TA_DEBUG_STARTDIM;
+       dimension >= TA_DEBUG_ENDDIM;
+       dimension--)
+  {
+    TA_AxisHints axis = &hints->axis[dimension];
+    TA_Edge edges = axis->edges;
+    TA_Edge elimit = edges + axis->num_edges;
+    TA_Edge edge;
+
+
+    TA_trace_open_event(trace, TA_TRACE_EDGES);
+    TA_trace_int(trace, dimension);
+    TA_trace_int(trace, dimension == TA_DIMENSION_HORZ ? hints->x_scale
+                                                       : hints->y_scale);
+    TA_trace_int(trace, axis->num_edges);
+
+    for (edge = edges; edge < elimit; edge++)
+    {
+      TA_trace_int(trace, edge->opos);
+      TA_trace_int(trace, edge->dir);
+      TA_trace_int(trace, TA_INDEX_NUM(edge->link, edges));
+      TA_trace_int(trace, TA_INDEX_NUM(edge->serif, edges));
+      TA_trace_int(trace, edge->blue_edge != NULL);
+      TA_trace_int(trace, edge->pos);
+      TA_trace_int(trace, edge->flags);
+    }
+    TA_trace_close_event(trace);
+  }
+
+  for (dimension = TA_DEBUG_STARTDIM;
+       dimension >= TA_DEBUG_ENDDIM;
+       dimension--)
+  {
+    TA_AxisHints axis = &hints->axis[dimension];
+    TA_Edge edges = axis->edges;
+    TA_Segment segments = axis->segments;
+    TA_Segment slimit = segments + axis->num_segments;
+    TA_Segment seg;
+
+
+    TA_trace_open_event(trace, TA_TRACE_SEGMENTS);
+    TA_trace_int(trace, dimension);
+    TA_trace_int(trace, axis->num_segments);
+
+    for (seg = segments; seg < slimit; seg++)
+    {
+      TA_trace_int(trace, seg->pos);
+      TA_trace_int(trace, seg->delta);
+      TA_trace_int(trace, seg->dir);
+      TA_trace_int(trace, TA_INDEX_NUM(seg->first, points));
+      TA_trace_int(trace, TA_INDEX_NUM(seg->last, points));
+      TA_trace_int(trace, TA_INDEX_NUM(seg->link, segments));
+      TA_trace_int(trace, TA_INDEX_NUM(seg->serif, segments));
+      TA_trace_int(trace, TA_INDEX_NUM(seg->edge, edges));
+      TA_trace_int(trace, seg->height);
+      TA_trace_int(trace, seg->height - (seg->max_coord - seg->min_coord));
+      TA_trace_int(trace, seg->flags);
+    }
+    TA_trace_close_event(trace);
+  }
+
+  TA_trace_open_event(trace, TA_TRACE_POINTS);
+  TA_trace_int(trace, hints->num_points);
+
+  for (point = points; point < limit; point++)
+  {
+    int point_idx = TA_INDEX_NUM(point, points);
+    int segment_idx_1 = ta_get_segment_index(hints, point_idx, 1);
+
+
+    if (contour < climit && *contour == point)
+    {
+      TA_trace_int(trace, 1);
+      contour++;
+    }
+    else
+      TA_trace_int(trace, 0);
+
+    TA_trace_int(trace, ta_get_edge_index(hints, segment_idx_1, 1));
+    TA_trace_int(trace, segment_idx_1);
+    TA_trace_int(trace, (point->flags & TA_FLAG_WEAK_INTERPOLATION) != 0);
+
+    TA_trace_int(trace, point->fx);
+    TA_trace_int(trace, point->fy);
+    TA_trace_int(trace, point->ox);
+    TA_trace_int(trace, point->oy);
+    TA_trace_int(trace, point->x);
+    TA_trace_int(trace, point->y);
+
+    TA_trace_int(trace, ta_get_strong_edge_index(hints, point->before, 1));
+    TA_trace_int(trace, ta_get_strong_edge_index(hints, point->after, 1));
+  }
+  TA_trace_close_event(trace);
+}
+
 #endif /* TA_DEBUG */
 
 
@@ -624,7 +773,7 @@ ta_glyph_hints_done(TA_GlyphHints hints)
     axis->max_segments = 0;
     if (axis->segments != axis->embedded.segments)
     {
-      free(axis->segments);
+      ta_free(axis->segments);
       axis->segments = NULL;
     }
 
@@ -632,14 +781,14 @@ ta_glyph_hints_done(TA_GlyphHints hints)
     axis->max_edges = 0;
     if (axis->edges != axis->embedded.edges)
     {
-      free(axis->edges);
+      ta_free(axis->edges);
       axis->edges = NULL;
     }
   }
 
   if (hints->contours != hints->embedded.contours)
   {
-    free(hints->contours);
+    ta_free(hints->contours);
     hints->contours = NULL;
   }
   hints->max_contours = 0;
@@ -647,9 +796,14 @@ ta_glyph_hints_done(TA_GlyphHints hints)
 
   if (hints->points != hints->embedded.points)
   {
-    free(hints->points);
+    ta_free(hints->points);
     hints->points = NULL;
   }
+  if (hints->coords != hints->embedded.coords)
+  {
+    ta_free(hints->coords);
+    hints->coords = NULL;
+  }
   hints->max_points = 0;
   hints->num_points = 0;
 }
@@ -753,8 +907,8 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
 
     new_max = (new_max + 3) & ~3U; /* round up to a multiple of 4 */
 
-    contours_new = (TA_Point*)realloc(hints->contours,
-                                      new_max * sizeof (TA_Point));
+    contours_new = (TA_Point*)ta_realloc(hints->contours,
+                                         new_max * sizeof (TA_Point));
     if (!contours_new)
       return FT_Err_Out_Of_Memory;
 
@@ -772,25 +926,36 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
     if (!hints->points)
     {
       hints->points = hints->embedded.points;
+      hints->coords = hints->embedded.coords;
       hints->max_points = TA_POINTS_EMBEDDED;
     }
   }
   else if (new_max > old_max)
   {
     TA_Point points_new;
+    FT_Pos* coords_new;
 
 
     if (hints->points == hints->embedded.points)
+    {
       hints->points = NULL;
+      hints->coords = NULL;
+    }
 
     new_max = (new_max + 2 + 7) & ~7U; /* round up to a multiple of 8 */
 
-    points_new = (TA_Point)realloc(hints->points,
-                                   new_max * sizeof (TA_PointRec));
+    points_new = (TA_Point)ta_realloc(hints->points,
+                                      new_max * sizeof (TA_PointRec));
     if (!points_new)
       return FT_Err_Out_Of_Memory;
-
     hints->points = points_new;
+
+    coords_new = (FT_Pos*)ta_realloc(hints->coords,
+                                     2 * new_max * sizeof (FT_Pos));
+    if (!coords_new)
+      return FT_Err_Out_Of_Memory;
+    hints->coords = coords_new;
+
     hints->max_points = (FT_Int)new_max;
   }
 
@@ -830,6 +995,7 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
     /* compute coordinates & Bezier flags, next and prev */
     {
       FT_Vector* vec = outline->points;
+      FT_Pos* coord = hints->coords;
       char* tag = outline->tags;
 
       TA_Point end = points + outline->contours[0];
@@ -838,15 +1004,22 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
       FT_Int contour_index = 0;
 
 
-      for (point = points; point < point_limit; point++, vec++, tag++)
+      /* scale all x and y values of the `FT_Vector' array in one go */
+      ta_coords_scale(coord, (const FT_Pos*)vec,
+                      2 * (FT_UInt)hints->num_points,
+                      x_scale, x_delta, y_scale, y_delta);
+
+      for (point = points;
+           point < point_limit;
+           point++, vec++, coord += 2, tag++)
       {
         point->in_dir = (FT_Char)TA_DIR_NONE;
         point->out_dir = (FT_Char)TA_DIR_NONE;
 
         point->fx = (FT_Short)vec->x;
         point->fy = (FT_Short)vec->y;
-        point->ox = point->x = FT_MulFix(vec->x, x_scale) + x_delta;
-        point->oy = point->y = FT_MulFix(vec->y, y_scale) + y_delta;
+        point->ox = point->x = coord[0];
+        point->oy = point->y = coord[1];
 
         switch (FT_CURVE_TAG(*tag))
         {
@@ -1468,99 +1641,56 @@ ta_glyph_hints_align_strong_points(TA_GlyphHints hints,
  ****************************************************************/
 
 
-/* shift the original coordinates of all points between `p1' and */
-/* `p2' to get hinted coordinates, using the same difference as */
+/* shift the original coordinates `v' of all points between `p1' and */
+/* `p2' to get hinted coordinates `u', using the same difference as */
 /* given by `ref' */
 
 static void
-ta_iup_shift(TA_Point p1,
-             TA_Point p2,
-             TA_Point ref)
+ta_iup_shift(FT_Pos* u,
+             const FT_Pos* v,
+             FT_Int p1,
+             FT_Int p2,
+             FT_Int ref)
 {
-  TA_Point p;
-  FT_Pos delta = ref->u - ref->v;
+  FT_Pos delta = u[ref] - v[ref];
 
 
   if (delta == 0)
     return;
 
-  for (p = p1; p < ref; p++)
-    p->u = p->v + delta;
-
-  for (p = ref + 1; p <= p2; p++)
-    p->u = p->v + delta;
+  ta_coords_shift(u + p1, v + p1, (FT_UInt)(ref - p1), delta);
+  ta_coords_shift(u + ref + 1, v + ref + 1, (FT_UInt)(p2 - ref), delta);
 }
 
 
-/* interpolate the original coordinates of all points between `p1' and */
-/* `p2' to get hinted coordinates, using `ref1' and `ref2' as the */
-/* reference points; the `u' and `v' members are the current and */
-/* original coordinate values, respectively. */
+/* interpolate the original coordinates `v' of all points between `p1' */
+/* and `p2' to get hinted coordinates `u', using `ref1' and `ref2' as */
+/* the reference points */
 
 /* details can be found in the TrueType bytecode specification */
 
 static void
-ta_iup_interp(TA_Point p1,
-              TA_Point p2,
-              TA_Point ref1,
-              TA_Point ref2)
+ta_iup_interp(FT_Pos* u,
+              const FT_Pos* v,
+              FT_Int p1,
+              FT_Int p2,
+              FT_Int ref1,
+              FT_Int ref2)
 {
-  TA_Point p;
-  FT_Pos u, v1, v2, u1, u2, d1, d2;
-
-
   if (p1 > p2)
     return;
 
-  if (ref1->v > ref2->v)
-  {
-    p = ref1;
-    ref1 = ref2;
-    ref2 = p;
-  }
-
-  v1 = ref1->v;
-  v2 = ref2->v;
-  u1 = ref1->u;
-  u2 = ref2->u;
-  d1 = u1 - v1;
-  d2 = u2 - v2;
-
-  if (u1 == u2 || v1 == v2)
+  if (v[ref1] > v[ref2])
   {
-    for (p = p1; p <= p2; p++)
-    {
-      u = p->v;
+    FT_Int tmp = ref1;
 
-      if (u <= v1)
-        u += d1;
-      else if (u >= v2)
-        u += d2;
-      else
-        u = u1;
 
-      p->u = u;
-    }
+    ref1 = ref2;
+    ref2 = tmp;
   }
-  else
-  {
-    FT_Fixed scale = FT_DivFix(u2 - u1, v2 - v1);
-
-
-    for (p = p1; p <= p2; p++)
-    {
-      u = p->v;
-
-      if (u <= v1)
-        u += d1;
-      else if (u >= v2)
-        u += d2;
-      else
-        u = u1 + FT_MulFix(u - v1, scale);
 
-      p->u = u;
-    }
-  }
+  ta_coords_interp(u + p1, v + p1, (FT_UInt)(p2 - p1 + 1),
+                   v[ref1], v[ref2], u[ref1], u[ref2]);
 }
 
 
@@ -1577,10 +1707,16 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
   TA_Point* contour = hints->contours;
   TA_Point* contour_limit = contour + hints->num_contours;
 
+  /* we work on columns of current and original coordinates; */
+  /* `coords' holds `2 * max_points' elements */
+  FT_Pos* u = hints->coords;
+  FT_Pos* v = hints->coords + hints->max_points;
+
   FT_UShort touch_flag;
   TA_Point point;
   TA_Point end_point;
   TA_Point first_point;
+  FT_Int i;
 
 
   /* pass 1: move segment points to edge positions */
@@ -1589,20 +1725,20 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
   {
     touch_flag = TA_FLAG_TOUCH_X;
 
-    for (point = points; point < point_limit; point++)
+    for (point = points, i = 0; point < point_limit; point++, i++)
     {
-      point->u = point->x;
-      point->v = point->ox;
+      u[i] = point->x;
+      v[i] = point->ox;
     }
   }
   else
   {
     touch_flag = TA_FLAG_TOUCH_Y;
 
-    for (point = points; point < point_limit; point++)
+    for (point = points, i = 0; point < point_limit; point++, i++)
     {
-      point->u = point->y;
-      point->v = point->oy;
+      u[i] = point->y;
+      v[i] = point->oy;
     }
   }
 
@@ -1652,24 +1788,36 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
       }
 
       /* interpolate between last_touched and point */
-      ta_iup_interp(last_touched + 1, point - 1,
-                    last_touched, point);
+      ta_iup_interp(u, v,
+                    (FT_Int)(last_touched - points) + 1,
+                    (FT_Int)(point - points) - 1,
+                    (FT_Int)(last_touched - points),
+                    (FT_Int)(point - points));
     }
 
   EndContour:
     /* special case: only one point was touched */
     if (last_touched == first_touched)
-      ta_iup_shift(first_point, end_point, first_touched);
+      ta_iup_shift(u, v,
+                   (FT_Int)(first_point - points),
+                   (FT_Int)(end_point - points),
+                   (FT_Int)(first_touched - points));
 
     else /* interpolate the last part */
     {
       if (last_touched < end_point)
-        ta_iup_interp(last_touched + 1, end_point,
-                      last_touched, first_touched);
+        ta_iup_interp(u, v,
+                      (FT_Int)(last_touched - points) + 1,
+                      (FT_Int)(end_point - points),
+                      (FT_Int)(last_touched - points),
+                      (FT_Int)(first_touched - points));
 
       if (first_touched > points)
-        ta_iup_interp(first_point, first_touched - 1,
-                      last_touched, first_touched);
+        ta_iup_interp(u, v,
+                      (FT_Int)(first_point - points),
+                      (FT_Int)(first_touched - points) - 1,
+                      (FT_Int)(last_touched - points),
+                      (FT_Int)(first_touched - points));
     }
 
   NextContour:
@@ -1679,13 +1827,13 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
   /* now save the interpolated values back to x/y */
   if (dim == TA_DIMENSION_HORZ)
   {
-    for (point = points; point < point_limit; point++)
-      point->x = point->u;
+    for (point = points, i = 0; point < point_limit; point++, i++)
+      point->x = u[i];
   }
   else
   {
-    for (point = points; point < point_limit; point++)
-      point->y = point->u;
+    for (point = points, i = 0; point < point_limit; point++, i++)
+      point->y = u[i];
   }
 }
 
@@ -21,6 +21,7 @@
 #define TAHINTS_H_
 
 #include "tatypes.h"
+#include "tatrace.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -442,6 +443,7 @@ typedef struct TA_GlyphHintsRec_
   FT_Int max_points; /* number of allocated points */
   FT_Int num_points; /* number of used points */
   TA_Point points; /* points array */
+  FT_Pos* coords; /* coordinate columns, `2 * max_points' elements */
 
   FT_Int max_contours; /* number of allocated contours */
   FT_Int num_contours; /* number of used contours */
@@ -459,12 +461,13 @@ typedef struct TA_GlyphHintsRec_
   TA_Hints_Recorder recorder;
   void* user;
 
-  /* two arrays to avoid allocation penalty; */
+  /* three arrays to avoid allocation penalty; */
   /* the `embedded' structure must be the last element! */
   struct
   {
     TA_Point contours[TA_CONTOURS_EMBEDDED];
     TA_PointRec points[TA_POINTS_EMBEDDED];
+    FT_Pos coords[2 * TA_POINTS_EMBEDDED];
   } embedded;
 } TA_GlyphHintsRec;
 
@@ -488,6 +491,10 @@ typedef struct TA_GlyphHintsRec_
 #define TA_HINTS_DO_BLUES(h) \
           (!_ta_debug_disable_blue_hints)
 
+/* point dumps must show the completely hinted outline */
+#define TA_HINTS_DO_OUTLINE(h) \
+          (_ta_debug || !(h)->recorder)
+
 #else /* !TA_DEBUG */
 
 #define TA_HINTS_DO_HORIZONTAL(h) \
@@ -499,8 +506,20 @@ typedef struct TA_GlyphHintsRec_
 #define TA_HINTS_DO_BLUES(h) \
           1
 
+#define TA_HINTS_DO_OUTLINE(h) \
+          !(h)->recorder
+
 #endif /* !TA_DEBUG */
 
+/* compile with `-DTA_NO_OUTLINE_SHORTCUT' to always compute the */
+/* complete outline; `ttfautohint-shortcut-check.sh' uses such a build */
+/* to verify that the shortcut doesn't change the output */
+#ifdef TA_NO_OUTLINE_SHORTCUT
+#  undef TA_HINTS_DO_OUTLINE
+#  define TA_HINTS_DO_OUTLINE(h) \
+            1
+#endif
+
 
 #define TA_HINTS_DO_ADVANCE(h) \
           !TA_HINTS_TEST_SCALER(h, TA_SCALER_FLAG_NO_ADVANCE)
@@ -534,6 +553,10 @@ ta_glyph_hints_dump_segments(TA_GlyphHints hints);
 
 void
 ta_glyph_hints_dump_edges(TA_GlyphHints hints);
+
+void
+ta_glyph_hints_trace(TA_GlyphHints hints,
+                     TA_Trace trace);
 #endif
 
 void
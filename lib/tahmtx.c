@@ -42,7 +42,7 @@ TA_sfnt_update_hmtx_table(SFNT* sfnt,
   hmtx_table->len += 2;
   /* make the allocated buffer length a multiple of 4 */
   buf_len = (hmtx_table->len + 3) & ~3U;
-  buf_new = (FT_Byte*)realloc(hmtx_table->buf, buf_len);
+  buf_new = (FT_Byte*)ta_realloc(hmtx_table->buf, buf_len);
   if (!buf_new)
   {
     hmtx_table->len -= 2;
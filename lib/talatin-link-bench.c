@@ -0,0 +1,214 @@
+/* talatin-link-bench.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) \
+ *         -I.. -I. \
+ *         -o talatin-link-bench talatin-link-bench.c \
+ *         .libs/libttfautohint.a \
+ *         `pkg-config --libs freetype2 harfbuzz` -lm
+ *
+ * after configuration and compilation of the library.  This program
+ * includes `talatin.c' to access its static functions.
+ *
+ * For random sets of segments with increasing size, the program compares
+ * the results of the two segment linking methods in `talatin.c', aborting
+ * with an assertion message in case of a difference.  It then prints the
+ * time per call for both methods; the crossover point is the value to use
+ * for `TA_LATIN_LINK_SORT_THRESHOLD'.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "talatin.c"
+
+
+#define NUM_SETS 16
+#define MAX_SEGMENTS 2048
+
+
+static TA_SegmentRec segments_orig[MAX_SEGMENTS];
+static TA_SegmentRec segments_all[MAX_SEGMENTS];
+static TA_SegmentRec segments_sorted[MAX_SEGMENTS];
+
+
+/* segments similar to the ones of a complex glyph */
+/* with 2048 units per EM */
+
+static void
+make_segments(TA_Segment segments,
+              int num_segments)
+{
+  int i;
+
+
+  for (i = 0; i < num_segments; i++)
+  {
+    TA_Segment seg = &segments[i];
+    int len = rand() % 400;
+
+
+    memset(seg, 0, sizeof (*seg));
+
+    seg->dir = (FT_Char)((rand() & 1) ? TA_DIR_UP : TA_DIR_DOWN);
+    seg->pos = (FT_Short)(rand() % 2048);
+    seg->min_coord = (FT_Short)(rand() % 2048 - 200);
+    /* some one-point segments */
+    seg->max_coord = (FT_Short)(seg->min_coord + (len < 20 ? 0 : len));
+  }
+}
+
+
+static void
+reset_segments(TA_Segment segments,
+               int num_segments)
+{
+  int i;
+
+
+  memcpy(segments, segments_orig, (size_t)num_segments * sizeof (*segments));
+
+  for (i = 0; i < num_segments; i++)
+  {
+    segments[i].score = 32000;
+    segments[i].link = NULL;
+    segments[i].serif = NULL;
+  }
+}
+
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+int
+main(void)
+{
+  TA_LatinMetricsRec metrics;
+  TA_AxisHintsRec axis;
+  TA_LatinLinkRec link;
+
+  int num_segments;
+  int crossover = 0;
+
+
+  memset(&metrics, 0, sizeof (metrics));
+  metrics.units_per_em = 2048;
+
+  memset(&axis, 0, sizeof (axis));
+  axis.major_dir = TA_DIR_UP;
+
+  link.len_threshold = TA_LATIN_CONSTANT(&metrics, 8);
+  link.len_score = TA_LATIN_CONSTANT(&metrics, 6000);
+  link.dist_score = 3000;
+
+  srand(1);
+
+  printf("segments   all (ns)   sorted (ns)\n");
+
+  for (num_segments = 4; num_segments <= MAX_SEGMENTS; num_segments *= 2)
+  {
+    double time_all = 0;
+    double time_sorted = 0;
+    int iterations = 1 + 100000 / num_segments;
+    int set;
+
+
+    axis.num_segments = num_segments;
+
+    for (set = 0; set < NUM_SETS; set++)
+    {
+      double start;
+      int i;
+
+
+      make_segments(segments_orig, num_segments);
+
+      /* test both with and without known stem widths */
+      link.max_width = (set & 1) ? 0 : 80 + rand() % 200;
+
+      /* check */
+      reset_segments(segments_all, num_segments);
+      axis.segments = segments_all;
+      ta_latin_link_segments_all(&axis, &link);
+
+      reset_segments(segments_sorted, num_segments);
+      axis.segments = segments_sorted;
+      i = ta_latin_link_segments_sorted(&axis, &link);
+      assert(!i);
+
+      for (i = 0; i < num_segments; i++)
+      {
+        TA_Segment link_all = segments_all[i].link;
+        TA_Segment link_sorted = segments_sorted[i].link;
+
+
+        assert(segments_all[i].score == segments_sorted[i].score);
+        assert((link_all ? link_all - segments_all : -1)
+               == (link_sorted ? link_sorted - segments_sorted : -1));
+      }
+
+      /* benchmark */
+      axis.segments = segments_all;
+      start = now();
+      for (i = 0; i < iterations; i++)
+      {
+        reset_segments(segments_all, num_segments);
+        ta_latin_link_segments_all(&axis, &link);
+      }
+      time_all += now() - start;
+
+      axis.segments = segments_sorted;
+      start = now();
+      for (i = 0; i < iterations; i++)
+      {
+        reset_segments(segments_sorted, num_segments);
+        ta_latin_link_segments_sorted(&axis, &link);
+      }
+      time_sorted += now() - start;
+    }
+
+    time_all /= (double)NUM_SETS * iterations;
+    time_sorted /= (double)NUM_SETS * iterations;
+
+    printf("%8d %10.0f %13.0f\n", num_segments, time_all, time_sorted);
+
+    if (!crossover && time_sorted < time_all)
+      crossover = num_segments;
+  }
+
+  if (crossover)
+    printf("\nthe sorted search is faster for %d segments and more\n",
+           crossover);
+
+  return 0;
+}
+
+/* end of talatin-link-bench.c */
@@ -18,6 +18,7 @@
 /* heavily modified 2011 by Werner Lemberg <wl@gnu.org> */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include <ft2build.h>
 #include FT_ADVANCES_H
@@ -2027,43 +2028,118 @@ Exit:
 }
 
 
-/* link segments to form stems and serifs; if `width_count' and */
-/* `widths' are non-zero, use them to fine-tune the scoring function */
+/* parameters of the scoring function used for linking segments */
 
-void
-ta_latin_hints_link_segments(TA_GlyphHints hints,
-                             FT_UInt width_count,
-                             TA_WidthRec* widths,
-                             TA_Dimension dim)
+typedef struct TA_LatinLinkRec_
 {
-  TA_AxisHints axis = &hints->axis[dim];
+  FT_Pos len_threshold;
+  FT_Pos len_score;
+  FT_Pos dist_score;
+  FT_Pos max_width;
+} TA_LatinLinkRec, *TA_LatinLink;
 
-  TA_Segment segments = axis->segments;
-  TA_Segment segment_limit = segments + axis->num_segments;
 
-  FT_Pos len_threshold, len_score, dist_score, max_width;
-  TA_Segment seg1, seg2;
+/* use the sorted search for linking segments if there are at least */
+/* that many segments; below, comparing all segments is faster */
+
+#ifndef TA_LATIN_LINK_SORT_THRESHOLD
+#  define TA_LATIN_LINK_SORT_THRESHOLD 112
+#endif
 
 
-  if (width_count)
-    max_width = widths[width_count - 1].org;
+/* the distance demerit of two segments `dist' units apart */
+
+static FT_Pos
+ta_latin_link_dist_demerit(TA_LatinLink link,
+                           FT_Pos dist)
+{
+  if (link->max_width)
+  {
+    /* distance demerits are based on multiples of `max_width'; */
+    /* we scale by 1024 for getting more precision */
+    FT_Pos delta = (dist << 10) / link->max_width - (1 << 10);
+
+
+    if (delta > 10000)
+      return 32000;
+    else if (delta > 0)
+      return delta * delta / link->dist_score;
+    else
+      return 0;
+  }
   else
-    max_width = 0;
+    return dist; /* default if no widths available */
+}
 
-  /* a heuristic value to set up a minimum value for overlapping */
-  len_threshold = TA_LATIN_CONSTANT(hints->metrics, 8);
-  if (len_threshold == 0)
-    len_threshold = 1;
 
-  /* a heuristic value to weight lengths */
-  len_score = TA_LATIN_CONSTANT(hints->metrics, 6000);
+/* compute the score of a stem formed by `seg1' and `seg2', with `seg1' */
+/* to the `left' of `seg2'; return 0 if the segments don't overlap */
+/* sufficiently */
+
+static FT_Bool
+ta_latin_link_score(TA_LatinLink link,
+                    TA_Segment seg1,
+                    TA_Segment seg2,
+                    FT_Pos* ascore)
+{
+  /* compute distance between the two segments */
+  FT_Pos min = seg1->min_coord;
+  FT_Pos max = seg1->max_coord;
+  FT_Pos len;
+
+
+  if (min < seg2->min_coord)
+    min = seg2->min_coord;
+  if (max > seg2->max_coord)
+    max = seg2->max_coord;
+
+  /* compute maximum coordinate difference of the two segments */
+  /* (this is, how much they overlap) */
+  len = max - min;
+
+  /* for one-point segments, `len' is zero if there is an overlap */
+  /* (and negative otherwise); we have to correct this */
+  if (len == 0
+      && (seg1->min_coord == seg1->max_coord
+          || seg2->min_coord == seg2->max_coord))
+    len = link->len_threshold;
+
+  if (len < link->len_threshold)
+    return 0;
+
+  /*
+   * The score is the sum of two demerits indicating the `badness' of a
+   * fit, measured along the segments' main axis and orthogonal to it,
+   * respectively.
+   *
+   * o The less overlapping along the main axis, the worse it is,
+   *   causing a larger demerit.
+   *
+   * o The nearer the orthogonal distance to a stem width, the better it
+   *   is, causing a smaller demerit.  For simplicity, however, we only
+   *   increase the demerit for values that exceed the largest stem
+   *   width.
+   */
+
+  *ascore = ta_latin_link_dist_demerit(link, seg2->pos - seg1->pos)
+            + link->len_score / len;
+
+  return 1;
+}
+
+
+/* compare all segments with each other */
+
+static void
+ta_latin_link_segments_all(TA_AxisHints axis,
+                           TA_LatinLink link)
+{
+  TA_Segment segments = axis->segments;
+  TA_Segment segment_limit = segments + axis->num_segments;
+
+  TA_Segment seg1, seg2;
 
-  /* a heuristic value to weight distances (no call to */
-  /* TA_LATIN_CONSTANT needed, since we work on multiples */
-  /* of the stem width) */
-  dist_score = 3000;
 
-  /* now compare each segment to the others */
   for (seg1 = segments; seg1 < segment_limit; seg1++)
   {
     if (seg1->dir != axis->major_dir)
@@ -2073,92 +2149,222 @@ ta_latin_hints_link_segments(TA_GlyphHints hints,
     /* with seg1 to the `left' of seg2 */
     for (seg2 = segments; seg2 < segment_limit; seg2++)
     {
-      FT_Pos pos1 = seg1->pos;
-      FT_Pos pos2 = seg2->pos;
+      FT_Pos score;
 
 
       if (seg1->dir + seg2->dir == 0
-          && pos2 > pos1)
+          && seg2->pos > seg1->pos
+          && ta_latin_link_score(link, seg1, seg2, &score))
       {
-        /* compute distance between the two segments */
-        FT_Pos min = seg1->min_coord;
-        FT_Pos max = seg1->max_coord;
-        FT_Pos len;
+        /* and we search for the smallest score */
+        if (score < seg1->score)
+        {
+          seg1->score = score;
+          seg1->link = seg2;
+        }
 
+        if (score < seg2->score)
+        {
+          seg2->score = score;
+          seg2->link = seg1;
+        }
+      }
+    }
+  }
+}
 
-        if (min < seg2->min_coord)
-          min = seg2->min_coord;
-        if (max > seg2->max_coord)
-          max = seg2->max_coord;
 
-        /* compute maximum coordinate difference of the two segments */
-        /* (this is, how much they overlap) */
-        len = max - min;
+static int
+ta_latin_link_compare(const void* a,
+                      const void* b)
+{
+  TA_Segment seg1 = *(const TA_Segment*)a;
+  TA_Segment seg2 = *(const TA_Segment*)b;
 
-        /* for one-point segments, `len' is zero if there is an overlap */
-        /* (and negative otherwise); we have to correct this */
-        if (len == 0
-            && (seg1->min_coord == seg1->max_coord
-                || seg2->min_coord == seg2->max_coord))
-          len = len_threshold;
 
-        if (len >= len_threshold)
-        {
-          /*
-           * The score is the sum of two demerits indicating the
-           * `badness' of a fit, measured along the segments' main axis
-           * and orthogonal to it, respectively.
-           *
-           * o The less overlapping along the main axis, the worse it
-           *   is, causing a larger demerit.
-           *
-           * o The nearer the orthogonal distance to a stem width, the
-           *   better it is, causing a smaller demerit.  For simplicity,
-           *   however, we only increase the demerit for values that
-           *   exceed the largest stem width.
-           */
+  if (seg1->pos < seg2->pos)
+    return -1;
+  if (seg1->pos > seg2->pos)
+    return 1;
 
-          FT_Pos dist = pos2 - pos1;
+  /* segments are elements of the same array */
+  return seg1 < seg2 ? -1 : seg1 > seg2;
+}
 
-          FT_Pos dist_demerit, score;
 
+/* search the best partner of `seg' in `candidates', starting at index */
+/* `start' and stepping by `step' (either 1 or -1) until index `end' is */
+/* reached; `candidates' must be sorted by position so that the distance */
+/* to `seg' grows monotonically */
 
-          if (max_width)
-          {
-            /* distance demerits are based on multiples of `max_width'; */
-            /* we scale by 1024 for getting more precision */
-            FT_Pos delta = (dist << 10) / max_width - (1 << 10);
+static void
+ta_latin_link_search(TA_LatinLink link,
+                     TA_Segment seg,
+                     TA_Segment* candidates,
+                     FT_Int start,
+                     FT_Int end,
+                     FT_Int step)
+{
+  FT_Int i;
 
+  TA_Segment best_link = NULL;
+  FT_Pos best_score = seg->score;
 
-            if (delta > 10000)
-              dist_demerit = 32000;
-            else if (delta > 0)
-              dist_demerit = delta * delta / dist_score;
-            else
-              dist_demerit = 0;
-          }
-          else
-            dist_demerit = dist; /* default if no widths available */
+  /* the length demerit can't be smaller than this value */
+  FT_Pos min_len_demerit = link->len_score
+                           / TA_MAX(seg->max_coord - seg->min_coord,
+                                    link->len_threshold);
 
-          score = dist_demerit + len_score / len;
 
-          /* and we search for the smallest score */
-          if (score < seg1->score)
-          {
-            seg1->score = score;
-            seg1->link = seg2;
-          }
-
-          if (score < seg2->score)
-          {
-            seg2->score = score;
-            seg2->link = seg1;
-          }
-        }
+  for (i = start; i != end; i += step)
+  {
+    TA_Segment other = candidates[i];
+    FT_Pos dist = step > 0 ? other->pos - seg->pos
+                           : seg->pos - other->pos;
+    FT_Pos bound;
+    FT_Pos score;
+
+
+    /* a lower bound of all scores from here on; */
+    /* the distance demerit is monotonic up to 32000 */
+    bound = TA_MIN(ta_latin_link_dist_demerit(link, dist), 32000)
+            + min_len_demerit;
+    if (bound > best_score
+        || (bound == best_score && !best_link))
+      break;
+
+    if (step > 0 ? ta_latin_link_score(link, seg, other, &score)
+                 : ta_latin_link_score(link, other, seg, &score))
+    {
+      /* in case of equal scores, `ta_latin_link_segments_all' */
+      /* takes the segment that comes first in the array */
+      if (score < best_score
+          || (score == best_score && best_link && other < best_link))
+      {
+        best_score = score;
+        best_link = other;
       }
     }
   }
 
+  if (best_link)
+  {
+    seg->score = best_score;
+    seg->link = best_link;
+  }
+}
+
+
+/* do the same as `ta_latin_link_segments_all', but sort the segments */
+/* by position first so that the search for a partner can stop as soon */
+/* as the distance gets too large; this gives identical results */
+
+static FT_Error
+ta_latin_link_segments_sorted(TA_AxisHints axis,
+                              TA_LatinLink link)
+{
+  TA_Segment segments = axis->segments;
+  TA_Segment segment_limit = segments + axis->num_segments;
+
+  TA_Segment* majors;
+  TA_Segment* minors;
+  FT_Int num_majors = 0;
+  FT_Int num_minors = 0;
+
+  TA_Segment seg;
+  FT_Int i, j;
+
+
+  majors = (TA_Segment*)ta_malloc((size_t)axis->num_segments
+                                  * sizeof (TA_Segment));
+  if (!majors)
+    return FT_Err_Out_Of_Memory;
+
+  /* segments in major direction grow from the start of the array, */
+  /* segments in opposite direction from the end */
+  minors = majors + axis->num_segments;
+
+  for (seg = segments; seg < segment_limit; seg++)
+  {
+    if (seg->dir == axis->major_dir)
+      majors[num_majors++] = seg;
+    else if (seg->dir + axis->major_dir == 0)
+      *(--minors) = seg;
+  }
+  num_minors = (FT_Int)(majors + axis->num_segments - minors);
+
+  qsort(majors, (size_t)num_majors, sizeof (TA_Segment),
+        ta_latin_link_compare);
+  qsort(minors, (size_t)num_minors, sizeof (TA_Segment),
+        ta_latin_link_compare);
+
+  /* for a segment in major direction, */
+  /* search rightwards for segments in opposite direction... */
+  for (i = 0, j = 0; i < num_majors; i++)
+  {
+    while (j < num_minors && minors[j]->pos <= majors[i]->pos)
+      j++;
+
+    ta_latin_link_search(link, majors[i], minors, j, num_minors, 1);
+  }
+
+  /* ...and vice versa */
+  for (i = num_minors - 1, j = num_majors - 1; i >= 0; i--)
+  {
+    while (j >= 0 && majors[j]->pos >= minors[i]->pos)
+      j--;
+
+    ta_latin_link_search(link, minors[i], majors, j, -1, -1);
+  }
+
+  ta_free(majors);
+
+  return FT_Err_Ok;
+}
+
+
+/* link segments to form stems and serifs; if `width_count' and */
+/* `widths' are non-zero, use them to fine-tune the scoring function */
+
+void
+ta_latin_hints_link_segments(TA_GlyphHints hints,
+                             FT_UInt width_count,
+                             TA_WidthRec* widths,
+                             TA_Dimension dim)
+{
+  TA_AxisHints axis = &hints->axis[dim];
+
+  TA_Segment segments = axis->segments;
+  TA_Segment segment_limit = segments + axis->num_segments;
+
+  TA_LatinLinkRec link;
+  TA_Segment seg1, seg2;
+
+
+  if (width_count)
+    link.max_width = widths[width_count - 1].org;
+  else
+    link.max_width = 0;
+
+  /* a heuristic value to set up a minimum value for overlapping */
+  link.len_threshold = TA_LATIN_CONSTANT(hints->metrics, 8);
+  if (link.len_threshold == 0)
+    link.len_threshold = 1;
+
+  /* a heuristic value to weight lengths */
+  link.len_score = TA_LATIN_CONSTANT(hints->metrics, 6000);
+
+  /* a heuristic value to weight distances (no call to */
+  /* TA_LATIN_CONSTANT needed, since we work on multiples */
+  /* of the stem width) */
+  link.dist_score = 3000;
+
+  /* now compare each segment to the others; */
+  /* if we run out of memory, fall back to the simple method */
+  if (axis->num_segments < TA_LATIN_LINK_SORT_THRESHOLD
+      || ta_latin_link_segments_sorted(axis, &link))
+    ta_latin_link_segments_all(axis, &link);
+
   /* now compute the `serif' segments, cf. explanations in `tahints.h' */
   for (seg1 = segments; seg1 < segment_limit; seg1++)
   {
@@ -2176,6 +2382,59 @@ ta_latin_hints_link_segments(TA_GlyphHints hints,
 }
 
 
+/* return the first edge in the edge list of `axis' whose position */
+/* differs less than `threshold' from `pos'; if `dir' isn't */
+/* `TA_DIR_NONE', the edge must have this direction also */
+
+static TA_Edge
+ta_latin_find_edge(TA_AxisHints axis,
+                   FT_Pos pos,
+                   FT_Pos threshold,
+                   TA_Direction dir,
+                   FT_Bool top_to_bottom_hinting)
+{
+  TA_Edge edges = axis->edges;
+  FT_Int lo = 0;
+  FT_Int hi = axis->num_edges;
+
+
+  /* the edges are sorted by position (in descending order for */
+  /* top-to-bottom hinting); use a binary search to find the first */
+  /* edge within the threshold */
+  while (lo < hi)
+  {
+    FT_Int mid = lo + (hi - lo) / 2;
+    FT_Pos fpos = edges[mid].fpos;
+
+
+    if (top_to_bottom_hinting ? (fpos >= pos + threshold)
+                              : (fpos <= pos - threshold))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  for (; lo < axis->num_edges; lo++)
+  {
+    TA_Edge edge = edges + lo;
+    FT_Pos dist;
+
+
+    dist = pos - edge->fpos;
+    if (dist < 0)
+      dist = -dist;
+
+    if (dist >= threshold)
+      break;
+
+    if (dir == TA_DIR_NONE || edge->dir == dir)
+      return edge;
+  }
+
+  return NULL;
+}
+
+
 /* link segments to edges, using feature analysis for selection */
 
 FT_Error
@@ -2259,7 +2518,6 @@ ta_latin_hints_compute_edges(TA_GlyphHints hints,
   for (seg = segments; seg < segment_limit; seg++)
   {
     TA_Edge found = NULL;
-    FT_Int ee;
 
 
     /* ignore too short segments, too wide ones, and, in this loop, */
@@ -2276,22 +2534,9 @@ ta_latin_hints_compute_edges(TA_GlyphHints hints,
       continue;
 
     /* look for an edge corresponding to the segment */
-    for (ee = 0; ee < axis->num_edges; ee++)
-    {
-      TA_Edge edge = axis->edges + ee;
-      FT_Pos dist;
-
-
-      dist = seg->pos - edge->fpos;
-      if (dist < 0)
-        dist = -dist;
-
-      if (dist < edge_distance_threshold && edge->dir == seg->dir)
-      {
-        found = edge;
-        break;
-      }
-    }
+    found = ta_latin_find_edge(axis, seg->pos, edge_distance_threshold,
+                               (TA_Direction)seg->dir,
+                               top_to_bottom_hinting);
 
     if (!found)
     {
@@ -2330,29 +2575,15 @@ ta_latin_hints_compute_edges(TA_GlyphHints hints,
   for (seg = segments; seg < segment_limit; seg++)
   {
     TA_Edge found = NULL;
-    FT_Int ee;
 
 
     if (seg->dir != TA_DIR_NONE)
       continue;
 
     /* look for an edge corresponding to the segment */
-    for (ee = 0; ee < axis->num_edges; ee++)
-    {
-      TA_Edge edge = axis->edges + ee;
-      FT_Pos dist;
-
-
-      dist = seg->pos - edge->fpos;
-      if (dist < 0)
-        dist = -dist;
-
-      if (dist < edge_distance_threshold)
-      {
-        found = edge;
-        break;
-      }
-    }
+    found = ta_latin_find_edge(axis, seg->pos, edge_distance_threshold,
+                               TA_DIR_NONE,
+                               top_to_bottom_hinting);
 
     /* one-point segments without a match are ignored */
     if (found)
@@ -3740,11 +3971,17 @@ ta_latin_hints_apply(FT_UInt glyph_index,
       ta_latin_hint_edges(hints, (TA_Dimension)dim);
       ta_glyph_hints_align_edge_points(hints, (TA_Dimension)dim);
       ta_glyph_hints_align_strong_points(hints, (TA_Dimension)dim);
-      ta_glyph_hints_align_weak_points(hints, (TA_Dimension)dim);
+
+      /* the hints recorder only consumes edges and the `ta_ip_*' */
+      /* actions of strong points; interpolating weak points and */
+      /* copying the result back to the outline are wasted work then */
+      if (TA_HINTS_DO_OUTLINE(hints))
+        ta_glyph_hints_align_weak_points(hints, (TA_Dimension)dim);
     }
   }
 
-  ta_glyph_hints_save(hints, outline);
+  if (TA_HINTS_DO_OUTLINE(hints))
+    ta_glyph_hints_save(hints, outline);
 
 Exit:
   return error;
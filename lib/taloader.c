@@ -18,6 +18,7 @@
 /* heavily modified 2011 by Werner Lemberg <wl@gnu.org> */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include <ft2build.h>
 #include FT_GLYPH_H
@@ -98,6 +99,11 @@ ta_loader_done(FONT* font)
 
   ta_glyph_hints_done(&loader->hints);
 
+  ta_free(loader->outline.outline.points);
+  ta_free(loader->outline.outline.tags);
+  ta_free(loader->outline.outline.contours);
+  memset(&loader->outline, 0, sizeof (TA_OutlineRec));
+
   loader->face = NULL;
   loader->globals = NULL;
 
@@ -109,6 +115,244 @@ ta_loader_done(FONT* font)
 }
 
 
+/* decode the simple glyph record of glyph `gindex' in `face', storing */
+/* the outline in `loader'; as in the `GLYPH' structure, the record is */
+/* given as `len1' bytes in `buf' before the instructions and `len2' */
+/* bytes in `buf2' after them; in case of error, no outline is stored, */
+/* and `ta_loader_load_glyph' uses FreeType's loader as usual */
+
+void
+ta_loader_decode_glyph(TA_Loader loader,
+                       FT_Face face,
+                       FT_UInt gindex,
+                       FT_Byte* buf,
+                       FT_ULong len1,
+                       FT_Byte* buf2,
+                       FT_ULong len2)
+{
+  TA_Outline outline = &loader->outline;
+
+  FT_Byte* p;
+  FT_Byte* endp;
+
+  FT_Int num_contours;
+  FT_Int num_points;
+  FT_Int i;
+
+  FT_Pos x;
+  FT_Pos y;
+
+
+  outline->face = NULL;
+
+  if (len1 < 10)
+    return;
+
+  p = buf;
+  num_contours = (FT_Short)NEXT_USHORT(p);
+  if (num_contours <= 0
+      || len1 != 10 + (FT_ULong)num_contours * 2)
+    return;
+
+  /* skip bounding box */
+  p += 8;
+
+  if (num_contours > outline->max_contours)
+  {
+    short* contours_new;
+
+
+    contours_new = (short*)ta_realloc(outline->outline.contours,
+                                      (size_t)num_contours * sizeof (short));
+    if (!contours_new)
+      return;
+
+    outline->outline.contours = contours_new;
+    outline->max_contours = num_contours;
+  }
+
+  /* the contour end points must increase */
+  num_points = 0;
+  for (i = 0; i < num_contours; i++)
+  {
+    FT_Int end = NEXT_USHORT(p);
+
+
+    if (end < num_points)
+      return;
+
+    outline->outline.contours[i] = (short)end;
+    num_points = end + 1;
+  }
+
+  if (num_points > outline->max_points)
+  {
+    FT_Vector* points_new;
+    char* tags_new;
+
+
+    points_new = (FT_Vector*)ta_realloc(outline->outline.points,
+                                        (size_t)num_points
+                                        * sizeof (FT_Vector));
+    if (!points_new)
+      return;
+    outline->outline.points = points_new;
+
+    tags_new = (char*)ta_realloc(outline->outline.tags,
+                                 (size_t)num_points * sizeof (char));
+    if (!tags_new)
+      return;
+    outline->outline.tags = tags_new;
+
+    outline->max_points = num_points;
+  }
+
+  p = buf2;
+  endp = p + len2;
+
+  /* get flags; we temporarily store them in the `tags' array */
+  for (i = 0; i < num_points;)
+  {
+    FT_Byte flags;
+    FT_Int count;
+
+
+    if (p + 1 > endp)
+      return;
+
+    flags = *(p++);
+    count = 1;
+
+    if (flags & REPEAT)
+    {
+      if (p + 1 > endp)
+        return;
+
+      count += *(p++);
+      if (i + count > num_points)
+        return;
+    }
+
+    while (count--)
+      outline->outline.tags[i++] = (char)flags;
+  }
+
+  /* get x coordinates */
+  x = 0;
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Byte flags = (FT_Byte)outline->outline.tags[i];
+
+
+    if (flags & X_SHORT_VECTOR)
+    {
+      if (p + 1 > endp)
+        return;
+
+      x += (flags & SAME_X) ? *p : -*p;
+      p++;
+    }
+    else if (!(flags & SAME_X))
+    {
+      if (p + 2 > endp)
+        return;
+
+      x += (FT_Short)NEXT_USHORT(p);
+    }
+
+    outline->outline.points[i].x = x;
+  }
+
+  /* get y coordinates and convert flags to tags */
+  y = 0;
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Byte flags = (FT_Byte)outline->outline.tags[i];
+
+
+    if (flags & Y_SHORT_VECTOR)
+    {
+      if (p + 1 > endp)
+        return;
+
+      y += (flags & SAME_Y) ? *p : -*p;
+      p++;
+    }
+    else if (!(flags & SAME_Y))
+    {
+      if (p + 2 > endp)
+        return;
+
+      y += (FT_Short)NEXT_USHORT(p);
+    }
+
+    outline->outline.points[i].y = y;
+    outline->outline.tags[i] = (flags & ON_CURVE) ? FT_CURVE_TAG_ON
+                                                  : FT_CURVE_TAG_CONIC;
+  }
+
+  outline->outline.n_points = (short)num_points;
+  outline->outline.n_contours = (short)num_contours;
+  outline->outline.flags = 0;
+
+  outline->face = face;
+  outline->gindex = gindex;
+  outline->checked = 0;
+}
+
+
+/* compare the decoded outline with the one just loaded by FreeType; */
+/* the latter gets shifted horizontally by FreeType if the glyph's */
+/* `xMin' value differs from the left side bearing in the `hmtx' table */
+
+static void
+ta_loader_check_outline(TA_Loader loader,
+                        FT_GlyphSlot slot)
+{
+  TA_Outline outline = &loader->outline;
+  FT_Outline* decoded = &outline->outline;
+  FT_Outline* loaded = &slot->outline;
+
+  FT_Face face = outline->face;
+  FT_Pos shift;
+  FT_Int i;
+
+
+  /* if we find a difference, we no longer use the decoded outline */
+  outline->face = NULL;
+
+  if (slot->format != FT_GLYPH_FORMAT_OUTLINE
+      || decoded->n_points != loaded->n_points
+      || decoded->n_contours != loaded->n_contours
+      || loaded->n_points <= 0)
+    return;
+
+  for (i = 0; i < decoded->n_contours; i++)
+    if (decoded->contours[i] != loaded->contours[i])
+      return;
+
+  shift = loaded->points[0].x - decoded->points[0].x;
+
+  for (i = 0; i < decoded->n_points; i++)
+    if (loaded->points[i].x - decoded->points[i].x != shift
+        || loaded->points[i].y != decoded->points[i].y
+        || FT_CURVE_TAG(loaded->tags[i]) != decoded->tags[i])
+      return;
+
+  /* FreeType might set more bits in the tags */
+  for (i = 0; i < decoded->n_points; i++)
+  {
+    decoded->points[i].x += shift;
+    decoded->tags[i] = loaded->tags[i];
+  }
+  decoded->flags = loaded->flags;
+
+  outline->metrics = slot->metrics;
+  outline->face = face;
+  outline->checked = 1;
+}
+
+
 /* load a single glyph component; this routine calls itself recursively, */
 /* if necessary, and does the main work of `ta_loader_load_glyph' */
 
@@ -130,11 +374,37 @@ ta_loader_load_g(TA_Loader loader,
 #endif
   FT_Int32 flags;
 
+  TA_Outline decoded = &loader->outline;
+  FT_Outline* outline;
+  FT_Glyph_Format format;
+
+
+  if (depth == 0
+      && decoded->face == face
+      && decoded->gindex == glyph_index
+      && decoded->checked
+      && !loader->transformed)
+  {
+    /* use the decoded outline instead of calling FreeType's loader */
+    slot->metrics = decoded->metrics;
+    outline = &decoded->outline;
+    format = FT_GLYPH_FORMAT_OUTLINE;
+  }
+  else
+  {
+    flags = load_flags | FT_LOAD_LINEAR_DESIGN;
+    error = FT_Load_Glyph(face, glyph_index, flags);
+    if (error)
+      goto Exit;
 
-  flags = load_flags | FT_LOAD_LINEAR_DESIGN;
-  error = FT_Load_Glyph(face, glyph_index, flags);
-  if (error)
-    goto Exit;
+    if (depth == 0
+        && decoded->face == face
+        && decoded->gindex == glyph_index)
+      ta_loader_check_outline(loader, slot);
+
+    outline = &slot->outline;
+    format = slot->format;
+  }
 
 #if 0
   loader->transformed = slot_internal->glyph_transformed;
@@ -152,35 +422,35 @@ ta_loader_load_g(TA_Loader loader,
   }
 #endif
 
-  switch (slot->format)
+  switch (format)
   {
   case FT_GLYPH_FORMAT_OUTLINE:
     /* translate the loaded glyph when an internal transform is needed */
     if (loader->transformed)
-      FT_Outline_Translate(&slot->outline,
+      FT_Outline_Translate(outline,
                            loader->trans_delta.x,
                            loader->trans_delta.y);
 
     /* copy the outline points in the loader's current extra points */
     /* which are used to keep original glyph coordinates */
     error = TA_GLYPHLOADER_CHECK_POINTS(gloader,
-                                        slot->outline.n_points + 4,
-                                        slot->outline.n_contours);
+                                        outline->n_points + 4,
+                                        outline->n_contours);
     if (error)
       goto Exit;
 
     memcpy(gloader->current.outline.points,
-           slot->outline.points,
-           (size_t)slot->outline.n_points * sizeof (FT_Vector));
+           outline->points,
+           (size_t)outline->n_points * sizeof (FT_Vector));
     memcpy(gloader->current.outline.contours,
-           slot->outline.contours,
-           (size_t)slot->outline.n_contours * sizeof (short));
+           outline->contours,
+           (size_t)outline->n_contours * sizeof (short));
     memcpy(gloader->current.outline.tags,
-           slot->outline.tags,
-           (size_t)slot->outline.n_points * sizeof (char));
+           outline->tags,
+           (size_t)outline->n_points * sizeof (char));
 
-    gloader->current.outline.n_points = slot->outline.n_points;
-    gloader->current.outline.n_contours = slot->outline.n_contours;
+    gloader->current.outline.n_points = outline->n_points;
+    gloader->current.outline.n_contours = outline->n_contours;
 
     /* compute original horizontal phantom points */
     /* (and ignore vertical ones) */
@@ -191,7 +461,7 @@ ta_loader_load_g(TA_Loader loader,
     loader->pp2.y = hints->y_delta;
 
     /* be sure to check for spacing glyphs */
-    if (slot->outline.n_points == 0)
+    if (outline->n_points == 0)
       goto Hint_Metrics;
 
     /* now load the slot image into the auto-outline */
@@ -209,6 +479,11 @@ ta_loader_load_g(TA_Loader loader,
                                                 metrics);
     }
 
+    /* the hints recorder neither looks at the phantom points */
+    /* nor at the glyph metrics */
+    if (!TA_HINTS_DO_OUTLINE(hints))
+      goto Add_Glyph;
+
     /* we now need to adjust the metrics according to the change in */
     /* width/positioning that occurred during the hinting process */
     if (scaler->render_mode != FT_RENDER_MODE_LIGHT)
@@ -282,6 +557,7 @@ ta_loader_load_g(TA_Loader loader,
       slot->rsb_delta = loader->pp2.x - pp2x;
     }
 
+  Add_Glyph:
     /* good, we simply add the glyph to our loader's base */
     TA_GlyphLoader_Add(gloader);
     break;
@@ -414,7 +690,7 @@ ta_loader_load_g(TA_Loader loader,
   }
 
 Hint_Metrics:
-  if (depth == 0)
+  if (depth == 0 && TA_HINTS_DO_OUTLINE(hints))
   {
     FT_BBox bbox;
     FT_Vector vvector;
@@ -556,17 +832,20 @@ ta_loader_load_glyph(FONT* font,
                                         options, &metrics);
     if (!error)
     {
-      TA_StyleClass style_class = metrics->style_class;
-      TA_WritingSystemClass writing_system_class =
-        ta_writing_system_classes[style_class->writing_system];
+      TA_StyleClass style_class;
+      TA_WritingSystemClass writing_system_class;
 
 
-      loader->metrics = metrics;
+      error = ta_face_globals_scale_metrics(loader->globals, metrics,
+                                            &scaler, &metrics);
+      if (error)
+        goto Exit;
 
-      if (writing_system_class->style_metrics_scale)
-        writing_system_class->style_metrics_scale(metrics, &scaler);
-      else
-        metrics->scaler = scaler;
+      style_class = metrics->style_class;
+      writing_system_class =
+        ta_writing_system_classes[style_class->writing_system];
+
+      loader->metrics = metrics;
 
       load_flags |= FT_LOAD_NO_SCALE
                     | FT_LOAD_IGNORE_TRANSFORM;
@@ -26,6 +26,23 @@
 
 typedef struct FONT_ FONT;
 
+
+/* the unscaled outline of a simple glyph, decoded directly */
+/* from its `glyf' table record; see `ta_loader_decode_glyph' */
+typedef struct TA_OutlineRec_
+{
+  FT_Face face; /* NULL if there is no outline */
+  FT_UInt gindex;
+  FT_Bool checked; /* set if identical to FreeType's outline */
+
+  FT_Outline outline;
+  FT_Glyph_Metrics metrics; /* unscaled, taken from FreeType */
+
+  FT_Int max_points; /* number of allocated points */
+  FT_Int max_contours; /* number of allocated contours */
+} TA_OutlineRec, *TA_Outline;
+
+
 typedef struct TA_LoaderRec_
 {
   /* current face data */
@@ -42,6 +59,9 @@ typedef struct TA_LoaderRec_
   FT_Vector pp1;
   FT_Vector pp2;
   /* we don't handle vertical phantom points */
+
+  /* a decoded outline that replaces `FT_Load_Glyph' */
+  TA_OutlineRec outline;
 } TA_LoaderRec, *TA_Loader;
 
 
@@ -65,6 +85,16 @@ ta_loader_load_glyph(FONT* font,
                      FT_Int32 load_flags);
 
 
+void
+ta_loader_decode_glyph(TA_Loader loader,
+                       FT_Face face,
+                       FT_UInt gindex,
+                       FT_Byte* buf,
+                       FT_ULong len1,
+                       FT_Byte* buf2,
+                       FT_ULong len2);
+
+
 void
 ta_loader_register_hints_recorder(TA_Loader loader,
                                   TA_Hints_Recorder hints_recorder,
@@ -65,7 +65,7 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
   if (loca_format)
   {
     loca_table->len = (data->num_glyphs + 1) * 4;
-    buf_new = (FT_Byte*)realloc(loca_table->buf, loca_table->len);
+    buf_new = (FT_Byte*)ta_realloc(loca_table->buf, loca_table->len);
     if (!buf_new)
       return FT_Err_Out_Of_Memory;
     else
@@ -100,8 +100,8 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
   else
   {
     loca_table->len = (data->num_glyphs + 1) * 2;
-    buf_new = (FT_Byte*)realloc(loca_table->buf,
-                                (loca_table->len + 3) & ~3U);
+    buf_new = (FT_Byte*)ta_realloc(loca_table->buf,
+                                   (loca_table->len + 3) & ~3U);
     if (!buf_new)
       return FT_Err_Out_Of_Memory;
     else
@@ -16,21 +16,16 @@
 #include "ta.h"
 
 
-FT_Error
-TA_sfnt_update_maxp_table(SFNT* sfnt,
-                          FONT* font)
+/* fill the hinting-related fields of `buf', a copy of the `maxp' table */
+
+void
+TA_sfnt_fill_maxp_buffer(SFNT* sfnt,
+                         FONT* font,
+                         FT_Byte* buf)
 {
-  SFNT_Table* maxp_table = &font->tables[sfnt->maxp_idx];
   SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
   glyf_Data* data = (glyf_Data*)glyf_table->data;
-  FT_Byte* buf = maxp_table->buf;
-
-
-  if (maxp_table->processed)
-    return TA_Err_Ok;
 
-  if (maxp_table->len != MAXP_LEN)
-    return FT_Err_Invalid_Table;
 
   if (font->dehint)
   {
@@ -67,8 +62,10 @@ TA_sfnt_update_maxp_table(SFNT* sfnt,
     buf[MAXP_MAX_TWILIGHT_POINTS_OFFSET + 1] = LOW(sfnt->max_twilight_points);
     buf[MAXP_MAX_STORAGE_OFFSET] = HIGH(sfnt->max_storage);
     buf[MAXP_MAX_STORAGE_OFFSET + 1] = LOW(sfnt->max_storage);
-    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET] = 0;
-    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET + 1] = NUM_FDEFS;
+    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET] = HIGH(NUM_FDEFS
+                                              + data->num_subroutines);
+    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET + 1] = LOW(NUM_FDEFS
+                                                 + data->num_subroutines);
     buf[MAXP_MAX_INSTRUCTION_DEFS_OFFSET] = 0;
     buf[MAXP_MAX_INSTRUCTION_DEFS_OFFSET + 1] = 0;
     buf[MAXP_MAX_STACK_ELEMENTS_OFFSET] = HIGH(sfnt->max_stack_elements);
@@ -78,6 +75,23 @@ TA_sfnt_update_maxp_table(SFNT* sfnt,
     buf[MAXP_MAX_COMPONENTS_OFFSET] = HIGH(sfnt->max_components);
     buf[MAXP_MAX_COMPONENTS_OFFSET + 1] = LOW(sfnt->max_components);
   }
+}
+
+
+FT_Error
+TA_sfnt_update_maxp_table(SFNT* sfnt,
+                          FONT* font)
+{
+  SFNT_Table* maxp_table = &font->tables[sfnt->maxp_idx];
+
+
+  if (maxp_table->processed)
+    return TA_Err_Ok;
+
+  if (maxp_table->len != MAXP_LEN)
+    return FT_Err_Invalid_Table;
+
+  TA_sfnt_fill_maxp_buffer(sfnt, font, maxp_table->buf);
 
   maxp_table->checksum = TA_table_compute_checksum(maxp_table->buf,
                                                    maxp_table->len);
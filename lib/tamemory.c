@@ -0,0 +1,389 @@
+/* tamemory.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tamemory.h"
+
+
+TA_THREAD_LOCAL TA_Memory _ta_memory;
+
+
+/* every accounted block starts with a header that holds its size; */
+/* the union ensures the alignment `malloc' would give */
+typedef union TA_BlockHeader_
+{
+  size_t size;
+
+  long long align_ll;
+  long double align_ld;
+  void* align_p;
+} TA_BlockHeader;
+
+#define HEADER_SIZE sizeof (TA_BlockHeader)
+
+
+#ifdef HAVE_PTHREAD_H
+#  define LOCK(memory) pthread_mutex_lock(&(memory)->mutex)
+#  define UNLOCK(memory) pthread_mutex_unlock(&(memory)->mutex)
+#else
+#  define LOCK(memory) do { } while (0)
+#  define UNLOCK(memory) do { } while (0)
+#endif
+
+
+static void*
+default_alloc(size_t size,
+              void* data)
+{
+  (void)data;
+
+  return malloc(size);
+}
+
+
+static void*
+default_realloc(void* block,
+                size_t old_size,
+                size_t new_size,
+                void* data)
+{
+  (void)old_size;
+  (void)data;
+
+  return realloc(block, new_size);
+}
+
+
+static void
+default_free(void* block,
+             size_t size,
+             void* data)
+{
+  (void)size;
+  (void)data;
+
+  free(block);
+}
+
+
+TA_Memory
+TA_memory_new(TA_Memory_Alloc_Func alloc_func,
+              TA_Memory_Realloc_Func realloc_func,
+              TA_Memory_Free_Func free_func,
+              void* data,
+              size_t limit)
+{
+  TA_Memory memory;
+
+
+  if (!alloc_func)
+  {
+    alloc_func = default_alloc;
+    realloc_func = default_realloc;
+    free_func = default_free;
+  }
+
+  memory = (TA_Memory)alloc_func(sizeof (TA_MemoryRec), data);
+  if (!memory)
+    return NULL;
+
+  memset(memory, 0, sizeof (TA_MemoryRec));
+
+  memory->alloc = alloc_func;
+  memory->realloc = realloc_func;
+  memory->free = free_func;
+  memory->data = data;
+  memory->limit = limit;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init(&memory->mutex, NULL);
+#endif
+
+  return memory;
+}
+
+
+void
+TA_memory_get_stats(TA_Memory memory,
+                    TA_Memory_Stats* stats)
+{
+  LOCK(memory);
+  *stats = memory->stats;
+  UNLOCK(memory);
+}
+
+
+void
+TA_memory_done(TA_Memory memory,
+               TA_Memory_Stats* stats)
+{
+  if (!memory)
+    return;
+
+  if (stats)
+    TA_memory_get_stats(memory, stats);
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy(&memory->mutex);
+#endif
+
+  memory->free(memory, sizeof (TA_MemoryRec), memory->data);
+}
+
+
+void
+TA_memory_set_phase(TA_Memory memory,
+                    int phase)
+{
+  TA_Memory_Phase_Stats* phase_stats;
+
+
+  if (!memory || phase < 0 || phase >= TA_MEMORY_PHASE_MAX)
+    return;
+
+  LOCK(memory);
+
+  memory->phase = phase;
+
+  /* memory still in use from previous phases counts, too */
+  phase_stats = &memory->stats.phases[phase];
+  if (memory->stats.cur_bytes > phase_stats->peak_bytes)
+    phase_stats->peak_bytes = memory->stats.cur_bytes;
+
+  UNLOCK(memory);
+}
+
+
+/* check the limit for a block growing from `old_size' to `new_size'; */
+/* the caller must hold the lock */
+static int
+memory_check_limit(TA_Memory memory,
+                   size_t old_size,
+                   size_t new_size)
+{
+  if (!memory->limit || new_size <= old_size)
+    return 1;
+
+  if (new_size - old_size > memory->limit - memory->stats.cur_bytes
+      || memory->stats.cur_bytes > memory->limit)
+  {
+    memory->limit_exceeded = 1;
+    return 0;
+  }
+
+  return 1;
+}
+
+
+/* the caller must hold the lock */
+static void
+memory_account(TA_Memory memory,
+               size_t old_size,
+               size_t new_size)
+{
+  TA_Memory_Stats* stats = &memory->stats;
+  TA_Memory_Phase_Stats* phase_stats = &stats->phases[memory->phase];
+
+
+  stats->num_allocs++;
+  phase_stats->num_allocs++;
+
+  if (new_size >= old_size)
+  {
+    stats->cur_bytes += new_size - old_size;
+    phase_stats->total_bytes += new_size - old_size;
+  }
+  else
+    stats->cur_bytes -= old_size - new_size;
+
+  if (stats->cur_bytes > stats->peak_bytes)
+    stats->peak_bytes = stats->cur_bytes;
+  if (stats->cur_bytes > phase_stats->peak_bytes)
+    phase_stats->peak_bytes = stats->cur_bytes;
+}
+
+
+void*
+TA_memory_alloc(TA_Memory memory,
+                size_t size)
+{
+  TA_BlockHeader* header = NULL;
+
+
+  if (size > (size_t)-1 - HEADER_SIZE)
+    return NULL;
+
+  LOCK(memory);
+
+  if (memory_check_limit(memory, 0, size))
+  {
+    header = (TA_BlockHeader*)memory->alloc(size + HEADER_SIZE,
+                                            memory->data);
+    if (header)
+      memory_account(memory, 0, size);
+  }
+
+  UNLOCK(memory);
+
+  if (!header)
+    return NULL;
+
+  header->size = size;
+
+  return header + 1;
+}
+
+
+void*
+TA_memory_realloc(TA_Memory memory,
+                  void* block,
+                  size_t size)
+{
+  TA_BlockHeader* header;
+  TA_BlockHeader* new_header = NULL;
+  size_t old_size;
+
+
+  if (!block)
+    return TA_memory_alloc(memory, size);
+
+  if (size > (size_t)-1 - HEADER_SIZE)
+    return NULL;
+
+  header = (TA_BlockHeader*)block - 1;
+  old_size = header->size;
+
+  LOCK(memory);
+
+  if (memory_check_limit(memory, old_size, size))
+  {
+    new_header = (TA_BlockHeader*)memory->realloc(header,
+                                                  old_size + HEADER_SIZE,
+                                                  size + HEADER_SIZE,
+                                                  memory->data);
+    if (new_header)
+      memory_account(memory, old_size, size);
+  }
+
+  UNLOCK(memory);
+
+  if (!new_header)
+    return NULL;
+
+  new_header->size = size;
+
+  return new_header + 1;
+}
+
+
+void
+TA_memory_free(TA_Memory memory,
+               void* block)
+{
+  TA_BlockHeader* header;
+  size_t size;
+
+
+  if (!block)
+    return;
+
+  header = (TA_BlockHeader*)block - 1;
+  size = header->size;
+
+  LOCK(memory);
+
+  memory->free(header, size + HEADER_SIZE, memory->data);
+
+  memory->stats.cur_bytes -= size;
+  memory->stats.num_frees++;
+
+  UNLOCK(memory);
+}
+
+
+void*
+ta_malloc(size_t size)
+{
+  if (!_ta_memory)
+    return malloc(size);
+
+  return TA_memory_alloc(_ta_memory, size);
+}
+
+
+void*
+ta_calloc(size_t nmemb,
+          size_t size)
+{
+  void* block;
+
+
+  if (!_ta_memory)
+    return calloc(nmemb, size);
+
+  if (size && nmemb > (size_t)-1 / size)
+    return NULL;
+
+  block = TA_memory_alloc(_ta_memory, nmemb * size);
+  if (block)
+    memset(block, 0, nmemb * size);
+
+  return block;
+}
+
+
+void*
+ta_realloc(void* block,
+           size_t size)
+{
+  if (!_ta_memory)
+    return realloc(block, size);
+
+  return TA_memory_realloc(_ta_memory, block, size);
+}
+
+
+void
+ta_free(void* block)
+{
+  if (!_ta_memory)
+  {
+    free(block);
+    return;
+  }
+
+  TA_memory_free(_ta_memory, block);
+}
+
+
+char*
+ta_strdup(const char* s)
+{
+  size_t len = strlen(s) + 1;
+  char* copy;
+
+
+  copy = (char*)ta_malloc(len);
+  if (copy)
+    memcpy(copy, s, len);
+
+  return copy;
+}
+
+/* end of tamemory.c */
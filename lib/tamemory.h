@@ -0,0 +1,159 @@
+/* tamemory.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * All memory the library allocates for itself goes through the `ta_malloc'
+ * family of functions.  They use the memory manager of the current thread,
+ * which gets set while `TTF_autohint' and friends are running; it accounts
+ * every block (current and peak usage, number of allocations, and the same
+ * per processing phase), enforces a memory limit, and forwards the actual
+ * work to the application's allocator functions.
+ *
+ * Outside of the library (for example, if the front end calls
+ * `number_set_show' or sds functions directly) no memory manager is set,
+ * and the functions are simple wrappers around `malloc' and friends.  A
+ * block must thus be deallocated in the same state it has been allocated;
+ * in particular, the memory manager gets unset while calling back into the
+ * application.
+ *
+ * This header doesn't depend on FreeType so that `numberset.c' and
+ * `sds.c' can use it also in stand-alone programs.
+ */
+
+#ifndef TAMEMORY_H_
+#define TAMEMORY_H_
+
+#include <stddef.h>
+
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+
+#include "ttfautohint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* the memory manager and the debugging state are per thread */
+/* so that `TTF_autohint' can be called concurrently */
+#if defined __cplusplus && __cplusplus >= 201103L
+#  define TA_THREAD_LOCAL thread_local
+#elif defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L
+#  define TA_THREAD_LOCAL _Thread_local
+#elif defined __GNUC__
+#  define TA_THREAD_LOCAL __thread
+#elif defined _MSC_VER
+#  define TA_THREAD_LOCAL __declspec(thread)
+#else
+#  error "no thread-local storage available"
+#endif
+
+
+typedef struct TA_MemoryRec_
+{
+  TA_Memory_Alloc_Func alloc;
+  TA_Memory_Realloc_Func realloc;
+  TA_Memory_Free_Func free;
+  void* data;
+
+  size_t limit; /* zero means no limit */
+  int limit_exceeded;
+
+  int phase;
+  TA_Memory_Stats stats;
+
+#ifdef HAVE_PTHREAD_H
+  /* hinting threads share the memory manager of their caller */
+  pthread_mutex_t mutex;
+#endif
+} TA_MemoryRec, *TA_Memory;
+
+
+/* the memory manager of the current thread */
+extern TA_THREAD_LOCAL TA_Memory _ta_memory;
+
+
+/*
+ * Create a memory manager.  Either all three function pointers are set or
+ * none of them; in the latter case the functions of standard C are used.
+ * The manager itself is allocated with `alloc_func' but not accounted.
+ * Return NULL if out of memory.
+ */
+TA_Memory
+TA_memory_new(TA_Memory_Alloc_Func alloc_func,
+              TA_Memory_Realloc_Func realloc_func,
+              TA_Memory_Free_Func free_func,
+              void* data,
+              size_t limit);
+
+/* copy the statistics to `stats' (if non-NULL), then destroy `memory' */
+void
+TA_memory_done(TA_Memory memory,
+               TA_Memory_Stats* stats);
+
+/* start a new processing phase (`TA_MEMORY_PHASE_XXX') */
+void
+TA_memory_set_phase(TA_Memory memory,
+                    int phase);
+
+void
+TA_memory_get_stats(TA_Memory memory,
+                    TA_Memory_Stats* stats);
+
+/* allocation functions for a given memory manager, */
+/* independent of the current thread's one */
+
+void*
+TA_memory_alloc(TA_Memory memory,
+                size_t size);
+
+void*
+TA_memory_realloc(TA_Memory memory,
+                  void* block,
+                  size_t size);
+
+void
+TA_memory_free(TA_Memory memory,
+               void* block);
+
+
+/* the allocation functions; same semantics as their standard C namesakes */
+
+void*
+ta_malloc(size_t size);
+
+void*
+ta_calloc(size_t nmemb,
+          size_t size);
+
+void*
+ta_realloc(void* block,
+           size_t size);
+
+void
+ta_free(void* block);
+
+char*
+ta_strdup(const char* s);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TAMEMORY_H_ */
+
+/* end of tamemory.h */
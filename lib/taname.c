@@ -119,8 +119,8 @@ parse_name_records(FT_Byte** curp,
     return TA_Err_Ok;
 
   /* allocate name records array */
-  n->name_records = (Name_Record*)calloc(1, n->name_count
-                                            * sizeof (Name_Record));
+  n->name_records = (Name_Record*)ta_calloc(1, n->name_count
+                                               * sizeof (Name_Record));
   if (!n->name_records)
     return FT_Err_Out_Of_Memory;
 
@@ -186,13 +186,15 @@ parse_name_records(FT_Byte** curp,
     /* this string gets probably modified */
     /* by the `info' or `info_post' callbacks, */
     /* so we have to call the allocation function provided by the user */
-    r->str = (FT_Byte*)font->allocate(r->len);
+    r->str = (FT_Byte*)TA_font_allocate(font, r->len);
     if (!r->str)
       return FT_Err_Out_Of_Memory;
     memcpy(r->str, s, r->len);
 
     if (font->info)
     {
+      /* the callback is application code */
+      _ta_memory = NULL;
       /* we ignore the return value of `font->info' */
       font->info(r->platform_id,
                  r->encoding_id,
@@ -201,6 +203,7 @@ parse_name_records(FT_Byte** curp,
                  &r->len,
                  &r->str,
                  font->info_data);
+      _ta_memory = font->memory;
     }
 
     count++;
@@ -208,12 +211,16 @@ parse_name_records(FT_Byte** curp,
 
   /* let the user modify `name' table entries */
   if (font->info && font->info_post)
+  {
+    _ta_memory = NULL;
     /* we ignore the return value of `font->info_post' */
     font->info_post(font->info_data);
+    _ta_memory = font->memory;
+  }
 
   /* shrink name record array if necessary */
-  n->name_records = (Name_Record*)realloc(n->name_records,
-                                          count * sizeof (Name_Record));
+  n->name_records = (Name_Record*)ta_realloc(n->name_records,
+                                             count * sizeof (Name_Record));
   n->name_count = count;
 
   return TA_Err_Ok;
@@ -237,7 +244,7 @@ parse_lang_tag_records(FT_Byte** curp,
     return TA_Err_Ok;
 
   /* allocate language tags array */
-  n->lang_tag_records = (Lang_Tag_Record*)calloc(
+  n->lang_tag_records = (Lang_Tag_Record*)ta_calloc(
                           1, n->lang_tag_count * sizeof (Lang_Tag_Record));
   if (!n->lang_tag_records)
     return FT_Err_Out_Of_Memory;
@@ -266,7 +273,7 @@ parse_lang_tag_records(FT_Byte** curp,
       continue;
 
     /* we don't massage the data since we only make a copy */
-    r->str = (FT_Byte*)malloc(r->len);
+    r->str = (FT_Byte*)ta_malloc(r->len);
     if (!r->str)
       return FT_Err_Out_Of_Memory;
 
@@ -304,7 +311,7 @@ build_name_table(Naming_Table* n,
   if (n->format == 1)
     buf_new_len += 2 + 4 * n->lang_tag_count;
 
-  buf_new = (FT_Byte*)malloc(buf_new_len);
+  buf_new = (FT_Byte*)ta_malloc(buf_new_len);
   if (!buf_new)
     return FT_Err_Out_Of_Memory;
 
@@ -372,7 +379,7 @@ build_name_table(Naming_Table* n,
   if (buf_new_len + data_len > 2 * 0xFFFF)
   {
     /* the table would become too large, so we do nothing */
-    free(buf_new);
+    ta_free(buf_new);
     return TA_Err_Ok;
   }
 
@@ -383,10 +390,10 @@ build_name_table(Naming_Table* n,
   /* make the allocated buffer length a multiple of 4 */
   len = (buf_new_len + 3) & ~3U;
 
-  buf_new_resized = (FT_Byte*)realloc(buf_new, len);
+  buf_new_resized = (FT_Byte*)ta_realloc(buf_new, len);
   if (!buf_new_resized)
   {
-    free(buf_new);
+    ta_free(buf_new);
     return FT_Err_Out_Of_Memory;
   }
   buf_new = buf_new_resized;
@@ -452,7 +459,7 @@ build_name_table(Naming_Table* n,
   }
 
   /* we are done; replace the old buffer with the new one */
-  free(name_table->buf);
+  ta_free(name_table->buf);
 
   name_table->buf = buf_new;
   name_table->len = buf_new_len;
@@ -521,12 +528,12 @@ TA_sfnt_update_name_table(SFNT* sfnt,
 
 Exit:
   for (i = 0; i < n.name_count; i++)
-    font->deallocate(n.name_records[i].str);
+    TA_font_deallocate(font, n.name_records[i].str);
   for (i = 0; i < n.lang_tag_count; i++)
-    free(n.lang_tag_records[i].str);
+    ta_free(n.lang_tag_records[i].str);
 
-  free(n.name_records);
-  free(n.lang_tag_records);
+  ta_free(n.name_records);
+  ta_free(n.lang_tag_records);
 
   name_table->processed = 1;
 
@@ -0,0 +1,163 @@
+/* tapeephole-test.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) \
+ *         -I.. -I. \
+ *         `pkg-config --cflags freetype2 harfbuzz` \
+ *         -o tapeephole-test tapeephole-test.c \
+ *         .libs/libttfautohint.a \
+ *         `pkg-config --libs freetype2 harfbuzz` -lm
+ *
+ * after configuration and compilation of the library.  The resulting
+ * binary aborts with an assertion message in case of an error, otherwise
+ * it produces no output.
+ *
+ * The bytecode buffers passed to `TA_sfnt_optimize_bytecode' have exactly
+ * the size of the input, so add compiler option
+ *
+ *   -fsanitize=address
+ *
+ * (to both the library and this program) to catch writes beyond them.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ta.h"
+
+
+typedef struct Test_
+{
+  const char* input;
+  const char* output; /* NULL if the input must stay unchanged */
+} Test;
+
+
+static const Test tests[] =
+{
+  /* adjacent pushes get merged */
+  { "B0 01 B0 02 2B",
+    "B1 01 02 2B" },
+
+  /* the common prefix of both branches gets hoisted */
+  { "4B B0 0A 50 58 B3 05 06 07 08 2B 1B B3 05 06 07 09 2B 59",
+    "B2 05 06 07 4B B0 0A 50 58 B0 08 2B 1B B0 09 2B 59" },
+
+  /* word values need word encoding */
+  { "B8 01 00 2B",
+    NULL },
+
+  /* values that fit into a byte don't */
+  { "B9 00 01 00 02 2B",
+    "B1 01 02 2B" },
+
+  /* the best encoding of the cost function is one byte larger than */
+  /* the input; this used to write beyond the output buffer */
+  { "4B B0 0A 50 58 B3 CD 02 AC E8 1B B8 01 80 B2 3E DE 06"
+      " BB 01 EE 01 3D 01 5D 01 C0 2B 59",
+    NULL },
+
+  /* not bytecode created by ttfautohint (truncated push instruction) */
+  { "B1 01",
+    NULL },
+};
+
+
+/* convert a string of hex numbers; return the number of bytes */
+
+static FT_UInt
+parse_hex(const char* s,
+          FT_Byte* buf)
+{
+  FT_UInt len = 0;
+
+
+  for (;;)
+  {
+    char* endptr;
+    unsigned long val;
+
+
+    val = strtoul(s, &endptr, 16);
+    if (endptr == s)
+      break;
+
+    assert(val <= 0xFF);
+    buf[len++] = (FT_Byte)val;
+    s = endptr;
+  }
+
+  return len;
+}
+
+
+int
+main(void)
+{
+  static SFNT sfnt;
+  static FONT font;
+  size_t i;
+
+
+  font.hinting_range_min = TA_HINTING_RANGE_MIN;
+  font.hinting_range_max = TA_HINTING_RANGE_MAX;
+
+  for (i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+  {
+    const Test* test = &tests[i];
+    FT_Byte input[256];
+    FT_Byte output[256];
+    FT_Byte* buf;
+    FT_UInt input_len;
+    FT_UInt output_len;
+    FT_UInt len;
+    FT_Error error;
+
+
+    input_len = parse_hex(test->input, input);
+    if (test->output)
+      output_len = parse_hex(test->output, output);
+    else
+    {
+      memcpy(output, input, input_len);
+      output_len = input_len;
+    }
+
+    /* exactly sized, so that address sanitizers can catch overflows */
+    buf = (FT_Byte*)malloc(input_len);
+    assert(buf);
+    memcpy(buf, input, input_len);
+    len = input_len;
+
+    error = TA_sfnt_optimize_bytecode(&sfnt, &font, buf, &len);
+    assert(!error);
+
+    assert(len == output_len);
+    assert(!memcmp(buf, output, len));
+
+    free(buf);
+  }
+
+  return 0;
+}
+
+/* end of tapeephole-test.c */
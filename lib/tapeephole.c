@@ -0,0 +1,868 @@
+/* tapeephole.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * A peephole optimizer for the bytecode of a glyph.
+ *
+ * Glyph programs created by ttfautohint consist of push instructions,
+ * instructions without inline data (mostly CALL and LOOPCALL), and
+ * `IF'-`ELSE'-`EIF' clauses that select hints records by the ppem value.
+ * We represent a program as a linked list of nodes, where a node is
+ * either a single instruction without inline data or a push instruction
+ * with an arbitrary number of values.  The following transformations are
+ * applied to the list.
+ *
+ * - Adjacent push instructions are merged.
+ *
+ * - In a clause
+ *
+ *     MPPEM PUSH(size) LT IF PUSH(a ...) ... ELSE PUSH(b ...) ... EIF
+ *
+ *   the longest common prefix of the values pushed at the beginning of
+ *   both branches is moved before `MPPEM' (the condition only uses stack
+ *   elements it pushes itself).  Nested clauses are handled from the
+ *   inside out, since the `ELSE' branch of an outer clause starts with
+ *   the values hoisted from an inner clause.
+ *
+ * Finally, push instructions are re-encoded, splitting the values into
+ * runs so that the size is minimal (with a small penalty for each
+ * additional instruction); this selects between `PUSHB_n' and `NPUSHB'
+ * (or `PUSHW_n' and `NPUSHW') and between byte and word encoding for
+ * each run separately.  If the result is not smaller than the input, the
+ * input is kept.
+ */
+
+
+#include "ta.h"
+
+
+/* no inline data */
+#define NODE_INSTRUCTION 0
+/* `num_values' values in `values[first_value]' and following */
+#define NODE_PUSH 1
+
+typedef struct Peephole_Node_
+{
+  FT_Byte type;
+  FT_Byte opcode; /* if `type' is NODE_INSTRUCTION */
+
+  FT_UInt first_value;
+  FT_UInt num_values;
+
+  FT_Int prev; /* -1 if none */
+  FT_Int next; /* -1 if none */
+} Peephole_Node;
+
+
+typedef struct Peephole_
+{
+  Peephole_Node* nodes;
+  FT_UInt num_nodes;
+  FT_UInt max_nodes;
+  FT_Int head;
+
+  /* the values of all push instructions */
+  FT_Long* values;
+  FT_UInt num_values;
+  FT_UInt max_values;
+
+  /* scratch arrays for `TA_peephole_encode' */
+  FT_UInt* costs;
+  FT_UInt* run_lengths;
+  FT_Byte* run_is_word;
+} Peephole;
+
+
+static FT_Error
+TA_peephole_add_values(Peephole* peephole,
+                       FT_UInt num_values)
+{
+  if (peephole->num_values + num_values > peephole->max_values)
+  {
+    FT_UInt new_max = 2 * peephole->max_values + num_values;
+    FT_Long* values_new;
+
+
+    values_new = (FT_Long*)ta_realloc(peephole->values,
+                                      new_max * sizeof (FT_Long));
+    if (!values_new)
+      return FT_Err_Out_Of_Memory;
+
+    peephole->values = values_new;
+    peephole->max_values = new_max;
+  }
+
+  peephole->num_values += num_values;
+
+  return FT_Err_Ok;
+}
+
+
+/* append a new node to the node array (but not to the list) */
+
+static FT_Int
+TA_peephole_new_node(Peephole* peephole,
+                     FT_Byte type)
+{
+  Peephole_Node* node;
+
+
+  /* the caller guarantees that there is enough space */
+  node = &peephole->nodes[peephole->num_nodes];
+
+  node->type = type;
+  node->opcode = 0;
+  node->first_value = 0;
+  node->num_values = 0;
+  node->prev = -1;
+  node->next = -1;
+
+  return (FT_Int)peephole->num_nodes++;
+}
+
+
+static void
+TA_peephole_insert_before(Peephole* peephole,
+                          FT_Int idx,
+                          FT_Int before)
+{
+  Peephole_Node* nodes = peephole->nodes;
+
+
+  nodes[idx].next = before;
+  nodes[idx].prev = nodes[before].prev;
+
+  if (nodes[before].prev >= 0)
+    nodes[nodes[before].prev].next = idx;
+  else
+    peephole->head = idx;
+
+  nodes[before].prev = idx;
+}
+
+
+static void
+TA_peephole_remove(Peephole* peephole,
+                   FT_Int idx)
+{
+  Peephole_Node* nodes = peephole->nodes;
+
+
+  if (nodes[idx].prev >= 0)
+    nodes[nodes[idx].prev].next = nodes[idx].next;
+  else
+    peephole->head = nodes[idx].next;
+
+  if (nodes[idx].next >= 0)
+    nodes[nodes[idx].next].prev = nodes[idx].prev;
+}
+
+
+/*
+ * Convert bytecode into a list of nodes, with one node per instruction.
+ * We reserve space for the nodes created by hoisting, which are at most
+ * one per `IF' instruction.
+ */
+
+static FT_Error
+TA_peephole_parse(Peephole* peephole,
+                  FT_Byte* buf,
+                  FT_UInt len)
+{
+  FT_Byte* p = buf;
+  FT_Byte* endp = buf + len;
+  FT_Int prev = -1;
+  FT_Error error;
+
+
+  peephole->num_nodes = 0;
+  peephole->num_values = 0;
+  peephole->head = -1;
+
+  if (2 * len + 1 > peephole->max_nodes)
+  {
+    Peephole_Node* nodes_new;
+
+
+    nodes_new = (Peephole_Node*)ta_realloc(peephole->nodes,
+                                           (2 * len + 1)
+                                           * sizeof (Peephole_Node));
+    if (!nodes_new)
+      return FT_Err_Out_Of_Memory;
+
+    peephole->nodes = nodes_new;
+    peephole->max_nodes = 2 * len + 1;
+  }
+
+  while (p < endp)
+  {
+    FT_Byte opcode = *(p++);
+    FT_UInt num_values = 0;
+    FT_Bool is_word = 0;
+    FT_Int idx;
+
+
+    if (opcode == NPUSHB || opcode == NPUSHW)
+    {
+      if (p == endp)
+        return FT_Err_Invalid_Table;
+      num_values = *(p++);
+      is_word = (opcode == NPUSHW);
+    }
+    else if (opcode >= PUSHB_1 && opcode <= PUSHB_8)
+      num_values = opcode - PUSHB_1 + 1;
+    else if (opcode >= PUSHW_1 && opcode <= PUSHW_8)
+    {
+      num_values = opcode - PUSHW_1 + 1;
+      is_word = 1;
+    }
+
+    if (opcode == NPUSHB || opcode == NPUSHW
+        || (opcode >= PUSHB_1 && opcode <= PUSHW_8))
+    {
+      FT_Long* value;
+      FT_UInt i;
+
+
+      if ((FT_UInt)(endp - p) < (is_word ? 2 : 1) * num_values)
+        return FT_Err_Invalid_Table;
+
+      idx = TA_peephole_new_node(peephole, NODE_PUSH);
+      peephole->nodes[idx].first_value = peephole->num_values;
+      peephole->nodes[idx].num_values = num_values;
+
+      error = TA_peephole_add_values(peephole, num_values);
+      if (error)
+        return error;
+
+      value = peephole->values + peephole->nodes[idx].first_value;
+      for (i = 0; i < num_values; i++)
+      {
+        if (is_word)
+        {
+          *(value++) = (FT_Short)((p[0] << 8) | p[1]);
+          p += 2;
+        }
+        else
+          *(value++) = *(p++);
+      }
+    }
+    else
+    {
+      idx = TA_peephole_new_node(peephole, NODE_INSTRUCTION);
+      peephole->nodes[idx].opcode = opcode;
+    }
+
+    peephole->nodes[idx].prev = prev;
+    if (prev >= 0)
+      peephole->nodes[prev].next = idx;
+    else
+      peephole->head = idx;
+    prev = idx;
+  }
+
+  return FT_Err_Ok;
+}
+
+
+/*
+ * Compute the optimal encoding of `num_values' values, storing the
+ * lengths and types of the runs in the scratch arrays.  Since every run
+ * is an instruction to be executed, the returned cost is the size in
+ * bytes plus one for each run; this way, splitting values into more runs
+ * must save at least two bytes.
+ */
+
+static FT_UInt
+TA_peephole_encode(Peephole* peephole,
+                   FT_Long* values,
+                   FT_UInt num_values)
+{
+  FT_UInt* costs = peephole->costs;
+  FT_UInt i;
+
+
+  costs[num_values] = 0;
+
+  for (i = num_values; i-- > 0;)
+  {
+    FT_Bool bytes_possible = 1;
+    FT_UInt k;
+
+
+    costs[i] = (FT_UInt)-1;
+
+    for (k = 1; k <= 255 && i + k <= num_values; k++)
+    {
+      FT_UInt header = (k <= 8) ? 2 : 3;
+      FT_UInt cost;
+
+
+      if (values[i + k - 1] < 0 || values[i + k - 1] > 255)
+        bytes_possible = 0;
+
+      if (bytes_possible)
+      {
+        cost = header + k + costs[i + k];
+        if (cost < costs[i])
+        {
+          costs[i] = cost;
+          peephole->run_lengths[i] = k;
+          peephole->run_is_word[i] = 0;
+        }
+      }
+
+      cost = header + 2 * k + costs[i + k];
+      if (cost < costs[i])
+      {
+        costs[i] = cost;
+        peephole->run_lengths[i] = k;
+        peephole->run_is_word[i] = 1;
+      }
+    }
+  }
+
+  return costs[0];
+}
+
+
+static FT_UInt
+TA_peephole_push_cost(Peephole* peephole,
+                      FT_Long* values,
+                      FT_UInt num_values)
+{
+  if (!num_values)
+    return 0;
+
+  return TA_peephole_encode(peephole, values, num_values);
+}
+
+
+/* the cost of the node's encoding as computed by `TA_peephole_encode' */
+
+static FT_UInt
+TA_peephole_node_cost(Peephole* peephole,
+                      FT_Int idx)
+{
+  Peephole_Node* node = &peephole->nodes[idx];
+
+
+  if (node->type == NODE_INSTRUCTION)
+    return 1;
+
+  return TA_peephole_push_cost(peephole,
+                               peephole->values + node->first_value,
+                               node->num_values);
+}
+
+
+static FT_Bool
+TA_peephole_is_instruction(Peephole* peephole,
+                           FT_Int idx,
+                           FT_Byte opcode)
+{
+  return idx >= 0
+         && peephole->nodes[idx].type == NODE_INSTRUCTION
+         && peephole->nodes[idx].opcode == opcode;
+}
+
+
+static FT_Bool
+TA_peephole_is_push(Peephole* peephole,
+                    FT_Int idx)
+{
+  return idx >= 0 && peephole->nodes[idx].type == NODE_PUSH;
+}
+
+
+/*
+ * If `idx' is an `IF' node preceded by `MPPEM PUSH(size) LT', return the
+ * index of the `MPPEM' node and set `size'; otherwise return -1.
+ */
+
+static FT_Int
+TA_peephole_ppem_condition(Peephole* peephole,
+                           FT_Int idx,
+                           FT_Long* size)
+{
+  Peephole_Node* nodes = peephole->nodes;
+  FT_Int lt, push, mppem;
+
+
+  if (!TA_peephole_is_instruction(peephole, idx, IF))
+    return -1;
+
+  lt = nodes[idx].prev;
+  if (!TA_peephole_is_instruction(peephole, lt, LT))
+    return -1;
+
+  push = nodes[lt].prev;
+  if (!TA_peephole_is_push(peephole, push) || nodes[push].num_values != 1)
+    return -1;
+
+  mppem = nodes[push].prev;
+  if (!TA_peephole_is_instruction(peephole, mppem, MPPEM))
+    return -1;
+
+  *size = peephole->values[nodes[push].first_value];
+
+  return mppem;
+}
+
+
+/*
+ * Starting after an `IF' or `ELSE' node, return the index of the node
+ * that ends the clause at the same nesting level (`ELSE' or `EIF');
+ * `-1' if none.
+ */
+
+static FT_Int
+TA_peephole_find_clause_end(Peephole* peephole,
+                            FT_Int idx)
+{
+  Peephole_Node* nodes = peephole->nodes;
+  FT_UInt depth = 0;
+
+
+  for (idx = nodes[idx].next; idx >= 0; idx = nodes[idx].next)
+  {
+    if (nodes[idx].type != NODE_INSTRUCTION)
+      continue;
+
+    if (nodes[idx].opcode == IF)
+      depth++;
+    else if (nodes[idx].opcode == ELSE && !depth)
+      return idx;
+    else if (nodes[idx].opcode == EIF)
+    {
+      if (!depth)
+        return idx;
+      depth--;
+    }
+  }
+
+  return -1;
+}
+
+
+static FT_Error
+TA_peephole_merge_pushes(Peephole* peephole)
+{
+  Peephole_Node* nodes = peephole->nodes;
+  FT_Int idx;
+  FT_Error error;
+
+
+  for (idx = peephole->head; idx >= 0; idx = nodes[idx].next)
+  {
+    FT_Int next = nodes[idx].next;
+    FT_UInt first;
+
+
+    if (!(TA_peephole_is_push(peephole, idx)
+          && TA_peephole_is_push(peephole, next)))
+      continue;
+
+    /* concatenate all following push nodes */
+    first = peephole->num_values;
+    error = TA_peephole_add_values(peephole, nodes[idx].num_values);
+    if (error)
+      return error;
+    memcpy(peephole->values + first,
+           peephole->values + nodes[idx].first_value,
+           nodes[idx].num_values * sizeof (FT_Long));
+
+    while (TA_peephole_is_push(peephole, next))
+    {
+      FT_UInt n = nodes[next].num_values;
+      FT_UInt offset = peephole->num_values;
+
+
+      error = TA_peephole_add_values(peephole, n);
+      if (error)
+        return error;
+      memcpy(peephole->values + offset,
+             peephole->values + nodes[next].first_value,
+             n * sizeof (FT_Long));
+
+      TA_peephole_remove(peephole, next);
+      next = nodes[idx].next;
+    }
+
+    nodes[idx].first_value = first;
+    nodes[idx].num_values = peephole->num_values - first;
+  }
+
+  return FT_Err_Ok;
+}
+
+
+/*
+ * Try to hoist common values out of the branches of the clause starting
+ * with `IF' node `idx'.  Set `changed' if successful.
+ */
+
+static FT_Error
+TA_peephole_hoist(Peephole* peephole,
+                  FT_Int idx,
+                  FT_Bool* changed)
+{
+  Peephole_Node* nodes = peephole->nodes;
+  FT_Long size;
+  FT_Int mppem, before, else_node, a, b;
+  FT_Long* a_values;
+  FT_Long* b_values;
+  FT_UInt m, n;
+  FT_UInt old_cost, new_cost;
+  FT_Error error;
+
+
+  mppem = TA_peephole_ppem_condition(peephole, idx, &size);
+  if (mppem < 0)
+    return FT_Err_Ok;
+
+  else_node = TA_peephole_find_clause_end(peephole, idx);
+  if (!TA_peephole_is_instruction(peephole, else_node, ELSE))
+    return FT_Err_Ok;
+
+  a = nodes[idx].next;
+  b = nodes[else_node].next;
+  if (!(TA_peephole_is_push(peephole, a) && TA_peephole_is_push(peephole, b)))
+    return FT_Err_Ok;
+
+  a_values = peephole->values + nodes[a].first_value;
+  b_values = peephole->values + nodes[b].first_value;
+
+  n = TA_MIN(nodes[a].num_values, nodes[b].num_values);
+  for (m = 0; m < n; m++)
+    if (a_values[m] != b_values[m])
+      break;
+  if (!m)
+    return FT_Err_Ok;
+
+  before = nodes[mppem].prev;
+
+  /* compare costs; the new values for `before' are set up */
+  /* at the end of the value array without committing them yet */
+  old_cost = TA_peephole_node_cost(peephole, a)
+             + TA_peephole_node_cost(peephole, b);
+  new_cost = TA_peephole_push_cost(peephole,
+                                   a_values + m,
+                                   nodes[a].num_values - m)
+             + TA_peephole_push_cost(peephole,
+                                     b_values + m,
+                                     nodes[b].num_values - m);
+
+  if (TA_peephole_is_push(peephole, before))
+  {
+    FT_UInt first = peephole->num_values;
+    FT_UInt num = nodes[before].num_values;
+
+
+    error = TA_peephole_add_values(peephole, num + m);
+    if (error)
+      return error;
+
+    /* `values' might have been reallocated */
+    a_values = peephole->values + nodes[a].first_value;
+    memcpy(peephole->values + first,
+           peephole->values + nodes[before].first_value,
+           num * sizeof (FT_Long));
+    memcpy(peephole->values + first + num, a_values, m * sizeof (FT_Long));
+
+    old_cost += TA_peephole_node_cost(peephole, before);
+    new_cost += TA_peephole_push_cost(peephole,
+                                      peephole->values + first,
+                                      num + m);
+
+    if (new_cost >= old_cost)
+    {
+      peephole->num_values = first;
+      return FT_Err_Ok;
+    }
+
+    nodes[before].first_value = first;
+    nodes[before].num_values = num + m;
+  }
+  else
+  {
+    FT_Int hoisted;
+
+
+    new_cost += TA_peephole_push_cost(peephole, a_values, m);
+    if (new_cost >= old_cost)
+      return FT_Err_Ok;
+
+    hoisted = TA_peephole_new_node(peephole, NODE_PUSH);
+    nodes[hoisted].first_value = nodes[a].first_value;
+    nodes[hoisted].num_values = m;
+    TA_peephole_insert_before(peephole, hoisted, mppem);
+  }
+
+  nodes[a].first_value += m;
+  nodes[a].num_values -= m;
+  if (!nodes[a].num_values)
+    TA_peephole_remove(peephole, a);
+
+  nodes[b].first_value += m;
+  nodes[b].num_values -= m;
+  if (!nodes[b].num_values)
+    TA_peephole_remove(peephole, b);
+
+  *changed = 1;
+
+  return FT_Err_Ok;
+}
+
+
+/*
+ * Write the program to `buf' and return its size.  If `buf' is NULL, only
+ * compute the size.
+ */
+
+#define EMIT(code) \
+          do \
+          { \
+            if (buf) \
+              buf[pos] = (FT_Byte)(code); \
+            pos++; \
+          } while (0)
+
+static FT_UInt
+TA_peephole_write(Peephole* peephole,
+                  FT_Byte* buf)
+{
+  Peephole_Node* nodes = peephole->nodes;
+  FT_UInt pos = 0;
+  FT_Int idx;
+
+
+  for (idx = peephole->head; idx >= 0; idx = nodes[idx].next)
+  {
+    FT_Long* values;
+    FT_UInt num_values;
+    FT_UInt i;
+
+
+    if (nodes[idx].type == NODE_INSTRUCTION)
+    {
+      EMIT(nodes[idx].opcode);
+      continue;
+    }
+
+    values = peephole->values + nodes[idx].first_value;
+    num_values = nodes[idx].num_values;
+    if (!num_values)
+      continue;
+
+    TA_peephole_encode(peephole, values, num_values);
+
+    i = 0;
+    while (i < num_values)
+    {
+      FT_UInt k = peephole->run_lengths[i];
+      FT_Bool is_word = peephole->run_is_word[i];
+      FT_UInt j;
+
+
+      if (k <= 8)
+        EMIT((is_word ? PUSHW_1 : PUSHB_1) - 1 + k);
+      else
+      {
+        EMIT(is_word ? NPUSHW : NPUSHB);
+        EMIT(k);
+      }
+
+      for (j = i; j < i + k; j++)
+      {
+        if (is_word)
+        {
+          EMIT(HIGH(values[j]));
+          EMIT(LOW(values[j]));
+        }
+        else
+          EMIT(values[j]);
+      }
+
+      i += k;
+    }
+  }
+
+  return pos;
+}
+
+#undef EMIT
+
+
+/*
+ * Count the instructions executed at `ppem' (without the instructions
+ * of called functions), assuming that the clauses in the program are
+ * selected by the ppem value as emitted by ttfautohint; other clauses
+ * are assumed to be true.  Directly after `TA_peephole_parse', each node
+ * corresponds to exactly one instruction.
+ */
+
+static FT_ULong
+TA_peephole_count_steps(Peephole* peephole,
+                        FT_UInt ppem)
+{
+  Peephole_Node* nodes = peephole->nodes;
+  FT_ULong steps = 0;
+  FT_Int idx;
+
+
+  idx = peephole->head;
+  while (idx >= 0)
+  {
+    FT_Long size;
+
+
+    steps++;
+
+    if (TA_peephole_is_instruction(peephole, idx, IF))
+    {
+      if (TA_peephole_ppem_condition(peephole, idx, &size) >= 0
+          && !((FT_Long)ppem < size))
+      {
+        /* continue after `ELSE' or `EIF' */
+        idx = TA_peephole_find_clause_end(peephole, idx);
+        if (idx < 0)
+          break;
+      }
+    }
+    else if (TA_peephole_is_instruction(peephole, idx, ELSE))
+    {
+      /* the `IF' branch has been executed; continue after `EIF' */
+      idx = TA_peephole_find_clause_end(peephole, idx);
+      if (idx < 0)
+        break;
+    }
+
+    idx = nodes[idx].next;
+  }
+
+  return steps;
+}
+
+
+static FT_ULong
+TA_peephole_count_all_steps(Peephole* peephole,
+                            FONT* font)
+{
+  FT_ULong steps = 0;
+  FT_UInt ppem;
+
+
+  for (ppem = font->hinting_range_min;
+       ppem <= font->hinting_range_max;
+       ppem++)
+    steps += TA_peephole_count_steps(peephole, ppem);
+
+  return steps;
+}
+
+
+/*
+ * Optimize the bytecode in `buf' in place, updating `len'.  The
+ * statistics in `sfnt' get updated also.
+ */
+
+FT_Error
+TA_sfnt_optimize_bytecode(SFNT* sfnt,
+                          FONT* font,
+                          FT_Byte* buf,
+                          FT_UInt* len)
+{
+  Peephole peephole;
+  FT_UInt new_len;
+  FT_Bool changed;
+  FT_Int idx;
+  FT_Error error;
+
+
+  if (!*len)
+    return FT_Err_Ok;
+
+  memset(&peephole, 0, sizeof (peephole));
+
+  error = TA_peephole_parse(&peephole, buf, *len);
+  if (error)
+  {
+    /* not our bytecode; leave it alone */
+    if (error == FT_Err_Invalid_Table)
+      error = FT_Err_Ok;
+    goto Exit;
+  }
+
+  sfnt->bytecode_len_before += *len;
+  sfnt->bytecode_steps_before += TA_peephole_count_all_steps(&peephole,
+                                                             font);
+
+  /* a push node has at most as many values as the program has bytes */
+  peephole.costs = (FT_UInt*)ta_malloc((*len + 1) * sizeof (FT_UInt));
+  peephole.run_lengths = (FT_UInt*)ta_malloc(*len * sizeof (FT_UInt));
+  peephole.run_is_word = (FT_Byte*)ta_malloc(*len);
+  if (!(peephole.costs && peephole.run_lengths && peephole.run_is_word))
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  do
+  {
+    changed = 0;
+
+    error = TA_peephole_merge_pushes(&peephole);
+    if (error)
+      goto Exit;
+
+    for (idx = peephole.head; idx >= 0; idx = peephole.nodes[idx].next)
+    {
+      error = TA_peephole_hoist(&peephole, idx, &changed);
+      if (error)
+        goto Exit;
+    }
+  } while (changed);
+
+  /* the cost function doesn't completely exclude a larger result, */
+  /* so we check the size before overwriting `buf' in place */
+  /* (the parsed program doesn't reference it) */
+  new_len = TA_peephole_write(&peephole, NULL);
+  if (new_len < *len)
+  {
+    TA_peephole_write(&peephole, buf);
+    *len = new_len;
+  }
+
+  /* count steps of the final program */
+  error = TA_peephole_parse(&peephole, buf, *len);
+  if (error)
+    goto Exit;
+
+  sfnt->bytecode_len_after += *len;
+  sfnt->bytecode_steps_after += TA_peephole_count_all_steps(&peephole,
+                                                            font);
+
+Exit:
+  ta_free(peephole.nodes);
+  ta_free(peephole.values);
+  ta_free(peephole.costs);
+  ta_free(peephole.run_lengths);
+  ta_free(peephole.run_is_word);
+
+  return error;
+}
+
+/* end of tapeephole.c */
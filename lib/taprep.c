@@ -530,10 +530,10 @@ TA_sfnt_build_number_set(SFNT* sfnt,
   /* so that we can easily split into chunks of 255 args */
   /* as needed by NPUSHB and friends; */
   /* for simplicity, always allocate an extra slot */
-  single2_args = (FT_UInt*)malloc((num_singles2 + 1) * sizeof (FT_UInt));
-  single_args = (FT_UInt*)malloc((num_singles + 1) * sizeof (FT_UInt));
-  range2_args = (FT_UInt*)malloc((2 * num_ranges2 + 1) * sizeof (FT_UInt));
-  range_args = (FT_UInt*)malloc((2 * num_ranges + 1) * sizeof (FT_UInt));
+  single2_args = (FT_UInt*)ta_malloc((num_singles2 + 1) * sizeof (FT_UInt));
+  single_args = (FT_UInt*)ta_malloc((num_singles + 1) * sizeof (FT_UInt));
+  range2_args = (FT_UInt*)ta_malloc((2 * num_ranges2 + 1) * sizeof (FT_UInt));
+  range_args = (FT_UInt*)ta_malloc((2 * num_ranges + 1) * sizeof (FT_UInt));
   if (!single2_args || !single_args
       || !range2_args || !range_args)
     goto Fail;
@@ -586,11 +586,11 @@ TA_sfnt_build_number_set(SFNT* sfnt,
   }
 
   /* this rough estimate of the buffer size gets adjusted later on */
-  *buf = (FT_Byte*)malloc((2 + 1) * num_singles2
-                          + (1 + 1) * num_singles
-                          + (4 + 1) * num_ranges2
-                          + (2 + 1) * num_ranges
-                          + 10);
+  *buf = (FT_Byte*)ta_malloc((2 + 1) * num_singles2
+                             + (1 + 1) * num_singles
+                             + (4 + 1) * num_ranges2
+                             + (2 + 1) * num_ranges
+                             + 10);
   if (!*buf)
     goto Fail;
   bufp = *buf;
@@ -618,10 +618,10 @@ TA_sfnt_build_number_set(SFNT* sfnt,
     sfnt->max_stack_elements = num_stack_elements;
 
 Fail:
-  free(single2_args);
-  free(single_args);
-  free(range2_args);
-  free(range_args);
+  ta_free(single2_args);
+  ta_free(single_args);
+  ta_free(range2_args);
+  ta_free(range_args);
 
   return bufp;
 }
@@ -724,10 +724,10 @@ TA_table_build_prep(FT_Byte** prep,
 
   /* buffer length must be a multiple of four */
   len = (buf_new_len + 3) & ~3U;
-  buf_new = (FT_Byte*)realloc(buf, len);
+  buf_new = (FT_Byte*)ta_realloc(buf, len);
   if (!buf_new)
   {
-    free(buf);
+    ta_free(buf);
     return FT_Err_Out_Of_Memory;
   }
   buf = buf_new;
@@ -958,7 +958,7 @@ TA_sfnt_build_prep_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_prep, prep_len, prep_buf);
   if (error)
-    free(prep_buf);
+    ta_free(prep_buf);
   else
     data->prep_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
@@ -0,0 +1,304 @@
+/* taprofile.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/* collect and write the per-glyph cost report of option `profile-file' */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ta.h"
+
+
+double
+TA_profile_time(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+
+  if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#endif
+
+  /* processor time is a good enough approximation */
+  /* if there is no monotonic clock */
+  return (double)clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+
+
+FT_Error
+TA_sfnt_init_profile(SFNT* sfnt,
+                     FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+
+  FT_UShort i;
+
+
+  if (!font->profile_file)
+    return FT_Err_Ok;
+
+  sfnt->profile = (Glyph_Profile*)ta_calloc(data->num_glyphs,
+                                            sizeof (Glyph_Profile));
+  if (!sfnt->profile)
+    return FT_Err_Out_Of_Memory;
+  sfnt->num_profile = data->num_glyphs;
+
+  for (i = 0; i < data->num_glyphs; i++)
+    sfnt->profile[i].copy_of = -1;
+
+  return FT_Err_Ok;
+}
+
+
+/* record the bytecode sizes after extracting subroutines */
+
+void
+TA_sfnt_finish_profile(SFNT* sfnt,
+                       FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+
+  FT_UInt i;
+
+
+  for (i = 0; i < sfnt->num_profile; i++)
+    sfnt->profile[i].final_ins_len = (FT_UInt)data->glyphs[i].ins_len;
+}
+
+
+/* the entries of the top-N summary */
+typedef struct Profile_Entry_
+{
+  SFNT* sfnt;
+  FT_Long idx;
+} Profile_Entry;
+
+
+static int
+profile_entry_compare(const void* a,
+                      const void* b)
+{
+  const Profile_Entry* entry1 = (const Profile_Entry*)a;
+  const Profile_Entry* entry2 = (const Profile_Entry*)b;
+
+  double time1 = entry1->sfnt->profile[entry1->idx].time;
+  double time2 = entry2->sfnt->profile[entry2->idx].time;
+
+
+  /* sort by decreasing time; */
+  /* equal values are sorted by subfont and glyph index */
+  if (time1 > time2)
+    return -1;
+  if (time1 < time2)
+    return 1;
+
+  if (entry1->sfnt != entry2->sfnt)
+    return entry1->sfnt < entry2->sfnt ? -1 : 1;
+
+  return entry1->idx < entry2->idx ? -1
+                                   : entry1->idx > entry2->idx;
+}
+
+
+static void
+profile_write_name(FILE* f,
+                   SFNT* sfnt,
+                   FT_Long idx)
+{
+  char buf[256];
+  char* s;
+
+
+  buf[0] = '\0';
+  (void)FT_Get_Glyph_Name(sfnt->face, (FT_UInt)idx, buf, 256);
+
+  /* glyph names can't contain commas or quotes, */
+  /* but we are paranoid */
+  fputc('"', f);
+  for (s = buf; *s; s++)
+  {
+    if (*s == '"')
+      fputc('"', f);
+    fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+
+/*
+ * Write a CSV file with one line per glyph, sorted by subfont and glyph
+ * index.  Lines starting with `#' at the end of the file hold a summary
+ * of the `profile_top' glyphs that took the most time, together with the
+ * totals of all columns.  Subfonts of a TTC that share the `glyf' table
+ * of a previous subfont don't get lines of their own since their glyphs
+ * are hinted only once; the summary lists them.
+ */
+
+FT_Error
+TA_font_write_profile(FONT* font)
+{
+  FILE* f = font->profile_file;
+
+  Profile_Entry* entries = NULL;
+  FT_ULong num_entries = 0;
+  FT_ULong num_hinted = 0;
+  FT_ULong i;
+  FT_Long j;
+
+  double total_time = 0;
+  FT_ULong total_action_hints_records = 0;
+  FT_ULong total_point_hints_records = 0;
+  FT_ULong total_delta_exceptions = 0;
+  FT_ULong total_ins_len = 0;
+  FT_ULong total_final_ins_len = 0;
+
+
+  if (!f)
+    return TA_Err_Ok;
+
+  for (j = 0; j < font->num_sfnts; j++)
+    num_entries += font->sfnts[j].num_profile;
+
+  if (num_entries)
+  {
+    entries = (Profile_Entry*)ta_malloc(num_entries * sizeof (Profile_Entry));
+    if (!entries)
+      return FT_Err_Out_Of_Memory;
+  }
+
+  fprintf(f, "font,glyph,name,time_ms,points,segments,edges,"
+             "action_records,point_records,ins_len,delta_exceptions,"
+             "copy_of,final_ins_len\n");
+
+  num_entries = 0;
+  for (j = 0; j < font->num_sfnts; j++)
+  {
+    SFNT* sfnt = &font->sfnts[j];
+    FT_Long idx;
+
+
+    for (idx = 0; idx < (FT_Long)sfnt->num_profile; idx++)
+    {
+      Glyph_Profile* profile = &sfnt->profile[idx];
+
+
+      fprintf(f, "%ld,%ld,", sfnt->face->face_index, idx);
+      profile_write_name(f, sfnt, idx);
+      fprintf(f, ",%.3f,%u,%u,%u,%u,%u,%u,%u,%ld,%u\n",
+                 profile->time,
+                 profile->num_points,
+                 profile->num_segments,
+                 profile->num_edges,
+                 profile->num_action_hints_records,
+                 profile->num_point_hints_records,
+                 profile->ins_len,
+                 profile->num_delta_exceptions,
+                 profile->copy_of,
+                 profile->final_ins_len);
+
+      entries[num_entries].sfnt = sfnt;
+      entries[num_entries].idx = idx;
+      num_entries++;
+
+      if (profile->copy_of < 0)
+        num_hinted++;
+
+      total_time += profile->time;
+      total_action_hints_records += profile->num_action_hints_records;
+      total_point_hints_records += profile->num_point_hints_records;
+      total_delta_exceptions += profile->num_delta_exceptions;
+      total_ins_len += profile->ins_len;
+      total_final_ins_len += profile->final_ins_len;
+    }
+  }
+
+  if (num_entries)
+    qsort(entries, num_entries, sizeof (Profile_Entry),
+          profile_entry_compare);
+
+  fprintf(f, "#\n"
+             "# %lu glyph%s (%lu hinted), %.3f ms,"
+             " hinting range %u-%u\n"
+             "# %lu action records, %lu point records,"
+             " %lu bytes of bytecode (%lu after extracting subroutines),"
+             " %lu delta exceptions\n",
+             num_entries, num_entries == 1 ? "" : "s", num_hinted,
+             total_time,
+             font->hinting_range_min, font->hinting_range_max,
+             total_action_hints_records, total_point_hints_records,
+             total_ins_len, total_final_ins_len, total_delta_exceptions);
+
+  for (j = 0; j < font->num_sfnts; j++)
+  {
+    SFNT* sfnt = &font->sfnts[j];
+    FT_Long k;
+
+
+    if (sfnt->num_profile)
+      continue;
+
+    for (k = 0; k < j; k++)
+      if (font->sfnts[k].glyf_idx == sfnt->glyf_idx
+          && font->sfnts[k].num_profile)
+        break;
+
+    if (k < j)
+      fprintf(f, "# subfont %ld shares the glyphs of subfont %ld\n",
+                 sfnt->face->face_index,
+                 font->sfnts[k].face->face_index);
+  }
+
+  if (font->profile_top && num_entries)
+  {
+    fprintf(f, "#\n"
+               "# top %u glyph%s by time:\n"
+               "#   font  glyph  time_ms  share  action_records"
+               "  ins_len  name\n",
+               font->profile_top, font->profile_top == 1 ? "" : "s");
+
+    for (i = 0; i < num_entries && i < font->profile_top; i++)
+    {
+      SFNT* sfnt = entries[i].sfnt;
+      Glyph_Profile* profile = &sfnt->profile[entries[i].idx];
+      char buf[256];
+
+
+      buf[0] = '\0';
+      (void)FT_Get_Glyph_Name(sfnt->face, (FT_UInt)entries[i].idx,
+                              buf, 256);
+
+      fprintf(f, "#   %4ld  %5ld  %7.3f  %4.1f%%  %14u  %7u  %s\n",
+                 sfnt->face->face_index, entries[i].idx,
+                 profile->time,
+                 total_time > 0 ? 100.0 * profile->time / total_time : 0.0,
+                 profile->num_action_hints_records,
+                 profile->ins_len,
+                 buf);
+    }
+  }
+
+  ta_free(entries);
+
+  if (ferror(f))
+    return TA_Err_Invalid_Stream_Write;
+
+  return TA_Err_Ok;
+}
+
+/* end of taprofile.c */
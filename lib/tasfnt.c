@@ -32,8 +32,9 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
   if (error)
     return error;
 
-  sfnt->table_infos = (SFNT_Table_Info*)malloc(sfnt->num_table_infos
-                                               * sizeof (SFNT_Table_Info));
+  sfnt->table_infos =
+    (SFNT_Table_Info*)ta_malloc(sfnt->num_table_infos
+                                * sizeof (SFNT_Table_Info));
   if (!sfnt->table_infos)
     return FT_Err_Out_Of_Memory;
 
@@ -94,7 +95,7 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
 
     /* make the allocated buffer length a multiple of 4 */
     buf_len = (len + 3) & ~3U;
-    buf = (FT_Byte*)malloc(buf_len);
+    buf = (FT_Byte*)ta_malloc(buf_len);
     if (!buf)
       return FT_Err_Out_Of_Memory;
 
@@ -156,13 +157,13 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
     else
     {
       /* reuse existing SFNT table */
-      free(buf);
+      ta_free(buf);
       *table_info = j;
     }
     continue;
 
   Err:
-    free(buf);
+    ta_free(buf);
     return error;
   }
 
@@ -17,6 +17,8 @@
 
 /* heavily modified 2014 by Werner Lemberg <wl@gnu.org> */
 
+#include <string.h>
+
 #include "tashaper.h"
 
 
@@ -412,22 +414,454 @@ static const hb_feature_t* features[] =
 };
 
 
+/*
+ * Blue zones and standard widths are computed from sample strings; every
+ * style shapes its strings cluster by cluster, and many styles share the
+ * same strings (for example, all styles of a script use the same standard
+ * characters, and all default styles check the same digits).  We thus
+ * cache the shaping result of a cluster per coverage.
+ *
+ * The cached values don't depend on the size currently set for the
+ * FreeType face (which changes while hinting): HarfBuzz uses its own font
+ * functions (see `ta_face_globals_new'), reading glyph indices, advance
+ * widths, and positions directly from the font tables, and the scale of
+ * the HarfBuzz font is fixed to units per EM.  Shaping thus only depends
+ * on the tables listed in `shaper_tables'; subfonts of a TTC that have
+ * identical versions of these tables share a single cache.
+ */
+
+typedef struct TA_ShaperElemRec_
+{
+  FT_ULong glyph_index;
+  FT_Long x_advance;
+  FT_Long y_offset;
+} TA_ShaperElemRec, *TA_ShaperElem;
+
+
+typedef struct TA_ShaperClusterRec_
+{
+  struct TA_ShaperClusterRec_* next;
+
+  FT_UInt32 hash; /* of `text' */
+  TA_Coverage coverage;
+
+  const char* text; /* not zero-terminated */
+  unsigned int len;
+
+  TA_ShaperElem elems;
+  unsigned int count;
+} TA_ShaperClusterRec, *TA_ShaperCluster;
+
+
+/* all tables HarfBuzz's shaper and font functions might access */
+static const FT_ULong shaper_tables[] =
+{
+  TTAG_cmap,
+  TTAG_head,
+  TTAG_maxp,
+  TTAG_hhea,
+  TTAG_hmtx,
+  TTAG_HVAR,
+  TTAG_vhea,
+  TTAG_vmtx,
+  TTAG_VVAR,
+  TTAG_GDEF,
+  TTAG_GSUB,
+  TTAG_GPOS,
+  TTAG_kern,
+  FT_MAKE_TAG('k', 'e', 'r', 'x'),
+  FT_MAKE_TAG('a', 'n', 'k', 'r'),
+  TTAG_feat,
+  TTAG_mort,
+  TTAG_morx,
+  TTAG_trak
+};
+
+#define NUM_SHAPER_TABLES \
+          (sizeof (shaper_tables) / sizeof (shaper_tables[0]))
+
+
+typedef struct TA_ShaperCacheRec_
+{
+  FT_UInt ref_count;
+
+  /* indices into the font's SFNT table array of `shaper_tables', */
+  /* or MISSING; `has_sfnt' is not set for faces that aren't subfonts */
+  FT_Bool has_sfnt;
+  FT_ULong tables[NUM_SHAPER_TABLES];
+  FT_UShort units_per_EM;
+
+  TA_ShaperCluster* buckets;
+  FT_UInt num_buckets; /* a power of two */
+  FT_UInt num_clusters;
+} TA_ShaperCacheRec;
+
+
+#define SHAPER_CACHE_INITIAL_BUCKETS 64
+
+
+/* get the SFNT table indices of `face' relevant for shaping */
+
+static FT_Bool
+shaper_cache_get_tables(FONT* font,
+                        FT_Face face,
+                        FT_ULong* tables)
+{
+  SFNT* sfnt = NULL;
+  FT_Long i;
+  size_t j;
+
+
+  for (i = 0; i < font->num_sfnts; i++)
+    if (font->sfnts[i].face == face)
+    {
+      sfnt = &font->sfnts[i];
+      break;
+    }
+
+  if (!sfnt || !sfnt->table_infos)
+    return 0;
+
+  for (j = 0; j < NUM_SHAPER_TABLES; j++)
+  {
+    FT_ULong k;
+
+
+    tables[j] = MISSING;
+
+    for (k = 0; k < sfnt->num_table_infos; k++)
+    {
+      SFNT_Table_Info idx = sfnt->table_infos[k];
+
+
+      if (idx != MISSING
+          && font->tables[idx].tag == shaper_tables[j])
+      {
+        tables[j] = idx;
+        break;
+      }
+    }
+  }
+
+  return 1;
+}
+
+
+FT_Error
+ta_shaper_cache_new(TA_FaceGlobals globals,
+                    TA_ShaperCache* acache)
+{
+  FONT* font = globals->font;
+  FT_Face face = globals->face;
+  TA_ShaperCache cache;
+
+  FT_ULong tables[NUM_SHAPER_TABLES];
+  FT_Bool has_sfnt;
+
+
+  has_sfnt = shaper_cache_get_tables(font, face, tables);
+
+  /* search the caches of the other subfonts for a match */
+  if (has_sfnt)
+  {
+    FT_Long i;
+
+
+    for (i = 0; i < font->num_sfnts; i++)
+    {
+      FT_Face other = font->sfnts[i].face;
+      TA_FaceGlobals other_globals;
+
+
+      if (!other || other == face)
+        continue;
+
+      other_globals = (TA_FaceGlobals)other->autohint.data;
+      if (!other_globals || !other_globals->shaper_cache)
+        continue;
+
+      cache = other_globals->shaper_cache;
+      if (cache->has_sfnt
+          && cache->units_per_EM == face->units_per_EM
+          && !memcmp(cache->tables, tables, sizeof (tables)))
+      {
+        cache->ref_count++;
+        *acache = cache;
+
+        return FT_Err_Ok;
+      }
+    }
+  }
+
+  cache = (TA_ShaperCache)ta_calloc(1, sizeof (TA_ShaperCacheRec));
+  if (!cache)
+    return FT_Err_Out_Of_Memory;
+
+  cache->buckets = (TA_ShaperCluster*)ta_calloc(SHAPER_CACHE_INITIAL_BUCKETS,
+                                                sizeof (TA_ShaperCluster));
+  if (!cache->buckets)
+  {
+    ta_free(cache);
+    return FT_Err_Out_Of_Memory;
+  }
+
+  cache->ref_count = 1;
+  cache->has_sfnt = has_sfnt;
+  memcpy(cache->tables, tables, sizeof (tables));
+  cache->units_per_EM = face->units_per_EM;
+  cache->num_buckets = SHAPER_CACHE_INITIAL_BUCKETS;
+
+  *acache = cache;
+
+  return FT_Err_Ok;
+}
+
+
+void
+ta_shaper_cache_done(TA_ShaperCache cache)
+{
+  FT_UInt i;
+
+
+  if (!cache)
+    return;
+
+  if (--cache->ref_count)
+    return;
+
+  for (i = 0; i < cache->num_buckets; i++)
+  {
+    TA_ShaperCluster cluster = cache->buckets[i];
+
+
+    while (cluster)
+    {
+      TA_ShaperCluster next = cluster->next;
+
+
+      /* `elems' and `text' are part of the `cluster' block */
+      ta_free(cluster);
+      cluster = next;
+    }
+  }
+
+  ta_free(cache->buckets);
+  ta_free(cache);
+}
+
+
+static FT_UInt32
+shaper_cache_hash(const char* p,
+                  unsigned int len)
+{
+  /* FNV-1a */
+  FT_UInt32 hash = 0x811C9DC5UL;
+  unsigned int i;
+
+
+  for (i = 0; i < len; i++)
+    hash = (hash ^ (FT_Byte)p[i]) * 0x01000193UL;
+
+  return hash;
+}
+
+
+static TA_ShaperCluster*
+shaper_cache_bucket(TA_ShaperCache cache,
+                    FT_UInt32 hash,
+                    TA_Coverage coverage)
+{
+  return &cache->buckets[(hash + (FT_UInt32)coverage)
+                         & (cache->num_buckets - 1)];
+}
+
+
+static TA_ShaperCluster
+shaper_cache_lookup(TA_ShaperCache cache,
+                    FT_UInt32 hash,
+                    TA_Coverage coverage,
+                    const char* p,
+                    unsigned int len)
+{
+  TA_ShaperCluster cluster = *shaper_cache_bucket(cache, hash, coverage);
+
+
+  for (; cluster; cluster = cluster->next)
+    if (cluster->hash == hash
+        && cluster->coverage == coverage
+        && cluster->len == len
+        && !memcmp(cluster->text, p, len))
+      return cluster;
+
+  return NULL;
+}
+
+
+/* double the number of buckets; */
+/* if we run out of memory, we simply continue with longer chains */
+
+static void
+shaper_cache_grow(TA_ShaperCache cache)
+{
+  TA_ShaperCluster* old_buckets = cache->buckets;
+  FT_UInt old_num_buckets = cache->num_buckets;
+  FT_UInt i;
+
+
+  cache->buckets = (TA_ShaperCluster*)ta_calloc(2 * old_num_buckets,
+                                                sizeof (TA_ShaperCluster));
+  if (!cache->buckets)
+  {
+    cache->buckets = old_buckets;
+    return;
+  }
+
+  cache->num_buckets = 2 * old_num_buckets;
+
+  for (i = 0; i < old_num_buckets; i++)
+  {
+    TA_ShaperCluster cluster = old_buckets[i];
+
+
+    while (cluster)
+    {
+      TA_ShaperCluster next = cluster->next;
+      TA_ShaperCluster* bucket = shaper_cache_bucket(cache,
+                                                     cluster->hash,
+                                                     cluster->coverage);
+
+
+      cluster->next = *bucket;
+      *bucket = cluster;
+      cluster = next;
+    }
+  }
+
+  ta_free(old_buckets);
+}
+
+
+/* add the contents of `buf' to the cache; */
+/* return NULL if out of memory */
+
+static TA_ShaperCluster
+shaper_cache_insert(TA_ShaperCache cache,
+                    FT_UInt32 hash,
+                    TA_Coverage coverage,
+                    const char* p,
+                    unsigned int len,
+                    hb_buffer_t* buf)
+{
+  TA_ShaperCluster cluster;
+  TA_ShaperCluster* bucket;
+
+  hb_glyph_info_t* ginfo;
+  hb_glyph_position_t* gpos;
+  unsigned int gcount;
+  unsigned int i;
+
+
+  ginfo = hb_buffer_get_glyph_infos(buf, &gcount);
+  gpos = hb_buffer_get_glyph_positions(buf, &gcount);
+
+  /* we allocate the cluster together with its elements and its text */
+  cluster = (TA_ShaperCluster)ta_malloc(sizeof (TA_ShaperClusterRec)
+                                        + gcount * sizeof (TA_ShaperElemRec)
+                                        + len);
+  if (!cluster)
+    return NULL;
+
+  cluster->elems = (TA_ShaperElem)(cluster + 1);
+  cluster->count = gcount;
+
+  for (i = 0; i < gcount; i++)
+  {
+    cluster->elems[i].glyph_index = ginfo[i].codepoint;
+    cluster->elems[i].x_advance = gpos[i].x_advance;
+    cluster->elems[i].y_offset = gpos[i].y_offset;
+  }
+
+  cluster->text = (const char*)(cluster->elems + gcount);
+  memcpy((char*)cluster->text, p, len);
+  cluster->len = len;
+  cluster->hash = hash;
+  cluster->coverage = coverage;
+
+  if (cache->num_clusters >= 2 * cache->num_buckets)
+    shaper_cache_grow(cache);
+
+  bucket = shaper_cache_bucket(cache, hash, coverage);
+  cluster->next = *bucket;
+  *bucket = cluster;
+  cache->num_clusters++;
+
+  return cluster;
+}
+
+
+/* a shaper buffer either points to a cached cluster */
+/* or (if we are out of memory) holds the shaping result itself */
+
+typedef struct TA_ShaperBufRec_
+{
+  hb_buffer_t* hb_buf;
+  TA_ShaperCluster cluster;
+} TA_ShaperBufRec, *TA_ShaperBuf;
+
+
 void*
 ta_shaper_buf_create(FT_Face face)
 {
+  TA_ShaperBuf buf;
+
   FT_UNUSED(face);
 
-  return (void*)hb_buffer_create();
+
+  buf = (TA_ShaperBuf)ta_malloc(sizeof (TA_ShaperBufRec));
+  if (!buf)
+    return NULL;
+
+  buf->hb_buf = hb_buffer_create();
+  buf->cluster = NULL;
+
+  return (void*)buf;
 }
 
 
 void
 ta_shaper_buf_destroy(FT_Face face,
-                      void* buf)
+                      void* buf_)
 {
+  TA_ShaperBuf buf = (TA_ShaperBuf)buf_;
+
   FT_UNUSED(face);
 
-  hb_buffer_destroy((hb_buffer_t*)buf);
+
+  if (!buf)
+    return;
+
+  hb_buffer_destroy(buf->hb_buf);
+  ta_free(buf);
+}
+
+
+static void
+shaper_shape(hb_font_t* font,
+             hb_buffer_t* buf,
+             const char* p,
+             int len,
+             const hb_feature_t* feature)
+{
+  /* feed character(s) to the HarfBuzz buffer */
+  hb_buffer_clear_contents(buf);
+  hb_buffer_add_utf8(buf, p, len, 0, len);
+
+  /* we let HarfBuzz guess the script and writing direction */
+  hb_buffer_guess_segment_properties(buf);
+
+  /* shape buffer, which means conversion from character codes to */
+  /* glyph indices, possibly applying a feature                   */
+  hb_shape(font, buf, feature, feature ? 1 : 0);
 }
 
 
@@ -437,25 +871,21 @@ ta_shaper_get_cluster(const char* p,
                       void* buf_,
                       unsigned int* count)
 {
-  TA_StyleClass style_class;
+  TA_FaceGlobals globals = metrics->globals;
+  TA_ShaperCache cache = globals->shaper_cache;
+  TA_Coverage coverage;
   const hb_feature_t* feature;
-  FT_Int upem;
   const char* q;
   int len;
+  FT_UInt32 hash;
 
-  hb_buffer_t* buf = (hb_buffer_t*)buf_;
-  hb_font_t* font;
+  TA_ShaperBuf buf = (TA_ShaperBuf)buf_;
+  TA_ShaperCluster cluster;
   hb_codepoint_t dummy;
 
 
-  upem = (FT_Int)metrics->globals->face->units_per_EM;
-  style_class = metrics->style_class;
-  feature = features[style_class->coverage];
-
-  font = metrics->globals->hb_font;
-
-  /* we shape at a size of units per EM; this means font units */
-  hb_font_set_scale(font, upem, upem);
+  coverage = metrics->style_class->coverage;
+  feature = features[coverage];
 
   while (*p == ' ')
     p++;
@@ -466,58 +896,90 @@ ta_shaper_get_cluster(const char* p,
     GET_UTF8_CHAR(dummy, q);
   len = (int)(q - p);
 
-  /* feed character(s) to the HarfBuzz buffer */
-  hb_buffer_clear_contents(buf);
-  hb_buffer_add_utf8(buf, p, len, 0, len);
-
-  /* we let HarfBuzz guess the script and writing direction */
-  hb_buffer_guess_segment_properties(buf);
+  /* like an empty HarfBuzz buffer, a buffer we couldn't allocate */
+  /* doesn't provide any glyphs */
+  if (!buf)
+  {
+    *count = 0;
+    return q;
+  }
 
-  /* shape buffer, which means conversion from character codes to */
-  /* glyph indices, possibly applying a feature                   */
-  hb_shape(font, buf, feature, feature ? 1 : 0);
+  hash = shaper_cache_hash(p, (unsigned int)len);
 
-  if (feature)
+  cluster = shaper_cache_lookup(cache, hash, coverage, p, (unsigned int)len);
+  if (!cluster)
   {
-    hb_buffer_t* hb_buf = metrics->globals->hb_buf;
-
-    unsigned int gcount;
-    hb_glyph_info_t* ginfo;
+    shaper_shape(globals->hb_font, buf->hb_buf, p, len, feature);
 
-    unsigned int hb_gcount;
-    hb_glyph_info_t* hb_ginfo;
+    if (feature)
+    {
+      TA_ShaperCluster plain;
+      hb_buffer_t* hb_buf = globals->hb_buf;
 
+      unsigned int gcount;
+      hb_glyph_info_t* ginfo;
 
-    /* we have to check whether applying a feature does actually change */
-    /* glyph indices; otherwise the affected glyph or glyphs aren't */
-    /* available at all in the feature */
+      unsigned int plain_gcount;
+      hb_glyph_info_t* plain_ginfo = NULL;
 
-    hb_buffer_clear_contents(hb_buf);
-    hb_buffer_add_utf8(hb_buf, p, len, 0, len);
-    hb_buffer_guess_segment_properties(hb_buf);
-    hb_shape(font, hb_buf, NULL, 0);
 
-    ginfo = hb_buffer_get_glyph_infos(buf, &gcount);
-    hb_ginfo = hb_buffer_get_glyph_infos(hb_buf, &hb_gcount);
+      /* we have to check whether applying a feature does actually */
+      /* change glyph indices; otherwise the affected glyph or glyphs */
+      /* aren't available at all in the feature -- the result without */
+      /* feature is cached, too, since other styles need it also */
 
-    if (gcount == hb_gcount)
-    {
-      unsigned int i;
+      plain = shaper_cache_lookup(cache,
+                                  hash,
+                                  TA_COVERAGE_DEFAULT,
+                                  p,
+                                  (unsigned int)len);
+      if (!plain)
+      {
+        shaper_shape(globals->hb_font, hb_buf, p, len, NULL);
+        plain = shaper_cache_insert(cache,
+                                    hash,
+                                    TA_COVERAGE_DEFAULT,
+                                    p,
+                                    (unsigned int)len,
+                                    hb_buf);
+      }
 
+      if (plain)
+        plain_gcount = plain->count;
+      else
+        plain_ginfo = hb_buffer_get_glyph_infos(hb_buf, &plain_gcount);
 
-      for (i = 0; i < gcount; i++)
-        if (ginfo[i].codepoint != hb_ginfo[i].codepoint)
-          break;
+      ginfo = hb_buffer_get_glyph_infos(buf->hb_buf, &gcount);
 
-      if (i == gcount)
+      if (gcount == plain_gcount)
       {
-        /* both buffers have identical glyph indices */
-        hb_buffer_clear_contents(buf);
+        unsigned int i;
+
+
+        for (i = 0; i < gcount; i++)
+          if (ginfo[i].codepoint != (plain ? plain->elems[i].glyph_index
+                                           : plain_ginfo[i].codepoint))
+            break;
+
+        if (i == gcount)
+        {
+          /* both buffers have identical glyph indices */
+          hb_buffer_clear_contents(buf->hb_buf);
+        }
       }
     }
+
+    cluster = shaper_cache_insert(cache,
+                                  hash,
+                                  coverage,
+                                  p,
+                                  (unsigned int)len,
+                                  buf->hb_buf);
   }
 
-  *count = hb_buffer_get_length(buf);
+  buf->cluster = cluster;
+  *count = cluster ? cluster->count
+                   : hb_buffer_get_length(buf->hb_buf);
 
 #ifdef TA_DEBUG
   if (feature && *count > 1)
@@ -536,26 +998,46 @@ ta_shaper_get_elem(TA_StyleMetrics metrics,
                    FT_Long* advance,
                    FT_Long* y_offset)
 {
-  hb_buffer_t* buf = (hb_buffer_t*)buf_;
-  hb_glyph_info_t* ginfo;
-  hb_glyph_position_t* gpos;
-  unsigned int gcount;
+  TA_ShaperBuf buf = (TA_ShaperBuf)buf_;
+  TA_ShaperCluster cluster;
 
   FT_UNUSED(metrics);
 
 
-  ginfo = hb_buffer_get_glyph_infos(buf, &gcount);
-  gpos = hb_buffer_get_glyph_positions(buf, &gcount);
+  if (!buf)
+    return 0;
+
+  cluster = buf->cluster;
+  if (!cluster)
+  {
+    hb_glyph_info_t* ginfo;
+    hb_glyph_position_t* gpos;
+    unsigned int gcount;
+
+
+    ginfo = hb_buffer_get_glyph_infos(buf->hb_buf, &gcount);
+    gpos = hb_buffer_get_glyph_positions(buf->hb_buf, &gcount);
+
+    if (idx >= gcount)
+      return 0;
+
+    if (advance)
+      *advance = gpos[idx].x_advance;
+    if (y_offset)
+      *y_offset = gpos[idx].y_offset;
+
+    return ginfo[idx].codepoint;
+  }
 
-  if (idx >= gcount)
+  if (idx >= cluster->count)
     return 0;
 
   if (advance)
-    *advance = gpos[idx].x_advance;
+    *advance = cluster->elems[idx].x_advance;
   if (y_offset)
-    *y_offset = gpos[idx].y_offset;
+    *y_offset = cluster->elems[idx].y_offset;
 
-  return ginfo[idx].codepoint;
+  return cluster->elems[idx].glyph_index;
 }
 
 /* end of tashaper.c */
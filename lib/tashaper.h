@@ -43,6 +43,13 @@ ta_shaper_get_coverage(TA_FaceGlobals globals,
                        FT_UInt* sample_glyph,
                        FT_Bool default_script);
 
+FT_Error
+ta_shaper_cache_new(TA_FaceGlobals globals,
+                    TA_ShaperCache* acache);
+
+void
+ta_shaper_cache_done(TA_ShaperCache cache);
+
 void*
 ta_shaper_buf_create(FT_Face face);
 
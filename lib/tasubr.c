@@ -0,0 +1,830 @@
+/* tasubr.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Extraction of subroutines shared by glyph programs.
+ *
+ * Related glyphs often get identical bytecode sequences, for example, the
+ * same hints records for stems they have in common, or complete programs
+ * for glyphs that differ only in their style.  After all glyphs have been
+ * hinted, we collect instruction sequences that occur in more than one
+ * glyph program.  Starting with the most profitable one, a sequence gets
+ * moved into a new function appended to the `fpgm' table (numbered after
+ * the `bci_*' functions), and all its occurrences are replaced with a
+ * call to this function.
+ *
+ * Only sequences that start and end at instruction boundaries and contain
+ * complete `IF'-`ELSE'-`EIF' clauses can be moved; since a function uses
+ * the same stack as its caller, the semantics of the bytecode doesn't
+ * change.  Function calls add a nesting level, which is not a problem
+ * since glyph programs call `bci_*' functions only a few levels deep.
+ *
+ * The `fpgm' table never gets larger than 0xFFFF bytes, the maximum value
+ * of `maxSizeOfInstructions' in the `maxp' table.
+ */
+
+
+#include "ta.h"
+
+
+/* shorter sequences never pay off */
+#define SUBR_MIN_LEN 8
+
+/* we don't consider sequences with more instructions */
+#define SUBR_MAX_INSTRUCTIONS 128
+
+/* function indices get pushed as signed words */
+#define SUBR_MAX_INDEX 0x7FFF
+
+/* the size of a program must fit into `maxSizeOfInstructions' */
+#define SUBR_MAX_FPGM_LEN 0xFFFF
+
+/* limits of the bit arrays to filter out unique sequences */
+#define SUBR_MIN_SEEN_BITS (1UL << 16)
+#define SUBR_MAX_SEEN_BITS (1UL << 25)
+
+
+typedef struct Subr_Candidate_
+{
+  FT_ULong hash;
+  FT_ULong len;
+
+  /* the first occurrence in the unmodified bytecode */
+  FT_UShort glyph_idx;
+  FT_ULong offset;
+
+  /* the glyphs containing the sequence */
+  FT_UShort num_glyphs;
+  FT_UShort last_glyph_idx;
+  FT_UInt glyph_list; /* index into `Subr.glyph_list' plus 1; 0 if none */
+
+  FT_Long profit; /* estimated */
+} Subr_Candidate;
+
+
+typedef struct Subr_Glyph_List_
+{
+  FT_UShort glyph_idx;
+  FT_UInt next; /* index plus 1; 0 if none */
+} Subr_Glyph_List;
+
+
+typedef struct Subr_
+{
+  glyf_Data* data;
+
+  /* the bytecode of the glyphs before any replacement */
+  FT_Byte** orig_bufs;
+
+  Subr_Candidate* candidates;
+  FT_UInt num_candidates;
+  FT_UInt max_candidates;
+
+  /* open addressing; index into `candidates' plus 1, 0 if empty */
+  FT_UInt* hash_table;
+  FT_UInt hash_size; /* a power of 2 */
+
+  Subr_Glyph_List* glyph_list;
+  FT_UInt num_glyph_list;
+  FT_UInt max_glyph_list;
+
+  /* bit arrays indexed by the hash value of a sequence, marking hash */
+  /* values seen at least once and twice, respectively; a first pass */
+  /* fills them so that the second pass can skip sequences that */
+  /* occur only once (hash collisions merely weaken this filter) */
+  FT_Byte* seen;
+  FT_Byte* seen_twice;
+  FT_ULong seen_mask; /* number of bits minus 1 */
+
+  /* the new functions */
+  FT_Byte* fdefs;
+  FT_ULong fdefs_len;
+  FT_ULong fdefs_size;
+} Subr;
+
+
+/* return zero if the instruction at `p' is truncated */
+
+static FT_ULong
+TA_subr_instruction_len(FT_Byte* p,
+                        FT_Byte* endp)
+{
+  FT_ULong len;
+
+
+  if (*p == NPUSHB || *p == NPUSHW)
+  {
+    if (p + 1 >= endp)
+      return 0;
+    len = 2 + (FT_ULong)p[1] * (*p == NPUSHW ? 2 : 1);
+  }
+  else if (*p >= PUSHB_1 && *p <= PUSHB_8)
+    len = 1 + (FT_ULong)(*p - PUSHB_1 + 1);
+  else if (*p >= PUSHW_1 && *p <= PUSHW_8)
+    len = 1 + 2 * (FT_ULong)(*p - PUSHW_1 + 1);
+  else
+    len = 1;
+
+  if (len > (FT_ULong)(endp - p))
+    return 0;
+
+  return len;
+}
+
+
+static FT_Byte*
+TA_subr_candidate_bytes(Subr* subr,
+                        Subr_Candidate* candidate)
+{
+  return subr->orig_bufs[candidate->glyph_idx] + candidate->offset;
+}
+
+
+static FT_Error
+TA_subr_grow_hash_table(Subr* subr)
+{
+  FT_UInt new_size = subr->hash_size ? 2 * subr->hash_size : 1024;
+  FT_UInt* new_table;
+  FT_UInt i;
+
+
+  new_table = (FT_UInt*)ta_calloc(new_size, sizeof (FT_UInt));
+  if (!new_table)
+    return FT_Err_Out_Of_Memory;
+
+  for (i = 0; i < subr->num_candidates; i++)
+  {
+    FT_UInt j = subr->candidates[i].hash & (new_size - 1);
+
+
+    while (new_table[j])
+      j = (j + 1) & (new_size - 1);
+    new_table[j] = i + 1;
+  }
+
+  ta_free(subr->hash_table);
+  subr->hash_table = new_table;
+  subr->hash_size = new_size;
+
+  return FT_Err_Ok;
+}
+
+
+/* register the sequence at `offset' in glyph `glyph_idx' */
+
+static FT_Error
+TA_subr_add_occurrence(Subr* subr,
+                       FT_ULong hash,
+                       FT_UShort glyph_idx,
+                       FT_ULong offset,
+                       FT_ULong len)
+{
+  FT_Byte* seq = subr->orig_bufs[glyph_idx] + offset;
+  Subr_Candidate* candidate;
+  FT_UInt j;
+  FT_Error error;
+
+
+  if (2 * (subr->num_candidates + 1) > subr->hash_size)
+  {
+    error = TA_subr_grow_hash_table(subr);
+    if (error)
+      return error;
+  }
+
+  for (j = hash & (subr->hash_size - 1);
+       subr->hash_table[j];
+       j = (j + 1) & (subr->hash_size - 1))
+  {
+    candidate = &subr->candidates[subr->hash_table[j] - 1];
+
+    if (candidate->hash == hash
+        && candidate->len == len
+        && !memcmp(TA_subr_candidate_bytes(subr, candidate), seq, len))
+      break;
+  }
+
+  if (subr->hash_table[j])
+  {
+    if (candidate->last_glyph_idx == glyph_idx)
+      return FT_Err_Ok;
+  }
+  else
+  {
+    if (subr->num_candidates == subr->max_candidates)
+    {
+      FT_UInt new_max = 2 * subr->max_candidates + 256;
+      Subr_Candidate* new_candidates;
+
+
+      new_candidates = (Subr_Candidate*)ta_realloc(subr->candidates,
+                                                   new_max
+                                                   * sizeof (Subr_Candidate));
+      if (!new_candidates)
+        return FT_Err_Out_Of_Memory;
+
+      subr->candidates = new_candidates;
+      subr->max_candidates = new_max;
+    }
+
+    subr->hash_table[j] = ++subr->num_candidates;
+
+    candidate = &subr->candidates[subr->num_candidates - 1];
+    candidate->hash = hash;
+    candidate->len = len;
+    candidate->glyph_idx = glyph_idx;
+    candidate->offset = offset;
+    candidate->num_glyphs = 0;
+    candidate->glyph_list = 0;
+    candidate->profit = 0;
+  }
+
+  /* prepend glyph to the candidate's glyph list */
+  if (subr->num_glyph_list == subr->max_glyph_list)
+  {
+    FT_UInt new_max = 2 * subr->max_glyph_list + 256;
+    Subr_Glyph_List* new_glyph_list;
+
+
+    new_glyph_list = (Subr_Glyph_List*)ta_realloc(subr->glyph_list,
+                                                  new_max
+                                                  * sizeof (Subr_Glyph_List));
+    if (!new_glyph_list)
+      return FT_Err_Out_Of_Memory;
+
+    subr->glyph_list = new_glyph_list;
+    subr->max_glyph_list = new_max;
+  }
+
+  subr->glyph_list[subr->num_glyph_list].glyph_idx = glyph_idx;
+  subr->glyph_list[subr->num_glyph_list].next = candidate->glyph_list;
+  candidate->glyph_list = ++subr->num_glyph_list;
+
+  candidate->num_glyphs++;
+  candidate->last_glyph_idx = glyph_idx;
+
+  return FT_Err_Ok;
+}
+
+
+/*
+ * Collect all sequences of a glyph program that can be moved.  If
+ * `count_only' is set, only mark their hash values in the `seen' bit
+ * arrays; otherwise, register sequences whose hash values have been seen
+ * at least twice.
+ */
+
+static FT_Error
+TA_subr_collect_glyph(Subr* subr,
+                      FT_UShort glyph_idx,
+                      FT_Bool count_only,
+                      FT_ULong** offsets,
+                      FT_ULong* max_offsets)
+{
+  FT_Byte* buf = subr->orig_bufs[glyph_idx];
+  FT_ULong len = subr->data->glyphs[glyph_idx].ins_len;
+
+  FT_ULong num_instructions;
+  FT_ULong pos;
+  FT_ULong s, e;
+  FT_Error error;
+
+
+  /* get instruction boundaries, */
+  /* with an additional element for the end of the bytecode */
+  num_instructions = 0;
+  pos = 0;
+  for (;;)
+  {
+    if (num_instructions == *max_offsets)
+    {
+      FT_ULong new_max = 2 * *max_offsets + 64;
+      FT_ULong* new_offsets;
+
+
+      new_offsets = (FT_ULong*)ta_realloc(*offsets,
+                                          new_max * sizeof (FT_ULong));
+      if (!new_offsets)
+        return FT_Err_Out_Of_Memory;
+
+      *offsets = new_offsets;
+      *max_offsets = new_max;
+    }
+
+    (*offsets)[num_instructions] = pos;
+    if (pos == len)
+      break;
+
+    num_instructions++;
+
+    pos += TA_subr_instruction_len(buf + pos, buf + len);
+    if (pos == (*offsets)[num_instructions - 1])
+      return FT_Err_Ok; /* truncated instruction; ignore glyph */
+  }
+
+  for (s = 0; s < num_instructions; s++)
+  {
+    /* FNV-1a */
+    FT_UInt32 hash = 0x811C9DC5UL;
+    FT_UInt depth = 0;
+
+
+    for (e = s;
+         e < num_instructions && e - s < SUBR_MAX_INSTRUCTIONS;
+         e++)
+    {
+      FT_Byte opcode = buf[(*offsets)[e]];
+      FT_ULong seq_len;
+      FT_ULong bit;
+      FT_Byte mask;
+      FT_ULong i;
+
+
+      if (opcode == FDEF
+          || opcode == ENDF
+          || opcode == IDEF
+          || opcode == JMPR
+          || opcode == JROT
+          || opcode == JROF)
+        break;
+
+      /* don't separate a function call from its index; */
+      /* otherwise, sequences starting with the `CALL' */
+      /* of an inserted function call could be extracted, */
+      /* increasing the nesting depth of function calls */
+      if (e == s && (opcode == CALL || opcode == LOOPCALL))
+        break;
+
+      if (opcode == IF)
+        depth++;
+      else if (opcode == ELSE)
+      {
+        if (!depth)
+          break;
+      }
+      else if (opcode == EIF)
+      {
+        if (!depth)
+          break;
+        depth--;
+      }
+
+      for (i = (*offsets)[e]; i < (*offsets)[e + 1]; i++)
+        hash = (hash ^ buf[i]) * 0x01000193UL;
+
+      seq_len = (*offsets)[e + 1] - (*offsets)[s];
+      if (depth || seq_len < SUBR_MIN_LEN)
+        continue;
+
+      bit = hash & subr->seen_mask;
+      mask = (FT_Byte)(1 << (bit & 7));
+
+      if (count_only)
+      {
+        if (subr->seen[bit >> 3] & mask)
+          subr->seen_twice[bit >> 3] |= mask;
+        else
+          subr->seen[bit >> 3] |= mask;
+        continue;
+      }
+
+      if (!(subr->seen_twice[bit >> 3] & mask))
+        continue;
+
+      error = TA_subr_add_occurrence(subr, hash, glyph_idx,
+                                     (*offsets)[s], seq_len);
+      if (error)
+        return error;
+    }
+  }
+
+  return FT_Err_Ok;
+}
+
+
+/*
+ * Return the number of non-overlapping occurrences of `seq' at
+ * instruction boundaries of glyph program `buf'; if `call' is not NULL,
+ * also replace them with `call', storing the result in `out'.
+ */
+
+static FT_ULong
+TA_subr_scan(FT_Byte* buf,
+             FT_ULong len,
+             FT_Byte* seq,
+             FT_ULong seq_len,
+             FT_Byte* call,
+             FT_ULong call_len,
+             FT_Byte* out)
+{
+  FT_Byte* p = buf;
+  FT_Byte* endp = buf + len;
+  FT_ULong count = 0;
+
+
+  while (p < endp)
+  {
+    FT_ULong ins_len;
+
+
+    /* the sequence consists of complete instructions, */
+    /* thus a match ends at an instruction boundary also */
+    if ((FT_ULong)(endp - p) >= seq_len
+        && !memcmp(p, seq, seq_len))
+    {
+      if (call)
+      {
+        memcpy(out, call, call_len);
+        out += call_len;
+      }
+
+      p += seq_len;
+      count++;
+      continue;
+    }
+
+    ins_len = TA_subr_instruction_len(p, endp);
+    if (!ins_len)
+      ins_len = (FT_ULong)(endp - p);
+
+    if (call)
+    {
+      memcpy(out, p, ins_len);
+      out += ins_len;
+    }
+
+    p += ins_len;
+  }
+
+  return count;
+}
+
+
+static int
+TA_subr_candidate_compare(const void* a,
+                          const void* b)
+{
+  const Subr_Candidate* candidate1 = (const Subr_Candidate*)a;
+  const Subr_Candidate* candidate2 = (const Subr_Candidate*)b;
+
+
+  /* most profitable first */
+  if (candidate1->profit != candidate2->profit)
+    return candidate1->profit > candidate2->profit ? -1 : 1;
+  if (candidate1->len != candidate2->len)
+    return candidate1->len > candidate2->len ? -1 : 1;
+
+  /* make the order unique */
+  if (candidate1->glyph_idx != candidate2->glyph_idx)
+    return (int)candidate1->glyph_idx - (int)candidate2->glyph_idx;
+  if (candidate1->offset != candidate2->offset)
+    return candidate1->offset < candidate2->offset ? -1 : 1;
+
+  return 0;
+}
+
+
+/*
+ * Move `candidate' into function `func_idx' if profitable and if the new
+ * functions don't get larger than `max_fdefs_len'.
+ */
+
+static FT_Error
+TA_subr_extract(Subr* subr,
+                Subr_Candidate* candidate,
+                FT_UInt func_idx,
+                FT_ULong max_fdefs_len,
+                FT_Long* saved)
+{
+  glyf_Data* data = subr->data;
+  FT_Byte* seq = TA_subr_candidate_bytes(subr, candidate);
+
+  FT_Byte call[4];
+  FT_ULong call_len;
+  FT_ULong count;
+  FT_Long profit;
+  FT_UInt l;
+
+  FT_Byte* bufp;
+
+
+  *saved = 0;
+
+  if (func_idx > 0xFF)
+  {
+    call[0] = PUSHW_1;
+    call[1] = HIGH(func_idx);
+    call[2] = LOW(func_idx);
+    call[3] = CALL;
+    call_len = 4;
+  }
+  else
+  {
+    call[0] = PUSHB_1;
+    call[1] = (FT_Byte)func_idx;
+    call[2] = CALL;
+    call_len = 3;
+  }
+
+  /* earlier extractions might have removed occurrences */
+  count = 0;
+  for (l = candidate->glyph_list; l; l = subr->glyph_list[l - 1].next)
+  {
+    GLYPH* glyph = &data->glyphs[subr->glyph_list[l - 1].glyph_idx];
+
+
+    count += TA_subr_scan(glyph->ins_buf, glyph->ins_len,
+                          seq, candidate->len,
+                          NULL, 0, NULL);
+  }
+
+  /* the function definition needs the function index, */
+  /* `FDEF', and `ENDF' in addition to the sequence */
+  profit = (FT_Long)(count * (candidate->len - call_len))
+           - (FT_Long)(candidate->len + call_len + 1);
+  if (profit <= 0)
+    return FT_Err_Ok;
+
+  if (subr->fdefs_len + candidate->len + call_len + 1 > max_fdefs_len)
+    return FT_Err_Ok;
+
+  /* append function */
+  if (subr->fdefs_len + candidate->len + call_len + 1 > subr->fdefs_size)
+  {
+    FT_ULong new_size = 2 * subr->fdefs_size
+                        + candidate->len + call_len + 1;
+    FT_Byte* new_fdefs;
+
+
+    new_fdefs = (FT_Byte*)ta_realloc(subr->fdefs, new_size);
+    if (!new_fdefs)
+      return FT_Err_Out_Of_Memory;
+
+    subr->fdefs = new_fdefs;
+    subr->fdefs_size = new_size;
+  }
+
+  bufp = subr->fdefs + subr->fdefs_len;
+
+  memcpy(bufp, call, call_len - 1);
+  bufp += call_len - 1;
+  BCI(FDEF);
+  memcpy(bufp, seq, candidate->len);
+  bufp += candidate->len;
+  BCI(ENDF);
+
+  subr->fdefs_len = (FT_ULong)(bufp - subr->fdefs);
+
+  /* replace occurrences */
+  for (l = candidate->glyph_list; l; l = subr->glyph_list[l - 1].next)
+  {
+    FT_UShort glyph_idx = subr->glyph_list[l - 1].glyph_idx;
+    GLYPH* glyph = &data->glyphs[glyph_idx];
+    FT_Byte* ins_buf;
+    FT_ULong ins_len;
+
+
+    /* a replacement never enlarges the bytecode */
+    ins_buf = (FT_Byte*)ta_malloc(glyph->ins_len);
+    if (!ins_buf)
+      return FT_Err_Out_Of_Memory;
+
+    count = TA_subr_scan(glyph->ins_buf, glyph->ins_len,
+                         seq, candidate->len,
+                         call, call_len, ins_buf);
+    if (!count)
+    {
+      ta_free(ins_buf);
+      continue;
+    }
+
+    ins_len = glyph->ins_len - count * (candidate->len - call_len);
+
+    /* the unmodified bytecode is still needed */
+    /* to access the sequences of other candidates */
+    if (glyph->ins_buf != subr->orig_bufs[glyph_idx])
+      ta_free(glyph->ins_buf);
+
+    glyph->ins_buf = ins_buf;
+    glyph->ins_len = ins_len;
+  }
+
+  *saved = profit;
+
+  return FT_Err_Ok;
+}
+
+
+/*
+ * Move instruction sequences shared by several glyph programs into new
+ * `fpgm' functions.  This must be called after all glyphs have been
+ * hinted.
+ */
+
+FT_Error
+TA_sfnt_extract_subroutines(SFNT* sfnt,
+                            FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  SFNT_Table* fpgm_table;
+
+  Subr subr;
+  FT_UInt num_candidates;
+
+  FT_ULong* offsets = NULL;
+  FT_ULong max_offsets = 0;
+
+  FT_UInt num_subroutines = 0;
+  FT_Long saved = 0;
+  FT_ULong total_len;
+  FT_ULong max_fdefs_len;
+  FT_UShort i;
+  FT_UInt j;
+  FT_Error error;
+
+
+  if (data->fpgm_idx == MISSING)
+    return FT_Err_Ok;
+  fpgm_table = &font->tables[data->fpgm_idx];
+
+  if (fpgm_table->len >= SUBR_MAX_FPGM_LEN)
+    return FT_Err_Ok;
+  max_fdefs_len = SUBR_MAX_FPGM_LEN - fpgm_table->len;
+
+  memset(&subr, 0, sizeof (subr));
+  subr.data = data;
+
+  subr.orig_bufs = (FT_Byte**)ta_malloc(data->num_glyphs * sizeof (FT_Byte*));
+  if (!subr.orig_bufs)
+    return FT_Err_Out_Of_Memory;
+  for (i = 0; i < data->num_glyphs; i++)
+    subr.orig_bufs[i] = data->glyphs[i].ins_buf;
+
+  /* the number of sequences is roughly proportional to the bytecode size */
+  total_len = 0;
+  for (i = 0; i < data->num_glyphs; i++)
+    total_len += data->glyphs[i].ins_len;
+
+  subr.seen_mask = SUBR_MIN_SEEN_BITS;
+  while (subr.seen_mask < SUBR_MAX_SEEN_BITS
+         && subr.seen_mask < 16 * total_len)
+    subr.seen_mask *= 2;
+
+  subr.seen = (FT_Byte*)ta_calloc(subr.seen_mask / 8, 1);
+  subr.seen_twice = (FT_Byte*)ta_calloc(subr.seen_mask / 8, 1);
+  if (!(subr.seen && subr.seen_twice))
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+  subr.seen_mask--;
+
+  /* first pass: count */
+  for (i = 0; i < data->num_glyphs; i++)
+  {
+    if (data->glyphs[i].ins_len < SUBR_MIN_LEN)
+      continue;
+
+    error = TA_subr_collect_glyph(&subr, i, 1, &offsets, &max_offsets);
+    if (error)
+      goto Exit;
+  }
+
+  /* second pass: collect sequences not known to be unique */
+  for (i = 0; i < data->num_glyphs; i++)
+  {
+    if (data->glyphs[i].ins_len < SUBR_MIN_LEN)
+      continue;
+
+    error = TA_subr_collect_glyph(&subr, i, 0, &offsets, &max_offsets);
+    if (error)
+      goto Exit;
+  }
+
+  /* we don't need the hash table and the bit arrays any more; */
+  /* keep only candidates that might pay off, sorted by profit */
+  ta_free(subr.hash_table);
+  subr.hash_table = NULL;
+  ta_free(subr.seen);
+  subr.seen = NULL;
+  ta_free(subr.seen_twice);
+  subr.seen_twice = NULL;
+
+  num_candidates = 0;
+  for (j = 0; j < subr.num_candidates; j++)
+  {
+    Subr_Candidate* candidate = &subr.candidates[j];
+
+
+    if (candidate->num_glyphs < 2)
+      continue;
+
+    candidate->profit = (FT_Long)(candidate->num_glyphs
+                                  * (candidate->len - 3))
+                        - (FT_Long)(candidate->len + 4);
+    if (candidate->profit > 0)
+      subr.candidates[num_candidates++] = *candidate;
+  }
+
+  qsort(subr.candidates, num_candidates, sizeof (Subr_Candidate),
+        TA_subr_candidate_compare);
+
+  for (j = 0; j < num_candidates; j++)
+  {
+    FT_UInt func_idx = NUM_FDEFS + data->num_subroutines + num_subroutines;
+    FT_Long profit;
+
+
+    if (func_idx > SUBR_MAX_INDEX)
+      break;
+
+    error = TA_subr_extract(&subr, &subr.candidates[j], func_idx,
+                            max_fdefs_len, &profit);
+    if (error)
+      goto Exit;
+
+    if (profit)
+    {
+      num_subroutines++;
+      saved += profit;
+    }
+  }
+
+  if (num_subroutines)
+  {
+    FT_Byte* fpgm_buf_new;
+    FT_ULong fpgm_len_new = fpgm_table->len + subr.fdefs_len;
+    FT_ULong len;
+
+
+    /* `max_fdefs_len' should prevent this */
+    if (fpgm_len_new > SUBR_MAX_FPGM_LEN)
+    {
+      error = TA_Err_Hinter_Overflow;
+      goto Exit;
+    }
+
+    /* buffer length must be a multiple of four */
+    len = (fpgm_len_new + 3) & ~3U;
+    fpgm_buf_new = (FT_Byte*)ta_realloc(fpgm_table->buf, len);
+    if (!fpgm_buf_new)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Exit;
+    }
+
+    memcpy(fpgm_buf_new + fpgm_table->len, subr.fdefs, subr.fdefs_len);
+
+    /* pad end of buffer with zeros */
+    memset(fpgm_buf_new + fpgm_len_new, 0, len - fpgm_len_new);
+
+    fpgm_table->buf = fpgm_buf_new;
+    fpgm_table->len = fpgm_len_new;
+    fpgm_table->checksum = TA_table_compute_checksum(fpgm_table->buf,
+                                                     fpgm_table->len);
+
+    if (fpgm_len_new > sfnt->max_instructions)
+      sfnt->max_instructions = (FT_UShort)fpgm_len_new;
+
+    data->num_subroutines += num_subroutines;
+  }
+
+  if (font->debug)
+    fprintf(stderr, "%u shared instruction sequence%s of subfont %ld"
+                    " moved to `fpgm', saving %ld bytes\n"
+                    "\n",
+                    num_subroutines, num_subroutines == 1 ? "" : "s",
+                    sfnt->face->face_index,
+                    saved);
+
+  error = FT_Err_Ok;
+
+Exit:
+  for (i = 0; i < data->num_glyphs; i++)
+    if (data->glyphs[i].ins_buf != subr.orig_bufs[i])
+      ta_free(subr.orig_bufs[i]);
+
+  ta_free(subr.orig_bufs);
+  ta_free(subr.candidates);
+  ta_free(subr.hash_table);
+  ta_free(subr.glyph_list);
+  ta_free(subr.fdefs);
+  ta_free(offsets);
+
+  return error;
+}
+
+/* end of tasubr.c */
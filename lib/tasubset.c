@@ -0,0 +1,880 @@
+/* tasubset.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Support for option `glyph-subset': instead of hinting all glyphs, we
+ * only regenerate the bytecode of selected glyphs and copy everything else
+ * from a font previously created by ttfautohint.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ta.h"
+
+
+/* the third field of control instruction lines that affect single glyphs */
+static const char* glyph_control_keywords[] =
+{
+  "touch",
+  "point",
+  "left",
+  "right",
+  "nodir",
+  NULL
+};
+
+
+/* lines of a `TTFA' table, split into global and glyph-specific data */
+typedef struct TTFA_Lines_
+{
+  char** global;
+  size_t num_global;
+
+  char** glyph;
+  size_t num_glyph;
+} TTFA_Lines;
+
+
+static FT_Bool
+TA_is_glyph_control_line(const char* s)
+{
+  const char** kw;
+  size_t len;
+  int i;
+
+
+  /* skip font index and glyph name or index */
+  for (i = 0; i < 2; i++)
+  {
+    s += strcspn(s, " ");
+    s += strspn(s, " ");
+  }
+
+  len = strcspn(s, " ");
+  for (kw = glyph_control_keywords; *kw; kw++)
+    if (len == strlen(*kw) && !strncmp(s, *kw, len))
+      return 1;
+
+  return 0;
+}
+
+
+/*
+ * Split the data of a `TTFA' table (as created by
+ * `TA_font_dump_parameters') into lines, modifying `buf'.  Control
+ * instructions get normalized by removing the indentation and the trailing
+ * `; \' continuation marker.
+ */
+
+static FT_Error
+TA_TTFA_split(char* buf,
+              TTFA_Lines* lines)
+{
+  char* token;
+  char* saveptr;
+  size_t num_lines;
+  char* p;
+
+
+  num_lines = 1;
+  for (p = buf; *p; p++)
+    if (*p == '\n')
+      num_lines++;
+
+  lines->global = (char**)ta_malloc(num_lines * sizeof (char*));
+  lines->glyph = (char**)ta_malloc(num_lines * sizeof (char*));
+  lines->num_global = 0;
+  lines->num_glyph = 0;
+  if (!lines->global || !lines->glyph)
+    return FT_Err_Out_Of_Memory;
+
+  for (token = strtok_r(buf, "\n", &saveptr);
+       token;
+       token = strtok_r(NULL, "\n", &saveptr))
+  {
+    size_t len;
+
+
+    /* the header line of control instructions is not significant */
+    if (!strncmp(token, "control-instructions =", 22))
+      continue;
+
+    if (*token != ' ')
+    {
+      lines->global[lines->num_global++] = token;
+      continue;
+    }
+
+    token += strspn(token, " ");
+    len = strlen(token);
+    if (len >= 3 && !strcmp(token + len - 3, "; \\"))
+      token[len - 3] = '\0';
+
+    if (TA_is_glyph_control_line(token))
+      lines->glyph[lines->num_glyph++] = token;
+    else
+      lines->global[lines->num_global++] = token;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static int
+TA_line_compare(const void* a,
+                const void* b)
+{
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+
+static int
+TA_glyph_index_compare(const void* a,
+                       const void* b)
+{
+  return *(const long*)a < *(const long*)b
+           ? -1
+           : *(const long*)a > *(const long*)b;
+}
+
+
+/* get the glyph index of a glyph-specific control instruction line */
+
+static FT_Error
+TA_font_get_control_glyph(FONT* font,
+                          const char* s,
+                          long* glyph_idx)
+{
+  long font_idx;
+  long idx;
+  char* endp;
+
+
+  font_idx = strtol(s, &endp, 10);
+  if (endp == s
+      || font_idx < 0
+      || font_idx >= font->num_sfnts)
+    return TA_Err_Previous_Font_Mismatch;
+
+  s = endp + strspn(endp, " ");
+
+  idx = strtol(s, &endp, 10);
+  if (endp == s || *endp != ' ')
+  {
+    char glyph_name[64];
+    size_t len = strcspn(s, " ");
+
+
+    if (len >= sizeof (glyph_name))
+      return TA_Err_Previous_Font_Mismatch;
+    memcpy(glyph_name, s, len);
+    glyph_name[len] = '\0';
+
+    idx = (long)FT_Get_Name_Index(font->sfnts[font_idx].face, glyph_name);
+    if (!idx && strcmp(glyph_name, ".notdef"))
+      return TA_Err_Previous_Font_Mismatch;
+  }
+
+  if (idx < 0 || idx > 0xFFFF)
+    return TA_Err_Previous_Font_Mismatch;
+
+  *glyph_idx = idx;
+
+  return TA_Err_Ok;
+}
+
+
+/*
+ * Compare the parameters stored in the `TTFA' table of the previous font
+ * with the current ones.  Everything except glyph-specific control
+ * instructions must be identical; the glyphs affected by changed
+ * control instructions are collected in `font->glyph_subset_control'.
+ */
+
+FT_Error
+TA_font_check_previous_TTFA(FONT* font)
+{
+  FT_Face previous = font->sfnts[0].previous;
+  FT_Error error;
+
+  FT_ULong TTFA_len = 0;
+  char* previous_TTFA = NULL;
+  char* current_TTFA = NULL;
+
+  TTFA_Lines previous_lines = { NULL, 0, NULL, 0 };
+  TTFA_Lines current_lines = { NULL, 0, NULL, 0 };
+
+  long* glyph_indices = NULL;
+  size_t num_glyph_indices = 0;
+  size_t i, j;
+
+  number_range* glyph_subset_control = NULL;
+
+
+  /* in TTCs, the `TTFA' table is attached to the first subfont */
+  error = FT_Load_Sfnt_Table(previous, TTAG_TTFA, 0, NULL, &TTFA_len);
+  if (error)
+    return TA_Err_Invalid_Previous_Font;
+
+  previous_TTFA = (char*)ta_malloc(TTFA_len + 1);
+  if (!previous_TTFA)
+    return FT_Err_Out_Of_Memory;
+
+  error = FT_Load_Sfnt_Table(previous, TTAG_TTFA, 0,
+                             (FT_Byte*)previous_TTFA, &TTFA_len);
+  if (error)
+  {
+    error = TA_Err_Invalid_Previous_Font;
+    goto Exit;
+  }
+  previous_TTFA[TTFA_len] = '\0';
+
+  current_TTFA = TA_font_dump_parameters(font, 0);
+  if (!current_TTFA)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  error = TA_TTFA_split(previous_TTFA, &previous_lines);
+  if (error)
+    goto Exit;
+  error = TA_TTFA_split(current_TTFA, &current_lines);
+  if (error)
+    goto Exit;
+
+  if (previous_lines.num_global != current_lines.num_global)
+  {
+    error = TA_Err_Previous_Font_Mismatch;
+    goto Exit;
+  }
+  for (i = 0; i < current_lines.num_global; i++)
+  {
+    if (strcmp(previous_lines.global[i], current_lines.global[i]))
+    {
+      error = TA_Err_Previous_Font_Mismatch;
+      goto Exit;
+    }
+  }
+
+  /* collect glyphs of control instructions present in only one font */
+  qsort(previous_lines.glyph, previous_lines.num_glyph, sizeof (char*),
+        TA_line_compare);
+  qsort(current_lines.glyph, current_lines.num_glyph, sizeof (char*),
+        TA_line_compare);
+
+  glyph_indices = (long*)ta_malloc((previous_lines.num_glyph
+                                    + current_lines.num_glyph + 1)
+                                   * sizeof (long));
+  if (!glyph_indices)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  i = 0;
+  j = 0;
+  while (i < previous_lines.num_glyph || j < current_lines.num_glyph)
+  {
+    const char* line;
+    int cmp;
+
+
+    if (i == previous_lines.num_glyph)
+      cmp = 1;
+    else if (j == current_lines.num_glyph)
+      cmp = -1;
+    else
+      cmp = strcmp(previous_lines.glyph[i], current_lines.glyph[j]);
+
+    if (!cmp)
+    {
+      i++;
+      j++;
+      continue;
+    }
+
+    line = (cmp < 0) ? previous_lines.glyph[i++] : current_lines.glyph[j++];
+
+    error = TA_font_get_control_glyph(font,
+                                      line,
+                                      &glyph_indices[num_glyph_indices]);
+    if (error)
+      goto Exit;
+    num_glyph_indices++;
+  }
+
+  /* `number_set_prepend' expects ascending, non-overlapping ranges */
+  qsort(glyph_indices, num_glyph_indices, sizeof (long),
+        TA_glyph_index_compare);
+
+  for (i = 0; i < num_glyph_indices; i++)
+  {
+    number_range* elem;
+
+
+    if (i && glyph_indices[i] == glyph_indices[i - 1])
+      continue;
+
+    elem = number_set_new((int)glyph_indices[i], (int)glyph_indices[i],
+                          0, 0xFFFF);
+    if (elem == NUMBERSET_ALLOCATION_ERROR)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Exit;
+    }
+    glyph_subset_control = number_set_prepend(glyph_subset_control, elem);
+  }
+
+  font->glyph_subset_control = number_set_reverse(glyph_subset_control);
+  glyph_subset_control = NULL;
+
+  error = TA_Err_Ok;
+
+Exit:
+  number_set_free(glyph_subset_control);
+  ta_free(glyph_indices);
+  ta_free(previous_lines.global);
+  ta_free(previous_lines.glyph);
+  ta_free(current_lines.global);
+  ta_free(current_lines.glyph);
+  ta_free(previous_TTFA);
+  ta_free(current_TTFA);
+
+  return error;
+}
+
+
+static FT_Error
+TA_sfnt_load_previous_table(SFNT* sfnt,
+                            FT_ULong tag,
+                            FT_Byte** buf,
+                            FT_ULong* len)
+{
+  FT_Error error;
+
+
+  *buf = NULL;
+  *len = 0;
+
+  error = FT_Load_Sfnt_Table(sfnt->previous, tag, 0, NULL, len);
+  if (error)
+    return TA_Err_Invalid_Previous_Font;
+
+  /* make `malloc' return a valid pointer even for empty tables */
+  *buf = (FT_Byte*)ta_malloc(*len + 1);
+  if (!*buf)
+    return FT_Err_Out_Of_Memory;
+
+  error = FT_Load_Sfnt_Table(sfnt->previous, tag, 0, *buf, len);
+  if (error)
+  {
+    ta_free(*buf);
+    *buf = NULL;
+    return TA_Err_Invalid_Previous_Font;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_sfnt_compare_previous_table(SFNT* sfnt,
+                               FONT* font,
+                               FT_ULong tag,
+                               FT_ULong idx)
+{
+  SFNT_Table* table;
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_Error error;
+
+
+  if (idx == MISSING)
+    return TA_Err_Previous_Font_Mismatch;
+  table = &font->tables[idx];
+
+  error = TA_sfnt_load_previous_table(sfnt, tag, &buf, &len);
+  if (error)
+    return error;
+
+  if (len != table->len
+      || memcmp(buf, table->buf, len))
+    error = TA_Err_Previous_Font_Mismatch;
+
+  ta_free(buf);
+
+  return error;
+}
+
+
+/*
+ * The previous font's `fpgm' table can contain additional functions
+ * created by `TA_sfnt_extract_subroutines'; we take them over since the
+ * reused bytecode calls them.
+ */
+
+static FT_Error
+TA_sfnt_adopt_previous_fpgm(SFNT* sfnt,
+                            FONT* font,
+                            FT_ULong idx)
+{
+  SFNT_Table* table;
+  FT_Byte* buf;
+  FT_Byte* buf_new;
+  FT_ULong len;
+  FT_Error error;
+
+
+  if (idx == MISSING)
+    return TA_Err_Previous_Font_Mismatch;
+  table = &font->tables[idx];
+
+  error = TA_sfnt_load_previous_table(sfnt, TTAG_fpgm, &buf, &len);
+  if (error)
+    return error;
+
+  if (len < table->len
+      || memcmp(buf, table->buf, table->len))
+  {
+    ta_free(buf);
+    return TA_Err_Previous_Font_Mismatch;
+  }
+
+  if (len == table->len)
+  {
+    ta_free(buf);
+    return TA_Err_Ok;
+  }
+
+  /* ttfautohint never creates larger programs */
+  if (len > 0xFFFF)
+  {
+    ta_free(buf);
+    return TA_Err_Invalid_Previous_Font;
+  }
+
+  /* buffer length must be a multiple of four */
+  buf_new = (FT_Byte*)ta_calloc(1, (len + 3) & ~3U);
+  if (!buf_new)
+  {
+    ta_free(buf);
+    return FT_Err_Out_Of_Memory;
+  }
+
+  memcpy(buf_new, buf, len);
+  ta_free(buf);
+
+  ta_free(table->buf);
+  table->buf = buf_new;
+  table->len = len;
+  table->checksum = TA_table_compute_checksum(buf_new, len);
+
+  if (len > sfnt->max_instructions)
+    sfnt->max_instructions = (FT_UShort)len;
+
+  return TA_Err_Ok;
+}
+
+
+/* get the data of glyph `idx' from the previous font's `glyf' table */
+
+static FT_Error
+TA_sfnt_get_previous_glyph(SFNT* sfnt,
+                           FT_Long idx,
+                           FT_Byte** buf,
+                           FT_ULong* len)
+{
+  FT_Byte* p;
+  FT_ULong start;
+  FT_ULong end;
+
+
+  if (sfnt->previous_long_offsets)
+  {
+    if ((FT_ULong)(idx + 2) * 4 > sfnt->previous_loca_len)
+      return TA_Err_Invalid_Previous_Font;
+
+    p = sfnt->previous_loca + idx * 4;
+    start = NEXT_ULONG(p);
+    end = NEXT_ULONG(p);
+  }
+  else
+  {
+    if ((FT_ULong)(idx + 2) * 2 > sfnt->previous_loca_len)
+      return TA_Err_Invalid_Previous_Font;
+
+    p = sfnt->previous_loca + idx * 2;
+    start = (FT_ULong)NEXT_USHORT(p) * 2;
+    end = (FT_ULong)NEXT_USHORT(p) * 2;
+  }
+
+  if (start > end
+      || end > sfnt->previous_glyf_len)
+    return TA_Err_Invalid_Previous_Font;
+
+  *buf = sfnt->previous_glyf + start;
+  *len = end - start;
+
+  return TA_Err_Ok;
+}
+
+
+/* locate the bytecode of a glyph record */
+
+static FT_Error
+TA_glyph_find_instructions(FT_Byte* buf,
+                           FT_ULong len,
+                           FT_Byte** ins_buf,
+                           FT_UShort* ins_len)
+{
+  FT_Byte* p;
+  FT_Byte* endp;
+  FT_Short num_contours;
+  FT_UShort flags;
+
+
+  *ins_buf = NULL;
+  *ins_len = 0;
+
+  /* empty glyph */
+  if (!len)
+    return TA_Err_Ok;
+
+  if (len < 10)
+    return TA_Err_Invalid_Previous_Font;
+
+  p = buf;
+  endp = buf + len;
+
+  num_contours = (FT_Short)NEXT_USHORT(p);
+  p += 8;
+
+  if (num_contours >= 0)
+  {
+    p += 2 * num_contours;
+    if (p + 2 > endp)
+      return TA_Err_Invalid_Previous_Font;
+  }
+  else
+  {
+    do
+    {
+      if (p + 4 > endp)
+        return TA_Err_Invalid_Previous_Font;
+
+      flags = NEXT_USHORT(p);
+      p += 2; /* glyph index */
+
+      p += (flags & ARGS_ARE_WORDS) ? 4 : 2;
+      if (flags & WE_HAVE_A_SCALE)
+        p += 2;
+      else if (flags & WE_HAVE_AN_XY_SCALE)
+        p += 4;
+      else if (flags & WE_HAVE_A_2X2)
+        p += 8;
+    } while (flags & MORE_COMPONENTS);
+
+    if (!(flags & WE_HAVE_INSTR))
+      return TA_Err_Ok;
+
+    if (p + 2 > endp)
+      return TA_Err_Invalid_Previous_Font;
+  }
+
+  *ins_len = NEXT_USHORT(p);
+  if (p + *ins_len > endp)
+    return TA_Err_Invalid_Previous_Font;
+
+  *ins_buf = p;
+
+  return TA_Err_Ok;
+}
+
+
+/* check whether the outline of a glyph is unchanged */
+
+static FT_Bool
+TA_sfnt_previous_outline_is_equal(SFNT* sfnt,
+                                  GLYPH* glyph,
+                                  FT_Long idx)
+{
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_Byte* ins_buf;
+  FT_UShort ins_len;
+
+
+  if (TA_sfnt_get_previous_glyph(sfnt, idx, &buf, &len))
+    return 0;
+  if (TA_glyph_find_instructions(buf, len, &ins_buf, &ins_len))
+    return 0;
+
+  if (!len)
+    return !(glyph->len1 || glyph->len2);
+
+  if (len < glyph->len1)
+    return 0;
+
+  if (glyph->num_contours < 0)
+  {
+    FT_ULong offset = glyph->flags_offset;
+
+
+    /* the previous font has flag `WE_HAVE_INSTR' set if there is */
+    /* bytecode for the composite glyph */
+    if (offset + 1 >= glyph->len1
+        || memcmp(buf, glyph->buf, offset)
+        || (buf[offset] & ~(WE_HAVE_INSTR >> 8))
+           != (glyph->buf[offset] & ~(WE_HAVE_INSTR >> 8))
+        || memcmp(buf + offset + 1,
+                  glyph->buf + offset + 1,
+                  glyph->len1 - offset - 1))
+      return 0;
+
+    return 1;
+  }
+
+  if (memcmp(buf, glyph->buf, glyph->len1))
+    return 0;
+
+  if ((FT_ULong)(ins_buf + ins_len - buf) + glyph->len2 > len
+      || memcmp(ins_buf + ins_len, glyph->buf2, glyph->len2))
+    return 0;
+
+  return 1;
+}
+
+
+/*
+ * Compare the `cvt', `fpgm', and `prep' tables with the previous font and
+ * load the previous font's glyph data.  We then decide which glyphs need
+ * new bytecode: glyphs in the subset given by the user, glyphs with
+ * changed control instructions, glyphs with a changed outline, and
+ * composite glyphs that have such glyphs as components.
+ *
+ * This must be called after the `cvt', `fpgm', and `prep' tables have been
+ * built.
+ */
+
+FT_Error
+TA_sfnt_check_previous_tables(SFNT* sfnt,
+                              FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+
+  FT_Error error;
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_UShort num_glyphs;
+  FT_UShort i;
+  FT_Bool changed;
+
+
+  error = TA_sfnt_compare_previous_table(sfnt, font,
+                                         TTAG_cvt, data->cvt_idx);
+  if (error)
+    return error;
+  error = TA_sfnt_adopt_previous_fpgm(sfnt, font, data->fpgm_idx);
+  if (error)
+    return error;
+  error = TA_sfnt_compare_previous_table(sfnt, font,
+                                         TTAG_prep, data->prep_idx);
+  if (error)
+    return error;
+
+  /* the number of glyphs must be identical, */
+  /* including a possible `.ttfautohint' glyph */
+  error = TA_sfnt_load_previous_table(sfnt, TTAG_maxp, &buf, &len);
+  if (error)
+    return error;
+  if (len != MAXP_LEN)
+  {
+    ta_free(buf);
+    return TA_Err_Invalid_Previous_Font;
+  }
+
+  num_glyphs = (FT_UShort)(buf[MAXP_NUM_GLYPHS] << 8
+                           | buf[MAXP_NUM_GLYPHS + 1]);
+  if (num_glyphs != data->num_glyphs)
+  {
+    ta_free(buf);
+    return TA_Err_Previous_Font_Mismatch;
+  }
+
+  /* copied bytecode might need larger values */
+  /* than the bytecode we are going to create */
+#define UPDATE_MAX(field, offset) \
+          do \
+          { \
+            FT_UShort val = (FT_UShort)(buf[offset] << 8 | buf[offset + 1]); \
+            \
+            \
+            if (val > sfnt->field) \
+              sfnt->field = val; \
+          } while (0)
+
+  UPDATE_MAX(max_twilight_points, MAXP_MAX_TWILIGHT_POINTS_OFFSET);
+  UPDATE_MAX(max_storage, MAXP_MAX_STORAGE_OFFSET);
+  UPDATE_MAX(max_stack_elements, MAXP_MAX_STACK_ELEMENTS_OFFSET);
+
+#undef UPDATE_MAX
+
+  /* the functions of the adopted `fpgm' table */
+  if (!data->num_subroutines)
+  {
+    FT_UShort num_fdefs =
+      (FT_UShort)(buf[MAXP_MAX_FUNCTION_DEFS_OFFSET] << 8
+                  | buf[MAXP_MAX_FUNCTION_DEFS_OFFSET + 1]);
+
+
+    if (num_fdefs > NUM_FDEFS)
+      data->num_subroutines = num_fdefs - (NUM_FDEFS);
+  }
+
+  ta_free(buf);
+
+  error = TA_sfnt_load_previous_table(sfnt, TTAG_head, &buf, &len);
+  if (error)
+    return error;
+  if (len <= LOCA_FORMAT_OFFSET)
+  {
+    ta_free(buf);
+    return TA_Err_Invalid_Previous_Font;
+  }
+  sfnt->previous_long_offsets = buf[LOCA_FORMAT_OFFSET] != 0;
+  ta_free(buf);
+
+  error = TA_sfnt_load_previous_table(sfnt, TTAG_glyf,
+                                      &sfnt->previous_glyf,
+                                      &sfnt->previous_glyf_len);
+  if (error)
+    return error;
+  error = TA_sfnt_load_previous_table(sfnt, TTAG_loca,
+                                      &sfnt->previous_loca,
+                                      &sfnt->previous_loca_len);
+  if (error)
+    return error;
+
+  sfnt->previous_rehint = (FT_Byte*)ta_calloc(data->num_glyphs, 1);
+  if (!sfnt->previous_rehint)
+    return FT_Err_Out_Of_Memory;
+
+  for (i = 0; i < data->num_glyphs; i++)
+  {
+    GLYPH* glyph = &data->glyphs[i];
+
+
+    if (number_set_is_element(font->glyph_subset, i)
+        || number_set_is_element(font->glyph_subset_control, i))
+      sfnt->previous_rehint[i] = 1;
+    else if (!TA_sfnt_previous_outline_is_equal(sfnt, glyph, i))
+      sfnt->previous_rehint[i] = 1;
+  }
+
+  /* propagate to composite glyphs, taking care of nested components */
+  do
+  {
+    changed = 0;
+
+    for (i = 0; i < data->num_glyphs; i++)
+    {
+      GLYPH* glyph = &data->glyphs[i];
+      FT_UShort j;
+
+
+      if (sfnt->previous_rehint[i])
+        continue;
+
+      for (j = 0; j < glyph->num_components; j++)
+      {
+        FT_UShort component = glyph->components[j];
+
+
+        if (component < data->num_glyphs
+            && sfnt->previous_rehint[component])
+        {
+          sfnt->previous_rehint[i] = 1;
+          changed = 1;
+          break;
+        }
+      }
+    }
+  } while (changed);
+
+  return TA_Err_Ok;
+}
+
+
+/*
+ * Copy the bytecode of glyph `idx' from the previous font instead of
+ * generating it.
+ */
+
+FT_Error
+TA_sfnt_copy_previous_instructions(SFNT* sfnt,
+                                   FONT* font,
+                                   FT_Long idx)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  /* `idx' is never negative */
+  GLYPH* glyph = &data->glyphs[idx];
+
+  FT_Error error;
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_Byte* ins_buf;
+  FT_UShort ins_len;
+
+
+  /* control instructions for this glyph are already part of the bytecode */
+  TA_control_skip_glyph(font, sfnt->face->face_index, idx);
+
+  error = TA_sfnt_get_previous_glyph(sfnt, idx, &buf, &len);
+  if (error)
+    return error;
+  error = TA_glyph_find_instructions(buf, len, &ins_buf, &ins_len);
+  if (error)
+    return error;
+
+  ta_free(glyph->ins_extra_buf);
+  glyph->ins_extra_buf = NULL;
+  glyph->ins_extra_len = 0;
+
+  ta_free(glyph->ins_buf);
+  glyph->ins_buf = NULL;
+  glyph->ins_len = ins_len;
+
+  if (!ins_len)
+    return TA_Err_Ok;
+
+  glyph->ins_buf = (FT_Byte*)ta_malloc(ins_len);
+  if (!glyph->ins_buf)
+  {
+    glyph->ins_len = 0;
+    return FT_Err_Out_Of_Memory;
+  }
+  memcpy(glyph->ins_buf, ins_buf, ins_len);
+
+  if (ins_len > sfnt->max_instructions)
+    sfnt->max_instructions = ins_len;
+
+  return TA_Err_Ok;
+}
+
+/* end of tasubset.c */
@@ -26,8 +26,9 @@ TA_sfnt_add_table_info(SFNT* sfnt)
 
   sfnt->num_table_infos++;
   table_infos_new =
-    (SFNT_Table_Info*)realloc(sfnt->table_infos, sfnt->num_table_infos
-                                                 * sizeof (SFNT_Table_Info));
+    (SFNT_Table_Info*)ta_realloc(sfnt->table_infos,
+                                 sfnt->num_table_infos
+                                 * sizeof (SFNT_Table_Info));
   if (!table_infos_new)
   {
     sfnt->num_table_infos--;
@@ -71,8 +72,8 @@ TA_font_add_table(FONT* font,
 
 
   font->num_tables++;
-  tables_new = (SFNT_Table*)realloc(font->tables,
-                                    font->num_tables * sizeof (SFNT_Table));
+  tables_new = (SFNT_Table*)ta_realloc(font->tables,
+                                       font->num_tables * sizeof (SFNT_Table));
   if (!tables_new)
   {
     font->num_tables--;
@@ -145,6 +146,135 @@ TA_sfnt_sort_table_info(SFNT* sfnt,
 }
 
 
+/*
+ * Subfonts of a TTC with different `glyf' tables (and thus separately
+ * created `cvt', `fpgm', and `prep' tables) often get identical bytecode
+ * tables.  After all tables have been built, we make the subfonts share
+ * the first table of identical ones and remove the others.  Since this
+ * changes the indices of tables, it should be called directly before the
+ * font gets assembled.
+ */
+
+FT_Error
+TA_font_share_identical_tables(FONT* font)
+{
+  SFNT_Table* tables = font->tables;
+  FT_ULong num_tables = font->num_tables;
+
+  FT_ULong* new_idx;
+  FT_ULong num_removed;
+  FT_ULong i, j;
+  FT_Long k;
+
+
+  new_idx = (FT_ULong*)ta_malloc(num_tables * sizeof (FT_ULong));
+  if (!new_idx)
+    return FT_Err_Out_Of_Memory;
+
+  /* first, map duplicates to their first instance */
+  num_removed = 0;
+  for (i = 0; i < num_tables; i++)
+  {
+    SFNT_Table* table = &tables[i];
+
+
+    new_idx[i] = i;
+
+    if (!(table->tag == TTAG_cvt
+          || table->tag == TTAG_fpgm
+          || table->tag == TTAG_prep))
+      continue;
+
+    /* the checksum serves as a hash value */
+    for (j = 0; j < i; j++)
+    {
+      if (new_idx[j] != j)
+        continue;
+
+      if (tables[j].tag == table->tag
+          && tables[j].checksum == table->checksum
+          && tables[j].len == table->len
+          && !memcmp(tables[j].buf, table->buf, table->len))
+      {
+        new_idx[i] = j;
+        num_removed++;
+        break;
+      }
+    }
+  }
+
+  if (!num_removed)
+  {
+    ta_free(new_idx);
+    return TA_Err_Ok;
+  }
+
+  /* then compact the table array */
+  j = 0;
+  for (i = 0; i < num_tables; i++)
+  {
+    if (new_idx[i] != i)
+    {
+      ta_free(tables[i].buf);
+      new_idx[i] = new_idx[new_idx[i]];
+      continue;
+    }
+
+    tables[j] = tables[i];
+    new_idx[i] = j++;
+  }
+
+  font->num_tables = j;
+
+#define REMAP(idx) \
+          do \
+          { \
+            if ((idx) != MISSING) \
+              (idx) = new_idx[idx]; \
+          } while (0)
+
+  for (k = 0; k < font->num_sfnts; k++)
+  {
+    SFNT* sfnt = &font->sfnts[k];
+
+
+    for (i = 0; i < sfnt->num_table_infos; i++)
+      REMAP(sfnt->table_infos[i]);
+
+    REMAP(sfnt->glyf_idx);
+    REMAP(sfnt->loca_idx);
+    REMAP(sfnt->head_idx);
+    REMAP(sfnt->hmtx_idx);
+    REMAP(sfnt->maxp_idx);
+    REMAP(sfnt->name_idx);
+    REMAP(sfnt->post_idx);
+    REMAP(sfnt->OS2_idx);
+    REMAP(sfnt->GPOS_idx);
+  }
+
+  for (i = 0; i < font->num_tables; i++)
+  {
+    if (tables[i].tag == TTAG_glyf && tables[i].data)
+    {
+      glyf_Data* data = (glyf_Data*)tables[i].data;
+
+
+      REMAP(data->cvt_idx);
+      REMAP(data->fpgm_idx);
+      REMAP(data->prep_idx);
+    }
+  }
+
+  REMAP(font->gasp_idx);
+
+#undef REMAP
+
+  ta_free(new_idx);
+
+  return TA_Err_Ok;
+}
+
+
 void
 TA_font_compute_table_offsets(FONT* font,
                               FT_ULong start)
@@ -37,6 +37,9 @@ void
 TA_sfnt_sort_table_info(SFNT* sfnt,
                         FONT* font);
 
+FT_Error
+TA_font_share_identical_tables(FONT* font);
+
 void
 TA_font_compute_table_offsets(FONT* font,
                               FT_ULong start);
@@ -0,0 +1,524 @@
+/* tatrace-decode.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) \
+ *         -I.. -I. \
+ *         -o tatrace-decode tatrace-decode.c \
+ *            numberset.c sds.c tamemory.c -lpthread
+ *
+ * after configuration.  Usage:
+ *
+ *   tatrace-decode [-f FONTS] [-g GLYPHS] [-s SIZES] TRACE-FILE
+ *
+ * The program converts a binary trace file written by ttfautohint's
+ * option `--debug-trace' into the text that option `--debug' emits for
+ * the hinting of glyphs.  FONTS, GLYPHS, and SIZES are number sets (for
+ * example, `10-20, 35') to restrict the output to the given subfont
+ * indices, glyph indices, and PPEM values, respectively.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <numberset.h>
+
+#include "tatrace.h"
+
+
+/* values of `TA_Direction' and `TA_Dimension' */
+#define DIR_RIGHT 1
+#define DIR_LEFT -1
+#define DIR_UP 2
+#define DIR_DOWN -2
+
+#define DIMENSION_HORZ 0
+
+/* the edge flags shown in the dumps */
+#define EDGE_ROUND (1U << 0)
+#define EDGE_SERIF (1U << 1)
+
+
+typedef struct Event_
+{
+  int type;
+  unsigned char* data;
+  size_t len;
+  size_t pos;
+} Event;
+
+
+static long
+get_int(Event* event)
+{
+  unsigned char* p = event->data + event->pos;
+  unsigned long v;
+
+
+  if (event->pos + 4 > event->len)
+  {
+    fprintf(stderr, "tatrace-decode: truncated event of type %d\n",
+            event->type);
+    exit(EXIT_FAILURE);
+  }
+  event->pos += 4;
+
+  v = ((unsigned long)p[0] << 24)
+      | ((unsigned long)p[1] << 16)
+      | ((unsigned long)p[2] << 8)
+      | (unsigned long)p[3];
+
+  /* sign-extend */
+  return (long)(v ^ 0x80000000UL) - 0x80000000L;
+}
+
+
+static const char*
+dir_str(long dir)
+{
+  switch (dir)
+  {
+  case DIR_UP:
+    return "up";
+  case DIR_DOWN:
+    return "down";
+  case DIR_LEFT:
+    return "left";
+  case DIR_RIGHT:
+    return "right";
+  default:
+    return "none";
+  }
+}
+
+
+static char*
+print_idx(char* p,
+          long idx)
+{
+  if (idx == -1)
+    strcpy(p, "--");
+  else
+    sprintf(p, "%ld", idx);
+
+  return p;
+}
+
+
+static const char*
+edge_flags_str(long flags)
+{
+  if ((flags & EDGE_ROUND) && (flags & EDGE_SERIF))
+    return "round serif";
+  if (flags & EDGE_ROUND)
+    return "round";
+  if (flags & EDGE_SERIF)
+    return "serif";
+
+  return "normal";
+}
+
+
+static void
+print_edges(Event* event)
+{
+  long dimension = get_int(event);
+  long scale = get_int(event);
+  long num_edges = get_int(event);
+  long i;
+
+
+  printf("Table of %s edges (1px=%.2fu, 10u=%.2fpx):\n",
+         dimension == DIMENSION_HORZ ? "vertical" : "horizontal",
+         65536.0 * 64.0 / scale,
+         10.0 * scale / 65536.0 / 64.0);
+
+  if (num_edges)
+    printf("  index    pos     dir   link  serif"
+           "  blue    opos     pos       flags\n");
+  else
+    printf("  (none)\n");
+
+  for (i = 0; i < num_edges; i++)
+  {
+    long opos = get_int(event);
+    long dir = get_int(event);
+    long link = get_int(event);
+    long serif = get_int(event);
+    long blue = get_int(event);
+    long pos = get_int(event);
+    long flags = get_int(event);
+
+    char buf1[16], buf2[16];
+
+
+    printf("  %5ld  %7.2f  %5s  %4s  %5s"
+           "    %c   %7.2f  %7.2f  %11s\n",
+           i,
+           opos / 64.0,
+           dir_str(dir),
+           print_idx(buf1, link),
+           print_idx(buf2, serif),
+           blue ? 'y' : 'n',
+           opos / 64.0,
+           pos / 64.0,
+           edge_flags_str(flags));
+  }
+  printf("\n");
+}
+
+
+static void
+print_segments(Event* event)
+{
+  long dimension = get_int(event);
+  long num_segments = get_int(event);
+  long i;
+
+
+  printf("Table of %s segments:\n",
+         dimension == DIMENSION_HORZ ? "vertical" : "horizontal");
+
+  if (num_segments)
+    printf("  index   pos   delta   dir   from   to "
+           "  link  serif  edge"
+           "  height  extra     flags\n");
+  else
+    printf("  (none)\n");
+
+  for (i = 0; i < num_segments; i++)
+  {
+    long pos = get_int(event);
+    long delta = get_int(event);
+    long dir = get_int(event);
+    long first = get_int(event);
+    long last = get_int(event);
+    long link = get_int(event);
+    long serif = get_int(event);
+    long edge = get_int(event);
+    long height = get_int(event);
+    long extra = get_int(event);
+    long flags = get_int(event);
+
+    char buf1[16], buf2[16], buf3[16];
+
+
+    printf("  %5ld  %5ld  %5ld  %5s  %4ld  %4ld"
+           "  %4s  %5s  %4s"
+           "  %6ld  %5ld  %11s\n",
+           i, pos, delta, dir_str(dir), first, last,
+           print_idx(buf1, link),
+           print_idx(buf2, serif),
+           print_idx(buf3, edge),
+           height, extra, edge_flags_str(flags));
+  }
+  printf("\n");
+}
+
+
+static void
+print_points(Event* event)
+{
+  long num_points = get_int(event);
+  long i;
+
+
+  printf("Table of points:\n");
+
+  if (num_points)
+    printf("  index  hedge  hseg  flags"
+           "  xorg  yorg  xscale  yscale   xfit    yfit "
+           "  hbef  haft");
+  else
+    printf("  (none)\n");
+
+  for (i = 0; i < num_points; i++)
+  {
+    long contour_start = get_int(event);
+    long edge = get_int(event);
+    long segment = get_int(event);
+    long weak = get_int(event);
+    long fx = get_int(event);
+    long fy = get_int(event);
+    long ox = get_int(event);
+    long oy = get_int(event);
+    long x = get_int(event);
+    long y = get_int(event);
+    long before = get_int(event);
+    long after = get_int(event);
+
+    char buf1[16], buf2[16], buf5[16], buf6[16];
+
+
+    if (contour_start)
+      printf("\n");
+
+    printf("  %5ld  %5s %5s   %4s"
+           " %5ld %5ld %7.2f %7.2f %7.2f %7.2f"
+           " %5s %5s\n",
+           i,
+           print_idx(buf1, edge),
+           print_idx(buf2, segment),
+           weak ? "weak" : " -- ",
+           fx, fy,
+           ox / 64.0, oy / 64.0,
+           x / 64.0, y / 64.0,
+           print_idx(buf5, before),
+           print_idx(buf6, after));
+  }
+  printf("\n");
+}
+
+
+static void
+print_record(Event* event)
+{
+  size_t i;
+
+
+  printf("%s hints record:\n",
+         event->type == TA_TRACE_ACTION_RECORD ? "action" : "point");
+
+  if (!event->len)
+    printf("  (none)");
+  else
+  {
+    printf("  ");
+    for (i = 0; i + 1 < event->len; i += 2)
+      printf(" %2d", event->data[i] * 256 + event->data[i + 1]);
+  }
+
+  printf(event->type == TA_TRACE_ACTION_RECORD ? "\n" : "\n\n");
+}
+
+
+static void
+print_header(const char* s,
+             char c)
+{
+  int num_chars = printf("%s\n", s);
+  int i;
+
+
+  for (i = 0; i < num_chars - 1; i++)
+    putchar(c);
+  printf("\n\n");
+}
+
+
+static number_range*
+parse_set(const char* s,
+          const char* what)
+{
+  number_range* set;
+  const char* end = number_set_parse(s, &set, 0, 0x7FFFFFFF);
+
+
+  if (*end || !set || set == NUMBERSET_ALLOCATION_ERROR)
+  {
+    fprintf(stderr, "tatrace-decode: invalid %s set `%s'\n", what, s);
+    exit(EXIT_FAILURE);
+  }
+
+  return set;
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  FILE* f;
+  unsigned char magic[TA_TRACE_MAGIC_LEN];
+
+  number_range* fonts = NULL;
+  number_range* glyphs = NULL;
+  number_range* sizes = NULL;
+
+  /* the current position in the trace */
+  long font_idx = -1;
+  long glyph_idx = -1;
+  long size = -1;
+
+  int c;
+
+
+  while ((c = getopt(argc, argv, "f:g:s:")) != -1)
+  {
+    switch (c)
+    {
+    case 'f':
+      fonts = parse_set(optarg, "font");
+      break;
+    case 'g':
+      glyphs = parse_set(optarg, "glyph");
+      break;
+    case 's':
+      sizes = parse_set(optarg, "size");
+      break;
+    default:
+      fprintf(stderr, "usage: tatrace-decode"
+                      " [-f FONTS] [-g GLYPHS] [-s SIZES] TRACE-FILE\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (optind != argc - 1)
+  {
+    fprintf(stderr, "usage: tatrace-decode"
+                    " [-f FONTS] [-g GLYPHS] [-s SIZES] TRACE-FILE\n");
+    exit(EXIT_FAILURE);
+  }
+
+  f = fopen(argv[optind], "rb");
+  if (!f)
+  {
+    perror(argv[optind]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (fread(magic, 1, TA_TRACE_MAGIC_LEN, f) != TA_TRACE_MAGIC_LEN
+      || memcmp(magic, TA_TRACE_MAGIC, TA_TRACE_MAGIC_LEN))
+  {
+    fprintf(stderr, "tatrace-decode: `%s' is not a trace file\n",
+            argv[optind]);
+    exit(EXIT_FAILURE);
+  }
+
+  for (;;)
+  {
+    unsigned char header[5];
+    Event event;
+    int selected;
+
+
+    if (fread(header, 1, 5, f) != 5)
+      break;
+
+    event.type = header[0];
+    event.len = ((size_t)header[1] << 24)
+                | ((size_t)header[2] << 16)
+                | ((size_t)header[3] << 8)
+                | (size_t)header[4];
+    event.pos = 0;
+
+    event.data = (unsigned char*)malloc(event.len ? event.len : 1);
+    if (!event.data)
+    {
+      fprintf(stderr, "tatrace-decode: allocation error\n");
+      exit(EXIT_FAILURE);
+    }
+    if (fread(event.data, 1, event.len, f) != event.len)
+    {
+      fprintf(stderr, "tatrace-decode: truncated trace file\n");
+      exit(EXIT_FAILURE);
+    }
+
+    if (event.type == TA_TRACE_GLYPH)
+    {
+      font_idx = get_int(&event);
+      glyph_idx = get_int(&event);
+      size = -1;
+    }
+    else if (event.type == TA_TRACE_SIZE)
+      size = get_int(&event);
+
+    /* messages outside of a glyph are shown only without filters; */
+    /* glyph-level data is shown for all sizes */
+    selected = (!fonts || number_set_is_element(fonts, (int)font_idx))
+               && (!glyphs || number_set_is_element(glyphs, (int)glyph_idx))
+               && (!sizes || size == -1
+                   || number_set_is_element(sizes, (int)size));
+
+    if (selected)
+    {
+      switch (event.type)
+      {
+      case TA_TRACE_GLYPH:
+        {
+          char buf[300];
+          int n;
+
+
+          n = sprintf(buf, "glyph %ld", glyph_idx);
+          if (event.len > 8)
+            sprintf(buf + n, " (%.*s)",
+                    (int)(event.len - 8 > 256 ? 256 : event.len - 8),
+                    (char*)event.data + 8);
+
+          /* the glyph header is underlined completely */
+          printf("%s\n", buf);
+          for (n = 0; buf[n]; n++)
+            putchar('=');
+          printf("\n\n");
+        }
+        break;
+
+      case TA_TRACE_SIZE:
+        {
+          char buf[32];
+
+
+          sprintf(buf, "size %ld", size);
+          print_header(buf, '-');
+        }
+        break;
+
+      case TA_TRACE_EDGES:
+        print_edges(&event);
+        break;
+
+      case TA_TRACE_SEGMENTS:
+        print_segments(&event);
+        break;
+
+      case TA_TRACE_POINTS:
+        print_points(&event);
+        break;
+
+      case TA_TRACE_ACTION_RECORD:
+      case TA_TRACE_POINT_RECORD:
+        print_record(&event);
+        break;
+
+      case TA_TRACE_MESSAGE:
+        fwrite(event.data, 1, event.len, stdout);
+        break;
+
+      default:
+        /* ignore unknown events */
+        break;
+      }
+    }
+
+    free(event.data);
+  }
+
+  fclose(f);
+
+  number_set_free(fonts);
+  number_set_free(glyphs);
+  number_set_free(sizes);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of tatrace-decode.c */
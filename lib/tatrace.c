@@ -0,0 +1,217 @@
+/* tatrace.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tatrace.h"
+#include "tamemory.h"
+
+
+/* the buffer gets written to the trace file if it exceeds this size */
+#define TRACE_FLUSH_SIZE 0x10000
+
+
+static void
+trace_flush(TA_Trace trace)
+{
+  if (trace->error || !trace->len)
+    return;
+
+  if (fwrite(trace->buf, 1, trace->len, trace->file) != trace->len)
+    trace->error = TA_TRACE_ERR_WRITE;
+
+  trace->len = 0;
+}
+
+
+static unsigned char*
+trace_reserve(TA_Trace trace,
+              size_t len)
+{
+  if (trace->error)
+    return NULL;
+
+  if (trace->len + len > trace->size)
+  {
+    size_t new_size = trace->size ? trace->size : 2 * TRACE_FLUSH_SIZE;
+    unsigned char* new_buf;
+
+
+    while (trace->len + len > new_size)
+      new_size *= 2;
+
+    new_buf = (unsigned char*)ta_realloc(trace->buf, new_size);
+    if (!new_buf)
+    {
+      trace->error = TA_TRACE_ERR_MEMORY;
+      return NULL;
+    }
+
+    trace->buf = new_buf;
+    trace->size = new_size;
+  }
+
+  trace->len += len;
+
+  return trace->buf + trace->len - len;
+}
+
+
+void
+TA_trace_init(TA_Trace trace,
+              FILE* file)
+{
+  memset(trace, 0, sizeof (TA_TraceRec));
+  trace->file = file;
+
+  if (file)
+    TA_trace_bytes(trace, TA_TRACE_MAGIC, TA_TRACE_MAGIC_LEN);
+}
+
+
+void
+TA_trace_open_event(TA_Trace trace,
+                    int type)
+{
+  unsigned char* p;
+
+
+  trace->event_start = trace->len;
+
+  /* the length gets filled in by `TA_trace_close_event' */
+  p = trace_reserve(trace, 5);
+  if (!p)
+    return;
+
+  p[0] = (unsigned char)type;
+}
+
+
+void
+TA_trace_int(TA_Trace trace,
+             long value)
+{
+  unsigned char* p = trace_reserve(trace, 4);
+  unsigned long v = (unsigned long)value;
+
+
+  if (!p)
+    return;
+
+  p[0] = (unsigned char)(v >> 24);
+  p[1] = (unsigned char)(v >> 16);
+  p[2] = (unsigned char)(v >> 8);
+  p[3] = (unsigned char)v;
+}
+
+
+void
+TA_trace_bytes(TA_Trace trace,
+               const void* data,
+               size_t len)
+{
+  unsigned char* p = trace_reserve(trace, len);
+
+
+  if (!p)
+    return;
+
+  memcpy(p, data, len);
+}
+
+
+void
+TA_trace_close_event(TA_Trace trace)
+{
+  unsigned char* p;
+  size_t len;
+
+
+  if (trace->error)
+    return;
+
+  p = trace->buf + trace->event_start + 1;
+  len = trace->len - trace->event_start - 5;
+
+  p[0] = (unsigned char)(len >> 24);
+  p[1] = (unsigned char)(len >> 16);
+  p[2] = (unsigned char)(len >> 8);
+  p[3] = (unsigned char)len;
+
+  /* only complete events get written */
+  if (trace->len >= TRACE_FLUSH_SIZE)
+    trace_flush(trace);
+}
+
+
+void
+TA_trace_glyph(TA_Trace trace,
+               long font_idx,
+               long glyph_idx,
+               const char* glyph_name)
+{
+  TA_trace_open_event(trace, TA_TRACE_GLYPH);
+  TA_trace_int(trace, font_idx);
+  TA_trace_int(trace, glyph_idx);
+  TA_trace_bytes(trace, glyph_name, strlen(glyph_name));
+  TA_trace_close_event(trace);
+}
+
+
+void
+TA_trace_size(TA_Trace trace,
+              unsigned int size)
+{
+  TA_trace_open_event(trace, TA_TRACE_SIZE);
+  TA_trace_int(trace, (long)size);
+  TA_trace_close_event(trace);
+}
+
+
+void
+TA_trace_record(TA_Trace trace,
+                int type,
+                const unsigned char* start,
+                const unsigned char* end)
+{
+  TA_trace_open_event(trace, type);
+  TA_trace_bytes(trace, start, (size_t)(end - start));
+  TA_trace_close_event(trace);
+}
+
+
+int
+TA_trace_done(TA_Trace trace)
+{
+  int error;
+
+
+  if (trace->file)
+  {
+    trace_flush(trace);
+    if (!trace->error && fflush(trace->file))
+      trace->error = TA_TRACE_ERR_WRITE;
+  }
+
+  error = trace->error;
+
+  ta_free(trace->buf);
+  memset(trace, 0, sizeof (TA_TraceRec));
+
+  return error;
+}
+
+/* end of tatrace.c */
@@ -0,0 +1,155 @@
+/* tatrace.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/* a binary trace of the hinting process, written instead of */
+/* the debugging output on stderr if option `debug-trace-file' is set; */
+/* `tatrace-decode.c' converts it back to text */
+
+#ifndef TATRACE_H_
+#define TATRACE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * A trace file starts with the eight bytes of `TA_TRACE_MAGIC', followed
+ * by a sequence of events.  An event consists of a one-byte type, a
+ * four-byte length of the payload, and the payload itself.  All integers
+ * in the payload are signed 32-bit values; like in SFNT tables, all
+ * multi-byte values are stored in big-endian byte order.
+ *
+ * Index values are -1 for non-existing objects (for example, a segment
+ * without a link).
+ */
+
+#define TA_TRACE_MAGIC "TATRACE1"
+#define TA_TRACE_MAGIC_LEN 8
+
+
+/*
+ * font index, glyph index, glyph name (remaining bytes, no trailing NUL)
+ */
+#define TA_TRACE_GLYPH 1
+
+/*
+ * PPEM value
+ */
+#define TA_TRACE_SIZE 2
+
+/*
+ * dimension, scaling value (16.16), number of edges, then 7 values per
+ * edge: original position, direction, link index, serif index, blue edge
+ * flag, position, flags; positions are in 26.6 format, directions are
+ * `TA_Direction' values
+ */
+#define TA_TRACE_EDGES 3
+
+/*
+ * dimension, number of segments, then 11 values per segment: position,
+ * delta, direction, first point index, last point index, link index,
+ * serif index, edge index, height, extra height, flags
+ */
+#define TA_TRACE_SEGMENTS 4
+
+/*
+ * number of points, then 12 values per point: contour start flag, edge
+ * index, segment index, weak interpolation flag, x and y in font units,
+ * scaled x and y, hinted x and y (26.6 format), index of the strong edges
+ * before and after the point
+ */
+#define TA_TRACE_POINTS 5
+
+/*
+ * action hints record (raw 16-bit values, no count)
+ */
+#define TA_TRACE_ACTION_RECORD 6
+
+/*
+ * point hints record (raw 16-bit values, no count)
+ */
+#define TA_TRACE_POINT_RECORD 7
+
+/*
+ * a message of the autohinter (remaining bytes, no trailing NUL)
+ */
+#define TA_TRACE_MESSAGE 8
+
+
+/* the state of the trace writer; */
+/* events are collected in `buf' and written to `file' in large chunks */
+typedef struct TA_TraceRec_
+{
+  FILE* file;
+
+  unsigned char* buf;
+  size_t len;
+  size_t size;
+
+  size_t event_start; /* offset of the currently open event */
+
+  int error; /* one of the `TA_TRACE_ERR_XXX' values */
+} TA_TraceRec, *TA_Trace;
+
+#define TA_TRACE_ERR_OK 0
+#define TA_TRACE_ERR_MEMORY 1
+#define TA_TRACE_ERR_WRITE 2
+
+
+void
+TA_trace_init(TA_Trace trace,
+              FILE* file);
+
+void
+TA_trace_open_event(TA_Trace trace,
+                    int type);
+void
+TA_trace_int(TA_Trace trace,
+             long value);
+void
+TA_trace_bytes(TA_Trace trace,
+               const void* data,
+               size_t len);
+void
+TA_trace_close_event(TA_Trace trace);
+
+void
+TA_trace_glyph(TA_Trace trace,
+               long font_idx,
+               long glyph_idx,
+               const char* glyph_name);
+void
+TA_trace_size(TA_Trace trace,
+              unsigned int size);
+void
+TA_trace_record(TA_Trace trace,
+                int type,
+                const unsigned char* start,
+                const unsigned char* end);
+
+int
+TA_trace_done(TA_Trace trace);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TATRACE_H_ */
+
+/* end of tatrace.h */
@@ -38,7 +38,7 @@ TA_font_build_TTC_header(FONT* font,
 
 
   len = (FT_ULong)((font->have_DSIG ? 24 : 12) + 4 * num_sfnts);
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_malloc(len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -165,7 +165,7 @@ TA_font_build_TTC(FONT* font)
                               TTAG_TTFA, TTFA_len, TTFA_buf);
     if (error)
     {
-      free(TTFA_buf);
+      ta_free(TTFA_buf);
       return error;
     }
   }
@@ -187,22 +187,28 @@ TA_font_build_TTC(FONT* font)
     error = TA_font_add_table(font, &dummy, TTAG_DSIG, DSIG_LEN, DSIG_buf);
     if (error)
     {
-      free(DSIG_buf);
+      ta_free(DSIG_buf);
       return error;
     }
   }
 
+  error = TA_font_share_identical_tables(font);
+  if (error)
+    return error;
+
   /* this also computes the SFNT table offsets */
   error = TA_font_build_TTC_header(font,
                                    &TTC_header_buf, &TTC_header_len);
   if (error)
     return error;
 
-  TTF_header_bufs = (FT_Byte**)calloc(1, (size_t)num_sfnts * sizeof (FT_Byte*));
+  TTF_header_bufs = (FT_Byte**)ta_calloc(1, (size_t)num_sfnts
+                                              * sizeof (FT_Byte*));
   if (!TTF_header_bufs)
     goto Err;
 
-  TTF_header_lens = (FT_ULong*)malloc((size_t)num_sfnts * sizeof (FT_ULong));
+  TTF_header_lens = (FT_ULong*)ta_malloc((size_t)num_sfnts
+                                         * sizeof (FT_ULong));
   if (!TTF_header_lens)
     goto Err;
 
@@ -225,7 +231,7 @@ TA_font_build_TTC(FONT* font)
                   + ((tables[num_tables - 1].len + 3) & ~3U);
   /* if `out-buffer' is set, this buffer gets returned to the user, */
   /* thus we use the customized allocator function */
-  font->out_buf = (FT_Byte*)font->allocate(font->out_len);
+  font->out_buf = (FT_Byte*)TA_font_allocate(font, font->out_len);
   if (!font->out_buf)
   {
     error = FT_Err_Out_Of_Memory;
@@ -257,14 +263,14 @@ TA_font_build_TTC(FONT* font)
   error = TA_Err_Ok;
 
 Err:
-  free(TTC_header_buf);
+  ta_free(TTC_header_buf);
   if (TTF_header_bufs)
   {
     for (i = 0; i < font->num_sfnts; i++)
-      free(TTF_header_bufs[i]);
-    free(TTF_header_bufs);
+      ta_free(TTF_header_bufs[i]);
+    ta_free(TTF_header_bufs);
   }
-  free(TTF_header_lens);
+  ta_free(TTF_header_lens);
 
   return error;
 }
@@ -56,7 +56,7 @@ TA_sfnt_build_TTF_header(SFNT* sfnt,
     *header_len = len;
     return TA_Err_Ok;
   }
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_malloc(len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -230,7 +230,7 @@ TA_font_build_TTF(FONT* font)
                               TTAG_TTFA, TTFA_len, TTFA_buf);
     if (error)
     {
-      free(TTFA_buf);
+      ta_free(TTFA_buf);
       return error;
     }
   }
@@ -257,7 +257,7 @@ TA_font_build_TTF(FONT* font)
                               TTAG_DSIG, DSIG_LEN, DSIG_buf);
     if (error)
     {
-      free(DSIG_buf);
+      ta_free(DSIG_buf);
       return error;
     }
   }
@@ -283,7 +283,7 @@ TA_font_build_TTF(FONT* font)
                   + ((tables[num_tables - 1].len + 3) & ~3U);
   /* if `out-buffer' is set, this buffer gets returned to the user, */
   /* thus we use the customized allocator function */
-  font->out_buf = (FT_Byte*)font->allocate(font->out_len);
+  font->out_buf = (FT_Byte*)TA_font_allocate(font, font->out_len);
   if (!font->out_buf)
   {
     error = FT_Err_Out_Of_Memory;
@@ -305,7 +305,7 @@ TA_font_build_TTF(FONT* font)
   error = TA_Err_Ok;
 
 Err:
-  free(header_buf);
+  ta_free(header_buf);
 
   return error;
 }
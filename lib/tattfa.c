@@ -36,10 +36,10 @@ TA_table_build_TTFA(FT_Byte** TTFA,
 
   /* buffer length must be a multiple of four */
   len = (buf_len + 3) & ~3U;
-  buf_new = (FT_Byte*)realloc(buf, len);
+  buf_new = (FT_Byte*)ta_realloc(buf, len);
   if (!buf_new)
   {
-    free(buf);
+    ta_free(buf);
     return FT_Err_Out_Of_Memory;
   }
   buf = buf_new;
@@ -26,6 +26,7 @@
 #include FT_OUTLINE_H
 
 #include "tablue.h"
+#include "tamemory.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -70,12 +71,13 @@ void
 _ta_message(const char* format,
             ...);
 
-extern int _ta_debug;
-extern int _ta_debug_global;
-extern int _ta_debug_disable_horz_hints;
-extern int _ta_debug_disable_vert_hints;
-extern int _ta_debug_disable_blue_hints;
-extern void* _ta_debug_hints;
+extern TA_THREAD_LOCAL int _ta_debug;
+extern TA_THREAD_LOCAL int _ta_debug_global;
+extern TA_THREAD_LOCAL int _ta_debug_disable_horz_hints;
+extern TA_THREAD_LOCAL int _ta_debug_disable_vert_hints;
+extern TA_THREAD_LOCAL int _ta_debug_disable_blue_hints;
+extern TA_THREAD_LOCAL void* _ta_debug_hints;
+extern TA_THREAD_LOCAL void* _ta_debug_trace;
 
 #else /* !TA_DEBUG */
 
@@ -385,6 +387,10 @@ typedef const TA_StyleClassRec* TA_StyleClass;
 
 typedef struct TA_FaceGlobalsRec_* TA_FaceGlobals;
 
+/* the shaped clusters of blue and sample character strings; */
+/* the structure is defined in `tashaper.c' */
+typedef struct TA_ShaperCacheRec_* TA_ShaperCache;
+
 /* This is the main structure that combines everything.  Autofit modules */
 /* specific to writing systems derive their structures from it, for      */
 /* example `TA_LatinMetrics'.                                            */
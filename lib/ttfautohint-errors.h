@@ -69,6 +69,12 @@ TA_ERRORDEF_(Invalid_Font_Type,        0xF6,
              "not a font with TrueType outlines in SFNT format")
 TA_ERRORDEF_(Unknown_Argument,         0xF7,
              "unknown argument")
+TA_ERRORDEF_(Invalid_Previous_Font,    0xF8,
+             "previous font not created by ttfautohint with `TTFA' table")
+TA_ERRORDEF_(Previous_Font_Mismatch,   0xF9,
+             "previous font doesn't match current input font and parameters")
+TA_ERRORDEF_(Memory_Limit,             0xFA,
+             "memory limit exceeded")
 
 TA_ERRORDEF_(XHeightSnapping_Invalid_Character,  0x101,
              "invalid character")
@@ -0,0 +1,1272 @@
+/* ttfautohint-font-gen.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) \
+ *         -I.. -I. \
+ *         `pkg-config --cflags freetype2` \
+ *         -o ttfautohint-font-gen ttfautohint-font-gen.c taranges.c
+ *
+ * after configuration (`make check' builds it also), then run
+ *
+ *   ./ttfautohint-font-gen [options] output-file
+ *
+ * The program creates a synthetic TrueType font (or a TrueType collection
+ * if more than one subfont is requested) to benchmark ttfautohint with
+ * fonts of controlled size and complexity.  Options:
+ *
+ *   -g N     number of glyphs per subfont, including `.notdef' and
+ *            composite glyphs (default: 256)
+ *   -p N     number of points per simple glyph (default: 48)
+ *   -c N     number of contours per simple glyph (default: 3)
+ *   -C N     number of composite glyphs per subfont (default: 0)
+ *   -d N     maximum nesting depth of composite glyphs (default: 1)
+ *   -s LIST  comma-separated list of script tags as used by option
+ *            `--default-script' (default: latn); character codes are
+ *            taken from the ranges in `taranges.c' so that ttfautohint's
+ *            style coverage works as in real fonts; each script gets an
+ *            equal share of the simple glyphs, which stay unmapped if a
+ *            script has fewer characters
+ *   -n N     number of subfonts (default: 1)
+ *   -r N     seed for the pseudo-random outline variations (default: 1)
+ *
+ * Simple glyphs consist of rectangular contours arranged in a grid, with
+ * the points distributed along the edges and some of them off-curve;
+ * the outlines vary pseudo-randomly, but the output is reproducible for
+ * a given seed.  Composite glyphs are not mapped in the `cmap' table.
+ *
+ * See `ttfautohint-scaling-bench.sh' for a benchmark suite based on this
+ * program.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "taranges.h"
+
+
+#define UNITS_PER_EM 2048
+#define ASCENDER 1900
+#define DESCENDER -500
+#define CAP_HEIGHT 1400
+#define X_HEIGHT 1000
+
+#define MAX_UNICODE 0x110000
+
+
+/* the scripts of `ttfautohint-scripts.h' */
+
+typedef struct Script_
+{
+  const char* tag;
+  const TA_Script_UniRangeRec* ranges;
+} Script;
+
+#undef SCRIPT
+#define SCRIPT(s, S, d, h, H, ss) \
+          { #s, ta_ ## s ## _uniranges },
+
+static const Script scripts[] =
+{
+
+#include "ttfautohint-scripts.h"
+
+  { NULL, NULL }
+};
+
+
+/* a growable byte buffer */
+
+typedef struct Buffer_
+{
+  unsigned char* data;
+  size_t len;
+  size_t size;
+} Buffer;
+
+
+static void
+buf_reserve(Buffer* b,
+            size_t len)
+{
+  if (b->len + len > b->size)
+  {
+    size_t new_size = b->size ? b->size : 1024;
+
+
+    while (b->len + len > new_size)
+      new_size *= 2;
+
+    b->data = (unsigned char*)realloc(b->data, new_size);
+    if (!b->data)
+    {
+      fprintf(stderr, "ttfautohint-font-gen: allocation error\n");
+      exit(EXIT_FAILURE);
+    }
+    b->size = new_size;
+  }
+}
+
+
+static void
+put8(Buffer* b,
+     unsigned int v)
+{
+  buf_reserve(b, 1);
+  b->data[b->len++] = (unsigned char)v;
+}
+
+
+static void
+put16(Buffer* b,
+      unsigned int v)
+{
+  put8(b, v >> 8);
+  put8(b, v);
+}
+
+
+static void
+put32(Buffer* b,
+      unsigned long v)
+{
+  put16(b, (unsigned int)(v >> 16));
+  put16(b, (unsigned int)v);
+}
+
+
+static void
+put_bytes(Buffer* b,
+          const void* data,
+          size_t len)
+{
+  buf_reserve(b, len);
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+}
+
+
+static void
+pad4(Buffer* b)
+{
+  while (b->len & 3)
+    put8(b, 0);
+}
+
+
+static void
+set32(Buffer* b,
+      size_t offset,
+      unsigned long v)
+{
+  b->data[offset] = (unsigned char)(v >> 24);
+  b->data[offset + 1] = (unsigned char)(v >> 16);
+  b->data[offset + 2] = (unsigned char)(v >> 8);
+  b->data[offset + 3] = (unsigned char)v;
+}
+
+
+static unsigned long
+checksum(const unsigned char* p,
+         size_t len)
+{
+  unsigned long sum = 0;
+  size_t i;
+
+
+  for (i = 0; i < len; i++)
+    sum += (unsigned long)p[i] << (8 * (3 - (i & 3)));
+
+  return sum & 0xFFFFFFFFUL;
+}
+
+
+/* a simple linear congruential generator for reproducible output */
+
+static unsigned long rand_state;
+
+
+static int
+random_int(int max)
+{
+  rand_state = (rand_state * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+  return max > 0 ? (int)((rand_state >> 8) % (unsigned long)max) : 0;
+}
+
+
+/* the parameters */
+
+typedef struct Params_
+{
+  int num_glyphs;
+  int num_points;
+  int num_contours;
+  int num_composites;
+  int composite_depth;
+  int num_subfonts;
+  unsigned long seed;
+
+  const Script** scripts;
+  int num_scripts;
+} Params;
+
+
+typedef struct Glyph_
+{
+  Buffer data;
+  int x_min, y_min, x_max, y_max;
+  int advance;
+
+  int num_points; /* for composites after recursion */
+  int num_contours;
+  int depth; /* 0 for simple glyphs */
+
+  unsigned long code; /* 0 if unmapped */
+} Glyph;
+
+
+typedef struct Table_
+{
+  unsigned long tag;
+  Buffer data;
+} Table;
+
+#define TAG(a, b, c, d) \
+          (((unsigned long)(a) << 24) \
+           | ((unsigned long)(b) << 16) \
+           | ((unsigned long)(c) << 8) \
+           | (unsigned long)(d))
+
+
+/* create a simple glyph with rectangular contours in a grid */
+
+static void
+make_simple_glyph(Glyph* glyph,
+                  const Params* params)
+{
+  int num_contours = params->num_contours;
+  int cols, rows;
+  int width = 900 + random_int(600);
+  int height = (random_int(2) ? CAP_HEIGHT : X_HEIGHT) + random_int(40) - 20;
+  int bottom = random_int(4) ? 0 : DESCENDER / 2;
+  int lsb = 50 + random_int(100);
+
+  short* xs;
+  short* ys;
+  unsigned char* flags;
+  int* ends;
+  int num_points = 0;
+  int c, i;
+
+
+  for (cols = 1; cols * cols < num_contours; cols++)
+    ;
+  rows = (num_contours + cols - 1) / cols;
+
+  xs = (short*)malloc((size_t)(params->num_points + 4 * num_contours)
+                      * sizeof (short));
+  ys = (short*)malloc((size_t)(params->num_points + 4 * num_contours)
+                      * sizeof (short));
+  flags = (unsigned char*)malloc((size_t)(params->num_points
+                                          + 4 * num_contours));
+  ends = (int*)malloc((size_t)num_contours * sizeof (int));
+  if (!xs || !ys || !flags || !ends)
+  {
+    fprintf(stderr, "ttfautohint-font-gen: allocation error\n");
+    exit(EXIT_FAILURE);
+  }
+
+  glyph->x_min = glyph->y_min = 0x7FFF;
+  glyph->x_max = glyph->y_max = -0x8000;
+
+  for (c = 0; c < num_contours; c++)
+  {
+    int cell_w = width / cols;
+    int cell_h = (height - bottom) / rows;
+    int stem = cell_w / 6 + random_int(cell_w / 8 + 1);
+
+    int x0 = lsb + (c % cols) * cell_w + random_int(stem / 2 + 1);
+    int y0 = bottom + (c / cols) * cell_h + random_int(stem / 2 + 1);
+    int x1 = lsb + (c % cols + 1) * cell_w - stem / 2;
+    int y1 = bottom + (c / cols + 1) * cell_h - stem / 2;
+
+    /* the points of this contour; at least the four corners */
+    int n = params->num_points / num_contours;
+    int per_side;
+    int side;
+
+
+    if (c < params->num_points % num_contours)
+      n++;
+    if (n < 4)
+      n = 4;
+    per_side = n / 4;
+
+    /* outer contours are drawn clockwise: */
+    /* up the left side, right along the top, down, left along the bottom */
+    for (side = 0; side < 4; side++)
+    {
+      int cx[2], cy[2];
+      int k, m = per_side + (side < n % 4);
+
+
+      switch (side)
+      {
+      case 0:
+        cx[0] = x0, cy[0] = y0, cx[1] = x0, cy[1] = y1;
+        break;
+      case 1:
+        cx[0] = x0, cy[0] = y1, cx[1] = x1, cy[1] = y1;
+        break;
+      case 2:
+        cx[0] = x1, cy[0] = y1, cx[1] = x1, cy[1] = y0;
+        break;
+      default:
+        cx[0] = x1, cy[0] = y0, cx[1] = x0, cy[1] = y0;
+        break;
+      }
+
+      /* the corner point plus `m - 1' points along the side */
+      for (k = 0; k < m; k++)
+      {
+        int x = cx[0] + (cx[1] - cx[0]) * k / m;
+        int y = cy[0] + (cy[1] - cy[0]) * k / m;
+
+
+        /* bulge some off-curve points to get round shapes */
+        if (k && random_int(3) == 0)
+        {
+          int bulge = random_int(stem / 3 + 1);
+
+
+          if (side == 0)
+            x -= bulge;
+          else if (side == 1)
+            y += bulge;
+          else if (side == 2)
+            x += bulge;
+          else
+            y -= bulge;
+
+          flags[num_points] = 0;
+        }
+        else
+          flags[num_points] = 1; /* on-curve */
+
+        xs[num_points] = (short)x;
+        ys[num_points] = (short)y;
+
+        if (x < glyph->x_min)
+          glyph->x_min = x;
+        if (x > glyph->x_max)
+          glyph->x_max = x;
+        if (y < glyph->y_min)
+          glyph->y_min = y;
+        if (y > glyph->y_max)
+          glyph->y_max = y;
+
+        num_points++;
+      }
+    }
+
+    ends[c] = num_points - 1;
+  }
+
+  glyph->num_points = num_points;
+  glyph->num_contours = num_contours;
+  glyph->depth = 0;
+  glyph->advance = glyph->x_max + lsb;
+
+  put16(&glyph->data, (unsigned int)num_contours);
+  put16(&glyph->data, (unsigned int)glyph->x_min);
+  put16(&glyph->data, (unsigned int)glyph->y_min);
+  put16(&glyph->data, (unsigned int)glyph->x_max);
+  put16(&glyph->data, (unsigned int)glyph->y_max);
+
+  for (c = 0; c < num_contours; c++)
+    put16(&glyph->data, (unsigned int)ends[c]);
+
+  put16(&glyph->data, 0); /* no instructions */
+
+  /* we always use 16-bit coordinate deltas */
+  for (i = 0; i < num_points; i++)
+    put8(&glyph->data, flags[i]);
+  for (i = 0; i < num_points; i++)
+    put16(&glyph->data, (unsigned int)(xs[i] - (i ? xs[i - 1] : 0)));
+  for (i = 0; i < num_points; i++)
+    put16(&glyph->data, (unsigned int)(ys[i] - (i ? ys[i - 1] : 0)));
+
+  free(xs);
+  free(ys);
+  free(flags);
+  free(ends);
+}
+
+
+/* create a composite glyph of two glyphs with smaller depth */
+
+static void
+make_composite_glyph(Glyph* glyphs,
+                     int idx,
+                     int first_simple,
+                     int depth)
+{
+  Glyph* glyph = &glyphs[idx];
+  int components[2];
+  int k;
+
+
+  glyph->x_min = glyph->y_min = 0x7FFF;
+  glyph->x_max = glyph->y_max = -0x8000;
+  glyph->num_points = 0;
+  glyph->num_contours = 0;
+  glyph->depth = depth;
+
+  /* take the components from the previous level */
+  /* if possible, otherwise simple glyphs */
+  for (k = 0; k < 2; k++)
+  {
+    int candidates[64];
+    int num_candidates = 0;
+    int i;
+
+
+    for (i = first_simple; i < idx && num_candidates < 64; i++)
+      if (glyphs[i].depth == depth - 1)
+        candidates[num_candidates++] = i;
+
+    if (num_candidates)
+      components[k] = candidates[random_int(num_candidates)];
+    else
+      components[k] = first_simple;
+  }
+
+  put16(&glyph->data, 0xFFFF); /* -1 */
+  put16(&glyph->data, 0); /* bounding box, filled in below */
+  put16(&glyph->data, 0);
+  put16(&glyph->data, 0);
+  put16(&glyph->data, 0);
+
+  for (k = 0; k < 2; k++)
+  {
+    Glyph* component = &glyphs[components[k]];
+    int dx = k ? glyphs[components[0]].advance : 0;
+    int dy = k ? random_int(200) - 100 : 0;
+
+
+    /* ARG_1_AND_2_ARE_WORDS | ARGS_ARE_XY_VALUES, MORE_COMPONENTS */
+    put16(&glyph->data, k ? 0x0003 : 0x0023);
+    put16(&glyph->data, (unsigned int)components[k]);
+    put16(&glyph->data, (unsigned int)dx);
+    put16(&glyph->data, (unsigned int)dy);
+
+    if (component->x_min + dx < glyph->x_min)
+      glyph->x_min = component->x_min + dx;
+    if (component->x_max + dx > glyph->x_max)
+      glyph->x_max = component->x_max + dx;
+    if (component->y_min + dy < glyph->y_min)
+      glyph->y_min = component->y_min + dy;
+    if (component->y_max + dy > glyph->y_max)
+      glyph->y_max = component->y_max + dy;
+
+    glyph->num_points += component->num_points;
+    glyph->num_contours += component->num_contours;
+    glyph->advance = dx + component->advance;
+  }
+
+  glyph->data.data[2] = (unsigned char)((unsigned int)glyph->x_min >> 8);
+  glyph->data.data[3] = (unsigned char)glyph->x_min;
+  glyph->data.data[4] = (unsigned char)((unsigned int)glyph->y_min >> 8);
+  glyph->data.data[5] = (unsigned char)glyph->y_min;
+  glyph->data.data[6] = (unsigned char)((unsigned int)glyph->x_max >> 8);
+  glyph->data.data[7] = (unsigned char)glyph->x_max;
+  glyph->data.data[8] = (unsigned char)((unsigned int)glyph->y_max >> 8);
+  glyph->data.data[9] = (unsigned char)glyph->y_max;
+}
+
+
+/* assign character codes from the scripts' ranges, */
+/* distributing the mapped glyphs evenly */
+
+static void
+assign_codes(Glyph* glyphs,
+             int num_simple,
+             const Params* params)
+{
+  unsigned char* used = (unsigned char*)calloc(MAX_UNICODE / 8, 1);
+  int idx = 1; /* skip `.notdef' */
+  int s;
+
+
+  if (!used)
+  {
+    fprintf(stderr, "ttfautohint-font-gen: allocation error\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (s = 0; s < params->num_scripts; s++)
+  {
+    const TA_Script_UniRangeRec* range = params->scripts[s]->ranges;
+    int quota = (num_simple - 1) / params->num_scripts
+                + (s < (num_simple - 1) % params->num_scripts);
+
+
+    for (; range->first && quota; range++)
+    {
+      unsigned long code;
+
+
+      for (code = range->first; code <= range->last && quota; code++)
+      {
+        /* the space character doesn't need an outline */
+        if (code == 0x20 || (used[code >> 3] & (1 << (code & 7))))
+          continue;
+
+        used[code >> 3] |= (unsigned char)(1 << (code & 7));
+        glyphs[idx++].code = code;
+        quota--;
+      }
+    }
+  }
+
+  free(used);
+}
+
+
+typedef struct Mapping_
+{
+  unsigned long code;
+  unsigned long glyph_idx;
+} Mapping;
+
+
+static int
+compare_mappings(const void* a,
+                 const void* b)
+{
+  const Mapping* ma = (const Mapping*)a;
+  const Mapping* mb = (const Mapping*)b;
+
+
+  return ma->code < mb->code ? -1 : ma->code > mb->code;
+}
+
+
+/* return the number of mappings starting at `m' */
+/* with consecutive character codes and glyph indices */
+
+static int
+run_length(const Mapping* m,
+           int num_mappings,
+           unsigned long limit)
+{
+  int n;
+
+
+  for (n = 1;
+       n < num_mappings
+       && m[n].code == m[n - 1].code + 1
+       && m[n].glyph_idx == m[n - 1].glyph_idx + 1
+       && m[n].code < limit;
+       n++)
+    ;
+
+  return n;
+}
+
+
+static void
+build_cmap(Buffer* b,
+           Glyph* glyphs,
+           int num_glyphs)
+{
+  Mapping* mappings;
+  int num_mappings = 0;
+  int num_bmp_mappings;
+  int num_groups = 0;
+  int num_bmp_segments = 1; /* the final 0xFFFF segment */
+  int i;
+  size_t subtable12_offset;
+
+
+  /* both `cmap' subtable formats need the mappings sorted by code */
+  mappings = (Mapping*)malloc((size_t)num_glyphs * sizeof (Mapping));
+  if (!mappings)
+  {
+    fprintf(stderr, "ttfautohint-font-gen: allocation error\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 1; i < num_glyphs; i++)
+  {
+    if (!glyphs[i].code)
+      continue;
+
+    mappings[num_mappings].code = glyphs[i].code;
+    mappings[num_mappings].glyph_idx = (unsigned long)i;
+    num_mappings++;
+  }
+  qsort(mappings, (size_t)num_mappings, sizeof (Mapping), compare_mappings);
+
+  for (num_bmp_mappings = 0;
+       num_bmp_mappings < num_mappings
+       && mappings[num_bmp_mappings].code < 0xFFFF;
+       num_bmp_mappings++)
+    ;
+
+  for (i = 0; i < num_bmp_mappings;
+       i += run_length(mappings + i, num_bmp_mappings - i, 0xFFFF))
+    num_bmp_segments++;
+  for (i = 0; i < num_mappings;
+       i += run_length(mappings + i, num_mappings - i, MAX_UNICODE))
+    num_groups++;
+
+  put16(b, 0); /* version */
+  put16(b, 2); /* number of subtables */
+  put16(b, 3);
+  put16(b, 1);
+  put32(b, 20);
+  put16(b, 3);
+  put16(b, 10);
+  subtable12_offset = b->len;
+  put32(b, 0); /* filled in below */
+
+  /* format 4 for BMP characters */
+  {
+    int seg_x2 = num_bmp_segments * 2;
+    int search_range = 2;
+    int entry_selector = 0;
+    int pass;
+
+
+    while (search_range * 2 <= seg_x2)
+    {
+      search_range *= 2;
+      entry_selector++;
+    }
+
+    put16(b, 4);
+    put16(b, (unsigned int)(16 + 8 * num_bmp_segments)); /* length */
+    put16(b, 0); /* language */
+    put16(b, (unsigned int)seg_x2);
+    put16(b, (unsigned int)search_range);
+    put16(b, (unsigned int)entry_selector);
+    put16(b, (unsigned int)(seg_x2 - search_range));
+
+    /* end codes, reserved pad, start codes, deltas, range offsets */
+    for (pass = 0; pass < 4; pass++)
+    {
+      int n;
+
+
+      for (i = 0; i < num_bmp_mappings; i += n)
+      {
+        const Mapping* m = mappings + i;
+
+
+        n = run_length(m, num_bmp_mappings - i, 0xFFFF);
+
+        if (pass == 0)
+          put16(b, (unsigned int)m[n - 1].code);
+        else if (pass == 1)
+          put16(b, (unsigned int)m->code);
+        else if (pass == 2)
+          put16(b, (unsigned int)(m->glyph_idx - m->code));
+        else
+          put16(b, 0);
+      }
+
+      if (pass == 0)
+      {
+        put16(b, 0xFFFF);
+        put16(b, 0); /* reserved pad */
+      }
+      else if (pass == 1)
+        put16(b, 0xFFFF);
+      else if (pass == 2)
+        put16(b, 1);
+      else
+        put16(b, 0);
+    }
+  }
+
+  /* format 12 for all characters */
+  set32(b, subtable12_offset, (unsigned long)b->len);
+
+  put16(b, 12);
+  put16(b, 0);
+  put32(b, 16 + 12 * (unsigned long)num_groups);
+  put32(b, 0); /* language */
+  put32(b, (unsigned long)num_groups);
+
+  {
+    int n;
+
+
+    for (i = 0; i < num_mappings; i += n)
+    {
+      const Mapping* m = mappings + i;
+
+
+      n = run_length(m, num_mappings - i, MAX_UNICODE);
+
+      put32(b, m->code);
+      put32(b, m[n - 1].code);
+      put32(b, m->glyph_idx);
+    }
+  }
+
+  free(mappings);
+}
+
+
+static void
+put_name(Buffer* strings,
+         Buffer* records,
+         unsigned int name_id,
+         const char* s)
+{
+  size_t len = strlen(s);
+
+
+  put16(records, 3); /* Windows */
+  put16(records, 1); /* Unicode BMP */
+  put16(records, 0x409); /* English (US) */
+  put16(records, name_id);
+  put16(records, (unsigned int)(2 * len));
+  put16(records, (unsigned int)strings->len);
+
+  while (*s)
+    put16(strings, (unsigned char)*s++);
+}
+
+
+static void
+build_name(Buffer* b,
+           int subfont)
+{
+  Buffer strings = { NULL, 0, 0 };
+  Buffer records = { NULL, 0, 0 };
+  char family[64];
+  char ps_name[64];
+
+
+  sprintf(family, "TA Synthetic %d", subfont);
+  sprintf(ps_name, "TASynthetic%d-Regular", subfont);
+
+  put_name(&strings, &records, 1, family);
+  put_name(&strings, &records, 2, "Regular");
+  put_name(&strings, &records, 3, ps_name);
+  put_name(&strings, &records, 4, family);
+  put_name(&strings, &records, 5, "Version 1.000");
+  put_name(&strings, &records, 6, ps_name);
+
+  put16(b, 0); /* format */
+  put16(b, 6); /* count */
+  put16(b, 6 + 6 * 12);
+  put_bytes(b, records.data, records.len);
+  put_bytes(b, strings.data, strings.len);
+
+  free(strings.data);
+  free(records.data);
+}
+
+
+/* create all tables of a subfont, sorted by tag */
+
+static int
+build_tables(Table* tables,
+             const Params* params,
+             int subfont)
+{
+  int num_glyphs = params->num_glyphs;
+  int num_composites = params->num_composites;
+  int num_simple = num_glyphs - num_composites;
+  Glyph* glyphs;
+  int i;
+
+  int x_min = 0x7FFF, y_min = 0x7FFF, x_max = -0x8000, y_max = -0x8000;
+  int advance_max = 0;
+  int max_points = 0, max_contours = 0;
+  int max_composite_points = 0, max_composite_contours = 0;
+  int max_depth = 0;
+  unsigned long first_code = 0xFFFF, last_code = 0;
+
+  Buffer* b;
+  Buffer glyf = { NULL, 0, 0 };
+  Buffer loca = { NULL, 0, 0 };
+
+
+  glyphs = (Glyph*)calloc((size_t)num_glyphs, sizeof (Glyph));
+  if (!glyphs)
+  {
+    fprintf(stderr, "ttfautohint-font-gen: allocation error\n");
+    exit(EXIT_FAILURE);
+  }
+
+  rand_state = params->seed + (unsigned long)subfont;
+
+  /* `.notdef' and the simple glyphs */
+  for (i = 0; i < num_simple; i++)
+    make_simple_glyph(&glyphs[i], params);
+
+  /* composite glyphs, distributed over the levels */
+  for (i = 0; i < num_composites; i++)
+  {
+    int depth = 1 + i * params->composite_depth / num_composites;
+
+
+    make_composite_glyph(glyphs, num_simple + i, 1, depth);
+  }
+
+  assign_codes(glyphs, num_simple, params);
+
+  for (i = 0; i < num_glyphs; i++)
+  {
+    Glyph* glyph = &glyphs[i];
+
+
+    put32(&loca, (unsigned long)glyf.len);
+    put_bytes(&glyf, glyph->data.data, glyph->data.len);
+    pad4(&glyf);
+
+    if (glyph->x_min < x_min)
+      x_min = glyph->x_min;
+    if (glyph->y_min < y_min)
+      y_min = glyph->y_min;
+    if (glyph->x_max > x_max)
+      x_max = glyph->x_max;
+    if (glyph->y_max > y_max)
+      y_max = glyph->y_max;
+    if (glyph->advance > advance_max)
+      advance_max = glyph->advance;
+
+    if (glyph->depth)
+    {
+      if (glyph->num_points > max_composite_points)
+        max_composite_points = glyph->num_points;
+      if (glyph->num_contours > max_composite_contours)
+        max_composite_contours = glyph->num_contours;
+      if (glyph->depth > max_depth)
+        max_depth = glyph->depth;
+    }
+    else
+    {
+      if (glyph->num_points > max_points)
+        max_points = glyph->num_points;
+      if (glyph->num_contours > max_contours)
+        max_contours = glyph->num_contours;
+    }
+
+    if (glyph->code)
+    {
+      unsigned long code = glyph->code > 0xFFFF ? 0xFFFF : glyph->code;
+
+
+      if (code < first_code)
+        first_code = code;
+      if (code > last_code)
+        last_code = code;
+    }
+  }
+  put32(&loca, (unsigned long)glyf.len);
+
+  /* OS/2 */
+  tables[0].tag = TAG('O', 'S', '/', '2');
+  b = &tables[0].data;
+  put16(b, 4); /* version */
+  put16(b, 1000); /* xAvgCharWidth */
+  put16(b, 400); /* usWeightClass */
+  put16(b, 5); /* usWidthClass */
+  put16(b, 0); /* fsType: installable embedding */
+  put16(b, 650); /* ySubscriptXSize */
+  put16(b, 700); /* ySubscriptYSize */
+  put16(b, 0); /* ySubscriptXOffset */
+  put16(b, 140); /* ySubscriptYOffset */
+  put16(b, 650); /* ySuperscriptXSize */
+  put16(b, 700); /* ySuperscriptYSize */
+  put16(b, 0); /* ySuperscriptXOffset */
+  put16(b, 480); /* ySuperscriptYOffset */
+  put16(b, 100); /* yStrikeoutSize */
+  put16(b, 530); /* yStrikeoutPosition */
+  put16(b, 0); /* sFamilyClass */
+  for (i = 0; i < 10; i++)
+    put8(b, 0); /* panose */
+  for (i = 0; i < 4; i++)
+    put32(b, 0); /* ulUnicodeRange1-4 */
+  put_bytes(b, "TAGN", 4); /* achVendID */
+  put16(b, 0x40); /* fsSelection: regular */
+  put16(b, (unsigned int)first_code);
+  put16(b, (unsigned int)last_code);
+  put16(b, ASCENDER); /* sTypoAscender */
+  put16(b, (unsigned int)DESCENDER); /* sTypoDescender */
+  put16(b, 0); /* sTypoLineGap */
+  put16(b, (unsigned int)(y_max > ASCENDER ? y_max : ASCENDER));
+  put16(b, (unsigned int)(y_min < DESCENDER ? -y_min : -DESCENDER));
+  put32(b, 1); /* ulCodePageRange1: Latin 1 */
+  put32(b, 0); /* ulCodePageRange2 */
+  put16(b, X_HEIGHT); /* sxHeight */
+  put16(b, CAP_HEIGHT); /* sCapHeight */
+  put16(b, 0); /* usDefaultChar */
+  put16(b, 0x20); /* usBreakChar */
+  put16(b, 2); /* usMaxContext */
+
+  /* cmap */
+  tables[1].tag = TAG('c', 'm', 'a', 'p');
+  build_cmap(&tables[1].data, glyphs, num_glyphs);
+
+  /* glyf */
+  tables[2].tag = TAG('g', 'l', 'y', 'f');
+  tables[2].data = glyf;
+
+  /* head */
+  tables[3].tag = TAG('h', 'e', 'a', 'd');
+  b = &tables[3].data;
+  put32(b, 0x00010000UL); /* version */
+  put32(b, 0x00010000UL); /* fontRevision */
+  put32(b, 0); /* checkSumAdjustment, filled in later */
+  put32(b, 0x5F0F3CF5UL); /* magicNumber */
+  put16(b, 0x000B); /* flags */
+  put16(b, UNITS_PER_EM);
+  put32(b, 0); /* created */
+  put32(b, 0);
+  put32(b, 0); /* modified */
+  put32(b, 0);
+  put16(b, (unsigned int)x_min);
+  put16(b, (unsigned int)y_min);
+  put16(b, (unsigned int)x_max);
+  put16(b, (unsigned int)y_max);
+  put16(b, 0); /* macStyle */
+  put16(b, 8); /* lowestRecPPEM */
+  put16(b, 2); /* fontDirectionHint */
+  put16(b, 1); /* indexToLocFormat: long offsets */
+  put16(b, 0); /* glyphDataFormat */
+
+  /* hhea */
+  tables[4].tag = TAG('h', 'h', 'e', 'a');
+  b = &tables[4].data;
+  put32(b, 0x00010000UL);
+  put16(b, ASCENDER);
+  put16(b, (unsigned int)DESCENDER);
+  put16(b, 0); /* lineGap */
+  put16(b, (unsigned int)advance_max);
+  put16(b, 0); /* minLeftSideBearing */
+  put16(b, 0); /* minRightSideBearing */
+  put16(b, (unsigned int)x_max); /* xMaxExtent */
+  put16(b, 1); /* caretSlopeRise */
+  put16(b, 0); /* caretSlopeRun */
+  put16(b, 0); /* caretOffset */
+  for (i = 0; i < 4; i++)
+    put16(b, 0); /* reserved */
+  put16(b, 0); /* metricDataFormat */
+  put16(b, (unsigned int)num_glyphs); /* numberOfHMetrics */
+
+  /* hmtx */
+  tables[5].tag = TAG('h', 'm', 't', 'x');
+  b = &tables[5].data;
+  for (i = 0; i < num_glyphs; i++)
+  {
+    put16(b, (unsigned int)glyphs[i].advance);
+    put16(b, (unsigned int)glyphs[i].x_min);
+  }
+
+  /* loca */
+  tables[6].tag = TAG('l', 'o', 'c', 'a');
+  tables[6].data = loca;
+
+  /* maxp */
+  tables[7].tag = TAG('m', 'a', 'x', 'p');
+  b = &tables[7].data;
+  put32(b, 0x00010000UL);
+  put16(b, (unsigned int)num_glyphs);
+  put16(b, (unsigned int)max_points);
+  put16(b, (unsigned int)max_contours);
+  put16(b, (unsigned int)max_composite_points);
+  put16(b, (unsigned int)max_composite_contours);
+  put16(b, 2); /* maxZones */
+  put16(b, 0); /* maxTwilightPoints */
+  put16(b, 0); /* maxStorage */
+  put16(b, 0); /* maxFunctionDefs */
+  put16(b, 0); /* maxInstructionDefs */
+  put16(b, 0); /* maxStackElements */
+  put16(b, 0); /* maxSizeOfInstructions */
+  put16(b, num_composites ? 2 : 0); /* maxComponentElements */
+  put16(b, (unsigned int)max_depth); /* maxComponentDepth */
+
+  /* name */
+  tables[8].tag = TAG('n', 'a', 'm', 'e');
+  build_name(&tables[8].data, subfont);
+
+  /* post, format 3.0 (no glyph names) */
+  tables[9].tag = TAG('p', 'o', 's', 't');
+  b = &tables[9].data;
+  put32(b, 0x00030000UL);
+  put32(b, 0); /* italicAngle */
+  put16(b, (unsigned int)-100); /* underlinePosition */
+  put16(b, 50); /* underlineThickness */
+  put32(b, 0); /* isFixedPitch */
+  put32(b, 0); /* minMemType42 */
+  put32(b, 0);
+  put32(b, 0);
+  put32(b, 0);
+
+  for (i = 0; i < num_glyphs; i++)
+    free(glyphs[i].data.data);
+  free(glyphs);
+
+  return 10;
+}
+
+
+/* append the table directory and the tables of a subfont */
+
+static void
+write_subfont(Buffer* out,
+              size_t font_offset,
+              Table* tables,
+              int num_tables,
+              int is_collection)
+{
+  size_t dir_offset = out->len;
+  size_t head_offset = 0;
+  int search_range = 1;
+  int entry_selector = 0;
+  int i;
+
+
+  while (search_range * 2 <= num_tables)
+  {
+    search_range *= 2;
+    entry_selector++;
+  }
+
+  put32(out, 0x00010000UL);
+  put16(out, (unsigned int)num_tables);
+  put16(out, (unsigned int)(search_range * 16));
+  put16(out, (unsigned int)entry_selector);
+  put16(out, (unsigned int)(num_tables * 16 - search_range * 16));
+
+  for (i = 0; i < num_tables; i++)
+  {
+    put32(out, tables[i].tag);
+    put32(out, 0); /* checksum, offset, and length follow */
+    put32(out, 0);
+    put32(out, 0);
+  }
+
+  for (i = 0; i < num_tables; i++)
+  {
+    size_t entry = dir_offset + 12 + (size_t)i * 16;
+
+
+    pad4(out);
+
+    if (tables[i].tag == TAG('h', 'e', 'a', 'd'))
+      head_offset = out->len;
+
+    set32(out, entry + 4, checksum(tables[i].data.data,
+                                   tables[i].data.len));
+    set32(out, entry + 8, (unsigned long)out->len);
+    set32(out, entry + 12, (unsigned long)tables[i].data.len);
+
+    put_bytes(out, tables[i].data.data, tables[i].data.len);
+  }
+  pad4(out);
+
+  /* for a collection, we use the checksum of the subfont's data */
+  set32(out, head_offset + 8,
+        (0xB1B0AFBAUL
+         - checksum(out->data + (is_collection ? font_offset : 0),
+                    out->len - (is_collection ? font_offset : 0)))
+        & 0xFFFFFFFFUL);
+}
+
+
+static void
+usage(void)
+{
+  fprintf(stderr,
+          "usage: ttfautohint-font-gen [-g glyphs] [-p points]"
+          " [-c contours]\n"
+          "                            [-C composites] [-d depth]"
+          " [-s scripts]\n"
+          "                            [-n subfonts] [-r seed]"
+          " output-file\n");
+  exit(EXIT_FAILURE);
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  Params params;
+  const char* script_list = "latn";
+  Buffer out = { NULL, 0, 0 };
+  FILE* f;
+  int c, i;
+
+
+  params.num_glyphs = 256;
+  params.num_points = 48;
+  params.num_contours = 3;
+  params.num_composites = 0;
+  params.composite_depth = 1;
+  params.num_subfonts = 1;
+  params.seed = 1;
+
+  while ((c = getopt(argc, argv, "g:p:c:C:d:s:n:r:")) != -1)
+  {
+    switch (c)
+    {
+    case 'g':
+      params.num_glyphs = atoi(optarg);
+      break;
+    case 'p':
+      params.num_points = atoi(optarg);
+      break;
+    case 'c':
+      params.num_contours = atoi(optarg);
+      break;
+    case 'C':
+      params.num_composites = atoi(optarg);
+      break;
+    case 'd':
+      params.composite_depth = atoi(optarg);
+      break;
+    case 's':
+      script_list = optarg;
+      break;
+    case 'n':
+      params.num_subfonts = atoi(optarg);
+      break;
+    case 'r':
+      params.seed = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if (optind != argc - 1)
+    usage();
+
+  if (params.num_contours < 1)
+    params.num_contours = 1;
+  if (params.num_points < 4 * params.num_contours)
+    params.num_points = 4 * params.num_contours;
+  if (params.composite_depth < 1)
+    params.composite_depth = 1;
+  if (params.num_subfonts < 1)
+    params.num_subfonts = 1;
+  if (params.num_composites < 0
+      || params.num_glyphs - params.num_composites < 2
+      || params.num_glyphs > 0xFFFF
+      || params.num_points > 0xFFFF)
+  {
+    fprintf(stderr, "ttfautohint-font-gen: invalid number of glyphs\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* parse the script tags */
+  params.scripts = (const Script**)malloc(sizeof (Script*)
+                                          * (strlen(script_list) + 1));
+  params.num_scripts = 0;
+  {
+    char* list = strdup(script_list);
+    char* tag;
+
+
+    if (!list || !params.scripts)
+    {
+      fprintf(stderr, "ttfautohint-font-gen: allocation error\n");
+      exit(EXIT_FAILURE);
+    }
+
+    for (tag = strtok(list, ","); tag; tag = strtok(NULL, ","))
+    {
+      const Script* script;
+
+
+      for (script = scripts; script->tag; script++)
+        if (!strcmp(script->tag, tag))
+          break;
+
+      if (!script->tag || !strcmp(tag, "none"))
+      {
+        fprintf(stderr, "ttfautohint-font-gen: unknown script `%s'\n", tag);
+        exit(EXIT_FAILURE);
+      }
+
+      params.scripts[params.num_scripts++] = script;
+    }
+
+    free(list);
+  }
+
+  if (!params.num_scripts)
+    usage();
+
+  if (params.num_subfonts > 1)
+  {
+    /* TTC header; the offsets get filled in below */
+    put32(&out, TAG('t', 't', 'c', 'f'));
+    put32(&out, 0x00010000UL);
+    put32(&out, (unsigned long)params.num_subfonts);
+    for (i = 0; i < params.num_subfonts; i++)
+      put32(&out, 0);
+  }
+
+  for (i = 0; i < params.num_subfonts; i++)
+  {
+    Table tables[10];
+    int num_tables;
+    int j;
+
+
+    memset(tables, 0, sizeof (tables));
+    num_tables = build_tables(tables, &params, i);
+
+    pad4(&out);
+    if (params.num_subfonts > 1)
+      set32(&out, 12 + 4 * (size_t)i, (unsigned long)out.len);
+
+    write_subfont(&out, out.len, tables, num_tables,
+                  params.num_subfonts > 1);
+
+    for (j = 0; j < num_tables; j++)
+      free(tables[j].data.data);
+  }
+
+  f = fopen(argv[optind], "wb");
+  if (!f || fwrite(out.data, 1, out.len, f) != out.len || fclose(f))
+  {
+    perror(argv[optind]);
+    exit(EXIT_FAILURE);
+  }
+
+  free(out.data);
+  free(params.scripts);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of ttfautohint-font-gen.c */
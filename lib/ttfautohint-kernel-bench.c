@@ -0,0 +1,981 @@
+/* ttfautohint-kernel-bench.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) \
+ *         -I.. -I. \
+ *         `pkg-config --cflags freetype2 harfbuzz` \
+ *         -o ttfautohint-kernel-bench ttfautohint-kernel-bench.c \
+ *         -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc \
+ *         .libs/libttfautohint.a \
+ *         `pkg-config --libs freetype2 harfbuzz` -lm
+ *
+ * after configuration and compilation of the library (the `--wrap'
+ * options are specific to GNU ld; they make the program count memory
+ * allocations), then run
+ *
+ *   ./ttfautohint-kernel-bench [-n repetitions] [-p ppem] [-g glyphs] \
+ *                              [-b baseline [-w]] [-t threshold] font.ttf
+ *
+ * The program measures the time and the number of memory allocations of
+ * the library's most frequently called functions (`kernels').  Its
+ * fixtures are real glyphs recorded at startup: the outlines of the glyphs
+ * in the number set `glyphs' (default: all glyphs) of the given font,
+ * scaled to `ppem' (default: 16), and the bytecode, push arguments, and
+ * SFNT tables of the font hinted by ttfautohint with default options.
+ * The kernels are
+ *
+ *   segments     `ta_latin_hints_compute_segments', per glyph and dimension
+ *   link         `ta_latin_hints_link_segments', per glyph and dimension
+ *   edges        `ta_latin_hints_compute_edges', per glyph and dimension
+ *   weak-points  `ta_glyph_hints_align_weak_points', per glyph and
+ *                dimension, after aligning edge and strong points to the
+ *                rounded edge positions
+ *   checksum     `TA_table_compute_checksum', per SFNT table
+ *   build-push   `TA_build_push', per glyph (all push arguments of a glyph
+ *                program)
+ *   peephole     `TA_sfnt_optimize_bytecode', per glyph program
+ *   numberset    `number_set_parse', per string (representative values
+ *                for ttfautohint's options)
+ *   llrb-insert, llrb-find, llrb-remove
+ *                operations on a red-black tree of `llrb.h', per point of
+ *                a glyph, inserted in the order of increasing x coordinates
+ *
+ * The latin kernels use the default standard width of the latin writing
+ * system (that is, no blue zones or style-specific widths are set up).
+ *
+ * For each kernel, the program runs all fixtures `repetitions' times
+ * (default: 10) and prints the fastest time per operation of a
+ * repetition, together with the average number of allocations per
+ * operation.
+ *
+ * If a baseline file is given, the times are compared with it; kernels
+ * that are more than `threshold' percent (default: 10) slower are marked,
+ * and the exit code is 1.  If the baseline file doesn't exist or option
+ * `-w' is given, the times are written to it instead.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h> /* for llrb.h */
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ta.h"
+#include "llrb.h"
+
+
+/* memory allocation counting, activated with GNU ld's `--wrap' option */
+
+static unsigned long num_allocs;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb,
+                    size_t size);
+void* __real_realloc(void* ptr,
+                     size_t size);
+
+
+void*
+__wrap_malloc(size_t size)
+{
+  num_allocs++;
+  return __real_malloc(size);
+}
+
+
+void*
+__wrap_calloc(size_t nmemb,
+              size_t size)
+{
+  num_allocs++;
+  return __real_calloc(nmemb, size);
+}
+
+
+void*
+__wrap_realloc(void* ptr,
+               size_t size)
+{
+  num_allocs++;
+  return __real_realloc(ptr, size);
+}
+
+
+/* the kernels */
+
+enum
+{
+  K_SEGMENTS,
+  K_LINK,
+  K_EDGES,
+  K_WEAK_POINTS,
+  K_CHECKSUM,
+  K_BUILD_PUSH,
+  K_PEEPHOLE,
+  K_NUMBERSET,
+  K_LLRB_INSERT,
+  K_LLRB_FIND,
+  K_LLRB_REMOVE,
+
+  NUM_KERNELS
+};
+
+typedef struct Kernel_
+{
+  const char* name;
+
+  double best_ns; /* fastest time per operation of a repetition */
+  double rep_ns; /* time of the current repetition */
+  unsigned long rep_ops; /* operations of the current repetition */
+
+  unsigned long total_ops;
+  unsigned long total_allocs;
+} Kernel;
+
+static Kernel kernels[NUM_KERNELS] =
+{
+  { "segments", 0, 0, 0, 0, 0 },
+  { "link", 0, 0, 0, 0, 0 },
+  { "edges", 0, 0, 0, 0, 0 },
+  { "weak-points", 0, 0, 0, 0, 0 },
+  { "checksum", 0, 0, 0, 0, 0 },
+  { "build-push", 0, 0, 0, 0, 0 },
+  { "peephole", 0, 0, 0, 0, 0 },
+  { "numberset", 0, 0, 0, 0, 0 },
+  { "llrb-insert", 0, 0, 0, 0, 0 },
+  { "llrb-find", 0, 0, 0, 0, 0 },
+  { "llrb-remove", 0, 0, 0, 0, 0 }
+};
+
+
+static double timer_overhead;
+
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+/* execute `stmt' as `n' operations of kernel `k' */
+#define MEASURE(k, n, stmt) \
+          do \
+          { \
+            unsigned long allocs_ = num_allocs; \
+            double start_ = now_ns(); \
+\
+\
+            stmt; \
+            kernels[k].rep_ns += now_ns() - start_ - timer_overhead; \
+            kernels[k].total_allocs += num_allocs - allocs_; \
+            kernels[k].rep_ops += (n); \
+          } while (0)
+
+
+/* representative arguments of options like `x-height-snapping-exceptions' */
+
+static const char* number_sets[] =
+{
+  "-",
+  "8-",
+  "6-9, 12, 14-17, 20-",
+  "7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31, 33, 35, 37, 39",
+  "  10 - 12 ,14,  16 - 18 , 22-24, 30 ,32-34,  40- 42,  48-",
+  NULL
+};
+
+
+/* a red-black tree of point indices, as used in `tabytecode.c' */
+
+typedef struct Node Node;
+struct Node
+{
+  LLRB_ENTRY(Node) entry;
+  FT_UShort point;
+};
+
+
+static int
+nodecmp(Node* e1,
+        Node* e2)
+{
+  return e1->point - e2->point;
+}
+
+
+typedef struct points points;
+
+LLRB_HEAD(points, Node);
+
+/* no trailing semicolon in the next line */
+LLRB_GENERATE_STATIC(points, Node, entry, nodecmp)
+
+
+/* the fixtures */
+
+typedef struct Glyph_Fixture_
+{
+  FT_Outline outline;
+
+  /* point indices sorted by x coordinate */
+  FT_UShort* order;
+
+  /* the hinted glyph's bytecode and its push arguments */
+  FT_Byte* ins;
+  FT_UInt ins_len;
+  FT_UInt* args;
+  FT_UInt num_args;
+  FT_Bool need_words;
+} Glyph_Fixture;
+
+typedef struct Table_Fixture_
+{
+  FT_Byte* buf;
+  FT_ULong len;
+} Table_Fixture;
+
+
+static FT_Outline* sort_outline;
+
+
+static int
+compare_points(const void* a,
+               const void* b)
+{
+  FT_Pos xa = sort_outline->points[*(const FT_UShort*)a].x;
+  FT_Pos xb = sort_outline->points[*(const FT_UShort*)b].x;
+
+
+  return xa < xb ? -1 : xa > xb;
+}
+
+
+/* extract all push arguments of a glyph program */
+
+static void
+collect_push_args(Glyph_Fixture* fixture)
+{
+  FT_Byte* p = fixture->ins;
+  FT_Byte* limit = p + fixture->ins_len;
+
+
+  /* there can't be more arguments than bytes */
+  fixture->args = (FT_UInt*)malloc((fixture->ins_len + 1)
+                                   * sizeof (FT_UInt));
+  assert(fixture->args);
+
+  fixture->num_args = 0;
+  fixture->need_words = 0;
+
+  while (p < limit)
+  {
+    FT_Byte opcode = *p++;
+    FT_UInt n;
+    FT_Bool is_word;
+
+
+    if (opcode == NPUSHB || opcode == NPUSHW)
+    {
+      if (p >= limit)
+        break;
+      n = *p++;
+      is_word = (opcode == NPUSHW);
+    }
+    else if (opcode >= PUSHB_1 && opcode <= PUSHB_8)
+    {
+      n = opcode - PUSHB_1 + 1;
+      is_word = 0;
+    }
+    else if (opcode >= PUSHW_1 && opcode <= PUSHW_8)
+    {
+      n = opcode - PUSHW_1 + 1;
+      is_word = 1;
+    }
+    else
+      continue; /* ttfautohint emits no other inline data */
+
+    if (is_word)
+      fixture->need_words = 1;
+
+    for (; n && p + is_word < limit; n--)
+    {
+      if (is_word)
+      {
+        fixture->args[fixture->num_args++] = (FT_UInt)((p[0] << 8) | p[1]);
+        p += 2;
+      }
+      else
+        fixture->args[fixture->num_args++] = *p++;
+    }
+  }
+}
+
+
+/* get the bytecode of simple glyph `idx' from the `glyf' table */
+
+static void
+get_glyph_bytecode(Glyph_Fixture* fixture,
+                   FT_Byte* glyf,
+                   FT_ULong glyf_len,
+                   FT_Byte* loca,
+                   FT_ULong loca_len,
+                   FT_Bool long_offsets,
+                   FT_UInt idx)
+{
+  FT_ULong offset, offset_next;
+  FT_Short num_contours;
+  FT_ULong ins_offset;
+  FT_UInt ins_len;
+
+
+  fixture->ins = NULL;
+  fixture->ins_len = 0;
+
+  if (long_offsets)
+  {
+    if ((idx + 2) * 4 > loca_len)
+      return;
+    offset = (FT_ULong)((loca[idx * 4] << 24) | (loca[idx * 4 + 1] << 16)
+                        | (loca[idx * 4 + 2] << 8) | loca[idx * 4 + 3]);
+    offset_next = (FT_ULong)((loca[idx * 4 + 4] << 24)
+                             | (loca[idx * 4 + 5] << 16)
+                             | (loca[idx * 4 + 6] << 8) | loca[idx * 4 + 7]);
+  }
+  else
+  {
+    if ((idx + 2) * 2 > loca_len)
+      return;
+    offset = (FT_ULong)((loca[idx * 2] << 8) | loca[idx * 2 + 1]) * 2;
+    offset_next = (FT_ULong)((loca[idx * 2 + 2] << 8)
+                             | loca[idx * 2 + 3]) * 2;
+  }
+
+  if (offset_next <= offset + 10 || offset_next > glyf_len)
+    return;
+
+  num_contours = (FT_Short)((glyf[offset] << 8) | glyf[offset + 1]);
+  if (num_contours < 0)
+    return; /* we ignore composite glyphs */
+
+  ins_offset = offset + 10 + 2 * (FT_ULong)num_contours;
+  if (ins_offset + 2 > offset_next)
+    return;
+
+  ins_len = (FT_UInt)((glyf[ins_offset] << 8) | glyf[ins_offset + 1]);
+  if (ins_offset + 2 + ins_len > offset_next)
+    return;
+
+  fixture->ins = (FT_Byte*)malloc(ins_len);
+  assert(fixture->ins || !ins_len);
+  memcpy(fixture->ins, glyf + ins_offset + 2, ins_len);
+  fixture->ins_len = ins_len;
+}
+
+
+static FT_Byte*
+load_table(FT_Face face,
+           FT_ULong tag,
+           FT_ULong* len)
+{
+  FT_Byte* buf;
+  FT_Error error;
+
+
+  *len = 0;
+  error = FT_Load_Sfnt_Table(face, tag, 0, NULL, len);
+  if (error)
+    return NULL;
+
+  /* `TA_table_compute_checksum' expects a multiple of 4 */
+  buf = (FT_Byte*)calloc(*len + 3, 1);
+  assert(buf);
+  error = FT_Load_Sfnt_Table(face, tag, 0, buf, len);
+  assert(!error);
+
+  return buf;
+}
+
+
+static char*
+read_file(const char* name,
+          size_t* len)
+{
+  FILE* f;
+  char* buf;
+  long file_len;
+  size_t read_len;
+
+
+  f = fopen(name, "rb");
+  if (!f)
+    return NULL;
+
+  fseek(f, 0, SEEK_END);
+  file_len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  assert(file_len >= 0);
+
+  buf = (char*)malloc((size_t)file_len + 1);
+  assert(buf);
+  read_len = fread(buf, 1, (size_t)file_len, f);
+  assert(read_len == (size_t)file_len);
+  fclose(f);
+
+  buf[file_len] = '\0';
+  *len = (size_t)file_len;
+
+  return buf;
+}
+
+
+static void
+usage(void)
+{
+  fprintf(stderr,
+          "usage: ttfautohint-kernel-bench [-n repetitions] [-p ppem]"
+          " [-g glyphs]\n"
+          "                                [-b baseline [-w]]"
+          " [-t threshold] font\n");
+  exit(2);
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  char* in_buf;
+  size_t in_len;
+  char* out_buf = NULL;
+  size_t out_len = 0;
+
+  int num_reps = 10;
+  FT_UInt ppem = 16;
+  const char* glyph_set_string = NULL;
+  number_range* glyph_set = NULL;
+  const char* baseline_name = NULL;
+  int write_baseline = 0;
+  double threshold = 10;
+
+  FT_Library library;
+  FT_Face face;
+  FT_Face hinted_face;
+  FT_Error error;
+  TA_Error ta_error;
+
+  Glyph_Fixture* glyphs;
+  FT_UInt num_glyphs = 0;
+  Table_Fixture* tables;
+  FT_UInt num_tables = 0;
+  FT_UInt max_points = 0;
+  FT_UInt max_args = 0;
+
+  TA_LatinMetricsRec metrics;
+  TA_GlyphHintsRec hints;
+  SFNT sfnt;
+  FONT* font;
+  FT_Byte* ins_buf;
+  FT_Byte* push_buf;
+  Node* nodes;
+  struct points tree;
+
+  FILE* baseline = NULL;
+  int num_regressions = 0;
+  int c, i, r;
+  FT_UInt g;
+  int dim;
+
+
+  while ((c = getopt(argc, argv, "n:p:g:b:wt:")) != -1)
+  {
+    switch (c)
+    {
+    case 'n':
+      num_reps = atoi(optarg);
+      break;
+    case 'p':
+      ppem = (FT_UInt)atoi(optarg);
+      break;
+    case 'g':
+      glyph_set_string = optarg;
+      break;
+    case 'b':
+      baseline_name = optarg;
+      break;
+    case 'w':
+      write_baseline = 1;
+      break;
+    case 't':
+      threshold = atof(optarg);
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if (optind != argc - 1)
+    usage();
+  if (num_reps < 1 || !ppem || (write_baseline && !baseline_name))
+    usage();
+
+  if (glyph_set_string)
+  {
+    const char* s = number_set_parse(glyph_set_string, &glyph_set, 0, -1);
+
+
+    if (*s || !glyph_set || glyph_set == NUMBERSET_ALLOCATION_ERROR)
+    {
+      fprintf(stderr, "invalid glyph set `%s'\n", glyph_set_string);
+      return 2;
+    }
+  }
+
+  in_buf = read_file(argv[optind], &in_len);
+  if (!in_buf)
+  {
+    fprintf(stderr, "cannot read `%s'\n", argv[optind]);
+    return 2;
+  }
+
+  /* a fixed epoch makes the output reproducible */
+  ta_error = TTF_autohint("in-buffer, in-buffer-len,"
+                          "out-buffer, out-buffer-len, epoch",
+                          in_buf, in_len,
+                          &out_buf, &out_len,
+                          0ULL);
+  if (ta_error)
+  {
+    fprintf(stderr, "hinting failed with error 0x%02X\n", ta_error);
+    return 2;
+  }
+
+  error = FT_Init_FreeType(&library);
+  assert(!error);
+  error = FT_New_Memory_Face(library, (FT_Byte*)in_buf, (FT_Long)in_len,
+                             0, &face);
+  assert(!error);
+  error = FT_New_Memory_Face(library, (FT_Byte*)out_buf, (FT_Long)out_len,
+                             0, &hinted_face);
+  assert(!error);
+
+  /* record the fixtures */
+  glyphs = (Glyph_Fixture*)calloc((size_t)face->num_glyphs,
+                                  sizeof (Glyph_Fixture));
+  assert(glyphs);
+
+  {
+    FT_ULong glyf_len, loca_len, head_len;
+    FT_Byte* glyf = load_table(hinted_face, TTAG_glyf, &glyf_len);
+    FT_Byte* loca = load_table(hinted_face, TTAG_loca, &loca_len);
+    FT_Byte* head = load_table(hinted_face, TTAG_head, &head_len);
+
+
+    assert(glyf && loca && head && head_len >= 54);
+
+    for (g = 0; g < (FT_UInt)face->num_glyphs; g++)
+    {
+      Glyph_Fixture* fixture = &glyphs[num_glyphs];
+      FT_Outline* outline = &face->glyph->outline;
+      FT_UShort k;
+
+
+      if (glyph_set && !number_set_is_element(glyph_set, (int)g))
+        continue;
+
+      error = FT_Load_Glyph(face, g, FT_LOAD_NO_SCALE);
+      if (error || outline->n_points <= 0)
+        continue;
+
+      error = FT_Outline_New(library,
+                             (FT_UInt)outline->n_points,
+                             outline->n_contours,
+                             &fixture->outline);
+      assert(!error);
+      FT_Outline_Copy(outline, &fixture->outline);
+
+      fixture->order = (FT_UShort*)malloc((size_t)outline->n_points
+                                          * sizeof (FT_UShort));
+      assert(fixture->order);
+      for (k = 0; k < outline->n_points; k++)
+        fixture->order[k] = k;
+      sort_outline = &fixture->outline;
+      qsort(fixture->order, (size_t)outline->n_points, sizeof (FT_UShort),
+            compare_points);
+
+      get_glyph_bytecode(fixture, glyf, glyf_len, loca, loca_len,
+                         head[51] != 0, g);
+      collect_push_args(fixture);
+
+      if ((FT_UInt)outline->n_points > max_points)
+        max_points = (FT_UInt)outline->n_points;
+      if (fixture->num_args > max_args)
+        max_args = fixture->num_args;
+
+      num_glyphs++;
+    }
+
+    free(glyf);
+    free(loca);
+    free(head);
+  }
+
+  {
+    FT_ULong num_sfnt_tables = 0;
+
+
+    FT_Sfnt_Table_Info(hinted_face, 0, NULL, &num_sfnt_tables);
+    tables = (Table_Fixture*)calloc(num_sfnt_tables, sizeof (Table_Fixture));
+    assert(tables);
+
+    for (i = 0; i < (int)num_sfnt_tables; i++)
+    {
+      FT_ULong tag, len;
+
+
+      if (FT_Sfnt_Table_Info(hinted_face, (FT_UInt)i, &tag, &len))
+        continue;
+
+      tables[num_tables].buf = load_table(hinted_face, tag,
+                                          &tables[num_tables].len);
+      if (tables[num_tables].buf)
+      {
+        tables[num_tables].len = (tables[num_tables].len + 3) & ~3UL;
+        num_tables++;
+      }
+    }
+  }
+
+  printf("%u glyphs, %u tables, %u ppem\n", num_glyphs, num_tables, ppem);
+
+  /* set up the hinting data similar to `ta_latin_metrics_init_widths' */
+  memset(&metrics, 0, sizeof (TA_LatinMetricsRec));
+  metrics.root.style_class = ta_style_classes[TA_STYLE_LATN_DFLT];
+  metrics.root.scaler.face = face;
+  metrics.root.scaler.x_scale = FT_DivFix((FT_Long)ppem << 6,
+                                          face->units_per_EM);
+  metrics.root.scaler.y_scale = metrics.root.scaler.x_scale;
+  metrics.root.scaler.render_mode = FT_RENDER_MODE_NORMAL;
+  metrics.units_per_em = face->units_per_EM;
+
+  for (dim = 0; dim < TA_DIMENSION_MAX; dim++)
+  {
+    TA_LatinAxis axis = &metrics.axis[dim];
+
+
+    axis->width_count = 1;
+    axis->widths[0].org = TA_LATIN_CONSTANT(&metrics, 50);
+    axis->standard_width = axis->widths[0].org;
+    axis->edge_distance_threshold = axis->standard_width / 5;
+  }
+
+  ta_glyph_hints_init(&hints);
+  ta_glyph_hints_rescale(&hints, (TA_StyleMetrics)&metrics);
+  hints.x_scale = metrics.root.scaler.x_scale;
+  hints.y_scale = metrics.root.scaler.y_scale;
+
+  memset(&sfnt, 0, sizeof (SFNT));
+  font = (FONT*)calloc(1, sizeof (FONT));
+  assert(font);
+  font->hinting_range_min = TA_HINTING_RANGE_MIN;
+  font->hinting_range_max = TA_HINTING_RANGE_MAX;
+
+  ins_buf = (FT_Byte*)malloc(0x10000);
+  push_buf = (FT_Byte*)malloc(2 * max_args + 2 * ((max_args + 254) / 255)
+                              + 1);
+  nodes = (Node*)malloc((max_points + 1) * sizeof (Node));
+  assert(ins_buf && push_buf && nodes);
+
+  /* calibrate the time measurement itself */
+  {
+    double start = now_ns();
+
+
+    for (i = 0; i < 10000; i++)
+      now_ns();
+    timer_overhead = (now_ns() - start) / 10000;
+  }
+
+  for (r = 0; r < num_reps; r++)
+  {
+    for (i = 0; i < NUM_KERNELS; i++)
+    {
+      kernels[i].rep_ns = 0;
+      kernels[i].rep_ops = 0;
+    }
+
+    for (g = 0; g < num_glyphs; g++)
+    {
+      Glyph_Fixture* fixture = &glyphs[g];
+      FT_UShort n = (FT_UShort)fixture->outline.n_points;
+      FT_UShort k;
+
+
+      /* the latin kernels, in the order of `ta_latin_hints_apply' */
+      error = ta_glyph_hints_reload(&hints, &fixture->outline);
+      assert(!error);
+
+      for (dim = 0; dim < TA_DIMENSION_MAX; dim++)
+      {
+        TA_LatinAxis axis = &metrics.axis[dim];
+
+
+        MEASURE(K_SEGMENTS, 1,
+                error = ta_latin_hints_compute_segments(&hints,
+                                                        (TA_Dimension)dim));
+        assert(!error);
+        MEASURE(K_LINK, 1,
+                ta_latin_hints_link_segments(&hints,
+                                             axis->width_count,
+                                             axis->widths,
+                                             (TA_Dimension)dim));
+        MEASURE(K_EDGES, 1,
+                error = ta_latin_hints_compute_edges(&hints,
+                                                     (TA_Dimension)dim));
+        assert(!error);
+      }
+
+      for (dim = 0; dim < TA_DIMENSION_MAX; dim++)
+      {
+        TA_AxisHints axis = &hints.axis[dim];
+        TA_Edge edge;
+
+
+        for (edge = axis->edges; edge < axis->edges + axis->num_edges; edge++)
+          edge->pos = TA_PIX_ROUND(edge->opos);
+
+        ta_glyph_hints_align_edge_points(&hints, (TA_Dimension)dim);
+        ta_glyph_hints_align_strong_points(&hints, (TA_Dimension)dim);
+        MEASURE(K_WEAK_POINTS, 1,
+                ta_glyph_hints_align_weak_points(&hints,
+                                                 (TA_Dimension)dim));
+      }
+
+      /* the bytecode kernels */
+      if (fixture->num_args)
+        MEASURE(K_BUILD_PUSH, 1,
+                TA_build_push(push_buf,
+                              fixture->args,
+                              fixture->num_args,
+                              fixture->need_words,
+                              1));
+
+      if (fixture->ins_len)
+      {
+        FT_UInt len = fixture->ins_len;
+
+
+        memcpy(ins_buf, fixture->ins, len);
+        MEASURE(K_PEEPHOLE, 1,
+                error = TA_sfnt_optimize_bytecode(&sfnt, font,
+                                                  ins_buf, &len));
+        assert(!error);
+      }
+
+      /* the red-black tree */
+      LLRB_INIT(&tree);
+      for (k = 0; k < n; k++)
+        nodes[k].point = fixture->order[k];
+
+      MEASURE(K_LLRB_INSERT, n,
+              for (k = 0; k < n; k++)
+                LLRB_INSERT(points, &tree, &nodes[k]));
+      MEASURE(K_LLRB_FIND, n,
+              for (k = 0; k < n; k++)
+              {
+                nodes[n].point = k;
+                if (!LLRB_FIND(points, &tree, &nodes[n]))
+                  abort();
+              });
+      MEASURE(K_LLRB_REMOVE, n,
+              for (k = 0; k < n; k++)
+                LLRB_REMOVE(points, &tree, &nodes[k]));
+    }
+
+    for (i = 0; i < (int)num_tables; i++)
+    {
+      volatile FT_ULong checksum;
+
+
+      MEASURE(K_CHECKSUM, 1,
+              checksum = TA_table_compute_checksum(tables[i].buf,
+                                                   tables[i].len));
+      (void)checksum;
+    }
+
+    for (i = 0; number_sets[i]; i++)
+    {
+      number_range* number_set;
+      const char* end;
+
+
+      MEASURE(K_NUMBERSET, 1,
+              end = number_set_parse(number_sets[i], &number_set, 1, 0xFFFF));
+      assert(!*end && number_set != NUMBERSET_ALLOCATION_ERROR);
+      number_set_free(number_set);
+    }
+
+    for (i = 0; i < NUM_KERNELS; i++)
+    {
+      Kernel* kernel = &kernels[i];
+      double ns;
+
+
+      if (!kernel->rep_ops)
+        continue;
+
+      kernel->total_ops += kernel->rep_ops;
+
+      ns = kernel->rep_ns / (double)kernel->rep_ops;
+      if (!r || ns < kernel->best_ns)
+        kernel->best_ns = ns;
+    }
+  }
+
+  /* compare with or write the baseline */
+  if (baseline_name)
+  {
+    baseline = write_baseline ? NULL : fopen(baseline_name, "r");
+    if (!baseline)
+      write_baseline = 1;
+  }
+
+  printf("%-12s %10s %10s %10s",
+         "kernel", "ops/rep", "ns/op", "allocs/op");
+  if (baseline)
+    printf(" %10s %8s", "baseline", "change");
+  printf("\n");
+
+  for (i = 0; i < NUM_KERNELS; i++)
+  {
+    Kernel* kernel = &kernels[i];
+    unsigned long rep_ops = kernel->total_ops / (unsigned long)num_reps;
+
+
+    if (!kernel->total_ops)
+    {
+      printf("%-12s %10s\n", kernel->name, "no data");
+      continue;
+    }
+
+    printf("%-12s %10lu %10.1f %10.2f",
+           kernel->name, rep_ops, kernel->best_ns,
+           (double)kernel->total_allocs / (double)kernel->total_ops);
+
+    if (baseline)
+    {
+      char line[128];
+      char name[64];
+      double base_ns;
+      int found = 0;
+
+
+      rewind(baseline);
+      while (fgets(line, sizeof (line), baseline))
+      {
+        if (sscanf(line, "%63s %lf", name, &base_ns) == 2
+            && !strcmp(name, kernel->name))
+        {
+          found = 1;
+          break;
+        }
+      }
+
+      if (found && base_ns > 0)
+      {
+        double change = 100 * (kernel->best_ns - base_ns) / base_ns;
+
+
+        printf(" %10.1f %+7.1f%%", base_ns, change);
+        if (change > threshold)
+        {
+          printf("  REGRESSION");
+          num_regressions++;
+        }
+      }
+      else
+        printf(" %10s", "-");
+    }
+
+    printf("\n");
+  }
+
+  if (baseline)
+  {
+    fclose(baseline);
+    if (num_regressions)
+      printf("%d kernels are more than %g%% slower than baseline `%s'\n",
+             num_regressions, threshold, baseline_name);
+  }
+  else if (baseline_name && write_baseline)
+  {
+    FILE* f = fopen(baseline_name, "w");
+
+
+    if (!f)
+    {
+      fprintf(stderr, "cannot write `%s'\n", baseline_name);
+      return 2;
+    }
+
+    for (i = 0; i < NUM_KERNELS; i++)
+      if (kernels[i].total_ops)
+        fprintf(f, "%s %.1f\n", kernels[i].name, kernels[i].best_ns);
+    fclose(f);
+
+    printf("baseline `%s' written\n", baseline_name);
+  }
+
+  for (g = 0; g < num_glyphs; g++)
+  {
+    FT_Outline_Done(library, &glyphs[g].outline);
+    free(glyphs[g].order);
+    free(glyphs[g].ins);
+    free(glyphs[g].args);
+  }
+  free(glyphs);
+  for (i = 0; i < (int)num_tables; i++)
+    free(tables[i].buf);
+  free(tables);
+
+  ta_glyph_hints_done(&hints);
+  free(font);
+  free(ins_buf);
+  free(push_buf);
+  free(nodes);
+  number_set_free(glyph_set);
+
+  FT_Done_Face(face);
+  FT_Done_Face(hinted_face);
+  FT_Done_FreeType(library);
+
+  free(in_buf);
+  free(out_buf);
+
+  return num_regressions ? 1 : 0;
+}
+
+/* end of ttfautohint-kernel-bench.c */
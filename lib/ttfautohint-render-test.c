@@ -0,0 +1,548 @@
+/* ttfautohint-render-test.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) \
+ *         -I.. -I. \
+ *         `pkg-config --cflags freetype2` \
+ *         -o ttfautohint-render-test ttfautohint-render-test.c \
+ *         .libs/libttfautohint.a \
+ *         `pkg-config --libs freetype2 harfbuzz` -lm -lpthread
+ *
+ * after configuration and compilation of the library, then run
+ *
+ *   ./ttfautohint-render-test [-j threads] [-l min] [-r max] \
+ *                             [-b baseline [-w]] font.ttf
+ *
+ * The program hints the given font, then renders every glyph of the
+ * result at every PPEM value of the hinting range (options `-l' and `-r',
+ * default: the library's hinting range) in the three rendering
+ * environments that select ttfautohint's stem width modes:
+ *
+ *   gray  FreeType's TrueType interpreter version 35, grayscale target
+ *   gdi   interpreter version 38 (only available if FreeType has been
+ *         compiled with `TT_CONFIG_OPTION_SUBPIXEL_HINTING'), LCD target
+ *   dw    interpreter version 40, LCD target
+ *
+ * Glyphs are distributed over `threads' threads (default: number of
+ * processors), each using its own FreeType library object.  For every
+ * environment, the program prints the number of renderings per second,
+ * which makes it a benchmark for the bytecode created by ttfautohint.
+ *
+ * A 64-bit hash of each bitmap (including its metrics) is compared with
+ * the data in file `baseline'; differences are listed, and the exit code
+ * is 1.  If the baseline file doesn't exist or option `-w' is given, the
+ * hashes are written to it instead.  Create a baseline before modifying
+ * the library to check that the rendering is not affected.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+#include FT_DRIVER_H
+
+#include <ttfautohint.h>
+
+
+typedef struct Render_Mode_
+{
+  const char* name;
+  FT_UInt interpreter_version;
+  FT_Int32 load_target;
+} Render_Mode;
+
+static const Render_Mode render_modes[] =
+{
+  { "gray", TT_INTERPRETER_VERSION_35, FT_LOAD_TARGET_NORMAL },
+  { "gdi", TT_INTERPRETER_VERSION_38, FT_LOAD_TARGET_LCD },
+  { "dw", TT_INTERPRETER_VERSION_40, FT_LOAD_TARGET_LCD }
+};
+
+#define NUM_RENDER_MODES \
+          (int)(sizeof (render_modes) / sizeof (render_modes[0]))
+
+
+typedef struct Thread_Data_
+{
+  const Render_Mode* mode;
+
+  const FT_Byte* font_buf;
+  FT_Long font_len;
+
+  int thread_idx;
+  int num_threads;
+
+  FT_UInt min_ppem;
+  FT_UInt max_ppem;
+
+  FT_Long num_glyphs;
+  unsigned long long* hashes; /* indexed by ppem and glyph */
+} Thread_Data;
+
+
+/* FNV-1a */
+
+static unsigned long long
+hash_bytes(unsigned long long hash,
+           const unsigned char* p,
+           size_t len)
+{
+  while (len--)
+  {
+    hash ^= *p++;
+    hash *= 0x100000001B3ULL;
+  }
+
+  return hash;
+}
+
+
+static unsigned long long
+hash_int(unsigned long long hash,
+         long value)
+{
+  unsigned char buf[4];
+
+
+  buf[0] = (unsigned char)((unsigned long)value >> 24);
+  buf[1] = (unsigned char)((unsigned long)value >> 16);
+  buf[2] = (unsigned char)((unsigned long)value >> 8);
+  buf[3] = (unsigned char)value;
+
+  return hash_bytes(hash, buf, 4);
+}
+
+
+static unsigned long long
+hash_glyph(FT_GlyphSlot slot)
+{
+  FT_Bitmap* bitmap = &slot->bitmap;
+  unsigned long long hash = 0xCBF29CE484222325ULL;
+  unsigned int row;
+  unsigned int width;
+
+
+  hash = hash_int(hash, slot->bitmap_left);
+  hash = hash_int(hash, slot->bitmap_top);
+  hash = hash_int(hash, slot->advance.x);
+  hash = hash_int(hash, (long)bitmap->width);
+  hash = hash_int(hash, (long)bitmap->rows);
+
+  /* the pitch might contain padding bytes */
+  width = bitmap->width;
+  if (bitmap->pixel_mode == FT_PIXEL_MODE_MONO)
+    width = (width + 7) / 8;
+
+  for (row = 0; row < bitmap->rows; row++)
+  {
+    const unsigned char* p = bitmap->buffer
+                             + (long)row * abs(bitmap->pitch);
+
+
+    hash = hash_bytes(hash, p, width);
+  }
+
+  return hash;
+}
+
+
+static FT_Error
+set_interpreter_version(FT_Library library,
+                        FT_UInt version)
+{
+  return FT_Property_Set(library, "truetype", "interpreter-version",
+                         &version);
+}
+
+
+static void*
+render(void* user)
+{
+  Thread_Data* data = (Thread_Data*)user;
+  FT_Library library;
+  FT_Face face;
+  FT_Error error;
+  FT_UInt ppem;
+  FT_Long idx;
+
+
+  error = FT_Init_FreeType(&library);
+  assert(!error);
+  error = set_interpreter_version(library,
+                                  data->mode->interpreter_version);
+  assert(!error);
+
+  error = FT_New_Memory_Face(library, data->font_buf, data->font_len, 0,
+                             &face);
+  assert(!error);
+
+  for (ppem = data->min_ppem; ppem <= data->max_ppem; ppem++)
+  {
+    unsigned long long* hashes = data->hashes
+                                 + (ppem - data->min_ppem)
+                                   * (size_t)data->num_glyphs;
+
+
+    error = FT_Set_Pixel_Sizes(face, ppem, ppem);
+    assert(!error);
+
+    for (idx = data->thread_idx;
+         idx < data->num_glyphs;
+         idx += data->num_threads)
+    {
+      error = FT_Load_Glyph(face, (FT_UInt)idx,
+                            FT_LOAD_DEFAULT | data->mode->load_target);
+      if (!error)
+        error = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
+
+      /* an error is a result, too */
+      hashes[idx] = error ? (unsigned long long)error
+                          : hash_glyph(face->glyph);
+    }
+  }
+
+  FT_Done_Face(face);
+  FT_Done_FreeType(library);
+
+  return NULL;
+}
+
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static char*
+read_file(const char* name,
+          size_t* len)
+{
+  FILE* f;
+  char* buf;
+  long file_len;
+  size_t read_len;
+
+
+  f = fopen(name, "rb");
+  if (!f)
+    return NULL;
+
+  fseek(f, 0, SEEK_END);
+  file_len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  assert(file_len >= 0);
+
+  buf = (char*)malloc((size_t)file_len + 1);
+  assert(buf);
+  read_len = fread(buf, 1, (size_t)file_len, f);
+  assert(read_len == (size_t)file_len);
+  fclose(f);
+
+  buf[file_len] = '\0';
+  *len = (size_t)file_len;
+
+  return buf;
+}
+
+
+static void
+usage(void)
+{
+  fprintf(stderr,
+          "usage: ttfautohint-render-test [-j threads] [-l min] [-r max]"
+          " [-b baseline [-w]] font\n");
+  exit(2);
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  char* in_buf;
+  size_t in_len;
+  char* out_buf = NULL;
+  size_t out_len = 0;
+
+  int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  int min_ppem = TA_HINTING_RANGE_MIN;
+  int max_ppem = TA_HINTING_RANGE_MAX;
+  const char* baseline_name = NULL;
+  int write_baseline = 0;
+
+  FT_Library library;
+  FT_Face face;
+  FT_Long num_glyphs;
+  FT_Error error;
+  TA_Error ta_error;
+
+  unsigned long long* hashes[NUM_RENDER_MODES];
+  int have_mode[NUM_RENDER_MODES];
+
+  char* baseline;
+  size_t baseline_len;
+  int num_diffs = 0;
+
+  double start;
+  int c;
+  int i, m;
+
+
+  while ((c = getopt(argc, argv, "j:l:r:b:w")) != -1)
+  {
+    switch (c)
+    {
+    case 'j':
+      num_threads = atoi(optarg);
+      break;
+    case 'l':
+      min_ppem = atoi(optarg);
+      break;
+    case 'r':
+      max_ppem = atoi(optarg);
+      break;
+    case 'b':
+      baseline_name = optarg;
+      break;
+    case 'w':
+      write_baseline = 1;
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if (optind != argc - 1)
+    usage();
+  if (num_threads < 1)
+    num_threads = 1;
+  if (min_ppem < 2 || max_ppem < min_ppem)
+    usage();
+
+  in_buf = read_file(argv[optind], &in_len);
+  assert(in_buf);
+
+  /* a fixed epoch makes the output reproducible */
+  start = now();
+  ta_error = TTF_autohint("in-buffer, in-buffer-len,"
+                          "out-buffer, out-buffer-len,"
+                          "hinting-range-min, hinting-range-max, epoch",
+                          in_buf, in_len,
+                          &out_buf, &out_len,
+                          min_ppem, max_ppem, 0ULL);
+  if (ta_error)
+  {
+    fprintf(stderr, "hinting failed with error 0x%02X\n", ta_error);
+    return 2;
+  }
+  printf("hinting: %.3fs\n", now() - start);
+
+  error = FT_Init_FreeType(&library);
+  assert(!error);
+  error = FT_New_Memory_Face(library, (FT_Byte*)out_buf, (FT_Long)out_len,
+                             0, &face);
+  assert(!error);
+  num_glyphs = face->num_glyphs;
+  FT_Done_Face(face);
+
+  for (m = 0; m < NUM_RENDER_MODES; m++)
+  {
+    const Render_Mode* mode = &render_modes[m];
+    size_t num_hashes = (size_t)(max_ppem - min_ppem + 1)
+                        * (size_t)num_glyphs;
+
+    pthread_t* threads;
+    Thread_Data* thread_data;
+    double elapsed;
+
+
+    hashes[m] = NULL;
+    have_mode[m] = !set_interpreter_version(library,
+                                            mode->interpreter_version);
+    if (!have_mode[m])
+    {
+      printf("%s: not supported by FreeType, skipped\n", mode->name);
+      continue;
+    }
+
+    hashes[m] = (unsigned long long*)calloc(num_hashes,
+                                            sizeof (unsigned long long));
+    threads = (pthread_t*)malloc((size_t)num_threads * sizeof (pthread_t));
+    thread_data = (Thread_Data*)malloc((size_t)num_threads
+                                       * sizeof (Thread_Data));
+    assert(hashes[m] && threads && thread_data);
+
+    start = now();
+
+    for (i = 0; i < num_threads; i++)
+    {
+      int ret;
+
+
+      thread_data[i].mode = mode;
+      thread_data[i].font_buf = (FT_Byte*)out_buf;
+      thread_data[i].font_len = (FT_Long)out_len;
+      thread_data[i].thread_idx = i;
+      thread_data[i].num_threads = num_threads;
+      thread_data[i].min_ppem = (FT_UInt)min_ppem;
+      thread_data[i].max_ppem = (FT_UInt)max_ppem;
+      thread_data[i].num_glyphs = num_glyphs;
+      thread_data[i].hashes = hashes[m];
+
+      ret = pthread_create(&threads[i], NULL, render, &thread_data[i]);
+      assert(!ret);
+    }
+
+    for (i = 0; i < num_threads; i++)
+    {
+      int ret = pthread_join(threads[i], NULL);
+
+
+      assert(!ret);
+    }
+
+    elapsed = now() - start;
+    printf("%s: %lu renderings (%ld glyphs, ppem %d-%d)"
+           " in %.3fs, %.0f/s\n",
+           mode->name, (unsigned long)num_hashes, num_glyphs,
+           min_ppem, max_ppem,
+           elapsed, elapsed > 0 ? (double)num_hashes / elapsed : 0.0);
+
+    free(thread_data);
+    free(threads);
+  }
+
+  FT_Done_FreeType(library);
+
+  if (baseline_name)
+  {
+    baseline = write_baseline ? NULL
+                              : read_file(baseline_name, &baseline_len);
+
+    if (!baseline)
+    {
+      FILE* f = fopen(baseline_name, "w");
+
+
+      assert(f);
+      for (m = 0; m < NUM_RENDER_MODES; m++)
+      {
+        int ppem;
+        FT_Long idx;
+
+
+        if (!have_mode[m])
+          continue;
+
+        for (ppem = min_ppem; ppem <= max_ppem; ppem++)
+          for (idx = 0; idx < num_glyphs; idx++)
+            fprintf(f, "%s %d %ld %016llx\n",
+                    render_modes[m].name, ppem, idx,
+                    hashes[m][(size_t)(ppem - min_ppem) * (size_t)num_glyphs
+                              + (size_t)idx]);
+      }
+      fclose(f);
+
+      printf("baseline `%s' written\n", baseline_name);
+    }
+    else
+    {
+      char* line = baseline;
+      int num_lines = 0;
+
+
+      /* we look up each line of the baseline in our data; */
+      /* modes missing in the current FreeType are ignored */
+      while (*line)
+      {
+        char* eol = strchr(line, '\n');
+        char name[16];
+        int ppem;
+        long idx;
+        unsigned long long hash;
+
+
+        if (eol)
+          *eol = '\0';
+
+        if (sscanf(line, "%15s %d %ld %llx",
+                   name, &ppem, &idx, &hash) == 4)
+        {
+          for (m = 0; m < NUM_RENDER_MODES; m++)
+            if (!strcmp(name, render_modes[m].name))
+              break;
+
+          if (m < NUM_RENDER_MODES && have_mode[m])
+          {
+            unsigned long long current = 0;
+            int found = ppem >= min_ppem && ppem <= max_ppem
+                        && idx >= 0 && idx < num_glyphs;
+
+
+            if (found)
+              current = hashes[m][(size_t)(ppem - min_ppem)
+                                    * (size_t)num_glyphs
+                                  + (size_t)idx];
+            num_lines++;
+
+            if (!found || current != hash)
+            {
+              if (num_diffs < 50)
+                printf("difference: mode %s, ppem %d, glyph %ld\n",
+                       name, ppem, idx);
+              num_diffs++;
+            }
+          }
+        }
+
+        if (!eol)
+          break;
+        line = eol + 1;
+      }
+
+      printf("%d of %d renderings differ from baseline `%s'\n",
+             num_diffs, num_lines, baseline_name);
+
+      free(baseline);
+    }
+  }
+
+  for (m = 0; m < NUM_RENDER_MODES; m++)
+    free(hashes[m]);
+  free(out_buf);
+  free(in_buf);
+
+  return num_diffs ? 1 : 0;
+}
+
+/* end of ttfautohint-render-test.c */
@@ -0,0 +1,137 @@
+#! /bin/sh
+#
+# Copyright (C) 2022 by Werner Lemberg.
+#
+# This file is part of the ttfautohint library, and may only be used,
+# modified, and distributed under the terms given in `COPYING'.  By
+# continuing to use, modify, or distribute this file you indicate that you
+# have read `COPYING' and understand and accept it fully.
+#
+# The file `COPYING' mentioned in the previous paragraph is distributed
+# with the ttfautohint library.
+#
+#
+# ttfautohint-scaling-bench.sh [<ttfautohint-options>...]
+#
+# Measure how ttfautohint's run time and memory consumption scale with the
+# size and complexity of the input font.  For each dimension (number of
+# glyphs, points per glyph, contours per glyph, composite depth, scripts,
+# and subfonts) a series of fonts gets created with `ttfautohint-font-gen'
+# while the other parameters stay at their default values; all options
+# are passed to ttfautohint.  The result is a table on stdout.
+#
+# The following environment variables control the script.
+#
+#   TTFAUTOHINT   the ttfautohint binary (default: `ttfautohint')
+#   FONT_GEN      the font generator (default: `./ttfautohint-font-gen')
+#   TIME          GNU time, needed for the elapsed time and the maximum
+#                 resident set size (default: `/usr/bin/time')
+#   BENCH_DIR     the directory for the generated fonts (default: a
+#                 temporary directory that gets removed afterwards)
+#   REPEAT        the number of runs per font; the fastest one is reported
+#                 (default: 3)
+
+
+TTFAUTOHINT=${TTFAUTOHINT:-ttfautohint}
+FONT_GEN=${FONT_GEN:-./ttfautohint-font-gen}
+TIME=${TIME:-/usr/bin/time}
+REPEAT=${REPEAT:-3}
+
+if [ ! -x "$FONT_GEN" ]; then
+  echo "$0: cannot find \`$FONT_GEN'; see \`ttfautohint-font-gen.c'" >&2
+  exit 1
+fi
+
+if ! "$TIME" -f "%e %M" true > /dev/null 2>&1; then
+  echo "$0: \`$TIME' is not GNU time" >&2
+  exit 1
+fi
+
+if [ -z "$BENCH_DIR" ]; then
+  BENCH_DIR=`mktemp -d "${TMPDIR:-/tmp}/ta-bench.XXXXXX"` || exit 1
+  trap 'rm -rf "$BENCH_DIR"' 0 1 2 15
+else
+  mkdir -p "$BENCH_DIR" || exit 1
+fi
+
+
+# run ttfautohint `$REPEAT' times on a font created with the given
+# generator options, then print a table row
+bench()
+{
+  label=$1
+  shift
+
+  case " $* " in
+  *" -n "[2-9]* | *" -n "[1-9][0-9]*)
+    suffix=ttc ;;
+  *)
+    suffix=ttf ;;
+  esac
+  input="$BENCH_DIR/in.$suffix"
+  output="$BENCH_DIR/out.$suffix"
+
+  if ! "$FONT_GEN" "$@" "$input"; then
+    echo "$0: cannot create font with options \`$*'" >&2
+    exit 1
+  fi
+
+  size=`wc -c < "$input" | tr -d ' '`
+  best_time=
+  best_mem=
+
+  i=0
+  while [ $i -lt "$REPEAT" ]; do
+    if ! "$TIME" -f "%e %M" -o "$BENCH_DIR/time" \
+           "$TTFAUTOHINT" $TA_OPTIONS "$input" "$output"; then
+      echo "$0: ttfautohint failed on font with options \`$*'" >&2
+      exit 1
+    fi
+
+    read t m < "$BENCH_DIR/time"
+    if [ -z "$best_time" ] \
+       || awk "BEGIN { exit !($t < $best_time) }"; then
+      best_time=$t
+    fi
+    if [ -z "$best_mem" ] || [ "$m" -lt "$best_mem" ]; then
+      best_mem=$m
+    fi
+
+    i=`expr $i + 1`
+  done
+
+  printf "%-10s %-38s %9s %10s %12s\n" \
+         "$label" "$*" "$size" "$best_time" "$best_mem"
+}
+
+
+TA_OPTIONS="$*"
+
+printf "%-10s %-38s %9s %10s %12s\n" \
+       "dimension" "generator options" "bytes" "time (s)" "max RSS (kB)"
+
+for g in 100 400 1600 6400; do
+  bench glyphs -g $g
+done
+
+for p in 16 64 256 1024; do
+  bench points -p $p
+done
+
+for c in 1 4 16 64; do
+  bench contours -c $c -p 256
+done
+
+for d in 1 2 4 8; do
+  bench depth -g 512 -C 256 -d $d
+done
+
+for s in latn latn,cyrl latn,cyrl,grek,arab latn,cyrl,grek,arab,deva,thai; do
+  bench scripts -g 600 -s $s
+done
+
+for n in 1 2 4 8; do
+  bench subfonts -n $n
+done
+
+# end of ttfautohint-scaling-bench.sh
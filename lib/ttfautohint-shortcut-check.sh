@@ -0,0 +1,107 @@
+#! /bin/sh
+#
+# Copyright (C) 2022 by Werner Lemberg.
+#
+# This file is part of the ttfautohint library, and may only be used,
+# modified, and distributed under the terms given in `COPYING'.  By
+# continuing to use, modify, or distribute this file you indicate that you
+# have read `COPYING' and understand and accept it fully.
+#
+# The file `COPYING' mentioned in the previous paragraph is distributed
+# with the ttfautohint library.
+#
+#
+# ttfautohint-shortcut-check.sh <font>...
+#
+# While collecting hints records, the library skips the interpolation of
+# weak points and the metrics adjustments since the bytecode doesn't
+# depend on them (see `TA_HINTS_DO_OUTLINE' in `tahints.h').  This script
+# checks that the hinted fonts are byte-identical to the output of a
+# library built without this shortcut, that is, configured with
+#
+#   CPPFLAGS=-DTA_NO_OUTLINE_SHORTCUT
+#
+# Each font gets hinted with several option sets, including composite
+# glyph hinting, symbol fonts, and a fallback script.  If
+# `ttfautohint-font-gen' is available, some generated fonts get checked
+# also; glyphs of these fonts not covered by a script's character ranges
+# are handled by the fallback script.  The script prints the differing
+# fonts and exits with code 1 if there are any.
+#
+# `make check' runs this script if `TTFAUTOHINT_REF' is set; the variable
+# `SHORTCUT_CHECK_FONTS' takes a list of additional fonts, for example
+#
+#   make check TTFAUTOHINT_REF=/path/to/ref/ttfautohint \
+#              SHORTCUT_CHECK_FONTS="`echo /usr/share/fonts/*/*.ttf`"
+#
+# The following environment variables control the script.
+#
+#   TTFAUTOHINT      the ttfautohint binary to check (default:
+#                    `ttfautohint')
+#   TTFAUTOHINT_REF  the ttfautohint binary built without the shortcut
+#                    (mandatory)
+#   FONT_GEN         the font generator (default: `./ttfautohint-font-gen')
+
+
+TTFAUTOHINT=${TTFAUTOHINT:-ttfautohint}
+FONT_GEN=${FONT_GEN:-./ttfautohint-font-gen}
+
+if [ -z "$TTFAUTOHINT_REF" ]; then
+  echo "$0: environment variable \`TTFAUTOHINT_REF' not set" >&2
+  exit 1
+fi
+
+CHECK_DIR=`mktemp -d "${TMPDIR:-/tmp}/ta-check.XXXXXX"` || exit 1
+trap 'rm -rf "$CHECK_DIR"' 0 1 2 15
+
+# avoid differences in the `head' table's modification date
+SOURCE_DATE_EPOCH=0
+export SOURCE_DATE_EPOCH
+
+fonts="$*"
+if [ -x "$FONT_GEN" ]; then
+  i=0
+  for opts in "" \
+              "-c 16 -p 256" \
+              "-g 200 -C 100 -d 3" \
+              "-g 200 -s latn,cyrl,grek,arab" \
+              "-n 2"; do
+    i=`expr $i + 1`
+    case "$opts" in
+    -n*)
+      font="$CHECK_DIR/gen$i.ttc" ;;
+    *)
+      font="$CHECK_DIR/gen$i.ttf" ;;
+    esac
+    "$FONT_GEN" $opts "$font" || exit 1
+    fonts="$fonts $font"
+  done
+fi
+
+if [ -z "$fonts" ]; then
+  echo "$0: no fonts to check" >&2
+  exit 1
+fi
+
+failed=0
+for font in $fonts; do
+  for opts in "" \
+              "--composites --adjust-subglyphs" \
+              "--strong-stem-width=gGD" \
+              "--windows-compatibility --increase-x-height=0" \
+              "--hinting-range-min=6 --hinting-range-max=100" \
+              "--symbol --fallback-script=latn" \
+              "--fallback-script=latn --fallback-scaling"; do
+    "$TTFAUTOHINT" $opts "$font" "$CHECK_DIR/out" || exit 1
+    "$TTFAUTOHINT_REF" $opts "$font" "$CHECK_DIR/ref" || exit 1
+
+    if ! cmp -s "$CHECK_DIR/out" "$CHECK_DIR/ref"; then
+      echo "$font ($opts): output differs"
+      failed=1
+    fi
+  done
+done
+
+exit $failed
+
+# end of ttfautohint-shortcut-check.sh
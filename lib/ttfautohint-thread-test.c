@@ -0,0 +1,385 @@
+/* ttfautohint-thread-test.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) \
+ *         -I.. -I. \
+ *         -o ttfautohint-thread-test ttfautohint-thread-test.c \
+ *         .libs/libttfautohint.a \
+ *         `pkg-config --libs freetype2 harfbuzz` -lm -lpthread
+ *
+ * after configuration and compilation of the library, then run
+ *
+ *   ./ttfautohint-thread-test [-n threads] [-i iterations] \
+ *                             [-c control-file] font... \
+ *                             [-c control-file] font...
+ *
+ * A control instructions file applies to all fonts following it; use
+ * `-c ""' to switch it off again.  Fonts can be TrueType collections, and
+ * the same font can be given several times, for example with and without
+ * a control file.
+ *
+ * Each font gets hinted with a set of option combinations (composite
+ * glyphs, x-height increase and Windows compatibility, stem width modes,
+ * fallback script and scaling, symbol font), resulting in a list of jobs.
+ * The program first runs all jobs in the main thread to get reference
+ * results.  Then `threads' threads (default: 8) run the whole job list
+ * `iterations' times each (default: 10), every thread starting at a
+ * different job so that different fonts and options get hinted at the
+ * same time, and compare their results with the references.  It aborts
+ * with an assertion message in case of an error, otherwise it produces no
+ * output.
+ *
+ * To check for data races with ThreadSanitizer, configure with
+ *
+ *   CFLAGS="-g -O1 -fsanitize=thread" LDFLAGS="-fsanitize=thread"
+ *
+ * add `-fsanitize=thread' to the compilation command above, and run, for
+ * example,
+ *
+ *   TSAN_OPTIONS=halt_on_error=1 \
+ *     ./ttfautohint-thread-test -n 4 -i 2 font.ttf fonts.ttc
+ *
+ * Debugging output (option `debug') is not tested since it is written to
+ * `stderr' without synchronization.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <ttfautohint.h>
+
+
+typedef struct Option_Set_
+{
+  int hint_composites;
+  int increase_x_height;
+  int windows_compatibility;
+  int gray_stem_width_mode;
+  int gdi_cleartype_stem_width_mode;
+  const char* fallback_script;
+  int fallback_scaling;
+  int symbol;
+} Option_Set;
+
+
+static const Option_Set option_sets[] =
+{
+  { 0, 14, 0, TA_STEM_WIDTH_MODE_QUANTIZED, TA_STEM_WIDTH_MODE_STRONG,
+    "none", 0, 0 },
+  { 1, 14, 0, TA_STEM_WIDTH_MODE_QUANTIZED, TA_STEM_WIDTH_MODE_STRONG,
+    "none", 0, 0 },
+  { 0, 0, 1, TA_STEM_WIDTH_MODE_QUANTIZED, TA_STEM_WIDTH_MODE_STRONG,
+    "none", 0, 0 },
+  { 1, 14, 0, TA_STEM_WIDTH_MODE_STRONG, TA_STEM_WIDTH_MODE_NATURAL,
+    "none", 0, 0 },
+  { 0, 14, 0, TA_STEM_WIDTH_MODE_QUANTIZED, TA_STEM_WIDTH_MODE_STRONG,
+    "latn", 1, 0 },
+  { 0, 14, 0, TA_STEM_WIDTH_MODE_QUANTIZED, TA_STEM_WIDTH_MODE_STRONG,
+    "latn", 0, 1 },
+};
+
+#define NUM_OPTION_SETS (int)(sizeof (option_sets) / sizeof (option_sets[0]))
+
+
+typedef struct Buffer_
+{
+  char* buf;
+  size_t len;
+} Buffer;
+
+
+typedef struct Job_
+{
+  const Buffer* font;
+  const Buffer* control; /* NULL if none */
+  const Option_Set* options;
+
+  char* ref_buf;
+  size_t ref_len;
+  int ref_progress_calls;
+} Job;
+
+
+typedef struct Thread_Data_
+{
+  const Job* jobs;
+  int num_jobs;
+  int first_job;
+
+  int iterations;
+  int num_progress_calls;
+} Thread_Data;
+
+
+static int
+progress(long curr_idx,
+         long num_glyphs,
+         long curr_sfnt,
+         long num_sfnts,
+         void* user)
+{
+  int* num_progress_calls = (int*)user;
+
+  (void)curr_idx;
+  (void)num_glyphs;
+  (void)curr_sfnt;
+  (void)num_sfnts;
+
+  /* user data must be per thread */
+  (*num_progress_calls)++;
+
+  return 0;
+}
+
+
+static TA_Error
+hint(const Job* job,
+     int* num_progress_calls,
+     char** out_bufp,
+     size_t* out_lenp)
+{
+  const Option_Set* options = job->options;
+
+
+  /* a fixed epoch makes the output reproducible */
+  return TTF_autohint("in-buffer, in-buffer-len, out-buffer, out-buffer-len,"
+                      "control-buffer, control-buffer-len,"
+                      "progress-callback, progress-callback-data,"
+                      "hint-composites, increase-x-height,"
+                      "windows-compatibility, gray-stem-width-mode,"
+                      "gdi-cleartype-stem-width-mode,"
+                      "fallback-script, fallback-scaling, symbol,"
+                      "TTFA-info, epoch",
+                      job->font->buf, job->font->len, out_bufp, out_lenp,
+                      job->control ? job->control->buf : NULL,
+                      job->control ? job->control->len : 0,
+                      progress, num_progress_calls,
+                      options->hint_composites, options->increase_x_height,
+                      options->windows_compatibility,
+                      options->gray_stem_width_mode,
+                      options->gdi_cleartype_stem_width_mode,
+                      options->fallback_script, options->fallback_scaling,
+                      options->symbol,
+                      1, 0ULL);
+}
+
+
+static void*
+worker(void* user)
+{
+  Thread_Data* data = (Thread_Data*)user;
+  int i, j;
+
+
+  for (i = 0; i < data->iterations; i++)
+  {
+    for (j = 0; j < data->num_jobs; j++)
+    {
+      const Job* job = &data->jobs[(data->first_job + j) % data->num_jobs];
+      char* out_buf = NULL;
+      size_t out_len = 0;
+      TA_Error error;
+
+
+      error = hint(job, &data->num_progress_calls, &out_buf, &out_len);
+      assert(!error);
+      assert(out_len == job->ref_len);
+      assert(!memcmp(out_buf, job->ref_buf, out_len));
+
+      free(out_buf);
+    }
+  }
+
+  return NULL;
+}
+
+
+static void
+read_file(const char* name,
+          Buffer* buffer)
+{
+  FILE* in;
+  long len;
+  size_t read_len;
+
+
+  in = fopen(name, "rb");
+  assert(in);
+
+  fseek(in, 0, SEEK_END);
+  len = ftell(in);
+  fseek(in, 0, SEEK_SET);
+  assert(len > 0);
+
+  buffer->buf = (char*)malloc((size_t)len);
+  assert(buffer->buf);
+  read_len = fread(buffer->buf, 1, (size_t)len, in);
+  assert(read_len == (size_t)len);
+  fclose(in);
+
+  buffer->len = (size_t)len;
+}
+
+
+static void
+usage(void)
+{
+  fprintf(stderr,
+          "usage: ttfautohint-thread-test [-n threads] [-i iterations]\n"
+          "                               [-c control-file] font...\n");
+  exit(1);
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  int num_threads = 8;
+  int iterations = 10;
+
+  /* every command line argument is at most a single file */
+  Buffer* files;
+  int num_files = 0;
+  Buffer* control = NULL;
+
+  Job* jobs;
+  int num_jobs = 0;
+  int total_progress_calls = 0;
+
+  pthread_t* threads;
+  Thread_Data* thread_data;
+  int ret;
+  int i, j;
+
+
+  files = (Buffer*)malloc((size_t)argc * sizeof (Buffer));
+  jobs = (Job*)malloc((size_t)argc * NUM_OPTION_SETS * sizeof (Job));
+  assert(files && jobs);
+
+  for (i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+
+
+    if (!strcmp(arg, "-n") || !strcmp(arg, "-i") || !strcmp(arg, "-c"))
+    {
+      if (++i == argc)
+        usage();
+
+      if (arg[1] == 'n')
+        num_threads = atoi(argv[i]);
+      else if (arg[1] == 'i')
+        iterations = atoi(argv[i]);
+      else if (!*argv[i])
+        control = NULL;
+      else
+      {
+        control = &files[num_files++];
+        read_file(argv[i], control);
+      }
+      continue;
+    }
+
+    if (arg[0] == '-')
+      usage();
+
+    read_file(arg, &files[num_files]);
+
+    for (j = 0; j < NUM_OPTION_SETS; j++)
+    {
+      Job* job = &jobs[num_jobs++];
+
+
+      job->font = &files[num_files];
+      job->control = control;
+      job->options = &option_sets[j];
+    }
+
+    num_files++;
+  }
+
+  if (!num_jobs)
+    usage();
+  assert(num_threads > 0);
+  assert(iterations > 0);
+
+  /* the reference results */
+  for (i = 0; i < num_jobs; i++)
+  {
+    Job* job = &jobs[i];
+    TA_Error error;
+
+
+    job->ref_buf = NULL;
+    job->ref_len = 0;
+    job->ref_progress_calls = 0;
+
+    error = hint(job, &job->ref_progress_calls,
+                 &job->ref_buf, &job->ref_len);
+    assert(!error);
+    assert(job->ref_progress_calls > 0);
+
+    total_progress_calls += job->ref_progress_calls;
+  }
+
+  threads = (pthread_t*)malloc((size_t)num_threads * sizeof (pthread_t));
+  thread_data = (Thread_Data*)malloc((size_t)num_threads
+                                     * sizeof (Thread_Data));
+  assert(threads && thread_data);
+
+  for (i = 0; i < num_threads; i++)
+  {
+    thread_data[i].jobs = jobs;
+    thread_data[i].num_jobs = num_jobs;
+    thread_data[i].first_job = i % num_jobs;
+    thread_data[i].iterations = iterations;
+    thread_data[i].num_progress_calls = 0;
+
+    ret = pthread_create(&threads[i], NULL, worker, &thread_data[i]);
+    assert(!ret);
+  }
+
+  for (i = 0; i < num_threads; i++)
+  {
+    ret = pthread_join(threads[i], NULL);
+    assert(!ret);
+    assert(thread_data[i].num_progress_calls
+           == iterations * total_progress_calls);
+  }
+
+  free(thread_data);
+  free(threads);
+
+  for (i = 0; i < num_jobs; i++)
+    free(jobs[i].ref_buf);
+  free(jobs);
+
+  for (i = 0; i < num_files; i++)
+    free(files[i].buf);
+  free(files);
+
+  return 0;
+}
+
+/* end of ttfautohint-thread-test.c */
@@ -65,25 +65,37 @@ TTF_autohint(const char* options,
   FT_Long reference_index = 0;
   const char* reference_name = NULL;
 
+  FILE* previous_file = NULL;
+
+  FILE* profile_file = NULL;
+  FT_UInt profile_top = 10;
+
   const char* in_buf = NULL;
   size_t in_len = 0;
   char** out_bufp = NULL;
   size_t* out_lenp = NULL;
+  TA_Context* contextp = NULL;
   const char* control_buf = NULL;
   size_t control_len = 0;
   const char* reference_buf = NULL;
   size_t reference_len = 0;
+  const char* previous_buf = NULL;
+  size_t previous_len = 0;
 
   const unsigned char** error_stringp = NULL;
 
   FT_Long hinting_range_min = -1;
   FT_Long hinting_range_max = -1;
   FT_Long hinting_limit = -1;
+  FT_UInt hinting_threads = 1;
   FT_Long increase_x_height = -1;
 
   const char* x_height_snapping_exceptions_string = NULL;
   number_range* x_height_snapping_exceptions = NULL;
 
+  const char* glyph_subset_string = NULL;
+  number_range* glyph_subset = NULL;
+
   FT_Long fallback_stem_width = 0;
 
   FT_Int gray_stem_width_mode = TA_STEM_WIDTH_MODE_QUANTIZED;
@@ -101,6 +113,16 @@ TTF_autohint(const char* options,
   TA_Alloc_Func allocate = NULL;
   TA_Free_Func deallocate = NULL;
 
+  TA_Memory_Alloc_Func memory_alloc = NULL;
+  TA_Memory_Realloc_Func memory_realloc = NULL;
+  TA_Memory_Free_Func memory_free = NULL;
+  void* memory_data = NULL;
+  size_t memory_limit = 0;
+  TA_Memory_Stats* memory_stats = NULL;
+
+  TA_Memory memory = NULL;
+  TA_Memory saved_memory = _ta_memory;
+
   FT_Bool windows_compatibility = 0;
   FT_Bool ignore_restrictions = 0;
   FT_Bool adjust_subglyphs = 0;
@@ -116,6 +138,7 @@ TTF_autohint(const char* options,
 
   FT_Bool dehint = 0;
   FT_Bool debug = 0;
+  FILE* debug_trace_file = NULL;
   FT_Bool TTFA_info = 0;
   unsigned long long epoch = ULLONG_MAX;
 
@@ -161,6 +184,8 @@ TTF_autohint(const char* options,
       adjust_subglyphs = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("alloc-func"))
       allocate = va_arg(ap, TA_Alloc_Func);
+    else if (COMPARE("context"))
+      contextp = va_arg(ap, TA_Context*);
     else if (COMPARE("control-buffer"))
     {
       control_file = NULL;
@@ -179,6 +204,8 @@ TTF_autohint(const char* options,
     }
     else if (COMPARE("debug"))
       debug = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("debug-trace-file"))
+      debug_trace_file = va_arg(ap, FILE*);
     else if (COMPARE("default-script"))
       default_script_string = va_arg(ap, const char*);
     else if (COMPARE("dehint"))
@@ -219,6 +246,8 @@ TTF_autohint(const char* options,
       gdi_cleartype_stem_width_mode = arg ? TA_STEM_WIDTH_MODE_STRONG
                                           : TA_STEM_WIDTH_MODE_QUANTIZED;
     }
+    else if (COMPARE("glyph-subset"))
+      glyph_subset_string = va_arg(ap, const char*);
     else if (COMPARE("gray-stem-width-mode"))
       gray_stem_width_mode = va_arg(ap, FT_Int);
     else if (COMPARE("gray-strong-stem-width"))
@@ -235,6 +264,8 @@ TTF_autohint(const char* options,
       hinting_range_max = (FT_Long)va_arg(ap, FT_UInt);
     else if (COMPARE("hinting-range-min"))
       hinting_range_min = (FT_Long)va_arg(ap, FT_UInt);
+    else if (COMPARE("hinting-threads"))
+      hinting_threads = va_arg(ap, FT_UInt);
     else if (COMPARE("hint-composites"))
       hint_composites = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("ignore-restrictions"))
@@ -263,6 +294,18 @@ TTF_autohint(const char* options,
       info_data = va_arg(ap, void*);
     else if (COMPARE("info-post-callback"))
       info_post = va_arg(ap, TA_Info_Post_Func);
+    else if (COMPARE("memory-alloc-func"))
+      memory_alloc = va_arg(ap, TA_Memory_Alloc_Func);
+    else if (COMPARE("memory-data"))
+      memory_data = va_arg(ap, void*);
+    else if (COMPARE("memory-free-func"))
+      memory_free = va_arg(ap, TA_Memory_Free_Func);
+    else if (COMPARE("memory-limit"))
+      memory_limit = va_arg(ap, size_t);
+    else if (COMPARE("memory-realloc-func"))
+      memory_realloc = va_arg(ap, TA_Memory_Realloc_Func);
+    else if (COMPARE("memory-stats"))
+      memory_stats = va_arg(ap, TA_Memory_Stats*);
     else if (COMPARE("out-buffer"))
     {
       out_file = NULL;
@@ -281,6 +324,26 @@ TTF_autohint(const char* options,
     }
     else if (COMPARE("pre-hinting"))
       adjust_subglyphs = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("previous-buffer"))
+    {
+      previous_file = NULL;
+      previous_buf = va_arg(ap, const char*);
+    }
+    else if (COMPARE("previous-buffer-len"))
+    {
+      previous_file = NULL;
+      previous_len = va_arg(ap, size_t);
+    }
+    else if (COMPARE("previous-file"))
+    {
+      previous_file = va_arg(ap, FILE*);
+      previous_buf = NULL;
+      previous_len = 0;
+    }
+    else if (COMPARE("profile-file"))
+      profile_file = va_arg(ap, FILE*);
+    else if (COMPARE("profile-top"))
+      profile_top = va_arg(ap, FT_UInt);
     else if (COMPARE("progress-callback"))
       progress = va_arg(ap, TA_Progress_Func);
     else if (COMPARE("progress-callback-data"))
@@ -336,20 +399,72 @@ TTF_autohint(const char* options,
     goto Err1;
   }
 
-  if (!(out_file
-        || (out_bufp && out_lenp)))
+  if (contextp)
+  {
+    *contextp = NULL;
+
+    /* a context replaces the output */
+    if (out_file
+        || out_bufp
+        || dehint
+        || glyph_subset_string)
+    {
+      error = FT_Err_Invalid_Argument;
+      goto Err1;
+    }
+  }
+  else if (!(out_file
+             || (out_bufp && out_lenp)))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* a glyph subset and a previous font must be given together */
+  if (glyph_subset_string)
+  {
+    if (dehint
+        || !(previous_file
+             || (previous_buf && previous_len)))
+    {
+      error = FT_Err_Invalid_Argument;
+      goto Err1;
+    }
+  }
+  else if (previous_file || previous_buf)
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* the memory functions must be given together */
+  if ((memory_alloc || memory_realloc || memory_free)
+      && !(memory_alloc && memory_realloc && memory_free))
   {
     error = FT_Err_Invalid_Argument;
     goto Err1;
   }
 
-  font = (FONT*)calloc(1, sizeof (FONT));
+  memory = TA_memory_new(memory_alloc, memory_realloc, memory_free,
+                         memory_data, memory_limit);
+  if (!memory)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err1;
+  }
+
+  /* from now on, `ta_malloc' and friends use `memory' in this thread */
+  _ta_memory = memory;
+
+  font = (FONT*)ta_calloc(1, sizeof (FONT));
   if (!font)
   {
     error = FT_Err_Out_Of_Memory;
     goto Err1;
   }
 
+  font->memory = memory;
+
   if (dehint)
     goto No_check;
 
@@ -394,6 +509,10 @@ TTF_autohint(const char* options,
   if (hinting_limit < 0)
     hinting_limit = TA_HINTING_LIMIT;
 
+  /* value 0 means no additional threads, as does value 1 */
+  if (!hinting_threads)
+    hinting_threads = 1;
+
   if (increase_x_height > 0
       && increase_x_height < TA_PROP_INCREASE_X_HEIGHT_MIN)
   {
@@ -458,14 +577,38 @@ TTF_autohint(const char* options,
     }
   }
 
+  if (glyph_subset_string)
+  {
+    const char* s = number_set_parse(glyph_subset_string,
+                                     &glyph_subset,
+                                     0, 0xFFFF);
+    if (*s)
+    {
+      /* we map numberset.h's error codes to values starting with 0x100 */
+      error = 0x100 - (FT_Error)(uintptr_t)glyph_subset;
+      errlinenum = 0;
+      errline = (char*)glyph_subset_string;
+      errpos = (char*)s;
+
+      goto Err1;
+    }
+
+    /* the previous font's `TTFA' table must be updated also */
+    TTFA_info = 1;
+  }
+
   font->reference_index = reference_index;
   font->reference_name = reference_name;
 
   font->hinting_range_min = (FT_UInt)hinting_range_min;
   font->hinting_range_max = (FT_UInt)hinting_range_max;
   font->hinting_limit = (FT_UInt)hinting_limit;
+  font->hinting_threads = hinting_threads;
+  font->profile_file = profile_file;
+  font->profile_top = profile_top;
   font->increase_x_height = (FT_UInt)increase_x_height;
   font->x_height_snapping_exceptions = x_height_snapping_exceptions;
+  font->glyph_subset = glyph_subset;
   font->fallback_stem_width = (FT_UInt)fallback_stem_width;
 
   font->gray_stem_width_mode = gray_stem_width_mode;
@@ -482,8 +625,9 @@ TTF_autohint(const char* options,
   font->symbol = symbol;
 
 No_check:
-  font->allocate = (allocate && out_bufp) ? allocate : malloc;
-  font->deallocate = (deallocate && out_bufp) ? deallocate : free;
+  font->allocate = (allocate && (out_bufp || contextp)) ? allocate : malloc;
+  font->deallocate = (deallocate && (out_bufp || contextp)) ? deallocate
+                                                            : free;
 
   font->progress = progress;
   font->progress_data = progress_data;
@@ -491,6 +635,12 @@ No_check:
   font->info_post = info_post;
   font->info_data = info_data;
 
+  /* a trace is only useful for a single call of `TTF_autohint' */
+  if (contextp)
+    debug_trace_file = NULL;
+  if (debug_trace_file)
+    debug = 1;
+
   font->debug = debug;
   font->dehint = dehint;
   font->TTFA_info = TTFA_info;
@@ -550,15 +700,39 @@ No_check:
     font->reference_len = reference_len;
   }
 
+  if (previous_file)
+  {
+    error = TA_font_file_read(previous_file,
+                              &font->previous_buf,
+                              &font->previous_len);
+    if (error)
+      goto Err;
+  }
+  else if (previous_buf)
+  {
+    /* a valid TTF can never be that small */
+    if (previous_len < 100)
+    {
+      error = TA_Err_Invalid_Previous_Font;
+      goto Err1;
+    }
+    font->previous_buf = (FT_Byte*)previous_buf;
+    font->previous_len = previous_len;
+  }
+
   error = TA_font_init(font);
   if (error)
     goto Err;
 
-  if (font->debug)
-  {
-    _ta_debug = 1;
-    _ta_debug_global = 1;
-  }
+  TA_trace_init(&font->trace, debug_trace_file);
+
+#ifdef TA_DEBUG
+  /* the debugging flags are thread-local; */
+  /* reset them since a previous call might have set them */
+  _ta_debug = font->debug;
+  _ta_debug_global = font->debug;
+  _ta_debug_trace = font->trace.file ? &font->trace : NULL;
+#endif
 
   /* we do some loops over all subfonts -- */
   /* to process options early, just start with loading all of them */
@@ -612,13 +786,23 @@ No_check:
     }
 
     fprintf(stderr, "%s", s);
-    free(s);
+    ta_free(s);
+  }
+
+  /* with option `glyph-subset', make sure that we can reuse data */
+  if (font->previous_buf)
+  {
+    error = TA_font_check_previous_TTFA(font);
+    if (error)
+      goto Err;
   }
 
   error = TA_control_build_tree(font);
   if (error)
     goto Err;
 
+  TA_memory_set_phase(memory, TA_MEMORY_PHASE_GLOBALS);
+
   /* loop again over subfonts and continue processing */
   for (i = 0; i < font->num_sfnts; i++)
   {
@@ -659,6 +843,14 @@ No_check:
       if (error)
         goto Err;
 
+      /* a context needs a face that can load replacement glyph data */
+      if (contextp)
+      {
+        error = TA_sfnt_open_incremental_face(sfnt, font);
+        if (error)
+          goto Err;
+      }
+
       /* we need the total number of points */
       /* for point delta instructions of composite glyphs; */
       /* we need composite point number sums */
@@ -726,6 +918,8 @@ No_check:
     SFNT* sfnt = &font->sfnts[i];
 
 
+    TA_memory_set_phase(memory, TA_MEMORY_PHASE_GLOBALS);
+
     error = ta_loader_init(font);
     if (error)
       goto Err;
@@ -744,7 +938,24 @@ No_check:
       error = TA_sfnt_build_prep_table(sfnt, font);
       if (error)
         goto Err;
+
+      if (font->previous_buf)
+      {
+        error = TA_sfnt_check_previous_tables(sfnt, font);
+        if (error)
+          goto Err;
+      }
+    }
+
+    /* glyphs get hinted later on with `TTF_autohint_glyph' */
+    if (contextp)
+    {
+      ta_loader_done(font);
+      continue;
     }
+
+    TA_memory_set_phase(memory, TA_MEMORY_PHASE_GLYPHS);
+
     error = TA_sfnt_build_glyf_table(sfnt, font);
     if (error)
       goto Err;
@@ -755,6 +966,22 @@ No_check:
     ta_loader_done(font);
   }
 
+  if (contextp)
+  {
+    error = TA_context_new(contextp, font, in_buf, control_buf, reference_buf);
+    if (error)
+      goto Err;
+
+    /* the context now owns `font' */
+    goto Err1;
+  }
+
+  TA_memory_set_phase(memory, TA_MEMORY_PHASE_OUTPUT);
+
+  error = TA_font_write_profile(font);
+  if (error)
+    goto Err;
+
   for (i = 0; i < font->num_sfnts; i++)
   {
     SFNT* sfnt = &font->sfnts[i];
@@ -814,11 +1041,28 @@ No_check:
   error = TA_Err_Ok;
 
 Err:
+#ifdef TA_DEBUG
+  _ta_debug_trace = NULL;
+#endif
+  {
+    int trace_error = TA_trace_done(&font->trace);
+
+
+    if (!error && trace_error)
+      error = (trace_error == TA_TRACE_ERR_MEMORY)
+                ? FT_Err_Out_Of_Memory
+                : TA_Err_Invalid_Stream_Write;
+  }
+
   TA_control_free(font->control);
   TA_control_free_tree(font);
-  TA_font_unload(font, in_buf, out_bufp, control_buf, reference_buf);
+  TA_font_unload(font, in_buf, out_bufp, control_buf, reference_buf,
+                 previous_buf);
 
 Err1:
+  if (error && memory && memory->limit_exceeded)
+    error = TA_Err_Memory_Limit;
+
   {
     FT_Error e = error;
 
@@ -835,6 +1079,9 @@ Err1:
       *error_stringp = (const unsigned char*)TA_get_error_message(e);
   }
 
+  /* the error callback is application code */
+  _ta_memory = saved_memory;
+
   if (err)
     err(error,
         error_string,
@@ -843,10 +1090,28 @@ Err1:
         errpos,
         err_data);
 
+  _ta_memory = memory;
+
   if (free_errline)
-    free(errline);
+    ta_free(errline);
   if (free_error_string)
-    free(error_string);
+    ta_free(error_string);
+
+  _ta_memory = saved_memory;
+
+  if (!memory)
+  {
+    if (memory_stats)
+      memset(memory_stats, 0, sizeof (TA_Memory_Stats));
+  }
+  else if (contextp && !error)
+  {
+    /* the context keeps the memory manager until it gets deallocated */
+    if (memory_stats)
+      TA_memory_get_stats(memory, memory_stats);
+  }
+  else
+    TA_memory_done(memory, memory_stats);
 
   return error;
 }